@@ -0,0 +1,474 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2026 agent
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <paludis/benchmarks/synthetic_tree.hh>
+
+#include <paludis/resolver/resolver.hh>
+#include <paludis/resolver/resolved.hh>
+#include <paludis/resolver/decisions.hh>
+#include <paludis/resolver/package_or_block_dep_spec.hh>
+#include <paludis/resolver/resolver_functions.hh>
+#include <paludis/resolver/suggest_restart.hh>
+#include <paludis/resolver/allow_choice_changes_helper.hh>
+#include <paludis/resolver/allowed_to_remove_helper.hh>
+#include <paludis/resolver/allowed_to_restart_helper.hh>
+#include <paludis/resolver/always_via_binary_helper.hh>
+#include <paludis/resolver/can_use_helper.hh>
+#include <paludis/resolver/confirm_helper.hh>
+#include <paludis/resolver/find_replacing_helper.hh>
+#include <paludis/resolver/find_repository_for_helper.hh>
+#include <paludis/resolver/get_constraints_for_dependent_helper.hh>
+#include <paludis/resolver/get_constraints_for_purge_helper.hh>
+#include <paludis/resolver/get_constraints_for_via_binary_helper.hh>
+#include <paludis/resolver/get_destination_types_for_blocker_helper.hh>
+#include <paludis/resolver/get_destination_types_for_error_helper.hh>
+#include <paludis/resolver/get_initial_constraints_for_helper.hh>
+#include <paludis/resolver/get_resolvents_for_helper.hh>
+#include <paludis/resolver/get_use_existing_nothing_helper.hh>
+#include <paludis/resolver/interest_in_spec_helper.hh>
+#include <paludis/resolver/make_destination_filtered_generator_helper.hh>
+#include <paludis/resolver/make_origin_filtered_generator_helper.hh>
+#include <paludis/resolver/make_unmaskable_filter_helper.hh>
+#include <paludis/resolver/order_early_helper.hh>
+#include <paludis/resolver/prefer_or_avoid_helper.hh>
+#include <paludis/resolver/promote_binaries_helper.hh>
+#include <paludis/resolver/remove_hidden_helper.hh>
+#include <paludis/resolver/remove_if_dependent_helper.hh>
+
+#include <paludis/repositories/fake/dep_parser.hh>
+
+#include <paludis/args/args.hh>
+#include <paludis/args/do_help.hh>
+
+#include <paludis/util/make_named_values.hh>
+#include <paludis/util/stringify.hh>
+#include <paludis/util/join.hh>
+#include <paludis/util/log.hh>
+#include <paludis/util/sequence.hh>
+
+#include <paludis/package_id.hh>
+#include <paludis/metadata_key.hh>
+#include <paludis/action.hh>
+#include <paludis/filter.hh>
+#include <paludis/version_spec.hh>
+#include <paludis/match_package.hh>
+#include <paludis/selection.hh>
+#include <paludis/generator.hh>
+#include <paludis/filtered_generator.hh>
+#include <paludis/user_dep_spec.hh>
+#include <paludis/serialise.hh>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+using namespace paludis;
+using namespace paludis::benchmarks;
+using namespace paludis::resolver;
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+namespace
+{
+    struct BenchmarksCommandLine :
+        args::ArgsHandler
+    {
+        std::string app_name() const override
+        {
+            return "paludis-benchmarks";
+        }
+
+        std::string app_synopsis() const override
+        {
+            return "Times Paludis operations on a synthetic repository.";
+        }
+
+        std::string app_description() const override
+        {
+            return "Generates a reproducible repository of fake packages, times the named benchmarks "
+                "(or all of them) against it, and writes the results as tab separated values.";
+        }
+
+        args::ArgsGroup g_tree_options;
+        args::IntegerArg a_ids;
+        args::IntegerArg a_seed;
+        args::IntegerArg a_versions;
+        args::IntegerArg a_chain_length;
+        args::IntegerArg a_deps;
+        args::IntegerArg a_choices;
+        args::IntegerArg a_slotted;
+        args::IntegerArg a_installed;
+        args::IntegerArg a_blockers;
+
+        args::ArgsGroup g_run_options;
+        args::IntegerArg a_targets;
+        args::IntegerArg a_repeat;
+        args::SwitchArg a_list;
+        args::SwitchArg a_help;
+
+        BenchmarksCommandLine() :
+            g_tree_options(main_options_section(), "Tree Options", "Control the generated repository."),
+            a_ids(&g_tree_options, "ids", 'n', "Create this many IDs (default 50000)"),
+            a_seed(&g_tree_options, "seed", 's', "Seed for the random number generator (default 1)"),
+            a_versions(&g_tree_options, "versions", '\0', "Versions of each package (default 4)"),
+            a_chain_length(&g_tree_options, "chain-length", '\0', "Packages in each dependency chain (default 20)"),
+            a_deps(&g_tree_options, "deps", '\0', "Most extra dependencies per ID (default 3)"),
+            a_choices(&g_tree_options, "choices", '\0', "Flags per ID (default 4)"),
+            a_slotted(&g_tree_options, "slotted-percent", '\0', "Percentage of slotted packages (default 20)"),
+            a_installed(&g_tree_options, "installed-percent", '\0', "Percentage of packages with an installed version (default 30)"),
+            a_blockers(&g_tree_options, "blocker-percent", '\0', "Percentage of dependencies with a blocker (default 5)"),
+            g_run_options(main_options_section(), "Run Options", "Control what is timed."),
+            a_targets(&g_run_options, "targets", 't', "Resolve this many chain heads at once (default 5)"),
+            a_repeat(&g_run_options, "repeat", 'r', "Run each benchmark this many times (default 3)"),
+            a_list(&g_run_options, "list", 'l', "List the available benchmarks", true),
+            a_help(&g_run_options, "help", 'h', "Display help message", false)
+        {
+            a_ids.set_argument(50000);
+            a_seed.set_argument(1);
+            a_versions.set_argument(4);
+            a_chain_length.set_argument(20);
+            a_deps.set_argument(3);
+            a_choices.set_argument(4);
+            a_slotted.set_argument(20);
+            a_installed.set_argument(30);
+            a_blockers.set_argument(5);
+            a_targets.set_argument(5);
+            a_repeat.set_argument(3);
+
+            add_usage_line("[ --ids n ] [ --seed n ] [ --repeat n ] [ benchmark ... ]");
+        }
+    };
+
+    /* the same helpers and options as the resolver's own tests use */
+    struct ResolverData
+    {
+        AllowChoiceChangesHelper allow_choice_changes_helper;
+        AllowedToRemoveHelper allowed_to_remove_helper;
+        AllowedToRestartHelper allowed_to_restart_helper;
+        AlwaysViaBinaryHelper always_via_binary_helper;
+        CanUseHelper can_use_helper;
+        ConfirmHelper confirm_helper;
+        FindReplacingHelper find_replacing_helper;
+        FindRepositoryForHelper find_repository_for_helper;
+        GetConstraintsForDependentHelper get_constraints_for_dependent_helper;
+        GetConstraintsForPurgeHelper get_constraints_for_purge_helper;
+        GetConstraintsForViaBinaryHelper get_constraints_for_via_binary_helper;
+        GetDestinationTypesForBlockerHelper get_destination_types_for_blocker_helper;
+        GetDestinationTypesForErrorHelper get_destination_types_for_error_helper;
+        GetInitialConstraintsForHelper get_initial_constraints_for_helper;
+        GetUseExistingNothingHelper get_use_existing_nothing_helper;
+        InterestInSpecHelper interest_in_spec_helper;
+        MakeDestinationFilteredGeneratorHelper make_destination_filtered_generator_helper;
+        MakeOriginFilteredGeneratorHelper make_origin_filtered_generator_helper;
+        MakeUnmaskableFilterHelper make_unmaskable_filter_helper;
+        OrderEarlyHelper order_early_helper;
+        PreferOrAvoidHelper prefer_or_avoid_helper;
+        PromoteBinariesHelper promote_binaries_helper;
+        RemoveHiddenHelper remove_hidden_helper;
+        RemoveIfDependentHelper remove_if_dependent_helper;
+        GetResolventsForHelper get_resolvents_for_helper;
+
+        ResolverData(const Environment * const env) :
+            allow_choice_changes_helper(env),
+            allowed_to_remove_helper(env),
+            allowed_to_restart_helper(env),
+            always_via_binary_helper(env),
+            can_use_helper(env),
+            confirm_helper(env),
+            find_replacing_helper(env),
+            find_repository_for_helper(env),
+            get_constraints_for_dependent_helper(env),
+            get_constraints_for_purge_helper(env),
+            get_constraints_for_via_binary_helper(env),
+            get_destination_types_for_blocker_helper(env),
+            get_destination_types_for_error_helper(env),
+            get_initial_constraints_for_helper(env),
+            get_use_existing_nothing_helper(env),
+            interest_in_spec_helper(env),
+            make_destination_filtered_generator_helper(env),
+            make_origin_filtered_generator_helper(env),
+            make_unmaskable_filter_helper(env),
+            order_early_helper(env),
+            prefer_or_avoid_helper(env),
+            promote_binaries_helper(env),
+            remove_hidden_helper(env),
+            remove_if_dependent_helper(env),
+            get_resolvents_for_helper(env, std::cref(remove_hidden_helper))
+        {
+            interest_in_spec_helper.set_follow_installed_dependencies(true);
+            interest_in_spec_helper.set_follow_installed_build_dependencies(true);
+            make_unmaskable_filter_helper.set_override_masks(false);
+        }
+
+        ResolverFunctions functions()
+        {
+            return make_named_values<ResolverFunctions>(
+                    n::allow_choice_changes_fn() = std::cref(allow_choice_changes_helper),
+                    n::allowed_to_remove_fn() = std::cref(allowed_to_remove_helper),
+                    n::allowed_to_restart_fn() = std::cref(allowed_to_restart_helper),
+                    n::always_via_binary_fn() = std::cref(always_via_binary_helper),
+                    n::can_use_fn() = std::cref(can_use_helper),
+                    n::confirm_fn() = std::cref(confirm_helper),
+                    n::find_replacing_fn() = std::cref(find_replacing_helper),
+                    n::find_repository_for_fn() = std::cref(find_repository_for_helper),
+                    n::get_constraints_for_dependent_fn() = std::cref(get_constraints_for_dependent_helper),
+                    n::get_constraints_for_purge_fn() = std::cref(get_constraints_for_purge_helper),
+                    n::get_constraints_for_via_binary_fn() = std::cref(get_constraints_for_via_binary_helper),
+                    n::get_destination_types_for_blocker_fn() = std::cref(get_destination_types_for_blocker_helper),
+                    n::get_destination_types_for_error_fn() = std::cref(get_destination_types_for_error_helper),
+                    n::get_initial_constraints_for_fn() = std::cref(get_initial_constraints_for_helper),
+                    n::get_resolvents_for_fn() = std::cref(get_resolvents_for_helper),
+                    n::get_use_existing_nothing_fn() = std::cref(get_use_existing_nothing_helper),
+                    n::interest_in_spec_fn() = std::cref(interest_in_spec_helper),
+                    n::make_destination_filtered_generator_fn() = std::cref(make_destination_filtered_generator_helper),
+                    n::make_origin_filtered_generator_fn() = std::cref(make_origin_filtered_generator_helper),
+                    n::make_unmaskable_filter_fn() = std::cref(make_unmaskable_filter_helper),
+                    n::order_early_fn() = std::cref(order_early_helper),
+                    n::prefer_or_avoid_fn() = std::cref(prefer_or_avoid_helper),
+                    n::promote_binaries_fn() = std::cref(promote_binaries_helper),
+                    n::remove_hidden_fn() = std::cref(remove_hidden_helper),
+                    n::remove_if_dependent_fn() = std::cref(remove_if_dependent_helper)
+                    );
+        }
+    };
+
+    struct BenchmarkState
+    {
+        SyntheticTree & tree;
+        const BenchmarksCommandLine & cmdline;
+        std::shared_ptr<const Resolved> resolved;
+    };
+
+    /* each benchmark returns how many things it did, so that results for
+     * different tree sizes can be compared */
+    typedef std::function<unsigned long (BenchmarkState &)> BenchmarkFunction;
+
+    template <typename T_>
+    unsigned long count(const std::shared_ptr<T_> & s)
+    {
+        return std::distance(s->begin(), s->end());
+    }
+
+    unsigned long benchmark_parse(BenchmarkState & state)
+    {
+        unsigned long result(0);
+        for (const auto & s : state.tree.dependency_strings())
+            if (fakerepository::parse_depend(s, &state.tree.environment()))
+                ++result;
+        return result;
+    }
+
+    unsigned long benchmark_match(BenchmarkState & state)
+    {
+        const auto & ids(state.tree.ids());
+        unsigned long step(std::max<unsigned long>(1, ids.size() / 1000)), result(0);
+
+        for (const auto & spec : state.tree.specs())
+            for (unsigned long i(0) ; i < ids.size() ; i += step)
+            {
+                if (match_package(state.tree.environment(), spec, ids[i], nullptr, { }))
+                    ++result;
+            }
+
+        return result;
+    }
+
+    unsigned long benchmark_versions(BenchmarkState & state)
+    {
+        std::vector<VersionSpec> versions;
+        for (const auto & id : state.tree.ids())
+            versions.push_back(id->version());
+
+        std::mt19937 random(state.cmdline.a_seed.argument());
+        std::shuffle(versions.begin(), versions.end(), random);
+        std::sort(versions.begin(), versions.end());
+        return versions.size();
+    }
+
+    unsigned long benchmark_select(BenchmarkState & state)
+    {
+        Environment & env(state.tree.environment());
+        unsigned long result(0);
+
+        for (const auto & spec : state.tree.specs())
+        {
+            result += count(env[selection::AllVersionsSorted(generator::Matches(spec, nullptr, { }))]);
+            result += count(env[selection::BestVersionOnly(generator::Matches(spec, nullptr, { }) | filter::SupportsAction<InstallAction>())]);
+        }
+
+        result += count(env[selection::AllVersionsGroupedBySlot(generator::All() | filter::InstalledAtRoot(env.system_root_key()->parse_value()))]);
+        return result;
+    }
+
+    unsigned long benchmark_resolve(BenchmarkState & state)
+    {
+        Environment & env(state.tree.environment());
+        const auto & heads(state.tree.chain_heads());
+        unsigned long n_targets(std::min<unsigned long>(heads.size(), std::max(1, state.cmdline.a_targets.argument())));
+
+        ResolverData data(&env);
+        while (true)
+        {
+            try
+            {
+                Resolver resolver(&env, data.functions());
+                for (unsigned long t(0) ; t < n_targets ; ++t)
+                    resolver.add_target(PackageOrBlockDepSpec(parse_user_package_dep_spec(heads[t], &env, { })), "");
+                resolver.resolve();
+                state.resolved = resolver.resolved();
+                break;
+            }
+            catch (const SuggestRestart & e)
+            {
+                data.get_initial_constraints_for_helper.add_suggested_restart(e);
+            }
+        }
+
+        return count(state.resolved->taken_change_or_remove_decisions());
+    }
+
+    unsigned long benchmark_serialise(BenchmarkState & state)
+    {
+        if (! state.resolved)
+            benchmark_resolve(state);
+
+        std::stringstream str;
+        Serialiser ser(str);
+        state.resolved->serialise(ser);
+
+        Deserialiser deser(&state.tree.environment(), str);
+        Deserialisation desern("Resolved", deser);
+        return count(Resolved::deserialise(desern).taken_change_or_remove_decisions());
+    }
+
+    const std::vector<std::pair<std::string, BenchmarkFunction> > all_benchmarks = {
+        { "parse",      &benchmark_parse },
+        { "match",      &benchmark_match },
+        { "versions",   &benchmark_versions },
+        { "select",     &benchmark_select },
+        { "resolve",    &benchmark_resolve },
+        { "serialise",  &benchmark_serialise }
+    };
+
+    void show(const std::string & name, const int iteration, const unsigned long items,
+            const std::chrono::steady_clock::duration & d)
+    {
+        cout << name << "\t" << iteration << "\t" << items << "\t"
+            << std::chrono::duration_cast<std::chrono::microseconds>(d).count() << endl;
+    }
+}
+
+int
+main(int argc, char * argv[])
+{
+    try
+    {
+        BenchmarksCommandLine cmdline;
+        cmdline.run(argc, argv, "paludis-benchmarks", "PALUDIS_BENCHMARKS_OPTIONS", "PALUDIS_BENCHMARKS_CMDLINE");
+
+        if (cmdline.a_help.specified())
+        {
+            cout << cmdline;
+            return EXIT_SUCCESS;
+        }
+
+        if (cmdline.a_list.specified())
+        {
+            for (const auto & b : all_benchmarks)
+                cout << b.first << endl;
+            return EXIT_SUCCESS;
+        }
+
+        std::vector<std::pair<std::string, BenchmarkFunction> > wanted;
+        for (const auto & p : cmdline.parameters())
+        {
+            auto b(std::find_if(all_benchmarks.begin(), all_benchmarks.end(),
+                        [&] (const std::pair<std::string, BenchmarkFunction> & x) { return x.first == p; }));
+            if (b == all_benchmarks.end())
+                throw args::DoHelp("No benchmark named '" + p + "'");
+            wanted.push_back(*b);
+        }
+
+        if (wanted.empty())
+            wanted = all_benchmarks;
+
+        Log::get_instance()->set_log_level(ll_warning);
+
+        auto params(make_named_values<SyntheticTreeParams>(
+                    n::blocker_percent() = cmdline.a_blockers.argument(),
+                    n::chain_length() = cmdline.a_chain_length.argument(),
+                    n::choices_per_id() = cmdline.a_choices.argument(),
+                    n::deps_per_id() = cmdline.a_deps.argument(),
+                    n::installed_percent() = cmdline.a_installed.argument(),
+                    n::number_of_ids() = cmdline.a_ids.argument(),
+                    n::seed() = unsigned(cmdline.a_seed.argument()),
+                    n::slotted_percent() = cmdline.a_slotted.argument(),
+                    n::versions_per_package() = cmdline.a_versions.argument()
+                    ));
+
+        cout << "# ids=" << params.number_of_ids() << " seed=" << params.seed()
+            << " versions=" << params.versions_per_package() << " chain-length=" << params.chain_length()
+            << " deps=" << params.deps_per_id() << " choices=" << params.choices_per_id()
+            << " slotted-percent=" << params.slotted_percent() << " installed-percent=" << params.installed_percent()
+            << " blocker-percent=" << params.blocker_percent() << " targets=" << cmdline.a_targets.argument() << endl;
+        cout << "benchmark\titeration\titems\tmicroseconds" << endl;
+
+        auto start(std::chrono::steady_clock::now());
+        SyntheticTree tree(params);
+        show("generate", 0, tree.ids().size(), std::chrono::steady_clock::now() - start);
+
+        BenchmarkState state{ tree, cmdline, nullptr };
+        for (const auto & b : wanted)
+            for (int i(0) ; i < std::max(1, cmdline.a_repeat.argument()) ; ++i)
+            {
+                start = std::chrono::steady_clock::now();
+                unsigned long items(b.second(state));
+                show(b.first, i, items, std::chrono::steady_clock::now() - start);
+            }
+
+        return EXIT_SUCCESS;
+    }
+    catch (const args::ArgsError & e)
+    {
+        cerr << "Usage error: " << e.message() << endl;
+        cerr << "Try " << argv[0] << " --help" << endl;
+        return EXIT_FAILURE;
+    }
+    catch (const args::DoHelp & h)
+    {
+        cerr << "Usage error: " << h.message << endl;
+        cerr << "Try " << argv[0] << " --help" << endl;
+        return EXIT_FAILURE;
+    }
+    catch (const Exception & e)
+    {
+        cerr << endl;
+        cerr << "Error:" << endl;
+        cerr << "  * " << e.backtrace("\n  * ") << e.message() << " (" << e.what() << ")" << endl;
+        cerr << endl;
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,301 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2026 agent
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <paludis/benchmarks/synthetic_tree.hh>
+#include <paludis/util/pimp-impl.hh>
+#include <paludis/util/stringify.hh>
+#include <paludis/util/make_named_values.hh>
+#include <paludis/util/indirect_iterator-impl.hh>
+#include <paludis/util/visitor.hh>
+#include <paludis/repositories/fake/fake_package_id.hh>
+#include <paludis/user_dep_spec.hh>
+#include <paludis/dep_spec.hh>
+#include <paludis/dep_spec_annotations.hh>
+#include <paludis/spec_tree.hh>
+#include <paludis/name.hh>
+#include <paludis/slot.hh>
+#include <algorithm>
+#include <random>
+
+using namespace paludis;
+using namespace paludis::benchmarks;
+
+namespace
+{
+    const int number_of_categories(50);
+
+    /* no hyphens, so that nothing looks like a version */
+    std::string category_of(const int p)
+    {
+        return "cat" + stringify(p % number_of_categories);
+    }
+
+    std::string package_of(const int p)
+    {
+        return "pkg" + stringify(p);
+    }
+
+    std::string qpn_of(const int p)
+    {
+        return category_of(p) + "/" + package_of(p);
+    }
+
+    /* the fake repository doesn't say what kind of block a blocker is, and
+     * the resolver needs to know, so we treat them all like an EAPI without
+     * !! does. the specs were only just created by parsing our string, so
+     * nobody else can have seen them yet. */
+    struct BlockerAnnotator
+    {
+        const std::shared_ptr<DepSpecAnnotations> annotations;
+
+        BlockerAnnotator() :
+            annotations(std::make_shared<DepSpecAnnotations>())
+        {
+            annotations->add(make_named_values<DepSpecAnnotation>(
+                        n::key() = "<resolution>",
+                        n::kind() = dsak_synthetic,
+                        n::role() = dsar_blocker_strong,
+                        n::value() = "<implicit-strong>"
+                        ));
+        }
+
+        void visit(const DependencySpecTree::NodeType<BlockDepSpec>::Type & node)
+        {
+            std::const_pointer_cast<BlockDepSpec>(node.spec())->set_annotations(annotations);
+        }
+
+        void visit(const DependencySpecTree::NodeType<PackageDepSpec>::Type &)
+        {
+        }
+
+        void visit(const DependencySpecTree::NodeType<NamedSetDepSpec>::Type &)
+        {
+        }
+
+        void visit(const DependencySpecTree::NodeType<DependenciesLabelsDepSpec>::Type &)
+        {
+        }
+
+        void visit(const DependencySpecTree::NodeType<ConditionalDepSpec>::Type & node)
+        {
+            std::for_each(indirect_iterator(node.begin()), indirect_iterator(node.end()), accept_visitor(*this));
+        }
+
+        void visit(const DependencySpecTree::NodeType<AnyDepSpec>::Type & node)
+        {
+            std::for_each(indirect_iterator(node.begin()), indirect_iterator(node.end()), accept_visitor(*this));
+        }
+
+        void visit(const DependencySpecTree::NodeType<AllDepSpec>::Type & node)
+        {
+            std::for_each(indirect_iterator(node.begin()), indirect_iterator(node.end()), accept_visitor(*this));
+        }
+    };
+}
+
+namespace paludis
+{
+    template <>
+    struct Imp<SyntheticTree>
+    {
+        SyntheticTreeParams params;
+        std::mt19937 random;
+
+        TestEnvironment env;
+        std::shared_ptr<FakeRepository> repo;
+        std::shared_ptr<FakeInstalledRepository> installed_repo;
+
+        int number_of_packages;
+        std::vector<bool> slotted;
+
+        std::vector<std::shared_ptr<const PackageID> > ids;
+        std::vector<std::string> dependency_strings;
+        std::vector<PackageDepSpec> specs;
+        std::vector<std::string> chain_heads;
+
+        BlockerAnnotator blocker_annotator;
+
+        Imp(const SyntheticTreeParams & p) :
+            params(p),
+            random(p.seed()),
+            repo(std::make_shared<FakeRepository>(make_named_values<FakeRepositoryParams>(
+                            n::environment() = &env,
+                            n::name() = RepositoryName("synthetic")
+                            ))),
+            installed_repo(std::make_shared<FakeInstalledRepository>(make_named_values<FakeInstalledRepositoryParams>(
+                            n::environment() = &env,
+                            n::name() = RepositoryName("installed"),
+                            n::suitable_destination() = true,
+                            n::supports_uninstall() = true
+                            ))),
+            number_of_packages(std::max(1, p.number_of_ids() / std::max(1, p.versions_per_package())))
+        {
+            params.chain_length() = std::max(1, params.chain_length());
+            params.versions_per_package() = std::max(1, params.versions_per_package());
+
+            env.add_repository(1, repo);
+            env.add_repository(2, installed_repo);
+        }
+
+        int percent()
+        {
+            return std::uniform_int_distribution<int>(0, 99)(random);
+        }
+
+        int pick(const int from, const int to)
+        {
+            return std::uniform_int_distribution<int>(from, to)(random);
+        }
+
+        std::string slot_dep(const int q)
+        {
+            return slotted[q] ? qpn_of(q) + ":" + stringify(pick(1, params.versions_per_package())) : qpn_of(q);
+        }
+
+        std::string make_dependencies(const int p)
+        {
+            std::string result;
+
+            /* the rest of our chain */
+            if (p + 1 < number_of_packages && 0 != (p + 1) % params.chain_length())
+                result.append(qpn_of(p + 1) + " ");
+
+            /* anything we depend upon is further along, so there are no cycles */
+            if (p + 2 < number_of_packages)
+                for (int d(pick(0, params.deps_per_id())) ; d > 0 ; --d)
+                {
+                    int q(pick(p + 2, std::min(number_of_packages - 1, p + 2 + 1000)));
+                    int r(percent());
+
+                    if (r < 40)
+                        result.append(qpn_of(q));
+                    else if (r < 60)
+                        result.append(">=" + qpn_of(q) + "-" + stringify(pick(1, params.versions_per_package())));
+                    else if (r < 70)
+                        result.append(slot_dep(q));
+                    else if (r < 85 && 0 != params.choices_per_id())
+                        result.append("f" + stringify(pick(0, params.choices_per_id() - 1)) + "? ( " + qpn_of(q) + " )");
+                    else
+                        result.append("|| ( " + qpn_of(q) + " " + qpn_of(pick(p + 2, number_of_packages - 1)) + " )");
+                    result.append(" ");
+
+                    /* never matches anything, but still has to be checked */
+                    if (percent() < params.blocker_percent())
+                        result.append("!<" + qpn_of(q) + "-1 ");
+                }
+
+            return result;
+        }
+
+        void make_id(FakeRepositoryBase & r, const int p, const int v, const std::string & deps)
+        {
+            auto id(r.add_version(category_of(p), package_of(p), stringify(v)));
+            id->set_slot(SlotName(slotted[p] ? stringify(v) : "0"));
+            id->build_dependencies_key()->set_from_string(deps);
+            id->run_dependencies_key()->set_from_string(deps);
+            id->build_dependencies_key()->parse_value()->top()->accept(blocker_annotator);
+            id->run_dependencies_key()->parse_value()->top()->accept(blocker_annotator);
+            for (int c(0) ; c < params.choices_per_id() ; ++c)
+                id->choices_key()->add("", "f" + stringify(c));
+
+            if (&r == repo.get())
+            {
+                ids.push_back(id);
+                dependency_strings.push_back(deps);
+            }
+        }
+
+        void generate()
+        {
+            for (int p(0) ; p < number_of_packages ; ++p)
+                slotted.push_back(percent() < params.slotted_percent());
+
+            for (int p(0) ; p < number_of_packages ; ++p)
+            {
+                if (0 == p % params.chain_length())
+                    chain_heads.push_back(qpn_of(p));
+
+                for (int v(1) ; v <= params.versions_per_package() ; ++v)
+                    make_id(*repo, p, v, make_dependencies(p));
+
+                if (percent() < params.installed_percent())
+                    make_id(*installed_repo, p, 1, make_dependencies(p));
+            }
+
+            for (int s(0) ; s < 1000 ; ++s)
+            {
+                int q(pick(0, number_of_packages - 1));
+                int r(percent());
+                std::string spec;
+                if (r < 50)
+                    spec = qpn_of(q);
+                else if (r < 80)
+                    spec = ">=" + qpn_of(q) + "-" + stringify(pick(1, params.versions_per_package()));
+                else
+                    spec = slot_dep(q);
+
+                specs.push_back(parse_user_package_dep_spec(spec, &env, { }));
+            }
+        }
+    };
+}
+
+SyntheticTree::SyntheticTree(const SyntheticTreeParams & p) :
+    _imp(p)
+{
+    _imp->generate();
+}
+
+SyntheticTree::~SyntheticTree() = default;
+
+TestEnvironment &
+SyntheticTree::environment()
+{
+    return _imp->env;
+}
+
+const std::vector<std::shared_ptr<const PackageID> > &
+SyntheticTree::ids() const
+{
+    return _imp->ids;
+}
+
+const std::vector<std::string> &
+SyntheticTree::dependency_strings() const
+{
+    return _imp->dependency_strings;
+}
+
+const std::vector<PackageDepSpec> &
+SyntheticTree::specs() const
+{
+    return _imp->specs;
+}
+
+const std::vector<std::string> &
+SyntheticTree::chain_heads() const
+{
+    return _imp->chain_heads;
+}
+
+namespace paludis
+{
+    template class Pimp<benchmarks::SyntheticTree>;
+}
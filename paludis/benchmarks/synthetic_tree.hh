@@ -0,0 +1,134 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2026 agent
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef PALUDIS_GUARD_PALUDIS_BENCHMARKS_SYNTHETIC_TREE_HH
+#define PALUDIS_GUARD_PALUDIS_BENCHMARKS_SYNTHETIC_TREE_HH 1
+
+#include <paludis/util/named_value.hh>
+#include <paludis/util/pimp.hh>
+#include <paludis/environments/test/test_environment.hh>
+#include <paludis/repositories/fake/fake_repository.hh>
+#include <paludis/repositories/fake/fake_installed_repository.hh>
+#include <paludis/package_id-fwd.hh>
+#include <paludis/dep_spec-fwd.hh>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace paludis
+{
+    namespace n
+    {
+        typedef Name<struct name_blocker_percent> blocker_percent;
+        typedef Name<struct name_chain_length> chain_length;
+        typedef Name<struct name_choices_per_id> choices_per_id;
+        typedef Name<struct name_deps_per_id> deps_per_id;
+        typedef Name<struct name_installed_percent> installed_percent;
+        typedef Name<struct name_number_of_ids> number_of_ids;
+        typedef Name<struct name_seed> seed;
+        typedef Name<struct name_slotted_percent> slotted_percent;
+        typedef Name<struct name_versions_per_package> versions_per_package;
+    }
+
+    namespace benchmarks
+    {
+        /**
+         * The shape of a SyntheticTree. The same parameters always give the
+         * same tree.
+         */
+        struct SyntheticTreeParams
+        {
+            /// Roughly how many dependencies mention a blocker.
+            NamedValue<n::blocker_percent, int> blocker_percent;
+
+            /// Packages come in chains this long, each depending upon the next.
+            NamedValue<n::chain_length, int> chain_length;
+
+            /// How many flags each ID has.
+            NamedValue<n::choices_per_id, int> choices_per_id;
+
+            /// The most dependencies each ID has, not counting its chain.
+            NamedValue<n::deps_per_id, int> deps_per_id;
+
+            /// Roughly how many packages have an older version installed.
+            NamedValue<n::installed_percent, int> installed_percent;
+
+            /// How many IDs to create, across every version of every package.
+            NamedValue<n::number_of_ids, int> number_of_ids;
+
+            NamedValue<n::seed, unsigned> seed;
+
+            /// Roughly how many packages have a slot for each version.
+            NamedValue<n::slotted_percent, int> slotted_percent;
+
+            NamedValue<n::versions_per_package, int> versions_per_package;
+        };
+
+        /**
+         * A TestEnvironment with a FakeRepository and a FakeInstalledRepository
+         * full of randomly generated, but reproducible, packages.
+         *
+         * Dependencies only ever point further along the list of packages,
+         * so the tree has no cycles, and the first package in each chain has
+         * the deepest dependencies.
+         */
+        class SyntheticTree
+        {
+            private:
+                Pimp<SyntheticTree> _imp;
+
+            public:
+                explicit SyntheticTree(const SyntheticTreeParams &);
+                ~SyntheticTree();
+
+                SyntheticTree(const SyntheticTree &) = delete;
+                SyntheticTree & operator= (const SyntheticTree &) = delete;
+
+                TestEnvironment & environment() PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                /**
+                 * Every ID in the repository, in the order in which they were
+                 * created.
+                 */
+                const std::vector<std::shared_ptr<const PackageID> > & ids() const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                /**
+                 * The dependency strings given to ids(), in the same order.
+                 */
+                const std::vector<std::string> & dependency_strings() const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                /**
+                 * Some specs of the kinds used in dependencies, for matching
+                 * against.
+                 */
+                const std::vector<PackageDepSpec> & specs() const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                /**
+                 * Packages at the start of a chain, which make good resolution
+                 * targets.
+                 */
+                const std::vector<std::string> & chain_heads() const PALUDIS_ATTRIBUTE((warn_unused_result));
+        };
+    }
+
+    extern template class Pimp<benchmarks::SyntheticTree>;
+}
+
+#endif
@@ -33,7 +33,8 @@
 #include <paludis/util/member_iterator-impl.hh>
 #include <paludis/util/indirect_iterator-impl.hh>
 #include <paludis/util/fs_stat.hh>
-#include <paludis/util/fs_iterator.hh>
+#include <paludis/util/fs_dir_walker.hh>
+#include <paludis/util/options.hh>
 #include <paludis/util/fs_error.hh>
 #include <paludis/util/join.hh>
 
@@ -84,7 +85,7 @@ namespace paludis
         void search_directory(const FSPath &);
 
         void walk_directory(const FSPath &);
-        void check_file(const FSPath &);
+        void check_file(const FSDirEntry &);
 
         void add_breakage(const FSPath &, const std::string &);
         void gather_package(const std::shared_ptr<const PackageID> &);
@@ -238,7 +239,7 @@ Imp<BrokenLinkageFinder>::walk_directory(const FSPath & directory)
 
     try
     {
-        std::for_each(FSIterator(directory, { fsio_include_dotfiles, fsio_inode_sort }), FSIterator(),
+        FSDirWalker(directory).walk({ fsio_include_dotfiles, fsio_inode_sort },
                 std::bind(&Imp<BrokenLinkageFinder>::check_file, this, _1));
     }
     catch (const FSError & ex)
@@ -248,15 +249,15 @@ Imp<BrokenLinkageFinder>::walk_directory(const FSPath & directory)
 }
 
 void
-Imp<BrokenLinkageFinder>::check_file(const FSPath & file)
+Imp<BrokenLinkageFinder>::check_file(const FSDirEntry & entry)
 {
     using namespace std::placeholders;
 
     try
     {
-        FSStat file_stat(file);
+        FSPath file(entry.path());
 
-        if (file_stat.is_symlink())
+        if (entry.is_symlink())
         {
             FSPath target(dereference_with_root(file, env->preferred_root_key()->parse_value()));
             if (target.stat().is_regular_file())
@@ -266,10 +267,10 @@ Imp<BrokenLinkageFinder>::check_file(const FSPath & file)
             }
         }
 
-        else if (file_stat.is_directory())
+        else if (entry.is_directory())
             walk_directory(file);
 
-        else if (file_stat.is_regular_file())
+        else if (entry.is_regular_file())
         {
             env->trigger_notifier_callback(NotifierCallbackLinkageStepEvent(file));
 
@@ -0,0 +1,277 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2026 agent
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <paludis/columnar_query.hh>
+#include <paludis/environment.hh>
+#include <paludis/selection.hh>
+#include <paludis/package_id.hh>
+#include <paludis/metadata_key.hh>
+#include <paludis/name.hh>
+#include <paludis/slot.hh>
+#include <paludis/version_spec.hh>
+#include <paludis/unformatted_pretty_printer.hh>
+#include <paludis/util/pimp-impl.hh>
+#include <paludis/util/sequence.hh>
+#include <paludis/util/wrapped_forward_iterator.hh>
+#include <paludis/util/stringify.hh>
+#include <paludis/util/timestamp.hh>
+#include <paludis/util/fs_path.hh>
+#include <vector>
+
+using namespace paludis;
+
+namespace
+{
+    enum SpecialField
+    {
+        sf_id,
+        sf_name,
+        sf_category,
+        sf_package,
+        sf_version,
+        sf_slot,
+        sf_repository,
+        sf_masked,
+        sf_key
+    };
+
+    SpecialField special_field(const std::string & f)
+    {
+        if (f == "id")
+            return sf_id;
+        else if (f == "name")
+            return sf_name;
+        else if (f == "category")
+            return sf_category;
+        else if (f == "package")
+            return sf_package;
+        else if (f == "version")
+            return sf_version;
+        else if (f == "slot")
+            return sf_slot;
+        else if (f == "repository")
+            return sf_repository;
+        else if (f == "masked")
+            return sf_masked;
+        else
+            return sf_key;
+    }
+
+    struct ValueGetter
+    {
+        std::string value;
+        bool has_value;
+
+        ValueGetter() :
+            has_value(true)
+        {
+        }
+
+        void visit(const MetadataTimeKey & k)
+        {
+            value = stringify(k.parse_value().seconds());
+        }
+
+        void visit(const MetadataValueKey<std::shared_ptr<const Choices> > &)
+        {
+            has_value = false;
+        }
+
+        void visit(const MetadataSectionKey &)
+        {
+            has_value = false;
+        }
+
+        void visit(const MetadataValueKey<std::shared_ptr<const PackageID> > & k)
+        {
+            value = stringify(*k.parse_value());
+        }
+
+        void visit(const MetadataValueKey<FSPath> & k)
+        {
+            value = stringify(k.parse_value());
+        }
+
+        void visit(const MetadataValueKey<bool> & k)
+        {
+            value = k.parse_value() ? "true" : "false";
+        }
+
+        void visit(const MetadataValueKey<long> & k)
+        {
+            value = stringify(k.parse_value());
+        }
+
+        void visit(const MetadataValueKey<std::string> & k)
+        {
+            value = k.parse_value();
+        }
+
+        void visit(const MetadataValueKey<Slot> & k)
+        {
+            value = k.parse_value().raw_value();
+        }
+
+        /* everything else is a spec tree or a collection */
+        template <typename T_>
+        void visit(const T_ & k)
+        {
+            value = k.pretty_print_value(UnformattedPrettyPrinter(), { });
+        }
+    };
+
+    struct Column
+    {
+        std::string field;
+        SpecialField special;
+        std::vector<std::string> values;
+        std::vector<bool> has_values;
+    };
+}
+
+namespace paludis
+{
+    template <>
+    struct Imp<ColumnarQuery>
+    {
+        unsigned number_of_rows;
+        std::vector<Column> columns;
+
+        Imp() :
+            number_of_rows(0)
+        {
+        }
+    };
+}
+
+ColumnarQuery::ColumnarQuery(const Environment & env, const Selection & selection,
+        const std::shared_ptr<const Sequence<std::string> > & fields) :
+    _imp()
+{
+    Context context("When running columnar query for '" + selection.as_string() + "':");
+
+    for (const auto & f : *fields)
+        _imp->columns.push_back(Column{ f, special_field(f), { }, { } });
+
+    auto ids(env[selection]);
+    for (const auto & id : *ids)
+    {
+        ++_imp->number_of_rows;
+
+        for (auto & c : _imp->columns)
+        {
+            std::string value;
+            bool has_value(true);
+
+            switch (c.special)
+            {
+                case sf_id:
+                    value = stringify(*id);
+                    break;
+
+                case sf_name:
+                    value = stringify(id->name());
+                    break;
+
+                case sf_category:
+                    value = stringify(id->name().category());
+                    break;
+
+                case sf_package:
+                    value = stringify(id->name().package());
+                    break;
+
+                case sf_version:
+                    value = stringify(id->version());
+                    break;
+
+                case sf_slot:
+                    if (id->slot_key())
+                        value = id->slot_key()->parse_value().raw_value();
+                    else
+                        has_value = false;
+                    break;
+
+                case sf_repository:
+                    value = stringify(id->repository_name());
+                    break;
+
+                case sf_masked:
+                    value = id->masked() ? "true" : "false";
+                    break;
+
+                case sf_key:
+                    {
+                        auto k(id->find_metadata(c.field));
+                        if (id->end_metadata() == k)
+                            has_value = false;
+                        else
+                        {
+                            ValueGetter v;
+                            (*k)->accept(v);
+                            value = v.value;
+                            has_value = v.has_value;
+                        }
+                    }
+                    break;
+            }
+
+            c.values.push_back(value);
+            c.has_values.push_back(has_value);
+        }
+    }
+}
+
+ColumnarQuery::~ColumnarQuery() = default;
+
+unsigned
+ColumnarQuery::number_of_rows() const
+{
+    return _imp->number_of_rows;
+}
+
+unsigned
+ColumnarQuery::number_of_columns() const
+{
+    return _imp->columns.size();
+}
+
+const std::string &
+ColumnarQuery::field(const unsigned column) const
+{
+    return _imp->columns.at(column).field;
+}
+
+bool
+ColumnarQuery::has_value(const unsigned column, const unsigned row) const
+{
+    return _imp->columns.at(column).has_values.at(row);
+}
+
+const std::string &
+ColumnarQuery::value(const unsigned column, const unsigned row) const
+{
+    return _imp->columns.at(column).values.at(row);
+}
+
+namespace paludis
+{
+    template class Pimp<ColumnarQuery>;
+}
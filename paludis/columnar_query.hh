@@ -0,0 +1,102 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2026 agent
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef PALUDIS_GUARD_PALUDIS_COLUMNAR_QUERY_HH
+#define PALUDIS_GUARD_PALUDIS_COLUMNAR_QUERY_HH 1
+
+#include <paludis/columnar_query-fwd.hh>
+#include <paludis/environment-fwd.hh>
+#include <paludis/selection-fwd.hh>
+#include <paludis/util/attributes.hh>
+#include <paludis/util/pimp.hh>
+#include <paludis/util/sequence-fwd.hh>
+#include <memory>
+#include <string>
+
+/** \file
+ * Declarations for paludis::ColumnarQuery.
+ *
+ * \ingroup g_environment
+ */
+
+namespace paludis
+{
+    /**
+     * Runs a Selection and fetches some fields of every ID it returns, so
+     * that callers such as the language bindings can get at lots of IDs
+     * without handling each one individually.
+     *
+     * A field is one of the special names \c id, \c name, \c category,
+     * \c package, \c version, \c slot, \c repository or \c masked, or else
+     * the raw name of a metadata key. Every value is held as a string.
+     * Metadata keys which an ID doesn't have, and keys whose values can't
+     * sensibly be turned into a string, have no value.
+     *
+     * \ingroup g_environment
+     * \since 3.0
+     */
+    class PALUDIS_VISIBLE ColumnarQuery
+    {
+        private:
+            Pimp<ColumnarQuery> _imp;
+
+        public:
+            ///\name Basic Operations
+            ///\{
+
+            ColumnarQuery(const Environment &, const Selection &, const std::shared_ptr<const Sequence<std::string> > & fields);
+            ~ColumnarQuery();
+
+            ColumnarQuery(const ColumnarQuery &) = delete;
+            ColumnarQuery & operator= (const ColumnarQuery &) = delete;
+
+            ///\}
+
+            /**
+             * How many IDs the selection returned.
+             */
+            unsigned number_of_rows() const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+            /**
+             * How many fields were asked for.
+             */
+            unsigned number_of_columns() const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+            /**
+             * The name of a field.
+             */
+            const std::string & field(const unsigned column) const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+            /**
+             * Does the ID in a row have a value for a field?
+             */
+            bool has_value(const unsigned column, const unsigned row) const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+            /**
+             * The value of a field for the ID in a row, or an empty string if
+             * it has no value.
+             */
+            const std::string & value(const unsigned column, const unsigned row) const PALUDIS_ATTRIBUTE((warn_unused_result));
+    };
+
+    extern template class Pimp<ColumnarQuery>;
+}
+
+#endif
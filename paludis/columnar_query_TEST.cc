@@ -0,0 +1,96 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2026 agent
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <paludis/columnar_query.hh>
+#include <paludis/selection.hh>
+#include <paludis/generator.hh>
+#include <paludis/filter.hh>
+#include <paludis/filtered_generator.hh>
+
+#include <paludis/environments/test/test_environment.hh>
+
+#include <paludis/repositories/fake/fake_repository.hh>
+#include <paludis/repositories/fake/fake_package_id.hh>
+
+#include <paludis/util/make_named_values.hh>
+#include <paludis/util/sequence.hh>
+
+#include <gtest/gtest.h>
+
+using namespace paludis;
+
+TEST(ColumnarQuery, Works)
+{
+    TestEnvironment e;
+
+    const std::shared_ptr<FakeRepository> r1(std::make_shared<FakeRepository>(make_named_values<FakeRepositoryParams>(
+                    n::environment() = &e,
+                    n::name() = RepositoryName("r1")
+                    )));
+    r1->add_version("cat", "one", "1")->keywords_key()->set_from_string("test");
+    r1->add_version("cat", "one", "2")->keywords_key()->set_from_string("other");
+    r1->add_version("cat", "two", "1")->build_dependencies_key()->set_from_string("cat/one");
+    e.add_repository(1, r1);
+
+    std::shared_ptr<Sequence<std::string> > fields(std::make_shared<Sequence<std::string> >());
+    fields->push_back("id");
+    fields->push_back("package");
+    fields->push_back("version");
+    fields->push_back("slot");
+    fields->push_back("masked");
+    fields->push_back("DEPEND");
+    fields->push_back("NOT_A_KEY");
+
+    ColumnarQuery q(e, selection::AllVersionsSorted(generator::All()), fields);
+    ASSERT_EQ(3u, q.number_of_rows());
+    ASSERT_EQ(7u, q.number_of_columns());
+
+    EXPECT_EQ("id", q.field(0));
+    EXPECT_EQ("NOT_A_KEY", q.field(6));
+
+    EXPECT_EQ("cat/one-1:0::r1", q.value(0, 0));
+    EXPECT_EQ("one", q.value(1, 1));
+    EXPECT_EQ("2", q.value(2, 1));
+    EXPECT_EQ("0", q.value(3, 2));
+
+    EXPECT_EQ("false", q.value(4, 0));
+    EXPECT_EQ("true", q.value(4, 1));
+
+    EXPECT_TRUE(q.has_value(5, 2));
+    EXPECT_EQ("cat/one", q.value(5, 2));
+
+    for (unsigned row(0) ; row < q.number_of_rows() ; ++row)
+    {
+        EXPECT_FALSE(q.has_value(6, row));
+        EXPECT_EQ("", q.value(6, row));
+    }
+}
+
+TEST(ColumnarQuery, Empty)
+{
+    TestEnvironment e;
+
+    std::shared_ptr<Sequence<std::string> > fields(std::make_shared<Sequence<std::string> >());
+    fields->push_back("name");
+
+    ColumnarQuery q(e, selection::AllVersionsSorted(generator::All()), fields);
+    EXPECT_EQ(0u, q.number_of_rows());
+    EXPECT_EQ(1u, q.number_of_columns());
+}
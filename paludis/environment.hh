@@ -699,6 +699,18 @@ namespace paludis
             virtual bool more_important_than(const RepositoryName &, const RepositoryName &) const
                 PALUDIS_ATTRIBUTE((warn_unused_result)) = 0;
 
+            /**
+             * A repository's position in our list of repositories, counting
+             * from one, so that more important repositories have higher ranks.
+             *
+             * This is cheap, and is intended for use in comparisons.
+             *
+             * \throw InternalError if we don't have the named repository.
+             * \since 3.0
+             */
+            virtual unsigned repository_rank(const RepositoryName &) const
+                PALUDIS_ATTRIBUTE((warn_unused_result)) = 0;
+
             ///\}
 
             ///\name Iterate over our repositories
@@ -44,12 +44,15 @@
 #include <paludis/util/join.hh>
 #include <paludis/util/sequence-impl.hh>
 #include <paludis/util/set-impl.hh>
+#include <paludis/util/profiler.hh>
+#include <paludis/util/hashes.hh>
 
 #include <algorithm>
 #include <mutex>
 #include <map>
 #include <list>
 #include <set>
+#include <unordered_map>
 
 #include "config.h"
 
@@ -127,6 +130,10 @@ namespace paludis
         std::list<std::shared_ptr<Repository> > repositories;
         std::multimap<int, std::list<std::shared_ptr<Repository> >::iterator> repository_importances;
 
+        /* kept up to date by add_repository, so that comparing IDs doesn't
+         * need to walk the repository list */
+        std::unordered_map<RepositoryName, unsigned, Hash<RepositoryName> > repository_ranks;
+
         mutable std::recursive_mutex sets_mutex;
         mutable bool loaded_sets;
         mutable std::shared_ptr<SetNameSet> set_names;
@@ -193,6 +200,10 @@ EnvironmentImplementation::is_paludis_package(const QualifiedPackageName & n) co
 std::shared_ptr<PackageIDSequence>
 EnvironmentImplementation::operator[] (const Selection & selection) const
 {
+    ProfileTimer timer("environment.selection");
+    if (timer.active())
+        timer.set_subject(selection.as_string());
+
     return selection.perform_select(this);
 }
 
@@ -368,6 +379,11 @@ EnvironmentImplementation::add_repository(int importance, const std::shared_ptr<
         }
 
     _imp->repository_importances.insert(std::make_pair(importance, _imp->repositories.insert(q, repository)));
+
+    _imp->repository_ranks.clear();
+    unsigned rank(0);
+    for (const auto & r : _imp->repositories)
+        _imp->repository_ranks.insert(std::make_pair(r->name(), ++rank));
 }
 
 const std::shared_ptr<const Repository>
@@ -579,21 +595,17 @@ EnvironmentImplementation::fetch_unique_qualified_package_name(const PackageName
 bool
 EnvironmentImplementation::more_important_than(const RepositoryName & lhs, const RepositoryName & rhs) const
 {
-    std::map<std::string, int> rank;
-    int x(0);
-
-    for (const auto & repository : repositories())
-        rank.insert(std::make_pair(stringify(repository->name()), ++x));
-
-    std::map<std::string, int>::const_iterator l(rank.find(stringify(lhs)));
-    if (l == rank.end())
-        throw InternalError(PALUDIS_HERE, "lhs.repository '" + stringify(lhs) + "' not in rank");
+    return repository_rank(lhs) > repository_rank(rhs);
+}
 
-    std::map<std::string, int>::const_iterator r(rank.find(stringify(rhs)));
-    if (r == rank.end())
-        throw InternalError(PALUDIS_HERE, "rhs.repository '" + stringify(rhs) + "' not in rank");
+unsigned
+EnvironmentImplementation::repository_rank(const RepositoryName & name) const
+{
+    auto r(_imp->repository_ranks.find(name));
+    if (r == _imp->repository_ranks.end())
+        throw InternalError(PALUDIS_HERE, "repository '" + stringify(name) + "' not in rank");
 
-    return l->second > r->second;
+    return r->second;
 }
 
 EnvironmentImplementation::RepositoryConstIterator
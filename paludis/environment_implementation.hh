@@ -123,6 +123,9 @@ namespace paludis
             virtual bool more_important_than(const RepositoryName &, const RepositoryName &) const
                 PALUDIS_ATTRIBUTE((warn_unused_result));
 
+            virtual unsigned repository_rank(const RepositoryName &) const
+                PALUDIS_ATTRIBUTE((warn_unused_result));
+
             virtual RepositoryConstIterator begin_repositories() const
                 PALUDIS_ATTRIBUTE((warn_unused_result));
 
@@ -79,6 +79,9 @@ TEST(EnvironmentImplementation, Repositories)
     EXPECT_TRUE(e.more_important_than(RepositoryName("repo2"), RepositoryName("repo1")));
     EXPECT_TRUE(! e.more_important_than(RepositoryName("repo2"), RepositoryName("repo2")));
     EXPECT_TRUE(! e.more_important_than(RepositoryName("repo1"), RepositoryName("repo1")));
+
+    EXPECT_LT(e.repository_rank(RepositoryName("repo1")), e.repository_rank(RepositoryName("repo2")));
+    EXPECT_THROW(e.repository_rank(RepositoryName("repo3")), InternalError);
 }
 
 namespace
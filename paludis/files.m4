@@ -20,6 +20,7 @@ add(`buffer_output_manager',                       `hh', `cc', `fwd')
 add(`call_pretty_printer',                         `hh', `cc', `fwd')
 add(`changed_choices',                             `hh', `cc', `fwd')
 add(`choice',                                      `hh', `cc', `se', `fwd')
+add(`columnar_query',                              `hh', `cc', `fwd', `gtest')
 add(`comma_separated_dep_parser',                  `hh', `cc', `gtest')
 add(`comma_separated_dep_pretty_printer',          `hh', `cc', `fwd')
 add(`command_output_manager',                      `hh', `cc', `fwd')
@@ -43,7 +43,10 @@
 #include <errno.h>
 #include <cstring>
 #include <cstdio>
+#include <algorithm>
 #include <list>
+#include <map>
+#include <memory>
 #include <set>
 #include <unordered_map>
 
@@ -57,12 +60,124 @@
 #  include <linux/falloc.h>
 #endif
 
+#ifdef HAVE_FICLONE
+#  include <sys/ioctl.h>
+#  include <linux/fs.h>
+#endif
+
+#ifdef HAVE_SENDFILE
+#  include <sys/sendfile.h>
+#endif
+
 using namespace paludis;
 
 #include <paludis/fs_merger-se.cc>
 
 typedef std::unordered_map<std::pair<dev_t, ino_t>, std::string, Hash<std::pair<dev_t, ino_t> > > MergedMap;
 
+namespace
+{
+    const size_t copy_chunk_size(1 << 20);
+
+    bool copy_unsupported(int e)
+    {
+        switch (e)
+        {
+            case ENOSYS:
+            case EXDEV:
+            case EINVAL:
+            case EOPNOTSUPP:
+            case EBADF:
+            case ENOTTY:
+            case EPERM:
+                return true;
+        }
+        return false;
+    }
+
+    /* Copy the contents of input_fd to output_fd, which must be a freshly
+     * created file. Reflinks are tried first, then in-kernel copies, and
+     * only then a read/write loop. The flag for whichever method finished
+     * the copy is added to flags; an empty file never reaches the kernel
+     * copy calls, so it gets no flag at all. */
+    void copy_file_contents(const FSPath & src, int input_fd, const FSPath & dst, int output_fd, off_t size,
+            FSMergerStatusFlags & flags)
+    {
+#ifdef HAVE_FICLONE
+        /* a failed clone leaves the destination untouched, so any error just
+         * means we try something else */
+        if (0 == ::ioctl(output_fd, FICLONE, input_fd))
+        {
+            flags += msi_reflinked;
+            return;
+        }
+        Log::get_instance()->message("merger.file.reflink_failed", ll_debug, lc_context)
+            << "Cannot clone '" << src << "' to '" << dst << "': " << ::strerror(errno);
+#endif
+
+        off_t copied(0);
+
+#ifdef HAVE_COPY_FILE_RANGE
+        while (copied < size)
+        {
+            ssize_t count(::copy_file_range(input_fd, nullptr, output_fd, nullptr,
+                        std::min<off_t>(size - copied, copy_chunk_size), 0));
+            if (count > 0)
+                copied += count;
+            else if (0 == count || copy_unsupported(errno))
+                break;
+            else
+                throw FSMergerError("copy_file_range '" + stringify(src) + "' to '" + stringify(dst) + "' failed: "
+                        + stringify(::strerror(errno)));
+        }
+
+        if (size > 0 && copied >= size)
+        {
+            flags += msi_copy_file_range;
+            return;
+        }
+#endif
+
+#ifdef HAVE_SENDFILE
+        while (copied < size)
+        {
+            ssize_t count(::sendfile(output_fd, input_fd, nullptr, std::min<off_t>(size - copied, copy_chunk_size)));
+            if (count > 0)
+                copied += count;
+            else if (0 == count || copy_unsupported(errno))
+                break;
+            else
+                throw FSMergerError("sendfile '" + stringify(src) + "' to '" + stringify(dst) + "' failed: "
+                        + stringify(::strerror(errno)));
+        }
+
+        if (size > 0 && copied >= size)
+        {
+            flags += msi_sendfile;
+            return;
+        }
+#endif
+
+        /* the size is only a hint, so keep going until we hit the end */
+        std::unique_ptr<char[]> buf(new char[copy_chunk_size]);
+        ssize_t count;
+        while ((count = ::read(input_fd, buf.get(), copy_chunk_size)) > 0)
+            for (ssize_t written(0) ; written < count ; )
+            {
+                ssize_t w(::write(output_fd, buf.get() + written, count - written));
+                if (-1 == w)
+                {
+                    if (EINTR == errno)
+                        continue;
+                    throw FSMergerError("write failed: " + stringify(::strerror(errno)));
+                }
+                written += w;
+            }
+        if (-1 == count)
+            throw FSMergerError("read failed: " + stringify(::strerror(errno)));
+    }
+}
+
 namespace paludis
 {
     template <>
@@ -72,11 +187,28 @@ namespace paludis
         FSMergerParams params;
         std::set<FSPath, FSPathComparator> elided_paths;
 
+        std::map<std::string, unsigned long> copy_counts;
+        unsigned long long copy_bytes;
+
         Imp(const FSMergerParams & p) :
-            params(p)
+            params(p),
+            copy_bytes(0)
         {
         }
 
+        void record_copy(const FSMergerStatusFlags & flags, off_t size)
+        {
+            if (flags[msi_reflinked])
+                ++copy_counts["reflink"];
+            else if (flags[msi_copy_file_range])
+                ++copy_counts["copy_file_range"];
+            else if (flags[msi_sendfile])
+                ++copy_counts["sendfile"];
+            else
+                ++copy_counts["read/write"];
+            copy_bytes += size;
+        }
+
         bool is_elided_directory(const FSPath & dir) const
         {
             for (FSIterator dentry(dir, { fsio_include_dotfiles }), invalid;
@@ -142,6 +274,16 @@ FSMerger::merge()
     } old_umask(::umask(0000));
 
     Merger::merge();
+
+    if (! _imp->copy_counts.empty())
+    {
+        std::string counts;
+        for (const auto & c : _imp->copy_counts)
+            counts.append((counts.empty() ? "" : ", ") + stringify(c.second) + " using " + c.first);
+
+        Log::get_instance()->message("merger.file.copy_statistics", ll_debug, lc_context)
+            << "Copied " << _imp->copy_bytes << " bytes rather than renaming: " << counts;
+    }
 }
 
 void
@@ -404,7 +546,7 @@ FSMerger::install_file(const FSPath & src, const FSPath & dst_dir, const std::st
     if (do_copy)
     {
         Log::get_instance()->message("merger.file.will_copy", ll_debug, lc_context) <<
-            "rename/link failed: " << ::strerror(errno) << ". Falling back to regular read/write copy";
+            "rename/link failed: " << ::strerror(errno) << ". Falling back to copying";
 
         FDHolder input_fd(::open(stringify(src).c_str(), O_RDONLY), false);
         if (-1 == input_fd)
@@ -441,13 +583,8 @@ FSMerger::install_file(const FSPath & src, const FSPath & dst_dir, const std::st
             throw FSMergerError("Cannot fchmod '" + stringify(dst) + "': " + stringify(::strerror(errno)));
         try_to_copy_xattrs(src, output_fd, result);
 
-        char buf[4096];
-        ssize_t count;
-        while ((count = read(input_fd, buf, 4096)) > 0)
-            if (-1 == write(output_fd, buf, count))
-                throw FSMergerError("write failed: " + stringify(::strerror(errno)));
-        if (-1 == count)
-            throw FSMergerError("read failed: " + stringify(::strerror(errno)));
+        copy_file_contents(src, input_fd, dst, output_fd, src_stat.file_size(), result);
+        _imp->record_copy(result, src_stat.file_size());
 
         /* might need to copy mtime */
         if (_imp->params.options()[mo_preserve_mtimes])
@@ -1104,6 +1241,18 @@ FSMerger::make_arrows(const FSMergerStatusFlags & flags) const
                 result[1] = '&';
                 continue;
 
+            case msi_reflinked:
+                result[1] = '=';
+                continue;
+
+            case msi_copy_file_range:
+                result[1] = '}';
+                continue;
+
+            case msi_sendfile:
+                result[1] = ')';
+                continue;
+
             case msi_fixed_ownership:
                 result[2] = '~';
                 continue;
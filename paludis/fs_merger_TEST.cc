@@ -38,9 +38,12 @@
 #include <functional>
 #include <iterator>
 #include <list>
+#include <map>
 
 #include <gtest/gtest.h>
 
+#include "config.h"
+
 using namespace paludis;
 
 namespace
@@ -100,13 +103,16 @@ namespace
     struct TestMerger :
         FSMerger
     {
+        std::map<std::string, FSMergerStatusFlags> file_flags;
+
         TestMerger(const FSMergerParams & p) :
             FSMerger(p)
         {
         }
 
-        void record_install_file(const FSPath &, const FSPath &, const std::string &, const FSMergerStatusFlags &) override
+        void record_install_file(const FSPath &, const FSPath &, const std::string & name, const FSMergerStatusFlags & flags) override
         {
+            file_flags[name] = flags;
         }
 
         void record_install_dir(const FSPath &, const FSPath &, const FSMergerStatusFlags &) override
@@ -422,6 +428,17 @@ TEST(Merger, FileDir)
     ASSERT_TRUE((data->root_dir / "file").stat().is_directory());
 }
 
+TEST(Merger, DeepCheck)
+{
+    auto data(make_merger("deep_check"));
+    ASSERT_TRUE((data->root_dir / "dir_3/dir_2/subdir/file").stat().is_directory());
+
+    ASSERT_TRUE(! data->merger.check());
+    EXPECT_THROW(data->merger.merge(), FSMergerError);
+
+    ASSERT_TRUE((data->root_dir / "dir_3/dir_2/subdir/file").stat().is_directory());
+}
+
 TEST(Merger, Override)
 {
     auto data(make_merger("override"));
@@ -512,3 +529,51 @@ TEST(Merger, MtimesFixes)
     ASSERT_TRUE(timestamps_nearly_equal((data->root_dir / "dir" / "dodgy_file").stat().mtim(), FSPath("fs_merger_TEST_dir/reference").stat().mtim()));
 }
 
+TEST(Merger, Copy)
+{
+    auto data(make_merger("copy", { mo_nondestructive }));
+
+    ASSERT_TRUE(data->merger.check());
+    data->merger.merge();
+
+    for (const auto & name : { "small_file", "empty_file", "dir/large_file" })
+    {
+        ASSERT_TRUE((data->image_dir / name).stat().is_regular_file());
+        ASSERT_TRUE((data->root_dir / name).stat().is_regular_file());
+
+        SafeIFStream i(data->image_dir / name);
+        std::string is((std::istreambuf_iterator<char>(i)), std::istreambuf_iterator<char>());
+        SafeIFStream r(data->root_dir / name);
+        std::string rs((std::istreambuf_iterator<char>(r)), std::istreambuf_iterator<char>());
+        EXPECT_EQ(is, rs);
+        EXPECT_EQ((data->image_dir / name).stat().file_size(), (data->root_dir / name).stat().file_size());
+    }
+
+    EXPECT_EQ(mode_t(04755), (data->root_dir / "dir/large_file").stat().permissions() & 07777);
+
+    /* nothing was there to copy, so no copy method should be claimed */
+    const FSMergerStatusFlags empty_flags(data->merger.file_flags.at("empty_file"));
+    EXPECT_FALSE(empty_flags[msi_copy_file_range]);
+    EXPECT_FALSE(empty_flags[msi_sendfile]);
+
+    for (const auto & name : { "small_file", "large_file" })
+    {
+        const FSMergerStatusFlags flags(data->merger.file_flags.at(name));
+        EXPECT_FALSE(flags[msi_rename]);
+        EXPECT_FALSE(flags[msi_as_hardlink]);
+        if (! flags[msi_reflinked])
+        {
+#if defined(HAVE_COPY_FILE_RANGE)
+            EXPECT_TRUE(flags[msi_copy_file_range]) << name;
+            EXPECT_FALSE(flags[msi_sendfile]) << name;
+#elif defined(HAVE_SENDFILE)
+            EXPECT_TRUE(flags[msi_sendfile]) << name;
+#endif
+        }
+        else
+        {
+            EXPECT_FALSE(flags[msi_copy_file_range]) << name;
+            EXPECT_FALSE(flags[msi_sendfile]) << name;
+        }
+    }
+}
@@ -110,6 +110,22 @@ touch -d '3 years ago' mtimes_fix/image/dodgy_file
 touch -d '3 years ago' mtimes_fix/image/dir/dodgy_file
 > mtimes_fix/root/existing_file
 
+mkdir -p copy/{image/dir,root}
+echo "small contents" > copy/image/small_file
+> copy/image/empty_file
+head -c 3000000 /dev/urandom > copy/image/dir/large_file
+chmod 4755 copy/image/dir/large_file
+
+mkdir -p deep_check/{image,root}
+for a in 1 2 3 4 ; do
+    for b in 1 2 3 4 ; do
+        mkdir -p deep_check/image/dir_${a}/dir_${b}/subdir
+        > deep_check/image/dir_${a}/dir_${b}/subdir/file
+        > deep_check/image/dir_${a}/file_${b}
+    done
+done
+mkdir -p deep_check/root/dir_3/dir_2/subdir/file
+
 mkdir hooks
 cd hooks
 mkdir \
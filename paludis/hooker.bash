@@ -29,6 +29,17 @@ if ! source $1 ; then
     exit 123
 fi
 
+if [[ ${2} == "--describe" ]] ; then
+    declare -F | while read -r _ _ f ; do
+        [[ ${f#hook_} != ${f} ]] && echo "function ${f}"
+    done
+    if [[ $(type -t hook_auto_names 2>/dev/null ) == "function" ]] ; then
+        names=$(hook_auto_names) || exit $?
+        echo "auto" ${names}
+    fi
+    exit 0
+fi
+
 if [[ $(type -t $2 2>/dev/null ) != "function" ]] ; then
     if [[ ${2#hook_depend} != ${2} ]] ; then
         exit 0
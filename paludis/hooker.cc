@@ -41,10 +41,16 @@
 #include <paludis/util/fs_iterator.hh>
 #include <paludis/util/fs_stat.hh>
 #include <paludis/util/env_var_names.hh>
+#include <paludis/util/safe_ifstream.hh>
+#include <paludis/util/cache_file.hh>
+#include <paludis/util/timestamp.hh>
 
+#include <algorithm>
 #include <list>
+#include <sstream>
 #include <iterator>
 #include <mutex>
+#include <vector>
 #include <dlfcn.h>
 #include <stdint.h>
 
@@ -94,6 +100,20 @@ namespace
             }
     };
 
+    struct FancyHookFileMetadata
+    {
+        bool described;
+        std::set<std::string> functions;
+        std::shared_ptr<Sequence<std::string> > auto_names;
+        std::map<std::string, std::string> dependencies;
+
+        FancyHookFileMetadata() :
+            described(false),
+            auto_names(std::make_shared<Sequence<std::string>>())
+        {
+        }
+    };
+
     class FancyHookFile :
         public HookFile
     {
@@ -101,14 +121,26 @@ namespace
             const FSPath _file_name;
             const bool _run_prefixed;
             const Environment * const _env;
+            const std::shared_ptr<const FSPath> _cache_dir;
+
+            mutable std::mutex _metadata_mutex;
+            mutable std::shared_ptr<FancyHookFileMetadata> _metadata;
+            mutable std::shared_ptr<Timestamp> _metadata_mtime;
 
             void _add_dependency_class(const Hook &, DirectedGraph<std::string, int> &, bool);
 
+            const std::shared_ptr<FancyHookFileMetadata> _need_metadata() const;
+            FSPath _cache_file() const;
+            bool _load_cache() const;
+            void _save_cache() const;
+
         public:
-            FancyHookFile(const FSPath & f, const bool r, const Environment * const e) :
+            FancyHookFile(const FSPath & f, const bool r, const Environment * const e,
+                    const std::shared_ptr<const FSPath> & c) :
                 _file_name(f),
                 _run_prefixed(r),
-                _env(e)
+                _env(e),
+                _cache_dir(c)
             {
             }
 
@@ -222,6 +254,20 @@ FancyHookFile::run(const Hook & hook,
 {
     Context c("When running hook script '" + stringify(file_name()) + "' for hook '" + hook.name() + "':");
 
+    {
+        std::unique_lock<std::mutex> lock(_metadata_mutex);
+        const std::shared_ptr<FancyHookFileMetadata> metadata(_need_metadata());
+
+        if (metadata->described && metadata->functions.end() == metadata->functions.find("hook_run_" + hook.name()))
+        {
+            Log::get_instance()->message("hook.fancy.no_run", ll_debug, lc_no_context)
+                << "Hook script '" << file_name() << "' does not define 'hook_run_" << hook.name() << "'";
+            return make_named_values<HookResult>(
+                    n::max_exit_status() = 0,
+                    n::output() = "");
+        }
+    }
+
     Log::get_instance()->message("hook.fancy.starting", ll_debug, lc_no_context) << "Starting hook script '"
         << file_name() << "' for '" << hook.name() << "'";
 
@@ -278,16 +324,136 @@ FancyHookFile::run(const Hook & hook,
             );
 }
 
-const std::shared_ptr<const Sequence<std::string > >
-FancyHookFile::auto_hook_names() const
+FSPath
+FancyHookFile::_cache_file() const
 {
-    Context c("When querying auto hook names for fancy hook '" + stringify(file_name()) + "':");
+    std::string name(stringify(file_name()));
+    std::replace(name.begin(), name.end(), '/', '%');
+    return *_cache_dir / (name + ".cache");
+}
+
+bool
+FancyHookFile::_load_cache() const
+{
+    if (! _cache_dir)
+        return false;
+
+    FSPath cache_file(_cache_file());
+    if (! cache_file.stat().is_regular_file())
+        return false;
+
+    Context context("When loading hook cache file '" + stringify(cache_file) + "':");
+
+    try
+    {
+        SafeIFStream f(cache_file);
+        std::string line;
+
+        if ((! std::getline(f, line)) || line != "paludis-hooker-cache-1")
+            return false;
+        if ((! std::getline(f, line)) || line != "file " + stringify(file_name()))
+            return false;
+        if ((! std::getline(f, line)) || line != "mtime " + stringify(_metadata_mtime->seconds()) + " "
+                + stringify(_metadata_mtime->nanoseconds()))
+            return false;
+
+        auto metadata(std::make_shared<FancyHookFileMetadata>());
+        metadata->described = true;
+
+        while (std::getline(f, line))
+        {
+            std::vector<std::string> tokens;
+            tokenise_whitespace(line, std::back_inserter(tokens));
+            if (tokens.empty())
+                continue;
+
+            if (tokens.at(0) == "function" && tokens.size() == 2)
+                metadata->functions.insert(tokens.at(1));
+            else if (tokens.at(0) == "auto")
+                std::copy(std::next(tokens.begin()), tokens.end(), metadata->auto_names->back_inserter());
+            else if (tokens.at(0) == "dependencies" && tokens.size() >= 2)
+                metadata->dependencies.insert(std::make_pair(tokens.at(1),
+                            join(std::next(tokens.begin(), 2), tokens.end(), " ")));
+            else
+            {
+                Log::get_instance()->message("hook.fancy.cache.bad_line", ll_debug, lc_context)
+                    << "Ignoring hook cache file '" << cache_file << "' due to bad line '" << line << "'";
+                return false;
+            }
+        }
+
+        _metadata = metadata;
+        return true;
+    }
+    catch (const SafeIFStreamError & e)
+    {
+        Log::get_instance()->message("hook.fancy.cache.read_failed", ll_debug, lc_context)
+            << "Cannot read hook cache file '" << cache_file << "': '" << e.message() << "' (" << e.what() << ")";
+        return false;
+    }
+}
+
+void
+FancyHookFile::_save_cache() const
+{
+    if ((! _cache_dir) || (! _metadata->described))
+        return;
+
+    FSPath cache_file(_cache_file());
+    Context context("When saving hook cache file '" + stringify(cache_file) + "':");
+
+    try
+    {
+        std::ostringstream f;
+        f << "paludis-hooker-cache-1" << std::endl;
+        f << "file " << file_name() << std::endl;
+        f << "mtime " << _metadata_mtime->seconds() << " " << _metadata_mtime->nanoseconds() << std::endl;
+
+        for (const auto & function : _metadata->functions)
+            f << "function " << function << std::endl;
+
+        if (! _metadata->auto_names->empty())
+            f << "auto " << join(_metadata->auto_names->begin(), _metadata->auto_names->end(), " ") << std::endl;
+
+        for (const auto & dependency : _metadata->dependencies)
+            f << "dependencies " << dependency.first << " " << dependency.second << std::endl;
+
+        write_cache_file(cache_file, f.str());
+    }
+    catch (const Exception & e)
+    {
+        Log::get_instance()->message("hook.fancy.cache.write_failed", ll_debug, lc_context)
+            << "Cannot write hook cache file '" << cache_file << "': '" << e.message() << "' (" << e.what() << ")";
+    }
+}
+
+const std::shared_ptr<FancyHookFileMetadata>
+FancyHookFile::_need_metadata() const
+{
+    Timestamp mtime(file_name().stat().mtim());
+    if (_metadata)
+    {
+        if (mtime == *_metadata_mtime)
+            return _metadata;
+
+        Log::get_instance()->message("hook.fancy.changed", ll_debug, lc_no_context)
+            << "Hook script '" << file_name() << "' has changed, describing it again";
+        _metadata.reset();
+    }
+
+    Context c("When describing fancy hook '" + stringify(file_name()) + "':");
+
+    _metadata_mtime = std::make_shared<Timestamp>(mtime);
+    if (_load_cache())
+        return _metadata;
+
+    _metadata = std::make_shared<FancyHookFileMetadata>();
 
     Log::get_instance()->message("hook.fancy.starting", ll_debug, lc_no_context) << "Starting hook script '" <<
-        file_name() << "' for auto hook names";
+        file_name() << "' for description";
 
     Process process(ProcessCommand({ "sh", "-c", getenv_with_default(env_vars::hooker_dir, LIBEXECDIR "/paludis") +
-            "/hooker.bash '" + stringify(file_name()) + "' 'hook_auto_names'" }));
+            "/hooker.bash '" + stringify(file_name()) + "' '--describe'" }));
 
     process
         .setenv("ROOT", stringify(_env->preferred_root_key()->parse_value()))
@@ -297,31 +463,47 @@ FancyHookFile::auto_hook_names() const
         .setenv("PALUDIS_REDUCED_GID", stringify(_env->reduced_gid()))
         .setenv("PALUDIS_REDUCED_UID", stringify(_env->reduced_uid()));
 
-    int exit_status(0);
-    std::string output("");
-    {
-        std::stringstream s;
-        process.capture_stdout(s);
-        exit_status = process.run().wait();
-        output = strip_trailing(std::string((std::istreambuf_iterator<char>(s)), std::istreambuf_iterator<char>()),
-                " \t\n");
-    }
+    std::stringstream s;
+    process.capture_stdout(s);
+    int exit_status(process.run().wait());
 
     if (0 == exit_status)
     {
-        std::shared_ptr<Sequence<std::string> > result(std::make_shared<Sequence<std::string>>());
-        tokenise_whitespace(output, result->back_inserter());
+        std::string line;
+        while (std::getline(s, line))
+        {
+            std::vector<std::string> tokens;
+            tokenise_whitespace(line, std::back_inserter(tokens));
+            if (tokens.empty())
+                continue;
+
+            if (tokens.at(0) == "function" && tokens.size() == 2)
+                _metadata->functions.insert(tokens.at(1));
+            else if (tokens.at(0) == "auto")
+                std::copy(std::next(tokens.begin()), tokens.end(), _metadata->auto_names->back_inserter());
+        }
+
+        _metadata->described = true;
         Log::get_instance()->message("hook.fancy.success", ll_debug, lc_no_context) << "Hook '" << file_name()
-            << "' returned success '" << exit_status << "' for auto hook names, result ("
-            << join(result->begin(), result->end(), ", ") << ")";
-        return result;
+            << "' returned success '" << exit_status << "' for description, functions ("
+            << join(_metadata->functions.begin(), _metadata->functions.end(), ", ") << "), auto hook names ("
+            << join(_metadata->auto_names->begin(), _metadata->auto_names->end(), ", ") << ")";
+        _save_cache();
     }
     else
-    {
         Log::get_instance()->message("hook.fancy.failure", ll_warning, lc_no_context) << "Hook '" << file_name()
-            << "' returned failure '" << exit_status << "' for auto hook names";
-        return std::make_shared<Sequence<std::string>>();
-    }
+            << "' returned failure '" << exit_status << "' for description";
+
+    return _metadata;
+}
+
+const std::shared_ptr<const Sequence<std::string > >
+FancyHookFile::auto_hook_names() const
+{
+    Context c("When querying auto hook names for fancy hook '" + stringify(file_name()) + "':");
+
+    std::unique_lock<std::mutex> lock(_metadata_mutex);
+    return _need_metadata()->auto_names;
 }
 
 void
@@ -339,56 +521,83 @@ FancyHookFile::_add_dependency_class(const Hook & hook, DirectedGraph<std::strin
     Context context("When adding dependency class '" + stringify(depend ? "depend" : "after") + "' for hook '"
             + stringify(hook.name()) + "' file '" + stringify(file_name()) + "':");
 
-    Log::get_instance()->message("hook.fancy.starting_dependencies", ll_debug, lc_no_context)
-        << "Starting hook script '" << file_name() << "' for dependencies of '" << hook.name() << "'";
+    const std::string function("hook_" + stringify(depend ? "depend" : "after") + "_" + stringify(hook.name()));
+    std::string deps;
 
-    Process process(ProcessCommand({ "sh", "-c", getenv_with_default(env_vars::hooker_dir, LIBEXECDIR "/paludis") +
-            "/hooker.bash '" + stringify(file_name()) + "' 'hook_" + (depend ? "depend" : "after") + "_" +
-            stringify(hook.name()) + "'" }));
+    {
+        std::unique_lock<std::mutex> lock(_metadata_mutex);
+        const std::shared_ptr<FancyHookFileMetadata> metadata(_need_metadata());
 
-    process
-        .setenv("ROOT", stringify(_env->preferred_root_key()->parse_value()))
-        .setenv("HOOK", hook.name())
-        .setenv("HOOK_FILE", stringify(file_name()))
-        .setenv("HOOK_LOG_LEVEL", stringify(Log::get_instance()->log_level()))
-        .setenv("PALUDIS_EBUILD_DIR", getenv_with_default(env_vars::ebuild_dir, LIBEXECDIR "/paludis"))
-        .setenv("PALUDIS_REDUCED_GID", stringify(_env->reduced_gid()))
-        .setenv("PALUDIS_REDUCED_UID", stringify(_env->reduced_uid()));
+        if (metadata->described && metadata->functions.end() == metadata->functions.find(function))
+        {
+            Log::get_instance()->message("hook.fancy.no_dependencies", ll_debug, lc_no_context)
+                << "Hook script '" << file_name() << "' does not define '" << function << "'";
+            return;
+        }
 
-    process.prefix_stderr(strip_trailing_string(file_name().basename(), ".bash") + "> ");
+        auto d(metadata->dependencies.find(function));
+        if (metadata->dependencies.end() != d)
+            deps = d->second;
+        else
+        {
+            Log::get_instance()->message("hook.fancy.starting_dependencies", ll_debug, lc_no_context)
+                << "Starting hook script '" << file_name() << "' for dependencies of '" << hook.name() << "'";
 
-    for (Hook::ConstIterator x(hook.begin()), x_end(hook.end()) ; x != x_end ; ++x)
-        process.setenv(x->first, x->second);
+            Process process(ProcessCommand({ "sh", "-c", getenv_with_default(env_vars::hooker_dir, LIBEXECDIR "/paludis") +
+                    "/hooker.bash '" + stringify(file_name()) + "' '" + function + "'" }));
 
-    std::stringstream s;
-    process.capture_stdout(s);
-    int exit_status(process.run().wait());
+            process
+                .setenv("ROOT", stringify(_env->preferred_root_key()->parse_value()))
+                .setenv("HOOK", hook.name())
+                .setenv("HOOK_FILE", stringify(file_name()))
+                .setenv("HOOK_LOG_LEVEL", stringify(Log::get_instance()->log_level()))
+                .setenv("PALUDIS_EBUILD_DIR", getenv_with_default(env_vars::ebuild_dir, LIBEXECDIR "/paludis"))
+                .setenv("PALUDIS_REDUCED_GID", stringify(_env->reduced_gid()))
+                .setenv("PALUDIS_REDUCED_UID", stringify(_env->reduced_uid()));
 
-    std::string deps((std::istreambuf_iterator<char>(s)), std::istreambuf_iterator<char>());
+            process.prefix_stderr(strip_trailing_string(file_name().basename(), ".bash") + "> ");
 
-    if (0 == exit_status)
-    {
-        Log::get_instance()->message("hook.fancy.success_dependencies", ll_debug, lc_no_context)
-            << "Hook dependencies for '" << file_name() << "' returned success '" << exit_status << "', result '" << deps << "'";
+            for (Hook::ConstIterator x(hook.begin()), x_end(hook.end()) ; x != x_end ; ++x)
+                process.setenv(x->first, x->second);
 
-        std::set<std::string> deps_s;
-        tokenise_whitespace(deps, std::inserter(deps_s, deps_s.end()));
+            std::stringstream s;
+            process.capture_stdout(s);
+            int exit_status(process.run().wait());
 
-        for (const auto & deps_ : deps_s)
-        {
-            if (g.has_node(deps_))
-                g.add_edge(strip_trailing_string(file_name().basename(), ".hook"), deps_, 0);
-            else if (depend)
-                Log::get_instance()->message("hook.fancy.dependency_not_found", ll_warning, lc_context)
-                    << "Hook dependency '" << deps_ << "' for '" << file_name() << "' not found";
-            else
-                Log::get_instance()->message("hook.fancy.after_not_found", ll_debug, lc_context)
-                    << "Hook after '" << deps_ << "' for '" << file_name() << "' not found";
+            if (0 != exit_status)
+            {
+                Log::get_instance()->message("hook.fancy.failure_dependencies", ll_warning, lc_no_context)
+                    << "Hook dependencies for '" << file_name() << "' returned failure '" << exit_status << "'";
+                return;
+            }
+
+            std::set<std::string> deps_s;
+            tokenise_whitespace(std::string((std::istreambuf_iterator<char>(s)), std::istreambuf_iterator<char>()),
+                    std::inserter(deps_s, deps_s.end()));
+            deps = join(deps_s.begin(), deps_s.end(), " ");
+
+            Log::get_instance()->message("hook.fancy.success_dependencies", ll_debug, lc_no_context)
+                << "Hook dependencies for '" << file_name() << "' returned success '" << exit_status << "', result '" << deps << "'";
+
+            metadata->dependencies.insert(std::make_pair(function, deps));
+            _save_cache();
         }
     }
-    else
-        Log::get_instance()->message("hook.fancy.failure_dependencies", ll_warning, lc_no_context)
-            << "Hook dependencies for '" << file_name() << "' returned failure '" << exit_status << "'";
+
+    std::set<std::string> deps_s;
+    tokenise_whitespace(deps, std::inserter(deps_s, deps_s.end()));
+
+    for (const auto & deps_ : deps_s)
+    {
+        if (g.has_node(deps_))
+            g.add_edge(strip_trailing_string(file_name().basename(), ".hook"), deps_, 0);
+        else if (depend)
+            Log::get_instance()->message("hook.fancy.dependency_not_found", ll_warning, lc_context)
+                << "Hook dependency '" << deps_ << "' for '" << file_name() << "' not found";
+        else
+            Log::get_instance()->message("hook.fancy.after_not_found", ll_debug, lc_context)
+                << "Hook after '" << deps_ << "' for '" << file_name() << "' not found";
+    }
 }
 
 SoHookFile::SoHookFile(const FSPath & f, const bool, const Environment * const e) :
@@ -458,6 +667,25 @@ SoHookFile::auto_hook_names() const
     return _auto_hook_names(_env);
 }
 
+namespace
+{
+    typedef std::list<std::shared_ptr<const Timestamp> > DirMTimes;
+
+    struct HookFilesEntry
+    {
+        std::shared_ptr<Sequence<std::shared_ptr<HookFile> > > hook_files;
+        DirMTimes dir_mtimes;
+    };
+
+    bool same_dir_mtimes(const DirMTimes & a, const DirMTimes & b)
+    {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(),
+                [] (const std::shared_ptr<const Timestamp> & x, const std::shared_ptr<const Timestamp> & y) {
+                    return x ? (y && *x == *y) : ! y;
+                });
+    }
+}
+
 namespace paludis
 {
     template<>
@@ -465,25 +693,54 @@ namespace paludis
     {
         const Environment * const env;
         std::list<std::pair<FSPath, bool> > dirs;
+        const std::shared_ptr<const FSPath> cache_dir;
 
         mutable std::recursive_mutex hook_files_mutex;
-        mutable std::map<std::string, std::shared_ptr<Sequence<std::shared_ptr<HookFile> > > > hook_files;
+        mutable std::map<std::string, HookFilesEntry> hook_files;
         mutable std::map<std::string, std::map<std::string, std::shared_ptr<HookFile> > > auto_hook_files;
         mutable bool has_auto_hook_files;
+        mutable DirMTimes auto_dir_mtimes;
 
         Imp(const Environment * const e) :
             env(e),
+            cache_dir(getenv_with_default(env_vars::hooker_cache_dir, "").empty() ? nullptr :
+                    std::make_shared<FSPath>(getenv_with_default(env_vars::hooker_cache_dir, ""))),
             has_auto_hook_files(false)
         {
         }
 
+        DirMTimes get_dir_mtimes(const std::string & subdir) const
+        {
+            DirMTimes result;
+            for (const auto & dir : dirs)
+            {
+                FSStat s(dir.first / subdir);
+                if (s.is_directory())
+                    result.push_back(std::make_shared<Timestamp>(s.mtim()));
+                else
+                    result.push_back(nullptr);
+            }
+            return result;
+        }
+
         void need_auto_hook_files() const
         {
             std::unique_lock<std::recursive_mutex> l(hook_files_mutex);
 
+            DirMTimes mtimes(get_dir_mtimes("auto"));
             if (has_auto_hook_files)
-                return;
+            {
+                if (same_dir_mtimes(mtimes, auto_dir_mtimes))
+                    return;
+
+                Log::get_instance()->message("hook.auto_changed", ll_debug, lc_no_context)
+                    << "Auto hook directories have changed, rescanning";
+                hook_files.clear();
+                auto_hook_files.clear();
+            }
+
             has_auto_hook_files = true;
+            auto_dir_mtimes = mtimes;
 
             Context context("When loading auto hooks:");
 
@@ -500,7 +757,7 @@ namespace paludis
 
                     if (is_file_with_extension(*e, ".hook", { }))
                     {
-                        hook_file = std::make_shared<FancyHookFile>(*e, dir.second, env);
+                        hook_file = std::make_shared<FancyHookFile>(*e, dir.second, env, cache_dir);
                         name = strip_trailing_string(e->basename(), ".hook");
                     }
                     else if (is_file_with_extension(*e, so_suffix, { }))
@@ -540,6 +797,7 @@ Hooker::add_dir(const FSPath & dir, const bool v)
     std::unique_lock<std::recursive_mutex> l(_imp->hook_files_mutex);
     _imp->hook_files.clear();
     _imp->auto_hook_files.clear();
+    _imp->has_auto_hook_files = false;
     _imp->dirs.push_back(std::make_pair(dir, v));
 }
 
@@ -605,7 +863,7 @@ Hooker::_find_hooks(const Hook & hook) const
 
             if (is_file_with_extension(*e, ".hook", { }))
                 if (! hook_files.insert(std::make_pair(strip_trailing_string(e->basename(), ".hook"),
-                                std::shared_ptr<HookFile>(std::make_shared<FancyHookFile>(*e, d->second, _imp->env)))).second)
+                                std::shared_ptr<HookFile>(std::make_shared<FancyHookFile>(*e, d->second, _imp->env, _imp->cache_dir)))).second)
                     Log::get_instance()->message("hook.discarding", ll_warning, lc_context) << "Discarding hook file '" << *e
                         << "' because of naming conflict with '" <<
                         hook_files.find(stringify(strip_trailing_string(e->basename(), ".hook")))->second->file_name() << "'";
@@ -776,20 +1034,38 @@ Hooker::perform_hook(
     /* file hooks, but only if necessary */
 
     std::unique_lock<std::recursive_mutex> l(_imp->hook_files_mutex);
-    std::map<std::string, std::shared_ptr<Sequence<std::shared_ptr<HookFile> > > >::iterator h(_imp->hook_files.find(hook.name()));
 
-    if (h == _imp->hook_files.end())
-        h = _imp->hook_files.insert(std::make_pair(hook.name(), _find_hooks(hook))).first;
+    /* rescanning is only needed if one of the directories has changed since we last looked */
+    _imp->need_auto_hook_files();
+    DirMTimes mtimes(_imp->get_dir_mtimes(hook.name()));
+    std::shared_ptr<const Sequence<std::shared_ptr<HookFile> > > hook_files;
+
+    std::map<std::string, HookFilesEntry>::const_iterator h(_imp->hook_files.find(hook.name()));
+    if (h != _imp->hook_files.end())
+    {
+        if (same_dir_mtimes(mtimes, h->second.dir_mtimes))
+            hook_files = h->second.hook_files;
+        else
+            Log::get_instance()->message("hook.changed", ll_debug, lc_no_context)
+                << "Hook directories for '" << hook.name() << "' have changed, rescanning";
+    }
+
+    if (! hook_files)
+    {
+        std::shared_ptr<Sequence<std::shared_ptr<HookFile> > > found(_find_hooks(hook));
+        _imp->hook_files[hook.name()] = HookFilesEntry{ found, mtimes };
+        hook_files = found;
+    }
 
-    if (! h->second->empty())
+    if (! hook_files->empty())
     {
         do
         {
             switch (hook.output_dest)
             {
                 case hod_stdout:
-                    for (Sequence<std::shared_ptr<HookFile> >::ConstIterator f(h->second->begin()),
-                            f_end(h->second->end()) ; f != f_end ; ++f)
+                    for (Sequence<std::shared_ptr<HookFile> >::ConstIterator f(hook_files->begin()),
+                            f_end(hook_files->end()) ; f != f_end ; ++f)
                         if ((*f)->file_name().stat().is_regular_file_or_symlink_to_regular_file())
                             result.max_exit_status() = std::max(result.max_exit_status(), (*f)->run(hook, optional_output_manager).max_exit_status());
                         else
@@ -798,8 +1074,8 @@ Hooker::perform_hook(
                     continue;
 
                 case hod_grab:
-                    for (Sequence<std::shared_ptr<HookFile> >::ConstIterator f(h->second->begin()),
-                            f_end(h->second->end()) ; f != f_end ; ++f)
+                    for (Sequence<std::shared_ptr<HookFile> >::ConstIterator f(hook_files->begin()),
+                            f_end(hook_files->end()) ; f != f_end ; ++f)
                     {
                         if (! (*f)->file_name().stat().is_regular_file_or_symlink_to_regular_file())
                         {
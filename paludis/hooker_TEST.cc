@@ -24,8 +24,12 @@
 
 #include <paludis/util/make_named_values.hh>
 #include <paludis/util/safe_ifstream.hh>
+#include <paludis/util/safe_ofstream.hh>
+#include <paludis/util/fs_stat.hh>
+#include <paludis/util/timestamp.hh>
 
 #include <iterator>
+#include <stdlib.h>
 
 #include <gtest/gtest.h>
 
@@ -214,3 +218,91 @@ TEST(Hooker, BadOutput)
 }
 
 
+
+TEST(Hooker, Cache)
+{
+    TestEnvironment env;
+    FSPath("hooker_TEST_dir/cached_hook.out").unlink();
+    ::setenv("PALUDIS_HOOKER_CACHE_DIR", "hooker_TEST_dir/cache", 1);
+
+    {
+        Hooker hooker(&env);
+        hooker.add_dir(FSPath("hooker_TEST_dir/"), false);
+        HookResult result(hooker.perform_hook(Hook("cached_hook"), nullptr));
+        EXPECT_EQ(0, result.max_exit_status());
+    }
+
+    {
+        Hooker hooker(&env);
+        hooker.add_dir(FSPath("hooker_TEST_dir/"), false);
+        HookResult result(hooker.perform_hook(Hook("cached_hook"), nullptr));
+        EXPECT_EQ(0, result.max_exit_status());
+    }
+
+    ::unsetenv("PALUDIS_HOOKER_CACHE_DIR");
+
+    EXPECT_TRUE(FSPath("hooker_TEST_dir/cache/hooker_TEST_dir%cached_hook%one.hook.cache").stat().is_regular_file());
+
+    SafeIFStream f(FSPath("hooker_TEST_dir/cached_hook.out"));
+    std::string line((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+
+    EXPECT_EQ("depend\nrun\nrun\nrun\nrun\n", line);
+}
+
+TEST(Hooker, Rescan)
+{
+    TestEnvironment env;
+    Hooker hooker(&env);
+
+    FSPath("hooker_TEST_dir/rescan.out").unlink();
+    hooker.add_dir(FSPath("hooker_TEST_dir/"), false);
+
+    HookResult result(hooker.perform_hook(Hook("rescan"), nullptr));
+    EXPECT_EQ(0, result.max_exit_status());
+
+    {
+        SafeOFStream f(FSPath("hooker_TEST_dir/rescan/two.bash"), -1, true);
+        f << "echo two >> hooker_TEST_dir/rescan.out" << std::endl;
+    }
+    FSPath("hooker_TEST_dir/rescan/two.bash").chmod(0755);
+    FSPath("hooker_TEST_dir/rescan").utime(Timestamp::now());
+
+    result = hooker.perform_hook(Hook("rescan"), nullptr);
+    EXPECT_EQ(0, result.max_exit_status());
+
+    SafeIFStream f(FSPath("hooker_TEST_dir/rescan.out"));
+    std::string line((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+
+    EXPECT_EQ("one\none\ntwo\n", line);
+}
+
+TEST(Hooker, ChangedHook)
+{
+    TestEnvironment env;
+    Hooker hooker(&env);
+
+    FSPath("hooker_TEST_dir/changed_hook.out").unlink();
+    hooker.add_dir(FSPath("hooker_TEST_dir/"), false);
+
+    /* no hook_run_changed_hook, so after describing it we don't run it */
+    HookResult result(hooker.perform_hook(Hook("changed_hook"), nullptr));
+    EXPECT_EQ(0, result.max_exit_status());
+    result = hooker.perform_hook(Hook("changed_hook"), nullptr);
+    EXPECT_EQ(0, result.max_exit_status());
+
+    {
+        SafeOFStream f(FSPath("hooker_TEST_dir/changed_hook/one.hook"), -1, true);
+        f << "hook_run_changed_hook() {" << std::endl;
+        f << "    echo run >> hooker_TEST_dir/changed_hook.out" << std::endl;
+        f << "}" << std::endl;
+    }
+    FSPath("hooker_TEST_dir/changed_hook/one.hook").utime(Timestamp(12345, 0));
+
+    result = hooker.perform_hook(Hook("changed_hook"), nullptr);
+    EXPECT_EQ(0, result.max_exit_status());
+
+    SafeIFStream f(FSPath("hooker_TEST_dir/changed_hook.out"));
+    std::string line((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+
+    EXPECT_EQ("sourced\nrun\n", line);
+}
@@ -293,3 +293,35 @@ for a in a b c d e f g h i ; do
     ln -s ../cycles.common cycles/${a}.hook
 done
 
+
+mkdir cache
+mkdir cached_hook
+cat <<"END" > cached_hook/one.hook
+hook_run_cached_hook() {
+    echo run >> hooker_TEST_dir/cached_hook.out
+}
+
+hook_depend_cached_hook() {
+    echo depend >> hooker_TEST_dir/cached_hook.out
+}
+END
+chmod +x cached_hook/one.hook
+
+cat <<"END" > cached_hook/two.hook
+hook_run_cached_hook() {
+    echo run >> hooker_TEST_dir/cached_hook.out
+}
+END
+chmod +x cached_hook/two.hook
+
+mkdir rescan
+cat <<"END" > rescan/one.bash
+echo one >> hooker_TEST_dir/rescan.out
+END
+chmod +x rescan/one.bash
+
+mkdir changed_hook
+cat <<"END" > changed_hook/one.hook
+echo sourced >> hooker_TEST_dir/changed_hook.out
+END
+chmod +x changed_hook/one.hook
@@ -23,14 +23,22 @@
 #include <paludis/util/log.hh>
 #include <paludis/util/pimp-impl.hh>
 #include <paludis/util/timestamp.hh>
-#include <paludis/util/fs_iterator.hh>
+#include <paludis/util/fs_dir_walker.hh>
+#include <paludis/util/options.hh>
 #include <paludis/util/fs_stat.hh>
+#include <paludis/util/fs_error.hh>
 #include <paludis/selinux/security_context.hh>
+#include <paludis/util/task_scheduler.hh>
 #include <paludis/environment.hh>
 #include <paludis/hook.hh>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
 #include <set>
 #include <istream>
 #include <ostream>
+#include <unordered_map>
+#include <vector>
 
 using namespace paludis;
 
@@ -39,6 +47,130 @@ MergerError::MergerError(const std::string & m) noexcept :
 {
 }
 
+namespace
+{
+    typedef std::unordered_map<std::string, std::shared_ptr<const std::vector<FSPath> > > CheckListings;
+    typedef std::unordered_map<std::string, EntryType> CheckEntryTypes;
+
+    EntryType entry_type_from_stat(const FSStat & f_stat)
+    {
+        if (! f_stat.exists())
+            return et_nothing;
+
+        if (f_stat.is_symlink())
+            return et_sym;
+
+        if (f_stat.is_regular_file())
+            return et_file;
+
+        if (f_stat.is_directory())
+            return et_dir;
+
+        return et_misc;
+    }
+
+    EntryType entry_type_from_entry(const FSDirEntry & e)
+    {
+        if (e.is_symlink())
+            return et_sym;
+
+        if (e.is_regular_file())
+            return et_file;
+
+        if (e.is_directory())
+            return et_dir;
+
+        return et_misc;
+    }
+
+    /* Walks the image ahead of the check pass, listing every directory and
+     * classifying every source and destination entry. Each directory is its
+     * own task, and spawns a task for each of its subdirectories. */
+    class CheckPrefetcher
+    {
+        private:
+            TaskGroup _group;
+            std::atomic<bool> _failed;
+
+            std::mutex _results_mutex;
+            CheckListings & _listings;
+            CheckEntryTypes & _types;
+
+            void _process(const FSPath & src_path, const FSPath & dst_path)
+            {
+                auto entries(std::make_shared<std::vector<FSPath> >());
+                std::vector<std::pair<std::string, EntryType> > types;
+
+                /* if there's no directory at the destination, nothing in
+                 * it can exist, so don't bother statting */
+                std::unique_ptr<FSDirWalker> dst_dir;
+                if (dst_path.stat().is_directory_or_symlink_to_directory())
+                    dst_dir.reset(new FSDirWalker(dst_path));
+
+                FSDirWalker src_dir(src_path);
+                src_dir.walk({ fsio_include_dotfiles, fsio_inode_sort }, [&] (const FSDirEntry & e) {
+                        FSPath src(e.path());
+                        entries->push_back(src);
+
+                        EntryType src_type(entry_type_from_entry(e));
+                        types.push_back(std::make_pair(stringify(src), src_type));
+
+                        FSPath dst(dst_path / e.name_string());
+                        types.push_back(std::make_pair(stringify(dst), dst_dir ?
+                                    entry_type_from_stat(dst_dir->stat_entry(e.name_string())) : et_nothing));
+
+                        if (et_dir == src_type)
+                            _spawn(src, dst);
+                    });
+
+                std::unique_lock<std::mutex> lock(_results_mutex);
+                _listings.insert(std::make_pair(stringify(src_path), entries));
+                _types.insert(types.begin(), types.end());
+            }
+
+            void _spawn(const FSPath & src, const FSPath & dst)
+            {
+                _group.spawn([this, src, dst] () {
+                        try
+                        {
+                            _process(src, dst);
+                        }
+                        catch (const Exception & e)
+                        {
+                            Log::get_instance()->message("merger.check.prefetch_failed", ll_debug, lc_no_context)
+                                << "Prefetching '" << src << "' failed: '" << e.message() << "' (" << e.what() << ")";
+                            _failed.store(true);
+                            _group.cancel();
+                        }
+                    });
+            }
+
+        public:
+            CheckPrefetcher(CheckListings & l, CheckEntryTypes & t) :
+                _failed(false),
+                _listings(l),
+                _types(t)
+            {
+            }
+
+            bool run(const FSPath & src, const FSPath & dst)
+            {
+                _spawn(src, dst);
+
+                try
+                {
+                    _group.wait();
+                }
+                catch (...)
+                {
+                    _failed.store(true);
+                }
+
+                return ! _failed.load();
+            }
+    };
+}
+
 namespace paludis
 {
     template <>
@@ -50,6 +182,10 @@ namespace paludis
 
         std::set<FSPath, FSPathComparator> fixed_entries;
 
+        /* only populated for the duration of check() */
+        CheckListings check_listings;
+        CheckEntryTypes check_entry_types;
+
         Imp(const MergerParams & p) :
             params(p),
             result(true),
@@ -87,7 +223,29 @@ Merger::check()
                 _imp->params.maybe_output_manager()).max_exit_status())
         make_check_fail();
 
-    do_dir_recursive(true, _imp->params.image(), _imp->params.root() / _imp->params.install_under());
+    if (_imp->params.image().stat().is_directory())
+    {
+        CheckPrefetcher prefetcher(_imp->check_listings, _imp->check_entry_types);
+        if (! prefetcher.run(_imp->params.image(), _imp->params.root() / _imp->params.install_under()))
+        {
+            _imp->check_listings.clear();
+            _imp->check_entry_types.clear();
+        }
+    }
+
+    try
+    {
+        do_dir_recursive(true, _imp->params.image(), _imp->params.root() / _imp->params.install_under());
+    }
+    catch (...)
+    {
+        _imp->check_listings.clear();
+        _imp->check_entry_types.clear();
+        throw;
+    }
+
+    _imp->check_listings.clear();
+    _imp->check_entry_types.clear();
 
     if (0 != _imp->params.environment()->perform_hook(extend_hook(
                          Hook("merger_check_post")
@@ -148,11 +306,24 @@ Merger::do_dir_recursive(bool is_check, const FSPath & src, const FSPath & dst)
 
     on_enter_dir(is_check, src);
 
-    FSIterator d(src, { fsio_include_dotfiles, fsio_inode_sort }), d_end;
+    std::shared_ptr<const std::vector<FSPath> > entries;
+    std::vector<EntryType> types;
+    auto listing(_imp->check_listings.find(stringify(src)));
+    if (is_check && _imp->check_listings.end() != listing)
+        entries = listing->second;
+    else
+    {
+        auto e(std::make_shared<std::vector<FSPath> >());
+        FSDirWalker(src).walk({ fsio_include_dotfiles, fsio_inode_sort }, [&] (const FSDirEntry & d) {
+                e->push_back(d.path());
+                types.push_back(entry_type_from_entry(d));
+            });
+        entries = e;
+    }
 
     if (is_check)
     {
-        if (d == d_end && dst != _imp->params.root().realpath())
+        if (entries->empty() && dst != _imp->params.root().realpath())
         {
             if (_imp->params.options()[mo_allow_empty_dirs])
                 Log::get_instance()->message("merger.empty_directory", ll_warning, lc_context) << "Installing empty directory '"
@@ -162,9 +333,9 @@ Merger::do_dir_recursive(bool is_check, const FSPath & src, const FSPath & dst)
         }
     }
 
-    for ( ; d != d_end ; ++d)
+    for (auto d(entries->begin()), d_end(entries->end()) ; d != d_end ; ++d)
     {
-        EntryType m(entry_type(*d));
+        EntryType m(types.empty() ? entry_type(*d) : types[d - entries->begin()]);
         switch (m)
         {
             case et_sym:
@@ -177,7 +348,9 @@ Merger::do_dir_recursive(bool is_check, const FSPath & src, const FSPath & dst)
 
             case et_dir:
                 on_dir(is_check, *d, dst);
-                if (_imp->result)
+                /* a failed check stops us checking any deeper, but a merge
+                 * must never silently leave out subdirectories */
+                if (_imp->result || ! is_check)
                 {
                     if (! _imp->skip_dir)
                         do_dir_recursive(is_check, *d,
@@ -217,21 +390,11 @@ Merger::entry_type(const FSPath & f)
 {
     Context context("When checking type of '" + stringify(f) + "':");
 
-    FSStat f_stat(f);
-
-    if (! f_stat.exists())
-        return et_nothing;
-
-    if (f_stat.is_symlink())
-        return et_sym;
+    auto t(_imp->check_entry_types.find(stringify(f)));
+    if (_imp->check_entry_types.end() != t)
+        return t->second;
 
-    if (f_stat.is_regular_file())
-        return et_file;
-
-    if (f_stat.is_directory())
-        return et_dir;
-
-    return et_misc;
+    return entry_type_from_stat(FSStat(f));
 }
 
 void
@@ -419,54 +582,54 @@ Merger::set_skipped_dir(const bool value)
 void
 Merger::do_ownership_fixes_recursive(const FSPath & dir)
 {
-    for (FSIterator d(dir, { fsio_include_dotfiles, fsio_inode_sort }), d_end ; d != d_end ; ++d)
-    {
-        std::pair<uid_t, gid_t> new_ids(_imp->params.get_new_ids_or_minus_one()(*d));
-        if (uid_t(-1) != new_ids.first || gid_t(-1) != new_ids.second)
-        {
-            FSPath f(*d);
-            FSStat f_stat(f);
-            f.lchown(new_ids.first, new_ids.second);
+    FSDirWalker(dir).walk({ fsio_include_dotfiles, fsio_inode_sort }, [&] (const FSDirEntry & d) {
+            FSPath f(d.path());
+            EntryType m(entry_type_from_entry(d));
 
-            if (et_sym != entry_type(*d))
+            std::pair<uid_t, gid_t> new_ids(_imp->params.get_new_ids_or_minus_one()(f));
+            if (uid_t(-1) != new_ids.first || gid_t(-1) != new_ids.second)
             {
-                mode_t mode(f_stat.permissions());
+                FSStat f_stat(d.stat());
+                f.lchown(new_ids.first, new_ids.second);
 
-                if (et_dir == entry_type(*d))
+                if (et_sym != m)
                 {
-                    if (uid_t(-1) != new_ids.first)
-                        mode &= ~S_ISUID;
-                    if (gid_t(-1) != new_ids.second)
-                        mode &= ~S_ISGID;
+                    mode_t mode(f_stat.permissions());
+
+                    if (et_dir == m)
+                    {
+                        if (uid_t(-1) != new_ids.first)
+                            mode &= ~S_ISUID;
+                        if (gid_t(-1) != new_ids.second)
+                            mode &= ~S_ISGID;
+                    }
+
+                    f.chmod(mode); /* set*id */
                 }
 
-                f.chmod(mode); /* set*id */
+                _imp->fixed_entries.insert(f);
             }
 
-            _imp->fixed_entries.insert(f);
-        }
+            switch (m)
+            {
+                case et_sym:
+                case et_file:
+                    return;
 
-        EntryType m(entry_type(*d));
-        switch (m)
-        {
-            case et_sym:
-            case et_file:
-                continue;
+                case et_dir:
+                    do_ownership_fixes_recursive(f);
+                    return;
 
-            case et_dir:
-                do_ownership_fixes_recursive(*d);
-                continue;
-
-            case et_misc:
-                throw MergerError("Unexpected 'et_misc' entry found at: " + stringify(*d));
+                case et_misc:
+                    throw MergerError("Unexpected 'et_misc' entry found at: " + stringify(f));
 
-            case et_nothing:
-            case last_et:
-                break;
-        }
+                case et_nothing:
+                case last_et:
+                    break;
+            }
 
-        throw InternalError(PALUDIS_HERE, "Unexpected entry_type '" + stringify(m) + "'");
-    }
+            throw InternalError(PALUDIS_HERE, "Unexpected entry_type '" + stringify(m) + "'");
+        });
 }
 
 bool
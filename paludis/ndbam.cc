@@ -31,6 +31,7 @@
 #include <paludis/util/timestamp.hh>
 #include <paludis/util/fs_stat.hh>
 #include <paludis/util/fs_iterator.hh>
+#include <paludis/util/fs_dir_walker.hh>
 #include <paludis/util/fs_error.hh>
 #include <paludis/ndbam.hh>
 #include <paludis/package_id.hh>
@@ -148,26 +149,25 @@ NDBAM::category_names()
     {
         Context context("When loading category names for NDBAM at '" + stringify(_imp->location) + "':");
         _imp->category_names = std::make_shared<CategoryNamePartSet>();
-        for (FSIterator d(_imp->location / "indices" / "categories", { fsio_want_directories, fsio_deref_symlinks_for_wants }), d_end ;
-                d != d_end ; ++d)
-        {
-            if ('-' == d->basename().at(0))
-                continue;
+        FSDirWalker(_imp->location / "indices" / "categories").walk({ fsio_want_directories, fsio_deref_symlinks_for_wants },
+                [&] (const FSDirEntry & d) {
+                    if ('-' == d.name()[0])
+                        return;
 
-            try
-            {
-                CategoryNamePart c(d->basename());
-                _imp->category_names->insert(c);
-                /* Inserting into category_contents_map might return false if
-                 * we're partially populated. That's ok. */
-                _imp->category_contents_map.insert(std::make_pair(c, std::make_shared<CategoryContents>()));
-            }
-            catch (const NameError & e)
-            {
-                Log::get_instance()->message("ndbam.categories.skipping", ll_warning, lc_context) <<
-                    "Skipping directory '" << *d << "' due to exception '" << e.message() << "' (" << e.what() << ")";
-            }
-        }
+                    try
+                    {
+                        CategoryNamePart c(d.name_string());
+                        _imp->category_names->insert(c);
+                        /* Inserting into category_contents_map might return false if
+                         * we're partially populated. That's ok. */
+                        _imp->category_contents_map.insert(std::make_pair(c, std::make_shared<CategoryContents>()));
+                    }
+                    catch (const NameError & e)
+                    {
+                        Log::get_instance()->message("ndbam.categories.skipping", ll_warning, lc_context) <<
+                            "Skipping directory '" << d.path() << "' due to exception '" << e.message() << "' (" << e.what() << ")";
+                    }
+                });
     }
 
     return _imp->category_names;
@@ -191,26 +191,25 @@ NDBAM::package_names(const CategoryNamePart & c)
     {
         Context context("When loading package names in '" + stringify(c) + "' for NDBAM at '" + stringify(_imp->location) + "':");
         cc.package_names = std::make_shared<QualifiedPackageNameSet>();
-        for (FSIterator d(_imp->location / "indices" / "categories" / stringify(c), { fsio_want_directories, fsio_deref_symlinks_for_wants }), d_end ;
-                d != d_end ; ++d)
-        {
-            if ('-' == d->basename().at(0))
-                continue;
+        FSDirWalker(_imp->location / "indices" / "categories" / stringify(c)).walk({ fsio_want_directories, fsio_deref_symlinks_for_wants },
+                [&] (const FSDirEntry & d) {
+                    if ('-' == d.name()[0])
+                        return;
 
-            try
-            {
-                QualifiedPackageName q(c + PackageNamePart(d->basename()));
-                cc.package_names->insert(q);
-                /* Inserting into package_contents_map might return false if
-                 * we're partially populated. That's ok. */
-                cc.package_contents_map.insert(std::make_pair(q, std::make_shared<PackageContents>()));
-            }
-            catch (const NameError & e)
-            {
-                Log::get_instance()->message("ndbam.packages.skipping", ll_warning, lc_context)
-                    << "Skipping directory '" << *d << "' due to exception '" << e.message() << "' (" << e.what() << ")";
-            }
-        }
+                    try
+                    {
+                        QualifiedPackageName q(c + PackageNamePart(d.name_string()));
+                        cc.package_names->insert(q);
+                        /* Inserting into package_contents_map might return false if
+                         * we're partially populated. That's ok. */
+                        cc.package_contents_map.insert(std::make_pair(q, std::make_shared<PackageContents>()));
+                    }
+                    catch (const NameError & e)
+                    {
+                        Log::get_instance()->message("ndbam.packages.skipping", ll_warning, lc_context)
+                            << "Skipping directory '" << d.path() << "' due to exception '" << e.message() << "' (" << e.what() << ")";
+                    }
+                });
     }
     return cc.package_names;
 }
@@ -303,47 +302,45 @@ NDBAM::entries(const QualifiedPackageName & q)
         pc.entries = std::make_shared<NDBAMEntrySequence>();
         Context context("When loading versions in '" + stringify(q) + "' for NDBAM at '" + stringify(_imp->location) + "':");
         pc.entries = std::make_shared<NDBAMEntrySequence>();
-        for (FSIterator d(_imp->location / "indices" / "categories" / stringify(q.category()) / stringify(q.package()),
-                    { fsio_want_directories, fsio_deref_symlinks_for_wants }), d_end ;
-                d != d_end ; ++d)
-        {
-            if ('-' == d->basename().at(0))
-                continue;
-
-            try
-            {
-                std::vector<std::string> tokens;
-                tokenise<delim_kind::AnyOfTag, delim_mode::DelimiterTag>(d->basename(), ":", "", std::back_inserter(tokens));
-                if (tokens.size() < 3)
-                {
-                    Log::get_instance()->message("ndbam.ids.ignoring", ll_warning, lc_context) << "Not using '" << *d <<
-                        "', since it contains less than three ':'s";
-                    continue;
-                }
+        FSDirWalker(_imp->location / "indices" / "categories" / stringify(q.category()) / stringify(q.package())).walk(
+                { fsio_want_directories, fsio_deref_symlinks_for_wants }, [&] (const FSDirEntry & d) {
+                    if ('-' == d.name()[0])
+                        return;
 
-                VersionSpec v(tokens[0], _imp->version_options);
-                SlotName s(tokens[1]);
-                std::string m(tokens[2]);
-                pc.entries->push_back(std::make_shared<NDBAMEntry>(NDBAMEntry(make_named_values<NDBAMEntry>(
-                                        n::fs_location() = d->realpath(),
-                                        n::magic() = m,
-                                        n::mutex() = std::make_shared<std::mutex>(),
-                                        n::name() = q,
-                                        n::package_id() = std::shared_ptr<PackageID>(),
-                                        n::slot() = s,
-                                        n::version() = v
-                                ))));
-            }
-            catch (const InternalError &)
-            {
-                throw;
-            }
-            catch (const Exception & e)
-            {
-                Log::get_instance()->message("ndbam.ids.skipping", ll_warning, lc_context) << "Skipping directory '" << *d << "' due to exception '"
-                    << e.message() << "' (" << e.what() << ")";
-            }
-        }
+                    try
+                    {
+                        std::vector<std::string> tokens;
+                        tokenise<delim_kind::AnyOfTag, delim_mode::DelimiterTag>(d.name_string(), ":", "", std::back_inserter(tokens));
+                        if (tokens.size() < 3)
+                        {
+                            Log::get_instance()->message("ndbam.ids.ignoring", ll_warning, lc_context) << "Not using '" << d.path() <<
+                                "', since it contains less than three ':'s";
+                            return;
+                        }
+
+                        VersionSpec v(tokens[0], _imp->version_options);
+                        SlotName s(tokens[1]);
+                        std::string m(tokens[2]);
+                        pc.entries->push_back(std::make_shared<NDBAMEntry>(NDBAMEntry(make_named_values<NDBAMEntry>(
+                                                n::fs_location() = d.path().realpath(),
+                                                n::magic() = m,
+                                                n::mutex() = std::make_shared<std::mutex>(),
+                                                n::name() = q,
+                                                n::package_id() = std::shared_ptr<PackageID>(),
+                                                n::slot() = s,
+                                                n::version() = v
+                                        ))));
+                    }
+                    catch (const InternalError &)
+                    {
+                        throw;
+                    }
+                    catch (const Exception & e)
+                    {
+                        Log::get_instance()->message("ndbam.ids.skipping", ll_warning, lc_context) << "Skipping directory '" << d.path() << "' due to exception '"
+                            << e.message() << "' (" << e.what() << ")";
+                    }
+                });
 
         using namespace std::placeholders;
         pc.entries->sort(NDBAMEntryVersionComparator());
@@ -627,26 +624,25 @@ NDBAM::category_names_containing_package(const PackageNamePart & p) const
         FSPath dd(_imp->location / "indices" / "packages" / stringify(p));
         if (dd.stat().is_directory_or_symlink_to_directory())
         {
-            for (FSIterator d(dd, { fsio_want_directories, fsio_deref_symlinks_for_wants }), d_end ; d != d_end ; ++d)
-            {
-                if ('-' == d->basename().at(0))
-                    continue;
+            FSDirWalker(dd).walk({ fsio_want_directories, fsio_deref_symlinks_for_wants }, [&] (const FSDirEntry & d) {
+                    if ('-' == d.name()[0])
+                        return;
 
-                try
-                {
-                    cncp.category_names_containing_package->insert(CategoryNamePart(d->basename()));
-                }
-                catch (const InternalError &)
-                {
-                    throw;
-                }
-                catch (const Exception & e)
-                {
-                    Log::get_instance()->message("ndbam.categories.skipping", ll_warning, lc_context)
-                        << "Skipping directory '" << *d << "' due to exception '"
-                        << e.message() << "' (" << e.what() << ")";
-                }
-            }
+                    try
+                    {
+                        cncp.category_names_containing_package->insert(CategoryNamePart(d.name_string()));
+                    }
+                    catch (const InternalError &)
+                    {
+                        throw;
+                    }
+                    catch (const Exception & e)
+                    {
+                        Log::get_instance()->message("ndbam.categories.skipping", ll_warning, lc_context)
+                            << "Skipping directory '" << d.path() << "' due to exception '"
+                            << e.message() << "' (" << e.what() << ")";
+                    }
+                });
         }
     }
 
@@ -36,7 +36,6 @@
 #include <paludis/util/hashes.hh>
 
 #include <functional>
-#include <unordered_map>
 #include <list>
 #include <algorithm>
 
@@ -161,28 +160,12 @@ paludis::operator== (const PackageID & a, const PackageID & b)
         && (! b.arbitrary_less_than_comparison(a));
 }
 
-namespace paludis
-{
-    template <>
-    struct Imp<PackageIDComparator>
-    {
-        std::unordered_map<RepositoryName, unsigned, Hash<RepositoryName> > m;
-    };
-}
-
 PackageIDComparator::PackageIDComparator(const Environment * const e) :
-    _imp()
+    _env(e)
 {
-    unsigned c(0);
-    for (const auto & repository : e->repositories())
-        _imp->m.insert(std::make_pair(repository->name(), ++c));
 }
 
-PackageIDComparator::PackageIDComparator(const PackageIDComparator & other) :
-    _imp()
-{
-    _imp->m = other._imp->m;
-}
+PackageIDComparator::PackageIDComparator(const PackageIDComparator &) = default;
 
 PackageIDComparator::~PackageIDComparator() = default;
 
@@ -190,29 +173,22 @@ bool
 PackageIDComparator::operator() (const std::shared_ptr<const PackageID> & a,
         const std::shared_ptr<const PackageID> & b) const
 {
-    if (a->name() < b->name())
+    /* these return by value, so only fetch each once */
+    const QualifiedPackageName a_name(a->name()), b_name(b->name());
+    if (a_name < b_name)
         return true;
-
-    if (a->name() > b->name())
+    if (b_name < a_name)
         return false;
 
-    if (a->version() < b->version())
+    const VersionSpec a_version(a->version()), b_version(b->version());
+    if (a_version < b_version)
         return true;
-
-    if (a->version() > b->version())
+    if (b_version < a_version)
         return false;
 
-    std::unordered_map<RepositoryName, unsigned, Hash<RepositoryName> >::const_iterator
-        ma(_imp->m.find(a->repository_name())),
-        mb(_imp->m.find(b->repository_name()));
-
-    if (ma == _imp->m.end() || mb == _imp->m.end())
-        throw InternalError(PALUDIS_HERE, "Repository not in database");
-
-    if (ma->second < mb->second)
-        return true;
-    if (ma->second > mb->second)
-        return false;
+    const RepositoryName a_repository(a->repository_name()), b_repository(b->repository_name());
+    if (a_repository != b_repository)
+        return _env->repository_rank(a_repository) < _env->repository_rank(b_repository);
 
     return a->arbitrary_less_than_comparison(*b);
 }
@@ -426,6 +426,8 @@ namespace paludis
      * repository's importance according to the supplied Environment,
      * and Environment::arbitrary_less_than_comparison.
      *
+     * Comparators are cheap to create and to copy.
+     *
      * \ingroup g_package_id
      * \since 0.26
      * \nosubgrouping
@@ -433,7 +435,7 @@ namespace paludis
     class PALUDIS_VISIBLE PackageIDComparator
     {
         private:
-            Pimp<PackageIDComparator> _imp;
+            const Environment * _env;
 
         public:
             ///\name Standard library typedefs
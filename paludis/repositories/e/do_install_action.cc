@@ -39,6 +39,7 @@
 #include <paludis/util/join.hh>
 #include <paludis/util/return_literal_function.hh>
 #include <paludis/util/tokeniser.hh>
+#include <paludis/util/destringify.hh>
 
 #include <paludis/action.hh>
 #include <paludis/dep_spec_flattener.hh>
@@ -335,6 +336,7 @@ paludis::erepository::do_install_action(
                             ELikeSymbolsChoiceValue::canonical_name_with_prefix()));
 
                 auto dwarf_compression(choices->find_by_name_with_prefix(ELikeDwarfCompressionChoiceValue::canonical_name_with_prefix()));
+                auto jobs_choice(choices->find_by_name_with_prefix(ELikeJobsChoiceValue::canonical_name_with_prefix()));
 
                 EStripper stripper(make_named_values<EStripperOptions>(
                             n::compress_splits() = symbols_choice && symbols_choice->enabled() && ELikeSymbolsChoiceValue::should_compress(
@@ -342,6 +344,7 @@ paludis::erepository::do_install_action(
                             n::debug_dir() = package_builddir / "image" / "usr" / libdir / "debug",
                             n::dwarf_compression() = dwarf_compression && dwarf_compression->enabled(),
                             n::image_dir() = package_builddir / "image",
+                            n::jobs() = jobs_choice && jobs_choice->enabled() ? destringify<unsigned>(jobs_choice->parameter()) : 1,
                             n::output_manager() = output_manager,
                             n::package_id() = id,
                             n::split() = symbols_choice && symbols_choice->enabled() && ELikeSymbolsChoiceValue::should_split(symbols_choice->parameter()),
@@ -0,0 +1,257 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2026 agent
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <paludis/repositories/e/e_installed_metadata_record.hh>
+#include <paludis/util/pimp-impl.hh>
+#include <paludis/util/log.hh>
+#include <paludis/util/cache_file.hh>
+#include <paludis/util/exception.hh>
+#include <paludis/util/fs_path.hh>
+#include <paludis/util/fs_stat.hh>
+#include <paludis/util/fs_dir_walker.hh>
+#include <paludis/util/fs_iterator.hh>
+#include <paludis/util/options.hh>
+#include <paludis/util/fs_error.hh>
+#include <paludis/util/stringify.hh>
+#include <paludis/util/destringify.hh>
+#include <paludis/util/safe_ifstream.hh>
+#include <paludis/util/timestamp.hh>
+#include <iterator>
+#include <map>
+
+using namespace paludis;
+using namespace paludis::erepository;
+
+namespace
+{
+    const std::string record_magic("paludis-installed-metadata-2");
+
+    /* anything bigger than this is probably not a metadata variable, and
+     * isn't worth reading just in case */
+    const off_t max_contents_size(64 * 1024);
+
+    /* we might only be able to set times to the microsecond */
+    bool same_time(const Timestamp & a, const Timestamp & b)
+    {
+        return a.seconds() == b.seconds() && a.nanoseconds() / 1000 == b.nanoseconds() / 1000;
+    }
+
+    bool worth_holding(const std::string & name, const FSStat & s)
+    {
+        /* variables don't have dots in their names, unlike the saved ebuild
+         * and environment */
+        if (std::string::npos != name.find('.'))
+            return false;
+
+        if (name == "CONTENTS" || name == "contents")
+            return false;
+
+        return s.is_regular_file() && s.file_size() <= max_contents_size;
+    }
+
+    std::string read_file(const FSPath & f)
+    {
+        SafeIFStream i(f);
+        return std::string((std::istreambuf_iterator<char>(i)), std::istreambuf_iterator<char>());
+    }
+
+    struct Entry
+    {
+        bool has_contents;
+        std::string contents;
+        std::string size;
+        std::string seconds;
+        std::string nanoseconds;
+    };
+
+    /* rewriting a file in place doesn't change its directory's mtime, so
+     * anything we hold contents for has to be checked too */
+    bool still_matches(const FSPath & dir, const std::string & name, const Entry & entry)
+    {
+        FSStat s(dir / name);
+        return s.is_regular_file()
+            && stringify(s.file_size()) == entry.size
+            && same_time(s.mtim(), Timestamp(destringify<time_t>(entry.seconds), destringify<long>(entry.nanoseconds)));
+    }
+}
+
+namespace paludis
+{
+    template <>
+    struct Imp<EInstalledMetadataRecord>
+    {
+        std::map<std::string, Entry> entries;
+    };
+}
+
+const std::string EInstalledMetadataRecord::file_name("paludis-metadata");
+
+EInstalledMetadataRecord::EInstalledMetadataRecord() :
+    _imp()
+{
+}
+
+EInstalledMetadataRecord::~EInstalledMetadataRecord() = default;
+
+std::shared_ptr<const EInstalledMetadataRecord>
+EInstalledMetadataRecord::load(const FSPath & dir)
+{
+    Context context("When loading installed metadata record in '" + stringify(dir) + "':");
+
+    FSPath record_file(dir / file_name);
+    FSStat record_stat(record_file);
+    if (! record_stat.is_regular_file())
+        return nullptr;
+
+    try
+    {
+        if (! same_time(dir.stat().mtim(), record_stat.mtim()))
+        {
+            Log::get_instance()->message("e.installed_metadata_record.stale", ll_debug, lc_context)
+                << "Record is older than its directory";
+            return nullptr;
+        }
+
+        std::string data(read_file(record_file));
+        if (0 != data.compare(0, record_magic.length() + 1, record_magic + "\n"))
+            return nullptr;
+
+        std::shared_ptr<EInstalledMetadataRecord> result(new EInstalledMetadataRecord);
+        CacheFieldReader r(data, record_magic.length() + 1);
+        while (! (r.bad() || r.done()))
+        {
+            std::string name(r.get()), has_contents(r.get()), contents(r.get()), size(r.get()), seconds(r.get()), nanoseconds(r.get());
+            result->_imp->entries.insert(std::make_pair(name, Entry{ has_contents == "1", contents, size, seconds, nanoseconds }));
+        }
+
+        if (r.bad())
+            return nullptr;
+
+        for (const auto & e : result->_imp->entries)
+            if (e.second.has_contents && ! still_matches(dir, e.first, e.second))
+            {
+                Log::get_instance()->message("e.installed_metadata_record.stale", ll_debug, lc_context)
+                    << "Record is older than '" << e.first << "'";
+                return nullptr;
+            }
+
+        return result;
+    }
+    catch (const Exception & e)
+    {
+        Log::get_instance()->message("e.installed_metadata_record.failure", ll_warning, lc_context)
+            << "Not using record: " << e.message() << " (" << e.what() << ")";
+        return nullptr;
+    }
+}
+
+void
+EInstalledMetadataRecord::write(const FSPath & dir)
+{
+    Context context("When writing installed metadata record in '" + stringify(dir) + "':");
+
+    FSPath record_file(dir / file_name);
+
+    try
+    {
+        std::string data(record_magic + "\n");
+
+        FSDirWalker d(dir);
+        d.walk({ fsio_inode_sort, fsio_include_dotfiles }, [&] (const FSDirEntry & e) {
+                std::string name(e.name_string());
+                if (name == file_name || is_cache_file_temporary(name, file_name))
+                    return;
+
+                FSStat s(d.stat_entry(name));
+                put_cache_field(data, name);
+                if (worth_holding(name, s))
+                {
+                    put_cache_field(data, "1");
+                    put_cache_field(data, read_file(dir / name));
+                    put_cache_field(data, stringify(s.file_size()));
+                    put_cache_field(data, stringify(s.mtim().seconds()));
+                    put_cache_field(data, stringify(s.mtim().nanoseconds()));
+                }
+                else
+                {
+                    put_cache_field(data, "0");
+                    put_cache_field(data, "");
+                    put_cache_field(data, "");
+                    put_cache_field(data, "");
+                    put_cache_field(data, "");
+                }
+                });
+
+        write_cache_file(record_file, data);
+
+        /* the rename changes the directory's mtime, so it's only now that
+         * we know what to stamp the record with. on filesystems with coarse
+         * timestamps, something could be added to the directory later
+         * without changing its mtime, so we don't use a record there. */
+        Timestamp dir_mtime(dir.stat().mtim());
+        if (0 == dir_mtime.nanoseconds())
+        {
+            record_file.unlink();
+            return;
+        }
+
+        record_file.utime(dir_mtime);
+    }
+    catch (const Exception & e)
+    {
+        Log::get_instance()->message("e.installed_metadata_record.write_failure", ll_warning, lc_context)
+            << "Couldn't write record: " << e.message() << " (" << e.what() << ")";
+
+        /* the old record should look stale by now, but don't rely on it */
+        try
+        {
+            record_file.unlink();
+        }
+        catch (const FSError &)
+        {
+        }
+    }
+}
+
+bool
+EInstalledMetadataRecord::exists(const std::string & name) const
+{
+    return _imp->entries.end() != _imp->entries.find(name);
+}
+
+bool
+EInstalledMetadataRecord::has_contents(const std::string & name) const
+{
+    auto e(_imp->entries.find(name));
+    return _imp->entries.end() != e && e->second.has_contents;
+}
+
+const std::string &
+EInstalledMetadataRecord::contents(const std::string & name) const
+{
+    auto e(_imp->entries.find(name));
+    if (_imp->entries.end() == e || ! e->second.has_contents)
+        throw InternalError(PALUDIS_HERE, "No contents for '" + name + "' in record");
+    return e->second.contents;
+}
+
+namespace paludis
+{
+    template class Pimp<EInstalledMetadataRecord>;
+}
@@ -0,0 +1,97 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2026 agent
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PALUDIS_GUARD_PALUDIS_REPOSITORIES_E_E_INSTALLED_METADATA_RECORD_HH
+#define PALUDIS_GUARD_PALUDIS_REPOSITORIES_E_E_INSTALLED_METADATA_RECORD_HH 1
+
+#include <paludis/util/attributes.hh>
+#include <paludis/util/pimp.hh>
+#include <paludis/util/fs_path-fwd.hh>
+#include <memory>
+#include <string>
+
+namespace paludis
+{
+    namespace erepository
+    {
+        /**
+         * The contents of every small file in an installed package's VDB or
+         * exndbam directory, gathered into one file so that loading an
+         * installed ID does not need to stat and read each of them.
+         *
+         * A record is only used if its modification time matches that of
+         * its directory, which we arrange when writing it, so adding,
+         * removing or renaming anything in the directory makes the record
+         * stale. The record also remembers the size and modification time
+         * of each file whose contents it holds, so rewriting one of those in
+         * place makes it stale too. Anything which changes the directory
+         * should call write() again afterwards, so the record can be used.
+         */
+        class PALUDIS_VISIBLE EInstalledMetadataRecord
+        {
+            private:
+                Pimp<EInstalledMetadataRecord> _imp;
+
+                EInstalledMetadataRecord();
+
+            public:
+                ~EInstalledMetadataRecord();
+
+                /**
+                 * The name of the record file, inside the package's directory.
+                 */
+                static const std::string file_name;
+
+                /**
+                 * Load the record for a directory, or return a null pointer if
+                 * there isn't a usable one.
+                 */
+                static std::shared_ptr<const EInstalledMetadataRecord> load(const FSPath & dir)
+                    PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                /**
+                 * (Re)write the record for a directory. Failure is logged, not
+                 * thrown, since callers can manage without a record.
+                 */
+                static void write(const FSPath & dir);
+
+                /**
+                 * Did the directory contain a file of this name?
+                 */
+                bool exists(const std::string & name) const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                /**
+                 * Is the named file's content held in the record? Large files
+                 * and files which are not metadata variables are only listed,
+                 * and must be read from the directory.
+                 */
+                bool has_contents(const std::string & name) const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                /**
+                 * The content of the named file, which must satisfy
+                 * has_contents.
+                 */
+                const std::string & contents(const std::string & name) const PALUDIS_ATTRIBUTE((warn_unused_result));
+        };
+    }
+
+    extern template class Pimp<erepository::EInstalledMetadataRecord>;
+}
+
+#endif
@@ -27,6 +27,7 @@
 #include <paludis/repositories/e/e_choice_value.hh>
 #include <paludis/repositories/e/e_string_set_key.hh>
 #include <paludis/repositories/e/e_slot_key.hh>
+#include <paludis/repositories/e/e_installed_metadata_record.hh>
 
 #include <paludis/util/stringify.hh>
 #include <paludis/util/log.hh>
@@ -157,6 +158,11 @@ namespace paludis
         mutable std::shared_ptr<const MetadataValueKey<FSPath> > fs_location;
         mutable std::shared_ptr<const EAPI> eapi;
 
+        /* if we have a usable record, we don't need to look at the
+         * individual files. only touched with mutex held. */
+        mutable bool has_record;
+        mutable std::shared_ptr<const EInstalledMetadataRecord> record;
+
         Imp(const QualifiedPackageName & q, const VersionSpec & v,
                 const Environment * const e,
                 const RepositoryName & r, const FSPath & f) :
@@ -164,8 +170,34 @@ namespace paludis
             version(v),
             environment(e),
             repository_name(r),
-            dir(f)
+            dir(f),
+            has_record(false)
+        {
+        }
+
+        void need_record() const
+        {
+            if (has_record)
+                return;
+
+            record = EInstalledMetadataRecord::load(dir);
+            has_record = true;
+        }
+
+        bool has_file(const std::string & n) const
+        {
+            need_record();
+            if (record)
+                return record->exists(n);
+            return (dir / n).stat().exists();
+        }
+
+        std::string file(const std::string & n) const
         {
+            need_record();
+            if (record && record->has_contents(n))
+                return strip_trailing(record->contents(n), "\r\n");
+            return file_contents(dir / n);
         }
     };
 }
@@ -214,31 +246,31 @@ EInstalledRepositoryID::need_keys_added() const
     std::shared_ptr<const EAPIEbuildEnvironmentVariables> env(eapi()->supported()->ebuild_environment_variables());
 
     if (! env->env_use().empty())
-        if ((_imp->dir / env->env_use()).stat().exists())
+        if (_imp->has_file(env->env_use()))
         {
-            _imp->keys->raw_use = EStringSetKeyStore::get_instance()->fetch(vars->use(), file_contents(_imp->dir / env->env_use()), mkt_internal);
+            _imp->keys->raw_use = EStringSetKeyStore::get_instance()->fetch(vars->use(), _imp->file(env->env_use()), mkt_internal);
             add_metadata_key(_imp->keys->raw_use);
         }
 
     if (! vars->slot()->name().empty())
-        if ((_imp->dir / vars->slot()->name()).stat().exists())
+        if (_imp->has_file(vars->slot()->name()))
         {
-            _imp->keys->slot = ESlotKeyStore::get_instance()->fetch(*eapi(), vars->slot(), file_contents(_imp->dir / vars->slot()->name()), mkt_internal);
+            _imp->keys->slot = ESlotKeyStore::get_instance()->fetch(*eapi(), vars->slot(), _imp->file(vars->slot()->name()), mkt_internal);
             add_metadata_key(_imp->keys->slot);
         }
 
     if (! vars->inherited()->name().empty())
-        if ((_imp->dir / vars->inherited()->name()).stat().exists())
+        if (_imp->has_file(vars->inherited()->name()))
         {
             _imp->keys->inherited = EStringSetKeyStore::get_instance()->fetch(vars->inherited(),
-                    file_contents(_imp->dir / vars->inherited()->name()), mkt_internal);
+                    _imp->file(vars->inherited()->name()), mkt_internal);
             add_metadata_key(_imp->keys->inherited);
         }
 
     if (! vars->defined_phases()->name().empty())
-        if ((_imp->dir / vars->defined_phases()->name()).stat().exists())
+        if (_imp->has_file(vars->defined_phases()->name()))
         {
-            std::string d(file_contents(_imp->dir / vars->defined_phases()->name()));
+            std::string d(_imp->file(vars->defined_phases()->name()));
             if (! strip_leading(d, " \t\r\n").empty())
             {
                 _imp->keys->defined_phases = EStringSetKeyStore::get_instance()->fetch(vars->defined_phases(),
@@ -248,9 +280,9 @@ EInstalledRepositoryID::need_keys_added() const
         }
 
     if (! vars->scm_revision()->name().empty())
-        if ((_imp->dir / vars->scm_revision()->name()).stat().exists())
+        if (_imp->has_file(vars->scm_revision()->name()))
         {
-            std::string d(file_contents(_imp->dir / vars->scm_revision()->name()));
+            std::string d(_imp->file(vars->scm_revision()->name()));
             if (! d.empty())
             {
                 _imp->keys->scm_revision = std::make_shared<LiteralMetadataValueKey<std::string> >(vars->scm_revision()->name(),
@@ -261,9 +293,9 @@ EInstalledRepositoryID::need_keys_added() const
 
     if (! vars->iuse()->name().empty())
     {
-        if ((_imp->dir / vars->iuse()->name()).stat().exists())
+        if (_imp->has_file(vars->iuse()->name()))
             _imp->keys->raw_iuse = EStringSetKeyStore::get_instance()->fetch(vars->iuse(),
-                    file_contents(_imp->dir / vars->iuse()->name()), mkt_internal);
+                    _imp->file(vars->iuse()->name()), mkt_internal);
         else
         {
             /* hack: if IUSE doesn't exist, we still need an iuse_key to make the choices
@@ -276,26 +308,26 @@ EInstalledRepositoryID::need_keys_added() const
 
     if (! vars->iuse_effective()->name().empty())
     {
-        if ((_imp->dir / vars->iuse_effective()->name()).stat().exists())
+        if (_imp->has_file(vars->iuse_effective()->name()))
         {
             _imp->keys->raw_iuse_effective = EStringSetKeyStore::get_instance()->fetch(vars->iuse_effective(),
-                    file_contents(_imp->dir / vars->iuse_effective()->name()), mkt_internal);
+                    _imp->file(vars->iuse_effective()->name()), mkt_internal);
             add_metadata_key(_imp->keys->raw_iuse_effective);
         }
     }
 
     if (! vars->myoptions()->name().empty())
-        if ((_imp->dir / vars->myoptions()->name()).stat().exists())
+        if (_imp->has_file(vars->myoptions()->name()))
         {
             _imp->keys->raw_myoptions = std::make_shared<EMyOptionsKey>(_imp->environment, vars->myoptions(),
-                        eapi(), file_contents(_imp->dir / vars->myoptions()->name()), mkt_internal, is_installed());
+                        eapi(), _imp->file(vars->myoptions()->name()), mkt_internal, is_installed());
             add_metadata_key(_imp->keys->raw_myoptions);
         }
 
     if (! vars->required_use()->name().empty())
-        if ((_imp->dir / vars->required_use()->name()).stat().exists())
+        if (_imp->has_file(vars->required_use()->name()))
         {
-            std::string v(file_contents(_imp->dir / vars->required_use()->name()));
+            std::string v(_imp->file(vars->required_use()->name()));
             if (! strip_leading(v, " \t\r\n").empty())
             {
                 _imp->keys->required_use = std::make_shared<ERequiredUseKey>(_imp->environment, vars->required_use(),
@@ -305,34 +337,34 @@ EInstalledRepositoryID::need_keys_added() const
         }
 
     if (! vars->use_expand()->name().empty())
-        if ((_imp->dir / vars->use_expand()->name()).stat().exists())
+        if (_imp->has_file(vars->use_expand()->name()))
         {
             _imp->keys->raw_use_expand = EStringSetKeyStore::get_instance()->fetch(vars->use_expand(),
-                    file_contents(_imp->dir / vars->use_expand()->name()), mkt_internal);
+                    _imp->file(vars->use_expand()->name()), mkt_internal);
             add_metadata_key(_imp->keys->raw_use_expand);
         }
 
     if (! vars->use_expand_hidden()->name().empty())
-        if ((_imp->dir / vars->use_expand_hidden()->name()).stat().exists())
+        if (_imp->has_file(vars->use_expand_hidden()->name()))
         {
             _imp->keys->raw_use_expand_hidden = EStringSetKeyStore::get_instance()->fetch(vars->use_expand_hidden(),
-                    file_contents(_imp->dir / vars->use_expand_hidden()->name()), mkt_internal);
+                    _imp->file(vars->use_expand_hidden()->name()), mkt_internal);
             add_metadata_key(_imp->keys->raw_use_expand_hidden);
         }
 
     if (! vars->license()->name().empty())
-        if ((_imp->dir / vars->license()->name()).stat().exists())
+        if (_imp->has_file(vars->license()->name()))
         {
             _imp->keys->license = std::make_shared<ELicenseKey>(_imp->environment, vars->license(), eapi(),
-                        file_contents(_imp->dir / vars->license()->name()), mkt_normal, is_installed());
+                        _imp->file(vars->license()->name()), mkt_normal, is_installed());
             add_metadata_key(_imp->keys->license);
         }
 
     if (! vars->dependencies()->name().empty())
     {
-        if ((_imp->dir / vars->dependencies()->name()).stat().exists())
+        if (_imp->has_file(vars->dependencies()->name()))
         {
-            std::string v(file_contents(_imp->dir / vars->dependencies()->name()));
+            std::string v(_imp->file(vars->dependencies()->name()));
             if (! strip_leading(v, " \t\r\n").empty())
             {
                 _imp->keys->dependencies = std::make_shared<EDependenciesKey>(_imp->environment, shared_from_this(), vars->dependencies()->name(),
@@ -345,9 +377,9 @@ EInstalledRepositoryID::need_keys_added() const
     else
     {
         if (! vars->build_depend()->name().empty())
-            if ((_imp->dir / vars->build_depend()->name()).stat().exists())
+            if (_imp->has_file(vars->build_depend()->name()))
             {
-                std::string v(file_contents(_imp->dir / vars->build_depend()->name()));
+                std::string v(_imp->file(vars->build_depend()->name()));
                 if (! strip_leading(v, " \t\r\n").empty())
                 {
                     _imp->keys->build_dependencies = std::make_shared<EDependenciesKey>(_imp->environment, shared_from_this(), vars->build_depend()->name(),
@@ -358,9 +390,9 @@ EInstalledRepositoryID::need_keys_added() const
             }
 
         if (! vars->run_depend()->name().empty())
-            if ((_imp->dir / vars->run_depend()->name()).stat().exists())
+            if (_imp->has_file(vars->run_depend()->name()))
             {
-                std::string v(file_contents(_imp->dir / vars->run_depend()->name()));
+                std::string v(_imp->file(vars->run_depend()->name()));
                 if (! strip_leading(v, " \t\r\n").empty())
                 {
                     _imp->keys->run_dependencies = std::make_shared<EDependenciesKey>(_imp->environment, shared_from_this(), vars->run_depend()->name(),
@@ -372,9 +404,9 @@ EInstalledRepositoryID::need_keys_added() const
 
         if (! vars->pdepend()->name().empty())
         {
-            if ((_imp->dir / vars->pdepend()->name()).stat().exists())
+            if (_imp->has_file(vars->pdepend()->name()))
             {
-                std::string v(file_contents(_imp->dir / vars->pdepend()->name()));
+                std::string v(_imp->file(vars->pdepend()->name()));
                 if (! strip_leading(v, " \t\r\n").empty())
                 {
                     _imp->keys->post_dependencies = std::make_shared<EDependenciesKey>(_imp->environment, shared_from_this(), vars->pdepend()->name(),
@@ -387,9 +419,9 @@ EInstalledRepositoryID::need_keys_added() const
     }
 
     if (! vars->restrictions()->name().empty())
-        if ((_imp->dir / vars->restrictions()->name()).stat().exists())
+        if (_imp->has_file(vars->restrictions()->name()))
         {
-            std::string v(file_contents(_imp->dir / vars->restrictions()->name()));
+            std::string v(_imp->file(vars->restrictions()->name()));
             if (! strip_leading(v, " \t\r\n").empty())
             {
                 _imp->keys->restrictions = std::make_shared<EPlainTextSpecKey>(_imp->environment, vars->restrictions(),
@@ -399,9 +431,9 @@ EInstalledRepositoryID::need_keys_added() const
         }
 
     if (! vars->properties()->name().empty())
-        if ((_imp->dir / vars->properties()->name()).stat().exists())
+        if (_imp->has_file(vars->properties()->name()))
         {
-            std::string v(file_contents(_imp->dir / vars->properties()->name()));
+            std::string v(_imp->file(vars->properties()->name()));
             if (! strip_leading(v, " \t\r\n").empty())
             {
                 _imp->keys->properties = std::make_shared<EPlainTextSpecKey>(_imp->environment, vars->properties(),
@@ -411,25 +443,25 @@ EInstalledRepositoryID::need_keys_added() const
         }
 
     if (! vars->src_uri()->name().empty())
-        if ((_imp->dir / vars->src_uri()->name()).stat().exists())
+        if (_imp->has_file(vars->src_uri()->name()))
         {
             _imp->keys->src_uri = std::make_shared<EFetchableURIKey>(_imp->environment, shared_from_this(), vars->src_uri(),
-                        file_contents(_imp->dir / vars->src_uri()->name()), mkt_dependencies);
+                        _imp->file(vars->src_uri()->name()), mkt_dependencies);
             add_metadata_key(_imp->keys->src_uri);
         }
 
     if (! vars->short_description()->name().empty())
-        if ((_imp->dir / vars->short_description()->name()).stat().exists())
+        if (_imp->has_file(vars->short_description()->name()))
         {
             _imp->keys->short_description = std::make_shared<LiteralMetadataValueKey<std::string> >(vars->short_description()->name(),
-                        vars->short_description()->description(), mkt_significant, file_contents(_imp->dir / vars->short_description()->name()));
+                        vars->short_description()->description(), mkt_significant, _imp->file(vars->short_description()->name()));
             add_metadata_key(_imp->keys->short_description);
         }
 
     if (! vars->long_description()->name().empty())
-        if ((_imp->dir / vars->long_description()->name()).stat().exists())
+        if (_imp->has_file(vars->long_description()->name()))
         {
-            std::string value(file_contents(_imp->dir / vars->long_description()->name()));
+            std::string value(_imp->file(vars->long_description()->name()));
             if (! strip_leading(value, " \t\r\n").empty())
             {
                 _imp->keys->long_description = std::make_shared<LiteralMetadataValueKey<std::string> >(vars->long_description()->name(),
@@ -439,9 +471,9 @@ EInstalledRepositoryID::need_keys_added() const
         }
 
     if (! vars->upstream_changelog()->name().empty())
-        if ((_imp->dir / vars->upstream_changelog()->name()).stat().exists())
+        if (_imp->has_file(vars->upstream_changelog()->name()))
         {
-            std::string value(file_contents(_imp->dir / vars->upstream_changelog()->name()));
+            std::string value(_imp->file(vars->upstream_changelog()->name()));
             if (! strip_leading(value, " \t\r\n").empty())
             {
                 _imp->keys->upstream_changelog = std::make_shared<ESimpleURIKey>(_imp->environment,
@@ -451,9 +483,9 @@ EInstalledRepositoryID::need_keys_added() const
         }
 
     if (! vars->upstream_release_notes()->name().empty())
-        if ((_imp->dir / vars->upstream_release_notes()->name()).stat().exists())
+        if (_imp->has_file(vars->upstream_release_notes()->name()))
         {
-            std::string value(file_contents(_imp->dir / vars->upstream_release_notes()->name()));
+            std::string value(_imp->file(vars->upstream_release_notes()->name()));
             if (! strip_leading(value, " \t\r\n").empty())
             {
                 _imp->keys->upstream_release_notes = std::make_shared<ESimpleURIKey>(_imp->environment,
@@ -463,9 +495,9 @@ EInstalledRepositoryID::need_keys_added() const
         }
 
     if (! vars->upstream_documentation()->name().empty())
-        if ((_imp->dir / vars->upstream_documentation()->name()).stat().exists())
+        if (_imp->has_file(vars->upstream_documentation()->name()))
         {
-            std::string value(file_contents(_imp->dir / vars->upstream_documentation()->name()));
+            std::string value(_imp->file(vars->upstream_documentation()->name()));
             if (! strip_leading(value, " \t\r\n").empty())
             {
                 _imp->keys->upstream_documentation = std::make_shared<ESimpleURIKey>(_imp->environment,
@@ -475,9 +507,9 @@ EInstalledRepositoryID::need_keys_added() const
         }
 
     if (! vars->bugs_to()->name().empty())
-        if ((_imp->dir / vars->bugs_to()->name()).stat().exists())
+        if (_imp->has_file(vars->bugs_to()->name()))
         {
-            std::string value(file_contents(_imp->dir / vars->bugs_to()->name()));
+            std::string value(_imp->file(vars->bugs_to()->name()));
             if (! strip_leading(value, " \t\r\n").empty())
             {
                 _imp->keys->bugs_to = std::make_shared<EPlainTextSpecKey>(_imp->environment, vars->bugs_to(), eapi(), value, mkt_normal, is_installed());
@@ -486,9 +518,9 @@ EInstalledRepositoryID::need_keys_added() const
         }
 
     if (! vars->remote_ids()->name().empty())
-        if ((_imp->dir / vars->remote_ids()->name()).stat().exists())
+        if (_imp->has_file(vars->remote_ids()->name()))
         {
-            std::string value(file_contents(_imp->dir / vars->remote_ids()->name()));
+            std::string value(_imp->file(vars->remote_ids()->name()));
             if (! strip_leading(value, " \t\r\n").empty())
             {
                 _imp->keys->remote_ids = std::make_shared<EPlainTextSpecKey>(_imp->environment,
@@ -498,10 +530,10 @@ EInstalledRepositoryID::need_keys_added() const
         }
 
     if (! vars->homepage()->name().empty())
-        if ((_imp->dir / vars->homepage()->name()).stat().exists())
+        if (_imp->has_file(vars->homepage()->name()))
         {
             _imp->keys->homepage = std::make_shared<ESimpleURIKey>(_imp->environment, vars->homepage(), eapi(),
-                        file_contents(_imp->dir / vars->homepage()->name()), mkt_significant, is_installed());
+                        _imp->file(vars->homepage()->name()), mkt_significant, is_installed());
             add_metadata_key(_imp->keys->homepage);
         }
 
@@ -520,12 +552,12 @@ EInstalledRepositoryID::need_keys_added() const
     add_metadata_key(_imp->keys->choices);
 
     std::shared_ptr<Set<std::string> > from_repositories_value(std::make_shared<Set<std::string>>());
-    if ((_imp->dir / "REPOSITORY").stat().exists())
-        from_repositories_value->insert(file_contents(_imp->dir / "REPOSITORY"));
-    if ((_imp->dir / "repository").stat().exists())
-        from_repositories_value->insert(file_contents(_imp->dir / "repository"));
-    if ((_imp->dir / "BINARY_REPOSITORY").stat().exists())
-        from_repositories_value->insert(file_contents(_imp->dir / "BINARY_REPOSITORY"));
+    if (_imp->has_file("REPOSITORY"))
+        from_repositories_value->insert(_imp->file("REPOSITORY"));
+    if (_imp->has_file("repository"))
+        from_repositories_value->insert(_imp->file("repository"));
+    if (_imp->has_file("BINARY_REPOSITORY"))
+        from_repositories_value->insert(_imp->file("BINARY_REPOSITORY"));
     if (! from_repositories_value->empty())
     {
         _imp->keys->from_repositories = std::make_shared<LiteralMetadataStringSetKey>("REPOSITORIES",
@@ -533,75 +565,78 @@ EInstalledRepositoryID::need_keys_added() const
         add_metadata_key(_imp->keys->from_repositories);
     }
 
-    if ((_imp->dir / "ASFLAGS").stat().exists())
+    if (_imp->has_file("ASFLAGS"))
     {
         _imp->keys->asflags = std::make_shared<LiteralMetadataValueKey<std::string> >("ASFLAGS", "ASFLAGS",
-                    mkt_internal, file_contents(_imp->dir / "ASFLAGS"));
+                    mkt_internal, _imp->file("ASFLAGS"));
         add_metadata_key(_imp->keys->asflags);
     }
 
-    if ((_imp->dir / "CBUILD").stat().exists())
+    if (_imp->has_file("CBUILD"))
     {
         _imp->keys->cbuild = std::make_shared<LiteralMetadataValueKey<std::string> >("CBUILD", "CBUILD",
-                    mkt_internal, file_contents(_imp->dir / "CBUILD"));
+                    mkt_internal, _imp->file("CBUILD"));
         add_metadata_key(_imp->keys->cbuild);
     }
 
-    if ((_imp->dir / "CFLAGS").stat().exists())
+    if (_imp->has_file("CFLAGS"))
     {
         _imp->keys->cflags = std::make_shared<LiteralMetadataValueKey<std::string> >("CFLAGS", "CFLAGS",
-                    mkt_internal, file_contents(_imp->dir / "CFLAGS"));
+                    mkt_internal, _imp->file("CFLAGS"));
         add_metadata_key(_imp->keys->cflags);
     }
 
-    if ((_imp->dir / "CHOST").stat().exists())
+    if (_imp->has_file("CHOST"))
     {
         _imp->keys->chost = std::make_shared<LiteralMetadataValueKey<std::string> >("CHOST", "CHOST",
-                    mkt_internal, file_contents(_imp->dir / "CHOST"));
+                    mkt_internal, _imp->file("CHOST"));
         add_metadata_key(_imp->keys->chost);
     }
 
-    if ((_imp->dir / "CONFIG_PROTECT").stat().exists())
+    if (_imp->has_file("CONFIG_PROTECT"))
     {
         _imp->keys->config_protect = std::make_shared<LiteralMetadataValueKey<std::string> >("CONFIG_PROTECT", "CONFIG_PROTECT",
-                    mkt_internal, file_contents(_imp->dir / "CONFIG_PROTECT"));
+                    mkt_internal, _imp->file("CONFIG_PROTECT"));
         add_metadata_key(_imp->keys->config_protect);
     }
 
-    if ((_imp->dir / "CONFIG_PROTECT_MASK").stat().exists())
+    if (_imp->has_file("CONFIG_PROTECT_MASK"))
     {
         _imp->keys->config_protect_mask = std::make_shared<LiteralMetadataValueKey<std::string> >("CONFIG_PROTECT_MASK", "CONFIG_PROTECT_MASK",
-                    mkt_internal, file_contents(_imp->dir / "CONFIG_PROTECT_MASK"));
+                    mkt_internal, _imp->file("CONFIG_PROTECT_MASK"));
         add_metadata_key(_imp->keys->config_protect_mask);
     }
 
-    if ((_imp->dir / "CXXFLAGS").stat().exists())
+    if (_imp->has_file("CXXFLAGS"))
     {
         _imp->keys->cxxflags = std::make_shared<LiteralMetadataValueKey<std::string> >("CXXFLAGS", "CXXFLAGS",
-                    mkt_internal, file_contents(_imp->dir / "CXXFLAGS"));
+                    mkt_internal, _imp->file("CXXFLAGS"));
         add_metadata_key(_imp->keys->cxxflags);
     }
 
-    if ((_imp->dir / "LDFLAGS").stat().exists())
+    if (_imp->has_file("LDFLAGS"))
     {
         _imp->keys->ldflags = std::make_shared<LiteralMetadataValueKey<std::string> >("LDFLAGS", "LDFLAGS",
-                    mkt_internal, file_contents(_imp->dir / "LDFLAGS"));
+                    mkt_internal, _imp->file("LDFLAGS"));
         add_metadata_key(_imp->keys->ldflags);
     }
 
-    if ((_imp->dir / "PKGMANAGER").stat().exists())
+    if (_imp->has_file("PKGMANAGER"))
     {
         _imp->keys->pkgmanager = std::make_shared<LiteralMetadataValueKey<std::string> >("PKGMANAGER", "Installed using",
-                    mkt_normal, file_contents(_imp->dir / "PKGMANAGER"));
+                    mkt_normal, _imp->file("PKGMANAGER"));
         add_metadata_key(_imp->keys->pkgmanager);
     }
 
-    if ((_imp->dir / "VDB_FORMAT").stat().exists())
+    if (_imp->has_file("VDB_FORMAT"))
     {
         _imp->keys->vdb_format = std::make_shared<LiteralMetadataValueKey<std::string> >("VDB_FORMAT", "VDB Format",
-                    mkt_internal, file_contents(_imp->dir / "VDB_FORMAT"));
+                    mkt_internal, _imp->file("VDB_FORMAT"));
         add_metadata_key(_imp->keys->vdb_format);
     }
+
+    /* everything we want from the record is a key now */
+    _imp->record.reset();
 }
 
 void
@@ -681,8 +716,8 @@ EInstalledRepositoryID::eapi() const
 
     Context context("When finding EAPI for '" + canonical_form(idcf_full) + "':");
 
-    if ((_imp->dir / "EAPI").stat().exists())
-        _imp->eapi = EAPIData::get_instance()->eapi_from_string(file_contents(_imp->dir / "EAPI"));
+    if (_imp->has_file("EAPI"))
+        _imp->eapi = EAPIData::get_instance()->eapi_from_string(_imp->file("EAPI"));
     else
     {
         Log::get_instance()->message("e.no_eapi", ll_debug, lc_context) << "No EAPI entry in '" << _imp->dir << "', pretending '"
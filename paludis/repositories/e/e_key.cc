@@ -52,6 +52,7 @@
 
 #include <algorithm>
 #include <functional>
+#include <mutex>
 
 using namespace paludis;
 using namespace paludis::erepository;
@@ -227,6 +228,11 @@ namespace paludis
         const std::string string_value;
         const MetadataKeyType type;
 
+        /* walking every ID's fetches, as fetch and print-unused-distfiles
+         * do, would otherwise reparse each one every time */
+        mutable std::mutex value_mutex;
+        mutable std::shared_ptr<const FetchableURISpecTree> value;
+
         Imp(const Environment * const e, const std::shared_ptr<const ERepositoryID> & i,
                 const std::shared_ptr<const EAPIMetadataVariable> & m, const std::string & v,
                 const MetadataKeyType t) :
@@ -252,8 +258,13 @@ EFetchableURIKey::~EFetchableURIKey() = default;
 const std::shared_ptr<const FetchableURISpecTree>
 EFetchableURIKey::parse_value() const
 {
+    std::unique_lock<std::mutex> lock(_imp->value_mutex);
+    if (_imp->value)
+        return _imp->value;
+
     Context context("When parsing metadata key '" + raw_name() + "' from '" + stringify(*_imp->id) + "':");
-    return parse_fetchable_uri(_imp->string_value, _imp->env, *_imp->id->eapi(), _imp->id->is_installed());
+    _imp->value = parse_fetchable_uri(_imp->string_value, _imp->env, *_imp->id->eapi(), _imp->id->is_installed());
+    return _imp->value;
 }
 
 const std::string
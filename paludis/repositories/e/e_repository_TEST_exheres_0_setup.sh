@@ -799,6 +799,34 @@ pkg_setup() {
     fi
 }
 END
+mkdir -p "packages/cat/batch-version"
+cat <<'END' > packages/cat/batch-version/batch-version-0.ebuild || exit 1
+DESCRIPTION="The Long Description"
+SUMMARY="The Short Description"
+HOMEPAGE="http://example.com/"
+DOWNLOADS=""
+SLOT="0"
+MYOPTIONS="spork"
+LICENCES="GPL-2"
+PLATFORMS="test"
+WORK="${WORKBASE}"
+
+pkg_setup() {
+    paludis_pipe_command_batch \
+        4 HAS_VERSION "${EAPI}" --root cat/pretend-installed \
+        4 HAS_VERSION "${EAPI}" --root cat/doesnotexist \
+        4 BEST_VERSION "${EAPI}" --root cat/pretend-installed \
+        4 BEST_VERSION "${EAPI}" --root cat/pretend-installed
+
+    [[ "${#PALUDIS_PIPE_COMMAND_BATCH_RESULTS[@]}" == 4 ]] || die "got ${#PALUDIS_PIPE_COMMAND_BATCH_RESULTS[@]} results"
+    [[ "${PALUDIS_PIPE_COMMAND_BATCH_RESULTS[0]}" == "0;" ]] || die "result 0 is ${PALUDIS_PIPE_COMMAND_BATCH_RESULTS[0]}"
+    [[ "${PALUDIS_PIPE_COMMAND_BATCH_RESULTS[1]}" == "1;" ]] || die "result 1 is ${PALUDIS_PIPE_COMMAND_BATCH_RESULTS[1]}"
+    [[ "${PALUDIS_PIPE_COMMAND_BATCH_RESULTS[2]}" == "0;cat/pretend-installed-1:0::installed" ]] || die "result 2 is ${PALUDIS_PIPE_COMMAND_BATCH_RESULTS[2]}"
+    [[ "${PALUDIS_PIPE_COMMAND_BATCH_RESULTS[3]}" == "${PALUDIS_PIPE_COMMAND_BATCH_RESULTS[2]}" ]] || die "result 3 is ${PALUDIS_PIPE_COMMAND_BATCH_RESULTS[3]}"
+
+    has_version cat/pretend-installed || die "has_version after batch failed"
+}
+END
 mkdir -p "packages/cat/match"
 cat <<'END' > packages/cat/match/match-0.ebuild || exit 1
 DESCRIPTION="The Long Description"
@@ -46,6 +46,7 @@ EStripper::EStripper(const EStripperOptions & options) :
                 n::debug_dir() = options.debug_dir(),
                 n::dwarf_compression() = options.dwarf_compression(),
                 n::image_dir() = options.image_dir(),
+                n::jobs() = options.jobs(),
                 n::split() = options.split(),
                 n::strip() = options.strip()
                 )),
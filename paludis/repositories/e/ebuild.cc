@@ -156,6 +156,7 @@ EbuildCommand::operator() ()
                                            params.permitted_directories(),
                                            params.parts(),
                                            params.volatile_files(),
+                                           std::make_shared<PipeCommandQueryCache>(),
                                            in_metadata_generation(), _1,
                                            params.maybe_output_manager()));
 
@@ -1056,7 +1057,9 @@ WriteVDBEntryCommand::operator() ()
                                         params.package_id(),
                                         nullptr,
                                         nullptr,
-                                        nullptr, false, _1,
+                                        nullptr,
+                                        std::make_shared<PipeCommandQueryCache>(),
+                                        false, _1,
                                         params.maybe_output_manager()));
 
     if (! eapi->ebuild_metadata_variables()->iuse_effective()->name().empty())
@@ -1323,6 +1326,7 @@ WriteBinaryEbuildCommand::operator() ()
                                         nullptr,
                                         nullptr,
                                         nullptr,
+                                        std::make_shared<PipeCommandQueryCache>(),
                                         false, _1,
                                         params.maybe_output_manager()));
 
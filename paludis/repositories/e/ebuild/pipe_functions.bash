@@ -71,6 +71,33 @@ paludis_pipe_command()
     echo "$rest"
 }
 
+# Usage: paludis_pipe_command_batch n1 COMMAND1 args... n2 COMMAND2 args...
+# Sends several pipe commands in one round trip. Each command is preceded by
+# its number of words. The responses, without the leading status character,
+# are placed in the PALUDIS_PIPE_COMMAND_BATCH_RESULTS array.
+paludis_pipe_command_batch()
+{
+    local r a
+    PALUDIS_PIPE_COMMAND_BATCH_RESULTS=( )
+    r="$(paludis_pipe_command BATCH "$@" )"
+    [[ -z "${r}" ]] && return
+
+    local -a results
+    IFS=$'\3' read -r -d '' -a results < <(echo -n "${r}" )
+    for a in "${results[@]}" ; do
+        if [[ "${a:0:1}" != "O" ]] ; then
+            type die &>/dev/null && eval die "\"paludis_pipe_command_batch returned error '\${a:0:1}' with text '\${a:1}'\""
+            echo "paludis_pipe_command_batch returned error '${a:0:1}' with text '${a:1}'" 1>&2
+            if [[ -n ${EBUILD_KILL_PID} ]]; then
+                echo "paludis_pipe_command_batch: making ebuild PID ${EBUILD_KILL_PID} exit with error" 1>&2
+                kill -s SIGUSR1 "${EBUILD_KILL_PID}"
+            fi
+            exit 126
+        fi
+        PALUDIS_PIPE_COMMAND_BATCH_RESULTS+=( "${a:1}" )
+    done
+}
+
 paludis_rewrite_var()
 {
     [[ "${#@}" -ne 3 ]] && die "$0 should take exactly three args"
@@ -71,6 +71,7 @@
 #include <paludis/util/strip.hh>
 
 #include <set>
+#include <atomic>
 #include <iterator>
 #include <algorithm>
 #include <ctime>
@@ -125,6 +126,23 @@ namespace
                 "FS Location",
                 mkt_internal, p);
     }
+
+    std::shared_ptr<const MetadataXML> metadata_xml_for(const Environment * const env, const RepositoryName & r,
+            const QualifiedPackageName & q, const FSPath & dir)
+    {
+        auto e_repo(std::static_pointer_cast<const ERepository>(env->fetch_repository(r)));
+        if (e_repo->params().write_cache().basename() == "empty")
+            return MetadataXMLPool::get_instance()->metadata_if_exists(dir / "metadata.xml");
+
+        FSPath cache_file(e_repo->params().write_cache());
+        if (e_repo->params().append_repository_name_to_write_cache())
+            cache_file /= stringify(r);
+        cache_file /= ".metadata_xml";
+        cache_file /= stringify(q.category());
+        cache_file /= stringify(q.package());
+
+        return MetadataXMLPool::get_instance()->metadata_if_exists(dir / "metadata.xml", cache_file);
+    }
 }
 
 namespace paludis
@@ -146,6 +164,13 @@ namespace paludis
         mutable bool has_non_xml_keys;
         mutable bool has_xml_keys;
         mutable bool has_masks;
+
+        /* set once the corresponding has_ flag's work is complete, so that
+         * callers can skip the lock. the has_ flags themselves are set at
+         * the start of the work, because loading re-enters. */
+        mutable std::atomic<bool> non_xml_keys_ready;
+        mutable std::atomic<bool> xml_keys_ready;
+        mutable std::atomic<bool> masks_ready;
         mutable bool has_stable, is_stable;
 
         const std::shared_ptr<const LiteralMetadataValueKey<FSPath> > fs_location;
@@ -201,6 +226,9 @@ namespace paludis
             has_non_xml_keys(false),
             has_xml_keys(false),
             has_masks(false),
+            non_xml_keys_ready(false),
+            xml_keys_ready(false),
+            masks_ready(false),
             has_stable(false),
             is_stable(false),
             fs_location(make_fs_location(guessed_eapi, f))
@@ -226,6 +254,9 @@ EbuildID::~EbuildID() = default;
 void
 EbuildID::need_non_xml_keys_added() const
 {
+    if (_imp->non_xml_keys_ready.load(std::memory_order_acquire))
+        return;
+
     std::unique_lock<std::recursive_mutex> lock(_imp->mutex);
 
     if (_imp->has_non_xml_keys)
@@ -424,6 +455,8 @@ EbuildID::need_non_xml_keys_added() const
         _imp->choices = std::make_shared<EChoicesKey>(_imp->environment, shared_from_this(), "PALUDIS_CHOICES", "Choices", mkt_normal,
                     e_repo, std::bind(return_literal_function(nullptr)));
     add_metadata_key(_imp->choices);
+
+    _imp->non_xml_keys_ready.store(true, std::memory_order_release);
 }
 
 const std::shared_ptr<const EAPI>
@@ -496,6 +529,9 @@ EbuildID::presource_eapi() const
 void
 EbuildID::need_xml_keys_added() const
 {
+    if (_imp->xml_keys_ready.load(std::memory_order_acquire))
+        return;
+
     std::unique_lock<std::recursive_mutex> lock(_imp->mutex);
 
     if (_imp->has_xml_keys)
@@ -509,8 +545,8 @@ EbuildID::need_xml_keys_added() const
 
     if (_imp->eapi->supported())
     {
-        std::shared_ptr<const MetadataXML> m(MetadataXMLPool::get_instance()->metadata_if_exists(
-                    _imp->fs_location->parse_value().dirname() / "metadata.xml"));
+        std::shared_ptr<const MetadataXML> m(metadata_xml_for(_imp->environment, repository_name(), name(),
+                    _imp->fs_location->parse_value().dirname()));
         if (m)
         {
             if (! m->long_description().empty())
@@ -522,11 +558,16 @@ EbuildID::need_xml_keys_added() const
                 add_metadata_key(std::make_shared<LiteralMetadataMaintainersKey>("maintainers", "Maintainers", mkt_normal, m->maintainers()));
         }
     }
+
+    _imp->xml_keys_ready.store(true, std::memory_order_release);
 }
 
 void
 EbuildID::need_keys_added() const
 {
+    if (_imp->non_xml_keys_ready.load(std::memory_order_acquire) && _imp->xml_keys_ready.load(std::memory_order_acquire))
+        return;
+
     std::unique_lock<std::recursive_mutex> lock(_imp->mutex);
 
     need_non_xml_keys_added();
@@ -536,8 +577,8 @@ EbuildID::need_keys_added() const
 const std::shared_ptr<const Map<ChoiceNameWithPrefix, std::string> >
 EbuildID::choice_descriptions() const
 {
-    std::shared_ptr<const MetadataXML> m(MetadataXMLPool::get_instance()->metadata_if_exists(
-                _imp->fs_location->parse_value().dirname() / "metadata.xml"));
+    std::shared_ptr<const MetadataXML> m(metadata_xml_for(_imp->environment, repository_name(), name(),
+                _imp->fs_location->parse_value().dirname()));
     if (m)
         return m->uses();
     else
@@ -616,6 +657,9 @@ namespace
 void
 EbuildID::need_masks_added() const
 {
+    if (_imp->masks_ready.load(std::memory_order_acquire))
+        return;
+
     std::unique_lock<std::recursive_mutex> lock(_imp->mutex);
 
     if (_imp->has_masks)
@@ -628,6 +672,7 @@ EbuildID::need_masks_added() const
     if (! eapi()->supported())
     {
         add_mask(std::make_shared<EUnsupportedMask>('E', "eapi", eapi()->name()));
+        _imp->masks_ready.store(true, std::memory_order_release);
         return;
     }
 
@@ -711,6 +756,8 @@ EbuildID::need_masks_added() const
                 add_mask(user_mask);
         }
     }
+
+    _imp->masks_ready.store(true, std::memory_order_release);
 }
 
 const std::string
@@ -778,11 +825,21 @@ EbuildID::repository_name() const
 const std::shared_ptr<const EAPI>
 EbuildID::eapi() const
 {
-    if (_imp->eapi)
+    /* set_eapi is only called whilst the non-xml keys are loading, so once
+     * they're ready eapi can't change again */
+    if (_imp->non_xml_keys_ready.load(std::memory_order_acquire))
         return _imp->eapi;
 
+    {
+        std::unique_lock<std::recursive_mutex> lock(_imp->mutex);
+        if (_imp->eapi)
+            return _imp->eapi;
+    }
+
     need_non_xml_keys_added();
 
+    std::unique_lock<std::recursive_mutex> lock(_imp->mutex);
+
     if (! _imp->eapi)
         throw InternalError(PALUDIS_HERE, "_imp->eapi still not set");
 
@@ -24,6 +24,7 @@
 #include <paludis/repositories/e/eapi_phase.hh>
 #include <paludis/repositories/e/extra_distribution_data.hh>
 #include <paludis/repositories/e/can_skip_phase.hh>
+#include <paludis/repositories/e/e_installed_metadata_record.hh>
 
 #include <paludis/util/pimp-impl.hh>
 #include <paludis/util/log.hh>
@@ -496,6 +497,7 @@ ExndbamRepository::merge(const MergeParams & m)
     }
 
     merger.merge();
+    EInstalledMetadataRecord::write(target_ver_dir);
 
     _imp->ndbam.index(m.package_id()->name(), uid_dir.basename());
 
@@ -0,0 +1,82 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2026 agent
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <paludis/repositories/e/layout_package_ids.hh>
+#include <paludis/util/exception.hh>
+#include <paludis/util/stringify.hh>
+
+using namespace paludis;
+using namespace paludis::erepository;
+
+std::unique_lock<std::mutex>
+paludis::erepository::take_layout_lock(std::mutex & m, std::atomic<unsigned> & contended)
+{
+#ifndef NDEBUG
+    std::unique_lock<std::mutex> result(m, std::try_to_lock);
+    if (! result.owns_lock())
+    {
+        ++contended;
+        result.lock();
+    }
+    return result;
+#else
+    (void) contended;
+    return std::unique_lock<std::mutex>(m);
+#endif
+}
+
+LayoutPackageIDs::LayoutPackageIDs() :
+    _loaded(false),
+    _loading_thread(std::thread::id())
+{
+}
+
+const std::shared_ptr<const PackageIDSequence>
+LayoutPackageIDs::get(std::atomic<unsigned> & contended,
+        const std::function<std::shared_ptr<const PackageIDSequence> ()> & load)
+{
+    /* _ids is only set before _loaded is, so anyone who sees _loaded set
+     * can use _ids without the lock */
+    if (_loaded.load(std::memory_order_acquire))
+        return _ids;
+
+    /* only we can have set this to ourselves, so there's no race here */
+    if (std::this_thread::get_id() == _loading_thread.load())
+        throw InternalError(PALUDIS_HERE, "Package IDs were asked for whilst they were being loaded");
+
+    std::unique_lock<std::mutex> lock(take_layout_lock(_mutex, contended));
+
+    if (_loaded.load(std::memory_order_relaxed))
+        return _ids;
+
+    struct Loading
+    {
+        std::atomic<std::thread::id> & thread;
+
+        ~Loading()
+        {
+            thread.store(std::thread::id());
+        }
+    } loading{_loading_thread};
+    _loading_thread.store(std::this_thread::get_id());
+
+    _ids = load();
+    _loaded.store(true, std::memory_order_release);
+    return _ids;
+}
@@ -0,0 +1,74 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2026 agent
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PALUDIS_GUARD_PALUDIS_REPOSITORIES_E_LAYOUT_PACKAGE_IDS_HH
+#define PALUDIS_GUARD_PALUDIS_REPOSITORIES_E_LAYOUT_PACKAGE_IDS_HH 1
+
+#include <paludis/util/attributes.hh>
+#include <paludis/package_id-fwd.hh>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace paludis
+{
+    namespace erepository
+    {
+        /**
+         * Lock one of a layout's mutexes. In debug builds, count how often
+         * we had to wait for it.
+         */
+        std::unique_lock<std::mutex> take_layout_lock(std::mutex &, std::atomic<unsigned> & contended);
+
+        /**
+         * The IDs for one package in a layout. They are loaded at most once,
+         * and once loaded can be had without taking a lock.
+         */
+        class LayoutPackageIDs
+        {
+            private:
+                std::mutex _mutex;
+                std::atomic<bool> _loaded;
+                std::atomic<std::thread::id> _loading_thread;
+                std::shared_ptr<const PackageIDSequence> _ids;
+
+            public:
+                LayoutPackageIDs();
+
+                LayoutPackageIDs(const LayoutPackageIDs &) = delete;
+                LayoutPackageIDs & operator= (const LayoutPackageIDs &) = delete;
+
+                /**
+                 * Our IDs, calling load to get them if nobody has yet.
+                 *
+                 * Loading must not ask for the same package's IDs again.
+                 * If it does, we throw rather than wait for ourselves.
+                 *
+                 * \throw InternalError if load asks for our IDs
+                 */
+                const std::shared_ptr<const PackageIDSequence> get(
+                        std::atomic<unsigned> & contended,
+                        const std::function<std::shared_ptr<const PackageIDSequence> ()> & load);
+        };
+    }
+}
+
+#endif
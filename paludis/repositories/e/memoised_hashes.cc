@@ -26,20 +26,21 @@
 #include <paludis/util/timestamp.hh>
 #include <paludis/util/fs_path.hh>
 #include <paludis/util/fs_stat.hh>
+#include <paludis/util/concurrent_map.hh>
+#include <paludis/util/hashes.hh>
 
-#include <map>
+#include <memory>
 
 using namespace paludis;
 using namespace paludis::erepository;
 
 namespace paludis
 {
-    typedef std::map<std::pair<std::string, std::string>, std::pair<Timestamp, std::string> > HashesMap;
+    typedef ConcurrentMap<std::pair<std::string, std::string>, std::shared_ptr<const std::pair<Timestamp, std::string> > > HashesMap;
 
     template <>
     struct Imp<MemoisedHashes>
     {
-        mutable std::mutex mutex;
         mutable HashesMap hashes;
 
         Imp()
@@ -61,23 +62,18 @@ MemoisedHashes::get(const std::string & algo, const FSPath & file, SafeIFStream
     std::pair<std::string, std::string> key(stringify(file), algo);
     Timestamp mtime(file.stat().mtim());
 
-    std::unique_lock<std::mutex> lock(_imp->mutex);
+    std::shared_ptr<const std::pair<Timestamp, std::string> > value;
+    if (_imp->hashes.find(key, value) && value->first == mtime)
+        return value->second;
 
-    HashesMap::iterator i(_imp->hashes.find(key));
+    /* we don't hold any lock whilst hashing, so if two threads want the same
+     * file they may both hash it, which is harmless */
+    value = std::make_shared<const std::pair<Timestamp, std::string> >(mtime, DigestRegistry::get_instance()->get(algo)(stream));
+    stream.clear();
+    stream.seekg(0, std::ios::beg);
 
-    if (i == _imp->hashes.end() || i->second.first != mtime)
-    {
-        std::pair<Timestamp, std::string> value(std::make_pair(mtime, DigestRegistry::get_instance()->get(algo)(stream)));
-        stream.clear();
-        stream.seekg(0, std::ios::beg);
-
-        if (i != _imp->hashes.end())
-            i->second = value;
-        else
-            i = _imp->hashes.insert(std::make_pair(key, value)).first;
-    }
-
-    return i->second.second;
+    _imp->hashes.assign(key, value);
+    return value->second;
 }
 
 namespace paludis
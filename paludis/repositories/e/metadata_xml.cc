@@ -23,24 +23,167 @@
 #include <paludis/util/singleton-impl.hh>
 #include <paludis/util/map-impl.hh>
 #include <paludis/util/hashes.hh>
+#include <paludis/util/concurrent_map.hh>
 #include <paludis/util/log.hh>
+#include <paludis/util/cache_file.hh>
 #include <paludis/util/fs_path.hh>
 #include <paludis/util/fs_stat.hh>
+#include <paludis/util/sequence-impl.hh>
+#include <paludis/util/stringify.hh>
+#include <paludis/util/destringify.hh>
+#include <paludis/util/make_named_values.hh>
+#include <paludis/util/safe_ifstream.hh>
+#include <paludis/util/timestamp.hh>
+#include <paludis/util/wrapped_forward_iterator.hh>
 #include <paludis/literal_metadata_key.hh>
 #include <paludis/choice.hh>
-#include <unordered_map>
+#include <paludis/maintainer.hh>
+#include <iterator>
+#include <mutex>
+#include <vector>
 
 using namespace paludis;
 using namespace paludis::erepository;
 
-typedef std::unordered_map<FSPath, std::shared_ptr<MetadataXML>, Hash<FSPath> > Store;
+namespace
+{
+    struct Entry
+    {
+        std::once_flag once;
+        std::shared_ptr<MetadataXML> metadata_xml;
+    };
+
+    typedef ConcurrentMap<FSPath, std::shared_ptr<Entry>, Hash<FSPath> > Store;
+
+    const std::string cache_magic("paludis-metadata-xml-1");
+
+    std::size_t get_count(CacheFieldReader & r)
+    {
+        std::string v(r.get());
+        return r.bad() ? 0 : destringify<std::size_t>(v);
+    }
+
+    std::shared_ptr<MetadataXML> load_cache(const FSPath & cache_file, const FSStat & metadata_xml_stat)
+    {
+        Context context("When loading metadata.xml cache file '" + stringify(cache_file) + "':");
+
+        if (! cache_file.stat().is_regular_file())
+            return nullptr;
+
+        try
+        {
+            SafeIFStream f(cache_file);
+            std::string data((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+            if (0 != data.compare(0, cache_magic.length() + 1, cache_magic + "\n"))
+                return nullptr;
+
+            CacheFieldReader r(data, cache_magic.length() + 1);
+            if (r.get() != stringify(metadata_xml_stat.mtim().seconds()) || r.get() != stringify(metadata_xml_stat.mtim().nanoseconds()))
+            {
+                Log::get_instance()->message("e.metadata_xml.cache.stale", ll_debug, lc_context)
+                    << "Cache file is older than the metadata.xml";
+                return nullptr;
+            }
+
+            auto result(std::make_shared<MetadataXML>(make_named_values<MetadataXML>(
+                            n::herds() = std::make_shared<Sequence<std::string> >(),
+                            n::long_description() = r.get(),
+                            n::maintainers() = std::make_shared<Maintainers>(),
+                            n::uses() = std::make_shared<Map<ChoiceNameWithPrefix, std::string> >()
+                            )));
+
+            for (std::size_t n(get_count(r)) ; n > 0 ; --n)
+                result->herds()->push_back(r.get());
+
+            for (std::size_t n(get_count(r)) ; n > 0 ; --n)
+            {
+                std::string author(r.get()), description(r.get()), email(r.get());
+                result->maintainers()->push_back(make_named_values<Maintainer>(
+                            n::author() = author,
+                            n::description() = description,
+                            n::email() = email
+                            ));
+            }
+
+            for (std::size_t n(get_count(r)) ; n > 0 ; --n)
+            {
+                std::string name(r.get()), description(r.get());
+                result->uses()->insert(ChoiceNameWithPrefix(name), description);
+            }
+
+            if (r.bad() || ! r.done())
+                return nullptr;
+
+            return result;
+        }
+        catch (const Exception & e)
+        {
+            Log::get_instance()->message("e.metadata_xml.cache.failure", ll_warning, lc_context)
+                << "Not using cache file: " << e.message() << " (" << e.what() << ")";
+            return nullptr;
+        }
+    }
+
+    void save_cache(const FSPath & cache_file, const FSStat & metadata_xml_stat, const MetadataXML & metadata_xml)
+    {
+        Context context("When saving metadata.xml cache file '" + stringify(cache_file) + "':");
+
+        std::string data(cache_magic + "\n");
+        put_cache_field(data, stringify(metadata_xml_stat.mtim().seconds()));
+        put_cache_field(data, stringify(metadata_xml_stat.mtim().nanoseconds()));
+        put_cache_field(data, metadata_xml.long_description());
+
+        put_cache_field(data, stringify(std::distance(metadata_xml.herds()->begin(), metadata_xml.herds()->end())));
+        for (const auto & h : *metadata_xml.herds())
+            put_cache_field(data, h);
+
+        put_cache_field(data, stringify(std::distance(metadata_xml.maintainers()->begin(), metadata_xml.maintainers()->end())));
+        for (const auto & m : *metadata_xml.maintainers())
+        {
+            put_cache_field(data, m.author());
+            put_cache_field(data, m.description());
+            put_cache_field(data, m.email());
+        }
+
+        put_cache_field(data, stringify(std::distance(metadata_xml.uses()->begin(), metadata_xml.uses()->end())));
+        for (const auto & u : *metadata_xml.uses())
+        {
+            put_cache_field(data, stringify(u.first));
+            put_cache_field(data, u.second);
+        }
+
+        try
+        {
+            /* create whatever is missing below the first directory that
+             * exists, with that directory's permissions */
+            std::vector<FSPath> missing;
+            FSPath dir(cache_file.dirname());
+            while (! dir.stat().exists() && dir != FSPath("/"))
+            {
+                missing.push_back(dir);
+                dir = dir.dirname();
+            }
+
+            FSStat dir_stat(dir);
+            for (auto m(missing.rbegin()), m_end(missing.rend()) ; m != m_end ; ++m)
+                if (m->mkdir(dir_stat.permissions(), { fspmkdo_ok_if_exists }))
+                    m->chmod(dir_stat.permissions());
+
+            write_cache_file(cache_file, data);
+        }
+        catch (const Exception & e)
+        {
+            Log::get_instance()->message("e.metadata_xml.cache.save_failure", ll_debug, lc_context)
+                << "Couldn't write cache file: " << e.message() << " (" << e.what() << ")";
+        }
+    }
+}
 
 namespace paludis
 {
     template <>
     struct Imp<MetadataXMLPool>
     {
-        mutable std::mutex mutex;
         mutable Store store;
     };
 }
@@ -54,32 +197,55 @@ MetadataXMLPool::~MetadataXMLPool() = default;
 
 const std::shared_ptr<const MetadataXML>
 MetadataXMLPool::metadata_if_exists(const FSPath & f) const
+{
+    return _metadata_if_exists(f, nullptr);
+}
+
+const std::shared_ptr<const MetadataXML>
+MetadataXMLPool::metadata_if_exists(const FSPath & f, const FSPath & cache_file) const
+{
+    return _metadata_if_exists(f, &cache_file);
+}
+
+const std::shared_ptr<const MetadataXML>
+MetadataXMLPool::_metadata_if_exists(const FSPath & f, const FSPath * const cache_file) const
 {
     Context context("When handling metadata.xml file '" + stringify(f) + "':");
 
     FSPath f_real(f.realpath_if_exists());
-    std::unique_lock<std::mutex> lock(_imp->mutex);
-    Store::const_iterator i(_imp->store.find(f_real));
-    if (i != _imp->store.end())
-        return i->second;
-    else
-    {
-        std::shared_ptr<MetadataXML> metadata_xml;
-        if (f_real.stat().is_regular_file_or_symlink_to_regular_file())
-        {
+
+    /* different files can be parsed at the same time, and the entry's
+     * once flag stops the same one being parsed twice */
+    std::shared_ptr<Entry> entry(_imp->store.find_or_insert(f_real, [] () { return std::make_shared<Entry>(); }));
+
+    std::call_once(entry->once, [&] () {
+            FSStat f_real_stat(f_real);
+            if (! f_real_stat.is_regular_file_or_symlink_to_regular_file())
+                return;
+
+            if (cache_file)
+            {
+                entry->metadata_xml = load_cache(*cache_file, f_real_stat);
+                if (entry->metadata_xml)
+                    return;
+            }
+
             try
             {
                 if (XMLThingsHandle::get_instance()->create_metadata_xml_from_xml_file())
-                    metadata_xml = XMLThingsHandle::get_instance()->create_metadata_xml_from_xml_file()(f);
+                    entry->metadata_xml = XMLThingsHandle::get_instance()->create_metadata_xml_from_xml_file()(f);
             }
             catch (const Exception & e)
             {
                 Log::get_instance()->message("e.metadata_xml.bad", ll_warning, lc_context) << "Got exception '"
                     << e.message() << "' (" << e.what() << "), ignoring metadata.xml file '" << f_real << "'";
             }
-        }
-        return _imp->store.insert(std::make_pair(f_real, metadata_xml)).first->second;
-    }
+
+            if (cache_file && entry->metadata_xml)
+                save_cache(*cache_file, f_real_stat, *entry->metadata_xml);
+            });
+
+    return entry->metadata_xml;
 }
 
 namespace paludis
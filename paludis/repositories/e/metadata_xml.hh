@@ -62,8 +62,19 @@ namespace paludis
                 MetadataXMLPool();
                 ~MetadataXMLPool();
 
+                const std::shared_ptr<const MetadataXML> _metadata_if_exists(
+                        const FSPath &, const FSPath * const) const PALUDIS_ATTRIBUTE((warn_unused_result));
+
             public:
                 const std::shared_ptr<const MetadataXML> metadata_if_exists(const FSPath &) const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                /**
+                 * As metadata_if_exists, but first try the extracted fields
+                 * saved in cache_file, and save them there after parsing
+                 * if the cache is missing or older than the metadata.xml.
+                 */
+                const std::shared_ptr<const MetadataXML> metadata_if_exists(
+                        const FSPath &, const FSPath & cache_file) const PALUDIS_ATTRIBUTE((warn_unused_result));
         };
     }
 
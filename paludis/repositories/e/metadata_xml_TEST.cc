@@ -0,0 +1,104 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2026 agent
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <paludis/repositories/e/metadata_xml.hh>
+
+#include <paludis/util/fs_path.hh>
+#include <paludis/util/fs_stat.hh>
+#include <paludis/util/timestamp.hh>
+#include <paludis/util/safe_ofstream.hh>
+#include <paludis/util/stringify.hh>
+#include <paludis/util/join.hh>
+#include <paludis/util/sequence.hh>
+#include <paludis/util/wrapped_forward_iterator.hh>
+#include <paludis/maintainer.hh>
+
+#include <cstdlib>
+
+#include <gtest/gtest.h>
+
+using namespace paludis;
+using namespace paludis::erepository;
+
+namespace
+{
+    std::string field(const std::string & s)
+    {
+        return stringify(s.length()) + ":" + s + ",";
+    }
+
+    void write_cache(const FSPath & cache_file, const Timestamp & t)
+    {
+        SafeOFStream f(cache_file, -1, true);
+        f << "paludis-metadata-xml-1\n"
+            << field(stringify(t.seconds())) << field(stringify(t.nanoseconds()))
+            << field("A package, with a long description\nover two lines")
+            << field("1") << field("monkeys")
+            << field("1") << field("Fred") << field("") << field("fred@example.com")
+            << field("1") << field("kitten") << field("Enable kittens");
+    }
+
+    struct MetadataXMLPoolTest :
+        testing::Test
+    {
+        void SetUp()
+        {
+            /* make sure we only ever get results from the cache */
+            ::setenv("PALUDIS_NO_XML", "yes", 1);
+        }
+    };
+}
+
+TEST_F(MetadataXMLPoolTest, Cached)
+{
+    FSPath dir(FSPath::cwd() / "metadata_xml_TEST_dir");
+    FSPath metadata_xml(dir / "repo" / "cat" / "cached" / "metadata.xml");
+    write_cache(dir / "cache" / "cached", metadata_xml.stat().mtim());
+
+    std::shared_ptr<const MetadataXML> m(MetadataXMLPool::get_instance()->metadata_if_exists(
+                metadata_xml, dir / "cache" / "cached"));
+    ASSERT_TRUE(bool(m));
+
+    EXPECT_EQ("A package, with a long description\nover two lines", m->long_description());
+    EXPECT_EQ("monkeys", join(m->herds()->begin(), m->herds()->end(), " "));
+    ASSERT_EQ(1, std::distance(m->maintainers()->begin(), m->maintainers()->end()));
+    EXPECT_EQ("Fred", m->maintainers()->begin()->author());
+    EXPECT_EQ("fred@example.com", m->maintainers()->begin()->email());
+
+    EXPECT_EQ(m, MetadataXMLPool::get_instance()->metadata_if_exists(metadata_xml));
+}
+
+TEST_F(MetadataXMLPoolTest, Stale)
+{
+    FSPath dir(FSPath::cwd() / "metadata_xml_TEST_dir");
+    FSPath metadata_xml(dir / "repo" / "cat" / "stale" / "metadata.xml");
+    Timestamp t(metadata_xml.stat().mtim());
+    write_cache(dir / "cache" / "stale", Timestamp(t.seconds() - 1, t.nanoseconds()));
+
+    EXPECT_FALSE(bool(MetadataXMLPool::get_instance()->metadata_if_exists(metadata_xml, dir / "cache" / "stale")));
+}
+
+TEST_F(MetadataXMLPoolTest, Missing)
+{
+    FSPath dir(FSPath::cwd() / "metadata_xml_TEST_dir");
+    write_cache(dir / "cache" / "missing", Timestamp(0, 0));
+
+    EXPECT_FALSE(bool(MetadataXMLPool::get_instance()->metadata_if_exists(
+                    dir / "repo" / "cat" / "missing" / "metadata.xml", dir / "cache" / "missing")));
+}
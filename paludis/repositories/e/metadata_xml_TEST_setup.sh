@@ -0,0 +1,18 @@
+#!/usr/bin/env bash
+# vim: set ft=sh sw=4 sts=4 et :
+
+mkdir metadata_xml_TEST_dir || exit 1
+cd metadata_xml_TEST_dir || exit 1
+
+for p in cached stale ; do
+    mkdir -p repo/cat/${p}
+    cat <<"END" > repo/cat/${p}/metadata.xml
+<?xml version="1.0" encoding="UTF-8"?>
+<!DOCTYPE pkgmetadata SYSTEM "http://www.gentoo.org/dtd/metadata.dtd">
+<pkgmetadata>
+    <longdescription>A package</longdescription>
+</pkgmetadata>
+END
+done
+
+mkdir -p cache
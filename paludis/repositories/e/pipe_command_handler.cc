@@ -39,6 +39,7 @@
 #include <paludis/util/set.hh>
 #include <paludis/util/indirect_iterator-impl.hh>
 #include <paludis/util/save.hh>
+#include <paludis/util/pimp-impl.hh>
 
 #include <paludis/output_manager.hh>
 #include <paludis/package_id.hh>
@@ -58,11 +59,71 @@
 
 #include <list>
 #include <vector>
+#include <map>
+#include <tuple>
 #include <limits>
 #include <sstream>
 #include <algorithm>
 
 using namespace paludis;
+using namespace paludis::erepository;
+
+namespace paludis
+{
+    template <>
+    struct Imp<PipeCommandQueryCache>
+    {
+        std::map<std::pair<std::string, std::string>, std::shared_ptr<const PackageDepSpec> > specs;
+        std::map<std::tuple<std::string, std::string, std::string>, std::shared_ptr<const PackageIDSequence> > ids;
+    };
+}
+
+PipeCommandQueryCache::PipeCommandQueryCache() :
+    _imp()
+{
+}
+
+PipeCommandQueryCache::~PipeCommandQueryCache() = default;
+
+const std::shared_ptr<const PackageIDSequence>
+PipeCommandQueryCache::matching_ids(
+        const Environment * const environment,
+        const std::shared_ptr<const PackageID> & from_id,
+        const std::string & eapi_name,
+        const std::string & root_argument,
+        const std::string & spec_string)
+{
+    auto key(std::make_tuple(eapi_name, root_argument, spec_string));
+    auto i(_imp->ids.find(key));
+    if (i != _imp->ids.end())
+        return i->second;
+
+    Filter root((filter::All()));
+    if (root_argument == "--slash")
+        root = filter::InstalledAtRoot(environment->system_root_key()->parse_value());
+    else if (root_argument == "--root")
+        root = filter::InstalledAtRoot(environment->preferred_root_key()->parse_value());
+    else
+        throw InternalError(PALUDIS_HERE, "bad root argument '" + root_argument + "'");
+
+    auto s(_imp->specs.find(std::make_pair(eapi_name, spec_string)));
+    if (s == _imp->specs.end())
+    {
+        std::shared_ptr<const EAPI> eapi(EAPIData::get_instance()->eapi_from_string(eapi_name));
+        s = _imp->specs.insert(std::make_pair(std::make_pair(eapi_name, spec_string),
+                    std::make_shared<PackageDepSpec>(parse_elike_package_dep_spec(spec_string,
+                            eapi->supported()->package_dep_spec_parse_options(),
+                            eapi->supported()->version_spec_options())))).first;
+    }
+    else
+        Log::get_instance()->message("e.pipe_commands.cache.spec", ll_debug, lc_context)
+            << "Reusing parsed spec '" << spec_string << "'";
+
+    std::shared_ptr<const PackageIDSequence> result((*environment)[selection::AllVersionsSorted(
+                generator::Matches(*s->second, from_id, { }) | root)]);
+    _imp->ids.insert(std::make_pair(key, result));
+    return result;
+}
 
 namespace
 {
@@ -184,11 +245,14 @@ paludis::erepository::pipe_command_handler(const Environment * const environment
         const std::shared_ptr<PermittedDirectories> & maybe_permitted_directories,
         const std::shared_ptr<Partitioning> & maybe_partitioning,
         const std::shared_ptr<FSPathSet> & maybe_volatiles,
+        const std::shared_ptr<PipeCommandQueryCache> & maybe_query_cache,
         bool in_metadata_generation,
         const std::string & s, const std::shared_ptr<OutputManager> & maybe_output_manager)
 {
     Context context("In ebuild pipe command handler for '" + stringify(*package_id) + "':");
 
+    auto query_cache(maybe_query_cache ? maybe_query_cache : std::make_shared<PipeCommandQueryCache>());
+
     try
     {
         std::vector<std::string> tokens;
@@ -212,7 +276,43 @@ paludis::erepository::pipe_command_handler(const Environment * const environment
             return "Eempty pipe command";
         }
 
-        if (tokens[0] == "PING")
+        if (tokens[0] == "BATCH")
+        {
+            /* BATCH n1 cmd1... n2 cmd2... runs several commands in one round
+             * trip, giving each command's own response separated by \3 */
+            std::string result("O");
+            for (auto t(next(tokens.begin())), t_end(tokens.end()) ; t != t_end ; )
+            {
+                std::string::size_type n(0);
+                try
+                {
+                    n = destringify<std::string::size_type>(*t);
+                }
+                catch (const DestringifyError &)
+                {
+                }
+
+                if (0 == n || std::string::size_type(std::distance(next(t), t_end)) < n || *next(t) == "BATCH")
+                {
+                    Log::get_instance()->message("e.pipe_commands.batch.bad", ll_warning, lc_context) << "Got bad BATCH pipe command";
+                    return "Ebad BATCH command";
+                }
+
+                std::string command;
+                for (auto c(next(t)), c_end(next(t, n + 1)) ; c != c_end ; ++c)
+                    command.append(*c + "\2");
+
+                if (result.length() > 1)
+                    result.append("\3");
+                result.append(pipe_command_handler(environment, package_id, maybe_permitted_directories, maybe_partitioning,
+                            maybe_volatiles, query_cache, in_metadata_generation, command, maybe_output_manager));
+
+                t = next(t, n + 1);
+            }
+
+            return result;
+        }
+        else if (tokens[0] == "PING")
         {
             if (tokens.size() != 3)
             {
@@ -317,19 +417,11 @@ paludis::erepository::pipe_command_handler(const Environment * const environment
                 if (! eapi->supported())
                     return "EBEST_VERSION EAPI " + tokens[1] + " unsupported";
 
-                Filter root((filter::All()));
-                if (tokens[2] == "--slash")
-                    root = filter::InstalledAtRoot(environment->system_root_key()->parse_value());
-                else if (tokens[2] == "--root")
-                    root = filter::InstalledAtRoot(environment->preferred_root_key()->parse_value());
-                else
+                if (tokens[2] != "--slash" && tokens[2] != "--root")
                     return "Ebad BEST_VERSION " + tokens[2] + " argument";
 
-                PackageDepSpec spec(parse_elike_package_dep_spec(tokens[3],
-                            eapi->supported()->package_dep_spec_parse_options(),
-                            eapi->supported()->version_spec_options()));
-                std::shared_ptr<const PackageIDSequence> entries((*environment)[selection::AllVersionsSorted(
-                            generator::Matches(spec, package_id, { }) | root)]);
+                std::shared_ptr<const PackageIDSequence> entries(query_cache->matching_ids(
+                            environment, package_id, tokens[1], tokens[2], tokens[3]));
 
                 if (entries->empty())
                     return "O1;";
@@ -355,19 +447,11 @@ paludis::erepository::pipe_command_handler(const Environment * const environment
                 if (! eapi->supported())
                     return "EHAS_VERSION EAPI " + tokens[1] + " unsupported";
 
-                Filter root((filter::All()));
-                if (tokens[2] == "--slash")
-                    root = filter::InstalledAtRoot(environment->system_root_key()->parse_value());
-                else if (tokens[2] == "--root")
-                    root = filter::InstalledAtRoot(environment->preferred_root_key()->parse_value());
-                else
+                if (tokens[2] != "--slash" && tokens[2] != "--root")
                     return "Ebad HAS_VERSION " + tokens[2] + " argument";
 
-                PackageDepSpec spec(parse_elike_package_dep_spec(tokens[3],
-                            eapi->supported()->package_dep_spec_parse_options(),
-                            eapi->supported()->version_spec_options()));
-                std::shared_ptr<const PackageIDSequence> entries((*environment)[selection::SomeArbitraryVersion(
-                            generator::Matches(spec, package_id, { }) | root)]);
+                std::shared_ptr<const PackageIDSequence> entries(query_cache->matching_ids(
+                            environment, package_id, tokens[1], tokens[2], tokens[3]));
                 if (entries->empty())
                     return "O1;";
                 else
@@ -387,11 +471,8 @@ paludis::erepository::pipe_command_handler(const Environment * const environment
                 if (! eapi->supported())
                     return "EMATCH EAPI " + tokens[1] + " unsupported";
 
-                PackageDepSpec spec(parse_elike_package_dep_spec(tokens[2],
-                            eapi->supported()->package_dep_spec_parse_options(),
-                            eapi->supported()->version_spec_options()));
-                std::shared_ptr<const PackageIDSequence> entries((*environment)[selection::AllVersionsSorted(
-                            generator::Matches(spec, package_id, { }) | filter::InstalledAtRoot(environment->preferred_root_key()->parse_value()))]);
+                std::shared_ptr<const PackageIDSequence> entries(query_cache->matching_ids(
+                            environment, package_id, tokens[1], "--root", tokens[2]));
 
                 if (entries->empty())
                     return "O1;";
@@ -26,6 +26,8 @@
 #include <paludis/package_id-fwd.hh>
 #include <paludis/output_manager-fwd.hh>
 #include <paludis/partitioning-fwd.hh>
+#include <paludis/util/pimp.hh>
+#include <paludis/util/attributes.hh>
 #include <functional>
 #include <string>
 
@@ -35,11 +37,46 @@ namespace paludis
     {
         class ERepositoryID;
 
+        /**
+         * Remembers parsed specs and selection results for the version query
+         * pipe commands (BEST_VERSION, HAS_VERSION and MATCH).
+         *
+         * One cache should be used for the lifetime of a single ebuild
+         * process. Nothing is installed or uninstalled whilst an ebuild phase
+         * is running, so results cannot go stale. A cache is only used by the
+         * pipe command handler for a single process, and so is not thread
+         * safe.
+         */
+        class PipeCommandQueryCache
+        {
+            private:
+                Pimp<PipeCommandQueryCache> _imp;
+
+            public:
+                PipeCommandQueryCache();
+                ~PipeCommandQueryCache();
+
+                PipeCommandQueryCache(const PipeCommandQueryCache &) = delete;
+                PipeCommandQueryCache & operator= (const PipeCommandQueryCache &) = delete;
+
+                /**
+                 * All installed IDs at the --slash or --root root which match
+                 * spec when parsed using the named EAPI, in sorted order.
+                 */
+                const std::shared_ptr<const PackageIDSequence> matching_ids(
+                        const Environment * const,
+                        const std::shared_ptr<const PackageID> & from_id,
+                        const std::string & eapi,
+                        const std::string & root_argument,
+                        const std::string & spec) PALUDIS_ATTRIBUTE((warn_unused_result));
+        };
+
         std::string pipe_command_handler(const Environment * const,
                 const std::shared_ptr<const ERepositoryID> &,
                 const std::shared_ptr<PermittedDirectories> &,
                 const std::shared_ptr<Partitioning> &,
                 const std::shared_ptr<FSPathSet> &,
+                const std::shared_ptr<PipeCommandQueryCache> & maybe_query_cache,
                 bool in_metadata_generation,
                 const std::string & s,
                 const std::shared_ptr<OutputManager> & maybe_output_manager);
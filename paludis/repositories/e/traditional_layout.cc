@@ -20,6 +20,7 @@
 
 #include <paludis/repositories/e/traditional_layout.hh>
 #include <paludis/repositories/e/e_repository.hh>
+#include <paludis/repositories/e/layout_package_ids.hh>
 #include <paludis/repositories/e/file_suffixes.hh>
 #include <paludis/repositories/e/traditional_mask_store.hh>
 
@@ -47,15 +48,19 @@
 
 #include <functional>
 #include <unordered_map>
+#include <unordered_set>
 #include <algorithm>
 #include <list>
+#include <mutex>
+#include <atomic>
 
 using namespace paludis;
 using namespace paludis::erepository;
 
 typedef std::unordered_map<CategoryNamePart, bool, Hash<CategoryNamePart> > CategoryMap;
-typedef std::unordered_map<QualifiedPackageName, bool, Hash<QualifiedPackageName> > PackagesMap;
-typedef std::unordered_map<QualifiedPackageName, std::shared_ptr<PackageIDSequence>, Hash<QualifiedPackageName>  > IDMap;
+typedef std::unordered_set<QualifiedPackageName, Hash<QualifiedPackageName> > PackagesSet;
+
+typedef std::unordered_map<QualifiedPackageName, std::shared_ptr<LayoutPackageIDs>, Hash<QualifiedPackageName> > IDMap;
 
 namespace
 {
@@ -77,14 +82,23 @@ namespace paludis
         const ERepository * const repository;
         const FSPath tree_root;
 
-        mutable std::recursive_mutex big_nasty_mutex;
-
-        mutable bool has_category_names;
+        /* category_names and category_names_collection are written once,
+         * under category_names_mutex, before has_category_names is set. The
+         * flags in category_names and package_names are protected by
+         * package_names_mutex, and ids by ids_mutex. */
+        mutable std::mutex category_names_mutex;
+        mutable std::atomic<bool> has_category_names;
         mutable CategoryMap category_names;
-        mutable PackagesMap package_names;
+        mutable std::shared_ptr<CategoryNamePartSet> category_names_collection;
+
+        mutable std::mutex package_names_mutex;
+        mutable PackagesSet package_names;
+
+        mutable std::mutex ids_mutex;
         mutable IDMap ids;
 
-        mutable std::shared_ptr<CategoryNamePartSet> category_names_collection;
+        /* how often we had to wait for a lock. only counted in debug builds */
+        mutable std::atomic<unsigned> contended;
 
         std::shared_ptr<FSPathSequence> arch_list_files;
         std::shared_ptr<FSPathSequence> repository_mask_files;
@@ -103,6 +117,7 @@ namespace paludis
             repository(r),
             tree_root(t),
             has_category_names(false),
+            contended(0),
             arch_list_files(std::make_shared<FSPathSequence>()),
             repository_mask_files(std::make_shared<FSPathSequence>()),
             profiles_desc_files(std::make_shared<FSPathSequence>()),
@@ -115,6 +130,13 @@ namespace paludis
                             repository_mask_files, EAPIForFileFunction(std::bind(std::mem_fn(&ERepository::eapi_for_file), r, std::placeholders::_1)))))
         {
         }
+
+        ~Imp()
+        {
+            if (0 != contended)
+                Log::get_instance()->message("e.traditional_layout.contention", ll_debug, lc_no_context)
+                    << "Layout for '" << repository->name() << "' waited for a lock " << contended << " times";
+        }
     };
 }
 
@@ -184,9 +206,12 @@ TraditionalLayout::categories_file() const
 void
 TraditionalLayout::need_category_names() const
 {
-    std::unique_lock<std::recursive_mutex> lock(_imp->big_nasty_mutex);
+    if (_imp->has_category_names.load(std::memory_order_acquire))
+        return;
+
+    std::unique_lock<std::mutex> lock(take_layout_lock(_imp->category_names_mutex, _imp->contended));
 
-    if (_imp->has_category_names)
+    if (_imp->has_category_names.load(std::memory_order_relaxed))
         return;
 
     Context context("When loading category names for " + stringify(_imp->repository->name()) + ":");
@@ -249,64 +274,74 @@ TraditionalLayout::need_category_names() const
         }
     }
 
-    _imp->has_category_names = true;
+    _imp->category_names_collection = std::make_shared<CategoryNamePartSet>();
+    std::transform(_imp->category_names.begin(), _imp->category_names.end(),
+            _imp->category_names_collection->inserter(),
+            std::mem_fn(&std::pair<const CategoryNamePart, bool>::first));
+
+    _imp->has_category_names.store(true, std::memory_order_release);
 }
 
-void
+const std::shared_ptr<const PackageIDSequence>
 TraditionalLayout::need_package_ids(const QualifiedPackageName & n) const
 {
-    std::unique_lock<std::recursive_mutex> lock(_imp->big_nasty_mutex);
-
     using namespace std::placeholders;
 
-    if (_imp->package_names[n])
-        return;
+    std::shared_ptr<LayoutPackageIDs> entry;
+    {
+        std::unique_lock<std::mutex> lock(take_layout_lock(_imp->ids_mutex, _imp->contended));
+        std::shared_ptr<LayoutPackageIDs> & e(_imp->ids[n]);
+        if (! e)
+            e = std::make_shared<LayoutPackageIDs>();
+        entry = e;
+    }
 
-    Context context("When loading versions for '" + stringify(n) + "' in "
-            + stringify(_imp->repository->name()) + ":");
+    /* make_id only looks at the file name, so loading never asks us for
+     * this package's IDs again */
+    return entry->get(_imp->contended, [&] () -> std::shared_ptr<const PackageIDSequence> {
+        Context context("When loading versions for '" + stringify(n) + "' in "
+                + stringify(_imp->repository->name()) + ":");
 
-    std::shared_ptr<PackageIDSequence> v(std::make_shared<PackageIDSequence>());
+        std::shared_ptr<PackageIDSequence> v(std::make_shared<PackageIDSequence>());
 
-    FSPath path(_imp->tree_root / stringify(n.category()) / stringify(n.package()));
+        FSPath path(_imp->tree_root / stringify(n.category()) / stringify(n.package()));
 
-    for (FSIterator e(path, { fsio_inode_sort }), e_end ; e != e_end ; ++e)
-    {
-        if (! FileSuffixes::get_instance()->is_package_file(n, *e))
-            continue;
-
-        try
-        {
-            std::shared_ptr<const PackageID> id(_imp->repository->make_id(n, *e));
-            if (indirect_iterator(v->end()) != std::find_if(indirect_iterator(v->begin()), indirect_iterator(v->end()),
-                        std::bind(std::equal_to<VersionSpec>(), id->version(), std::bind(std::mem_fn(&PackageID::version), _1))))
-                Log::get_instance()->message("e.traditional_layout.id.duplicate", ll_warning, lc_context)
-                    << "Ignoring entry '" << *e << "' for '" << n << "' in repository '" << _imp->repository->name()
-                    << "' because another equivalent version already exists";
-            else
-                v->push_back(id);
-        }
-        catch (const InternalError &)
+        for (FSIterator e(path, { fsio_inode_sort }), e_end ; e != e_end ; ++e)
         {
-            throw;
-        }
-        catch (const Exception & ee)
-        {
-            Log::get_instance()->message("e.traditional_layout.id.failure", ll_warning, lc_context)
-                << "Skipping entry '" << *e << "' for '" << n << "' in repository '"
-                << _imp->repository->name() << "' due to exception '" << ee.message() << "' ("
-                << ee.what() << ")'";
+            if (! FileSuffixes::get_instance()->is_package_file(n, *e))
+                continue;
+
+            try
+            {
+                std::shared_ptr<const PackageID> id(_imp->repository->make_id(n, *e));
+                if (indirect_iterator(v->end()) != std::find_if(indirect_iterator(v->begin()), indirect_iterator(v->end()),
+                            std::bind(std::equal_to<VersionSpec>(), id->version(), std::bind(std::mem_fn(&PackageID::version), _1))))
+                    Log::get_instance()->message("e.traditional_layout.id.duplicate", ll_warning, lc_context)
+                        << "Ignoring entry '" << *e << "' for '" << n << "' in repository '" << _imp->repository->name()
+                        << "' because another equivalent version already exists";
+                else
+                    v->push_back(id);
+            }
+            catch (const InternalError &)
+            {
+                throw;
+            }
+            catch (const Exception & ee)
+            {
+                Log::get_instance()->message("e.traditional_layout.id.failure", ll_warning, lc_context)
+                    << "Skipping entry '" << *e << "' for '" << n << "' in repository '"
+                    << _imp->repository->name() << "' due to exception '" << ee.message() << "' ("
+                    << ee.what() << ")'";
+            }
         }
-    }
 
-    _imp->ids.insert(std::make_pair(n, v));
-    _imp->package_names[n] = true;
+        return v;
+    });
 }
 
 bool
 TraditionalLayout::has_category_named(const CategoryNamePart & c) const
 {
-    std::unique_lock<std::recursive_mutex> lock(_imp->big_nasty_mutex);
-
     Context context("When checking for category '" + stringify(c) + "' in '" + stringify(_imp->repository->name()) + "':");
 
     need_category_names();
@@ -316,70 +351,52 @@ TraditionalLayout::has_category_named(const CategoryNamePart & c) const
 bool
 TraditionalLayout::has_package_named(const QualifiedPackageName & q) const
 {
-    std::unique_lock<std::recursive_mutex> lock(_imp->big_nasty_mutex);
-
     Context context("When checking for package '" + stringify(q) + "' in '" + stringify(_imp->repository->name()) + ":");
 
     need_category_names();
 
-    CategoryMap::iterator cat_iter(_imp->category_names.find(q.category()));
+    CategoryMap::const_iterator cat_iter(_imp->category_names.find(q.category()));
 
     if (_imp->category_names.end() == cat_iter)
         return false;
 
-    if (cat_iter->second)
     {
+        std::unique_lock<std::mutex> lock(take_layout_lock(_imp->package_names_mutex, _imp->contended));
+
+        if (_imp->package_names.end() != _imp->package_names.find(q))
+            return true;
+
         /* this category's package names are fully loaded */
-        return _imp->package_names.find(q) != _imp->package_names.end();
+        if (cat_iter->second)
+            return false;
     }
-    else
-    {
-        /* package names are only partially loaded or not loaded */
-        if (_imp->package_names.find(q) != _imp->package_names.end())
-            return true;
 
+    /* package names are only partially loaded or not loaded */
+    {
         FSPath fs(_imp->tree_root);
         fs /= stringify(q.category());
         fs /= stringify(q.package());
         if (! fs.stat().is_directory_or_symlink_to_directory())
             return false;
-        _imp->package_names.insert(std::make_pair(q, false));
+
+        std::unique_lock<std::mutex> lock(take_layout_lock(_imp->package_names_mutex, _imp->contended));
+        _imp->package_names.insert(q);
         return true;
     }
 }
 
-void
-TraditionalLayout::need_category_names_collection() const
-{
-    std::unique_lock<std::recursive_mutex> lock(_imp->big_nasty_mutex);
-
-    if (_imp->category_names_collection)
-        return;
-
-    need_category_names();
-
-    _imp->category_names_collection = std::make_shared<CategoryNamePartSet>();
-    std::transform(_imp->category_names.begin(), _imp->category_names.end(),
-            _imp->category_names_collection->inserter(),
-            std::mem_fn(&std::pair<const CategoryNamePart, bool>::first));
-}
-
 std::shared_ptr<const CategoryNamePartSet>
 TraditionalLayout::category_names() const
 {
-    std::unique_lock<std::recursive_mutex> lock(_imp->big_nasty_mutex);
-
     Context context("When fetching category names in " + stringify(stringify(_imp->repository->name())) + ":");
 
-    need_category_names_collection();
+    need_category_names();
     return _imp->category_names_collection;
 }
 
 std::shared_ptr<const QualifiedPackageNameSet>
 TraditionalLayout::package_names(const CategoryNamePart & c) const
 {
-    std::unique_lock<std::recursive_mutex> lock(_imp->big_nasty_mutex);
-
     using namespace std::placeholders;
 
     /* this isn't particularly fast because it isn't called very often. avoid
@@ -391,9 +408,12 @@ TraditionalLayout::package_names(const CategoryNamePart & c) const
 
     need_category_names();
 
-    if (_imp->category_names.end() == _imp->category_names.find(c))
+    CategoryMap::iterator cat_iter(_imp->category_names.find(c));
+    if (_imp->category_names.end() == cat_iter)
         return std::make_shared<QualifiedPackageNameSet>();
 
+    std::list<QualifiedPackageName> found;
+
     if ((_imp->tree_root / stringify(c)).stat().is_directory_or_symlink_to_directory())
         for (FSIterator d(_imp->tree_root / stringify(c), { fsio_inode_sort, fsio_deref_symlinks_for_wants, fsio_want_directories }), d_end ; d != d_end ; ++d)
         {
@@ -402,7 +422,7 @@ TraditionalLayout::package_names(const CategoryNamePart & c) const
                 if (d->basename() == "CVS")
                    continue;
 
-                _imp->package_names.insert(std::make_pair(c + PackageNamePart(d->basename()), false));
+                found.push_back(c + PackageNamePart(d->basename()));
             }
             catch (const NameError & e)
             {
@@ -412,14 +432,17 @@ TraditionalLayout::package_names(const CategoryNamePart & c) const
             }
         }
 
-    _imp->category_names[c] = true;
+    std::unique_lock<std::mutex> lock(take_layout_lock(_imp->package_names_mutex, _imp->contended));
+
+    _imp->package_names.insert(found.begin(), found.end());
+    cat_iter->second = true;
 
     std::shared_ptr<QualifiedPackageNameSet> result(std::make_shared<QualifiedPackageNameSet>());
 
-    for (PackagesMap::const_iterator p(_imp->package_names.begin()), p_end(_imp->package_names.end()) ;
+    for (PackagesSet::const_iterator p(_imp->package_names.begin()), p_end(_imp->package_names.end()) ;
             p != p_end ; ++p)
-        if (p->first.category() == c)
-            result->insert(p->first);
+        if (p->category() == c)
+            result->insert(*p);
 
     return result;
 }
@@ -427,15 +450,10 @@ TraditionalLayout::package_names(const CategoryNamePart & c) const
 std::shared_ptr<const PackageIDSequence>
 TraditionalLayout::package_ids(const QualifiedPackageName & n) const
 {
-    std::unique_lock<std::recursive_mutex> lock(_imp->big_nasty_mutex);
-
     Context context("When fetching versions of '" + stringify(n) + "' in " + stringify(_imp->repository->name()) + ":");
 
     if (has_package_named(n))
-    {
-        need_package_ids(n);
-        return _imp->ids.find(n)->second;
-    }
+        return need_package_ids(n);
     else
         return std::make_shared<PackageIDSequence>();
 }
@@ -42,8 +42,7 @@ namespace paludis
                 Pimp<TraditionalLayout> _imp;
 
                 void need_category_names() const;
-                void need_category_names_collection() const;
-                void need_package_ids(const QualifiedPackageName &) const;
+                const std::shared_ptr<const PackageIDSequence> need_package_ids(const QualifiedPackageName &) const;
 
             public:
                 ///\name Basic operations
@@ -28,6 +28,7 @@
 #include <paludis/repositories/e/e_repository.hh>
 #include <paludis/repositories/e/extra_distribution_data.hh>
 #include <paludis/repositories/e/can_skip_phase.hh>
+#include <paludis/repositories/e/e_installed_metadata_record.hh>
 
 #include <paludis/action.hh>
 #include <paludis/util/config_file.hh>
@@ -55,6 +56,7 @@
 #include <paludis/dep_spec_annotations.hh>
 #include <paludis/unformatted_pretty_printer.hh>
 #include <paludis/slot.hh>
+#include <paludis/elike_package_dep_spec.hh>
 
 #include <paludis/util/is_file_with_extension.hh>
 #include <paludis/util/log.hh>
@@ -72,11 +74,14 @@
 #include <paludis/util/safe_ifstream.hh>
 #include <paludis/util/safe_ofstream.hh>
 #include <paludis/util/timestamp.hh>
+#include <paludis/util/cache_file.hh>
 #include <paludis/util/destringify.hh>
 #include <paludis/util/fs_stat.hh>
 #include <paludis/util/fs_iterator.hh>
+#include <paludis/util/fs_dir_walker.hh>
 #include <paludis/util/join.hh>
 #include <paludis/util/return_literal_function.hh>
+#include <paludis/util/task_scheduler.hh>
 
 #include <paludis/util/pimp-impl.hh>
 #include <paludis/util/create_iterator-impl.hh>
@@ -89,7 +94,9 @@
 #include <list>
 #include <map>
 #include <iostream>
+#include <sstream>
 #include <mutex>
+#include <exception>
 #include <cstring>
 #include <cerrno>
 #include <ctime>
@@ -101,6 +108,163 @@ typedef std::unordered_map<CategoryNamePart, std::shared_ptr<QualifiedPackageNam
 typedef std::unordered_map<QualifiedPackageName, std::shared_ptr<PackageIDSequence>, Hash<QualifiedPackageName> > IDMap;
 typedef std::map<std::pair<QualifiedPackageName, VersionSpec>, std::shared_ptr<std::list<QualifiedPackageName> > > ProvidesMap;
 
+namespace
+{
+    struct LayoutCacheCategory
+    {
+        Timestamp mtime;
+        std::vector<std::string> entries;
+
+        LayoutCacheCategory() :
+            mtime(0, 0)
+        {
+        }
+    };
+
+    /* the category directories in a VDB, and the package directories in each
+     * category, along with the modification times they had when we read
+     * them. */
+    struct LayoutCache
+    {
+        Timestamp mtime;
+        std::map<std::string, LayoutCacheCategory> categories;
+
+        LayoutCache() :
+            mtime(0, 0)
+        {
+        }
+    };
+
+    const std::string layout_cache_magic("paludis-vdb-layout-1");
+
+    std::shared_ptr<const LayoutCache> read_layout_cache(const FSPath & f)
+    {
+        if (f == FSPath("/var/empty") || ! f.stat().is_regular_file())
+            return nullptr;
+
+        Context context("When reading VDB layout cache '" + stringify(f) + "':");
+
+        auto bad([&] (const std::string & why) -> std::shared_ptr<const LayoutCache> {
+                Log::get_instance()->message("e.vdb.layout_cache.bad", ll_debug, lc_context)
+                    << "Ignoring layout cache '" << f << "': " << why;
+                return nullptr;
+            });
+
+        try
+        {
+            SafeIFStream s(f);
+            auto result(std::make_shared<LayoutCache>());
+
+            std::string line;
+            if ((! std::getline(s, line)) || line != layout_cache_magic)
+                return bad("bad magic");
+
+            std::vector<std::string> tokens;
+            if (! std::getline(s, line))
+                return bad("no timestamp");
+            tokenise_whitespace(line, std::back_inserter(tokens));
+            if (2 != tokens.size())
+                return bad("bad timestamp line '" + line + "'");
+            result->mtime = Timestamp(destringify<time_t>(tokens[0]), destringify<long>(tokens[1]));
+
+            while (std::getline(s, line))
+            {
+                tokens.clear();
+                tokenise_whitespace(line, std::back_inserter(tokens));
+                if (4 != tokens.size())
+                    return bad("bad category line '" + line + "'");
+
+                LayoutCacheCategory & c(result->categories[tokens[0]]);
+                c.mtime = Timestamp(destringify<time_t>(tokens[1]), destringify<long>(tokens[2]));
+                for (int n(destringify<int>(tokens[3])) ; n > 0 ; --n)
+                {
+                    if (! std::getline(s, line))
+                        return bad("truncated category '" + tokens[0] + "'");
+                    c.entries.push_back(line);
+                }
+            }
+
+            return result;
+        }
+        catch (const Exception & e)
+        {
+            return bad("exception '" + e.message() + "' (" + e.what() + ")");
+        }
+    }
+
+    /* VDB directories are always cat/pkg-ver, so there's no need to go
+     * through the full user dep spec parser to split them up. */
+    std::pair<QualifiedPackageName, VersionSpec> split_name_and_version(const CategoryNamePart & c, const std::string & s)
+    {
+        std::string p(s);
+        VersionSpec v(elike_get_remove_trailing_version(p, user_version_spec_options()));
+        return std::make_pair(c + PackageNamePart(p), v);
+    }
+
+    struct WalkedPackage
+    {
+        std::string entry;
+        QualifiedPackageName name;
+        VersionSpec version;
+    };
+
+    struct CategoryWalk
+    {
+        std::string name;
+        Timestamp mtime;
+        std::vector<std::string> entries;
+        bool walked;
+
+        std::vector<WalkedPackage> packages;
+        std::vector<std::pair<std::string, std::string> > failures;
+
+        CategoryWalk(const std::string & n) :
+            name(n),
+            mtime(0, 0),
+            walked(false)
+        {
+        }
+    };
+
+    void walk_category(CategoryWalk & c, const FSPath & location, const std::shared_ptr<const LayoutCache> & cache)
+    {
+        FSDirWalker d(location / c.name);
+        c.mtime = d.stat_entry(".").mtim();
+
+        auto i(cache ? cache->categories.find(c.name) : std::map<std::string, LayoutCacheCategory>::const_iterator());
+        if (cache && cache->categories.end() != i && i->second.mtime == c.mtime)
+            c.entries = i->second.entries;
+        else
+        {
+            c.walked = true;
+            d.walk({ fsio_inode_sort, fsio_want_directories, fsio_deref_symlinks_for_wants },
+                    [&] (const FSDirEntry & e) { c.entries.push_back(e.name_string()); });
+        }
+
+        CategoryNamePart category(c.name);
+        for (std::vector<std::string>::const_iterator e(c.entries.begin()), e_end(c.entries.end()) ;
+                e != e_end ; ++e)
+        {
+            if (std::string::npos == e->rfind('-'))
+                continue;
+
+            try
+            {
+                std::pair<QualifiedPackageName, VersionSpec> p(split_name_and_version(category, *e));
+                c.packages.push_back(WalkedPackage{ *e, p.first, p.second });
+            }
+            catch (const InternalError &)
+            {
+                throw;
+            }
+            catch (const Exception & ee)
+            {
+                c.failures.push_back(std::make_pair(*e, "exception '" + ee.message() + "' (" + ee.what() + ")"));
+            }
+        }
+    }
+}
+
 namespace paludis
 {
     template <>
@@ -110,28 +274,40 @@ namespace paludis
 
         const std::shared_ptr<std::recursive_mutex> big_nasty_mutex;
 
+        /* goes up by one every time we're invalidated, so that anything
+         * which let go of the lock can tell whether we've been replaced */
+        const unsigned long long generation;
+
         mutable CategoryMap categories;
         mutable bool has_category_names;
         mutable IDMap ids;
 
+        mutable std::shared_ptr<const LayoutCache> layout_cache;
+        mutable LayoutCache seen_layout;
+        mutable bool seen_layout_differs;
+
         std::shared_ptr<RepositoryNameCache> names_cache;
 
-        Imp(const VDBRepository * const, const VDBRepositoryParams &, std::shared_ptr<std::recursive_mutex> = std::make_shared<std::recursive_mutex>());
+        Imp(const VDBRepository * const, const VDBRepositoryParams &,
+                std::shared_ptr<std::recursive_mutex> = std::make_shared<std::recursive_mutex>(), const unsigned long long = 0);
         ~Imp();
 
         std::shared_ptr<const MetadataValueKey<FSPath> > location_key;
         std::shared_ptr<const MetadataValueKey<FSPath> > root_key;
         std::shared_ptr<const MetadataValueKey<std::string> > format_key;
         std::shared_ptr<const MetadataValueKey<FSPath> > names_cache_key;
+        std::shared_ptr<const MetadataValueKey<FSPath> > layout_cache_key;
         std::shared_ptr<const MetadataValueKey<FSPath> > builddir_key;
         std::shared_ptr<const MetadataValueKey<std::string> > eapi_when_unknown_key;
     };
 
     Imp<VDBRepository>::Imp(const VDBRepository * const r,
-            const VDBRepositoryParams & p, std::shared_ptr<std::recursive_mutex> m) :
+            const VDBRepositoryParams & p, std::shared_ptr<std::recursive_mutex> m, const unsigned long long g) :
         params(p),
         big_nasty_mutex(m),
+        generation(g),
         has_category_names(false),
+        seen_layout_differs(false),
         names_cache(std::make_shared<RepositoryNameCache>(p.names_cache(), r)),
         location_key(std::make_shared<LiteralMetadataValueKey<FSPath> >("location", "location",
                     mkt_significant, params.location())),
@@ -141,6 +317,8 @@ namespace paludis
                     mkt_significant, "vdb")),
         names_cache_key(std::make_shared<LiteralMetadataValueKey<FSPath> >("names_cache", "names_cache",
                     mkt_normal, params.names_cache())),
+        layout_cache_key(std::make_shared<LiteralMetadataValueKey<FSPath> >("layout_cache", "layout_cache",
+                    mkt_normal, params.layout_cache())),
         builddir_key(std::make_shared<LiteralMetadataValueKey<FSPath> >("builddir", "builddir",
                     mkt_normal, params.builddir())),
         eapi_when_unknown_key(std::make_shared<LiteralMetadataValueKey<std::string> >(
@@ -179,6 +357,7 @@ VDBRepository::_add_metadata_keys() const
     add_metadata_key(_imp->root_key);
     add_metadata_key(_imp->format_key);
     add_metadata_key(_imp->names_cache_key);
+    add_metadata_key(_imp->layout_cache_key);
     add_metadata_key(_imp->builddir_key);
     add_metadata_key(_imp->eapi_when_unknown_key);
 }
@@ -196,22 +375,19 @@ VDBRepository::has_category_named(const CategoryNamePart & c, const RepositoryCo
 }
 
 bool
-VDBRepository::has_package_named(const QualifiedPackageName & q, const RepositoryContentMayExcludes &) const
+VDBRepository::has_package_named(const QualifiedPackageName & q, const RepositoryContentMayExcludes & x) const
 {
-    std::unique_lock<std::recursive_mutex> lock(*_imp->big_nasty_mutex);
-
     Context context("When checking for package '" + stringify(q) +
             "' in " + stringify(name()) + ":");
 
-    need_category_names();
-
-    CategoryMap::iterator cat_iter(_imp->categories.find(q.category()));
-    if (_imp->categories.end() == cat_iter)
+    if (! has_category_named(q.category(), x))
         return false;
 
     need_package_ids(q.category());
 
-    return cat_iter->second->end() != cat_iter->second->find(q);
+    std::unique_lock<std::recursive_mutex> lock(*_imp->big_nasty_mutex);
+    CategoryMap::iterator cat_iter(_imp->categories.find(q.category()));
+    return _imp->categories.end() != cat_iter && cat_iter->second && cat_iter->second->end() != cat_iter->second->find(q);
 }
 
 const bool
@@ -240,40 +416,35 @@ VDBRepository::category_names(const RepositoryContentMayExcludes &) const
 std::shared_ptr<const QualifiedPackageNameSet>
 VDBRepository::package_names(const CategoryNamePart & c, const RepositoryContentMayExcludes & x) const
 {
-    std::unique_lock<std::recursive_mutex> lock(*_imp->big_nasty_mutex);
-
     Context context("When fetching package names in category '" + stringify(c)
             + "' in " + stringify(name()) + ":");
 
-    std::shared_ptr<QualifiedPackageNameSet> result(std::make_shared<QualifiedPackageNameSet>());
-
-    need_category_names();
     if (! has_category_named(c, x))
         return std::make_shared<QualifiedPackageNameSet>();
 
     need_package_ids(c);
 
-    return _imp->categories.find(c)->second;
+    std::unique_lock<std::recursive_mutex> lock(*_imp->big_nasty_mutex);
+    CategoryMap::const_iterator i(_imp->categories.find(c));
+    if (_imp->categories.end() == i || ! i->second)
+        return std::make_shared<QualifiedPackageNameSet>();
+    return i->second;
 }
 
 std::shared_ptr<const PackageIDSequence>
 VDBRepository::package_ids(const QualifiedPackageName & n, const RepositoryContentMayExcludes & x) const
 {
-    std::unique_lock<std::recursive_mutex> lock(*_imp->big_nasty_mutex);
-
     Context context("When fetching versions of '" + stringify(n) + "' in "
             + stringify(name()) + ":");
 
-
-    need_category_names();
-    if (! has_category_named(n.category(), x))
-        return std::make_shared<PackageIDSequence>();
-
-    need_package_ids(n.category());
     if (! has_package_named(n, x))
         return std::make_shared<PackageIDSequence>();
 
-    return _imp->ids.find(n)->second;
+    std::unique_lock<std::recursive_mutex> lock(*_imp->big_nasty_mutex);
+    IDMap::const_iterator i(_imp->ids.find(n));
+    if (_imp->ids.end() == i)
+        return std::make_shared<PackageIDSequence>();
+    return i->second;
 }
 
 std::shared_ptr<Repository>
@@ -314,6 +485,15 @@ VDBRepository::repository_factory_create(
     if (name.empty())
         name = "installed";
 
+    std::string layout_cache(f("layout_cache"));
+    if (layout_cache.empty())
+    {
+        if (FSPath(names_cache) == FSPath("/var/empty"))
+            layout_cache = "/var/empty";
+        else
+            layout_cache = stringify(FSPath(names_cache) / (name + ".layout"));
+    }
+
     std::string eapi_when_unknown(f("eapi_when_unknown"));
     if (eapi_when_unknown.empty())
         eapi_when_unknown = EExtraDistributionData::get_instance()->data_from_distribution(
@@ -324,6 +504,7 @@ VDBRepository::repository_factory_create(
                 n::builddir() = builddir,
                 n::eapi_when_unknown() = eapi_when_unknown,
                 n::environment() = env,
+                n::layout_cache() = layout_cache,
                 n::location() = location,
                 n::name() = RepositoryName(name),
                 n::names_cache() = names_cache,
@@ -563,7 +744,7 @@ void
 VDBRepository::invalidate()
 {
     std::unique_lock<std::recursive_mutex> lock(*_imp->big_nasty_mutex);
-    _imp.reset(new Imp<VDBRepository>(this, _imp->params, _imp->big_nasty_mutex));
+    _imp.reset(new Imp<VDBRepository>(this, _imp->params, _imp->big_nasty_mutex, _imp->generation + 1));
     _add_metadata_keys();
 }
 
@@ -745,6 +926,7 @@ VDBRepository::merge(const MergeParams & m)
     }
 
     merger.merge();
+    EInstalledMetadataRecord::write(vdb_dir);
 
     if (is_replace)
     {
@@ -805,21 +987,39 @@ VDBRepository::need_category_names() const
 
     Context context("When loading category names from '" + stringify(_imp->params.location()) + "':");
 
-    for (FSIterator d(_imp->params.location(), { fsio_inode_sort, fsio_want_directories, fsio_deref_symlinks_for_wants }), d_end ; d != d_end ; ++d)
-        try
-        {
-            _imp->categories.insert(std::make_pair(CategoryNamePart(d->basename()),
-                        std::shared_ptr<QualifiedPackageNameSet>()));
-        }
-        catch (const InternalError &)
-        {
-            throw;
-        }
-        catch (const Exception & e)
-        {
-            Log::get_instance()->message("e.vdb.categories.failure", ll_warning, lc_context) << "Skipping VDB category dir '"
-                << *d << "' due to exception '" << e.message() << "' (" << e.what() << ")";
-        }
+    auto add([&] (const std::string & c) {
+            try
+            {
+                _imp->categories.insert(std::make_pair(CategoryNamePart(c), std::shared_ptr<QualifiedPackageNameSet>()));
+                _imp->seen_layout.categories[c];
+            }
+            catch (const InternalError &)
+            {
+                throw;
+            }
+            catch (const Exception & e)
+            {
+                Log::get_instance()->message("e.vdb.categories.failure", ll_warning, lc_context) << "Skipping VDB category dir '"
+                    << (_imp->params.location() / c) << "' due to exception '" << e.message() << "' (" << e.what() << ")";
+            }
+        });
+
+    FSDirWalker top(_imp->params.location());
+    _imp->layout_cache = read_layout_cache(_imp->params.layout_cache());
+    _imp->seen_layout.mtime = top.stat_entry(".").mtim();
+
+    if (_imp->layout_cache && _imp->layout_cache->mtime == _imp->seen_layout.mtime)
+    {
+        for (auto c(_imp->layout_cache->categories.begin()), c_end(_imp->layout_cache->categories.end()) ;
+                c != c_end ; ++c)
+            add(c->first);
+    }
+    else
+    {
+        _imp->seen_layout_differs = true;
+        top.walk({ fsio_inode_sort, fsio_want_directories, fsio_deref_symlinks_for_wants },
+                [&] (const FSDirEntry & d) { add(d.name_string()); });
+    }
 
     _imp->has_category_names = true;
 }
@@ -827,43 +1027,156 @@ VDBRepository::need_category_names() const
 void
 VDBRepository::need_package_ids(const CategoryNamePart & c) const
 {
+    {
+        std::unique_lock<std::recursive_mutex> lock(*_imp->big_nasty_mutex);
+
+        CategoryMap::iterator i(_imp->categories.find(c));
+        if (_imp->categories.end() != i && i->second)
+            return;
+    }
+
+    need_all_package_ids();
+
+    std::unique_lock<std::recursive_mutex> lock(*_imp->big_nasty_mutex);
+    std::shared_ptr<QualifiedPackageNameSet> & q(_imp->categories[c]);
+    if (! q)
+        q = std::make_shared<QualifiedPackageNameSet>();
+}
+
+void
+VDBRepository::need_all_package_ids() const
+{
+    /* we only hold the lock whilst deciding what to walk and whilst storing
+     * the results, not for the walk itself. if our caller is holding it
+     * too, that is still safe, since waiting for the walk never runs
+     * anything but the walk. */
     std::unique_lock<std::recursive_mutex> lock(*_imp->big_nasty_mutex);
 
-    if (_imp->categories[c])
+    need_category_names();
+
+    Context context("When loading package names from '" + stringify(_imp->params.location()) + "':");
+
+    std::vector<CategoryWalk> walks;
+    for (CategoryMap::const_iterator c(_imp->categories.begin()), c_end(_imp->categories.end()) ;
+            c != c_end ; ++c)
+        if (! c->second)
+            walks.push_back(CategoryWalk(stringify(c->first)));
+
+    if (walks.empty())
         return;
 
-    Context context("When loading package names from '" + stringify(_imp->params.location()) +
-            "' in category '" + stringify(c) + "':");
+    const unsigned long long generation(_imp->generation);
+    const FSPath location(_imp->params.location());
+    const std::shared_ptr<const LayoutCache> layout_cache(_imp->layout_cache);
+    lock.unlock();
 
-    std::shared_ptr<QualifiedPackageNameSet> q(std::make_shared<QualifiedPackageNameSet>());
+    /* reading each category and splitting its entries into names and
+     * versions is independent, so do them all at once */
+    parallel_for_each(walks.begin(), walks.end(), std::bind(&walk_category, std::placeholders::_1,
+                std::cref(location), std::cref(layout_cache)));
 
-    for (FSIterator d(_imp->params.location() / stringify(c), { fsio_inode_sort, fsio_want_directories, fsio_deref_symlinks_for_wants }), d_end ;
-            d != d_end ; ++d)
-        try
-        {
-            std::string s(d->basename());
-            if (std::string::npos == s.rfind('-'))
-                continue;
+    lock.lock();
 
-            PackageDepSpec p(parse_user_package_dep_spec("=" + stringify(c) + "/" + s,
-                        _imp->params.environment(), { }));
-            q->insert(*p.package_ptr());
-            IDMap::iterator i(_imp->ids.find(*p.package_ptr()));
-            if (_imp->ids.end() == i)
-                i = _imp->ids.insert(std::make_pair(*p.package_ptr(), std::make_shared<PackageIDSequence>())).first;
-            i->second->push_back(make_id(*p.package_ptr(), p.version_requirements_ptr()->begin()->version_spec(), *d));
-        }
-        catch (const InternalError &)
+    /* we've been invalidated whilst walking, so start again */
+    if (generation != _imp->generation)
+    {
+        lock.unlock();
+        need_all_package_ids();
+        return;
+    }
+
+    for (std::vector<CategoryWalk>::iterator w(walks.begin()), w_end(walks.end()) ;
+            w != w_end ; ++w)
+    {
+        CategoryNamePart c(w->name);
+
+        /* someone else walked it at the same time as us, and got in first */
+        if (_imp->categories[c])
+            continue;
+        std::shared_ptr<QualifiedPackageNameSet> q(std::make_shared<QualifiedPackageNameSet>());
+
+        for (std::vector<WalkedPackage>::const_iterator p(w->packages.begin()), p_end(w->packages.end()) ;
+                p != p_end ; ++p)
         {
-            throw;
+            q->insert(p->name);
+            IDMap::iterator i(_imp->ids.find(p->name));
+            if (_imp->ids.end() == i)
+                i = _imp->ids.insert(std::make_pair(p->name, std::make_shared<PackageIDSequence>())).first;
+            i->second->push_back(make_id(p->name, p->version, _imp->params.location() / w->name / p->entry));
         }
-        catch (const Exception & e)
-        {
+
+        for (std::vector<std::pair<std::string, std::string> >::const_iterator f(w->failures.begin()), f_end(w->failures.end()) ;
+                f != f_end ; ++f)
             Log::get_instance()->message("e.vdb.packages.failure", ll_warning, lc_context) << "Skipping VDB package dir '"
-                << *d << "' due to exception '" << e.message() << "' (" << e.what() << ")";
+                << (_imp->params.location() / w->name / f->first) << "' due to " << f->second;
+
+        _imp->categories[c] = q;
+
+        LayoutCacheCategory & l(_imp->seen_layout.categories[w->name]);
+        l.mtime = w->mtime;
+        l.entries = std::move(w->entries);
+        if (w->walked)
+            _imp->seen_layout_differs = true;
+    }
+
+    if (_imp->seen_layout_differs)
+        write_layout_cache();
+}
+
+void
+VDBRepository::write_layout_cache() const
+{
+    const FSPath & f(_imp->params.layout_cache());
+    if (f == FSPath("/var/empty"))
+        return;
+
+    Context context("When writing VDB layout cache '" + stringify(f) + "':");
+
+    if (! f.dirname().stat().is_directory())
+    {
+        Log::get_instance()->message("e.vdb.layout_cache.no_dir", ll_debug, lc_context)
+            << "Not writing layout cache because '" << f.dirname() << "' is not a directory";
+        return;
+    }
+
+    auto stamp([] (const Timestamp & t) -> std::string {
+            Timestamp c(cache_timestamp(t));
+            return stringify(c.seconds()) + " " + stringify(c.nanoseconds());
+        });
+
+    for (auto c(_imp->seen_layout.categories.begin()), c_end(_imp->seen_layout.categories.end()) ;
+            c != c_end ; ++c)
+        for (auto e(c->second.entries.begin()), e_end(c->second.entries.end()) ;
+                e != e_end ; ++e)
+            if (std::string::npos != e->find('\n'))
+            {
+                Log::get_instance()->message("e.vdb.layout_cache.newline", ll_debug, lc_context)
+                    << "Not writing layout cache because an entry in '" << c->first << "' contains a newline";
+                return;
+            }
+
+    try
+    {
+        std::ostringstream s;
+        s << layout_cache_magic << std::endl;
+        s << stamp(_imp->seen_layout.mtime) << std::endl;
+
+        for (auto c(_imp->seen_layout.categories.begin()), c_end(_imp->seen_layout.categories.end()) ;
+                c != c_end ; ++c)
+        {
+            s << c->first << " " << stamp(c->second.mtime) << " " << c->second.entries.size() << std::endl;
+            for (auto e(c->second.entries.begin()), e_end(c->second.entries.end()) ;
+                    e != e_end ; ++e)
+                s << *e << std::endl;
         }
 
-    _imp->categories[c] = q;
+        write_cache_file(f, s.str());
+    }
+    catch (const Exception & e)
+    {
+        Log::get_instance()->message("e.vdb.layout_cache.write_failure", ll_debug, lc_context)
+            << "Not writing layout cache due to exception '" << e.message() << "' (" << e.what() << ")";
+    }
 }
 
 const std::shared_ptr<const ERepositoryID>
@@ -880,16 +1193,18 @@ VDBRepository::make_id(const QualifiedPackageName & q, const VersionSpec & v, co
 const std::shared_ptr<const ERepositoryID>
 VDBRepository::package_id_if_exists(const QualifiedPackageName & q, const VersionSpec & v) const
 {
-    std::unique_lock<std::recursive_mutex> lock(*_imp->big_nasty_mutex);
-
     if (! has_package_named(q, { }))
         return std::shared_ptr<const ERepositoryID>();
 
-    need_package_ids(q.category());
+    std::unique_lock<std::recursive_mutex> lock(*_imp->big_nasty_mutex);
 
     using namespace std::placeholders;
 
-    PackageIDSequence::ConstIterator i(_imp->ids[q]->begin()), i_end(_imp->ids[q]->end());
+    IDMap::const_iterator ids(_imp->ids.find(q));
+    if (_imp->ids.end() == ids)
+        return std::shared_ptr<const ERepositoryID>();
+
+    PackageIDSequence::ConstIterator i(ids->second->begin()), i_end(ids->second->end());
     for ( ; i != i_end ; ++i)
         if (v == (*i)->version())
             return std::static_pointer_cast<const ERepositoryID>(*i);
@@ -1273,8 +1588,10 @@ VDBRepository::perform_updates()
                             << "', cannot update PF-equivalent VDB key for move";
                     }
 
-                    SafeOFStream category(to_dir / "CATEGORY", -1, true);
-                    category << m->second.category() << std::endl;
+                    {
+                        SafeOFStream category(to_dir / "CATEGORY", -1, true);
+                        category << m->second.category() << std::endl;
+                    }
 
                     if (newpf != oldpf)
                     {
@@ -1285,6 +1602,8 @@ VDBRepository::perform_updates()
                                 it->rename(to_dir / (newpf + it->basename().substr(lastdot)));
                         }
                     }
+
+                    EInstalledMetadataRecord::write(to_dir);
                 }
             }
         }
@@ -1297,8 +1616,12 @@ VDBRepository::perform_updates()
             {
                 std::cout << "    " << *m->first << " to " << m->second << std::endl;
 
-                SafeOFStream f(m->first->fs_location_key()->parse_value() / "SLOT", -1, true);
-                f << m->second << std::endl;
+                {
+                    SafeOFStream f(m->first->fs_location_key()->parse_value() / "SLOT", -1, true);
+                    f << m->second << std::endl;
+                }
+
+                EInstalledMetadataRecord::write(m->first->fs_location_key()->parse_value());
             }
         }
 
@@ -1320,15 +1643,20 @@ VDBRepository::perform_updates()
             for (PackageIDSequence::ConstIterator i(ids->begin()), i_end(ids->end()) ;
                     i != i_end ; ++i)
             {
+                bool rewrite_done_here(false);
                 if ((*i)->build_dependencies_key())
-                    rewrite_done |= rewrite_dependencies((*i)->fs_location_key()->parse_value() / (*i)->build_dependencies_key()->raw_name(),
+                    rewrite_done_here |= rewrite_dependencies((*i)->fs_location_key()->parse_value() / (*i)->build_dependencies_key()->raw_name(),
                             (*i)->build_dependencies_key(), dep_rewrites);
                 if ((*i)->run_dependencies_key())
-                    rewrite_done |= rewrite_dependencies((*i)->fs_location_key()->parse_value() / (*i)->run_dependencies_key()->raw_name(),
+                    rewrite_done_here |= rewrite_dependencies((*i)->fs_location_key()->parse_value() / (*i)->run_dependencies_key()->raw_name(),
                             (*i)->run_dependencies_key(), dep_rewrites);
                 if ((*i)->post_dependencies_key())
-                    rewrite_done |= rewrite_dependencies((*i)->fs_location_key()->parse_value() / (*i)->post_dependencies_key()->raw_name(),
+                    rewrite_done_here |= rewrite_dependencies((*i)->fs_location_key()->parse_value() / (*i)->post_dependencies_key()->raw_name(),
                             (*i)->post_dependencies_key(), dep_rewrites);
+
+                if (rewrite_done_here)
+                    EInstalledMetadataRecord::write((*i)->fs_location_key()->parse_value());
+                rewrite_done |= rewrite_done_here;
             }
 
             std::cout << std::endl << "Updating configuration files" << std::endl;
@@ -42,6 +42,7 @@ namespace paludis
         typedef Name<struct name_builddir> builddir;
         typedef Name<struct name_eapi_when_unknown> eapi_when_unknown;
         typedef Name<struct name_environment> environment;
+        typedef Name<struct name_layout_cache> layout_cache;
         typedef Name<struct name_location> location;
         typedef Name<struct name_name> name;
         typedef Name<struct name_names_cache> names_cache;
@@ -55,6 +56,7 @@ namespace paludis
             NamedValue<n::builddir, FSPath> builddir;
             NamedValue<n::eapi_when_unknown, std::string> eapi_when_unknown;
             NamedValue<n::environment, Environment *> environment;
+            NamedValue<n::layout_cache, FSPath> layout_cache;
             NamedValue<n::location, FSPath> location;
             NamedValue<n::name, RepositoryName> name;
             NamedValue<n::names_cache, FSPath> names_cache;
@@ -81,6 +83,8 @@ namespace paludis
 
             void need_category_names() const;
             void need_package_ids(const CategoryNamePart &) const;
+            void need_all_package_ids() const;
+            void write_layout_cache() const;
 
             const std::shared_ptr<const erepository::ERepositoryID> package_id_if_exists(const QualifiedPackageName &,
                     const VersionSpec &) const
@@ -19,6 +19,7 @@
 
 #include <paludis/repositories/e/vdb_repository.hh>
 #include <paludis/repositories/e/e_repository.hh>
+#include <paludis/repositories/e/e_installed_metadata_record.hh>
 #include <paludis/repositories/e/spec_tree_pretty_printer.hh>
 
 #include <paludis/environments/test/test_environment.hh>
@@ -27,6 +28,8 @@
 #include <paludis/util/options.hh>
 #include <paludis/util/make_named_values.hh>
 #include <paludis/util/safe_ifstream.hh>
+#include <paludis/util/safe_ofstream.hh>
+#include <paludis/util/timestamp.hh>
 #include <paludis/util/fs_iterator.hh>
 #include <paludis/util/fs_stat.hh>
 #include <paludis/util/join.hh>
@@ -43,6 +46,7 @@
 #include <paludis/choice.hh>
 #include <paludis/unformatted_pretty_printer.hh>
 #include <paludis/contents.hh>
+#include <paludis/slot.hh>
 
 #include <paludis/util/indirect_iterator-impl.hh>
 
@@ -170,6 +174,133 @@ TEST(VDBRepository, HasCategoryNamed)
     EXPECT_TRUE(! repo->has_category_named(CategoryNamePart("cat-three"), { }));
 }
 
+TEST(VDBRepository, LayoutCache)
+{
+    FSPath location(FSPath::cwd() / "vdb_repository_TEST_dir" / "layoutcache");
+    FSPath layout_cache(FSPath::cwd() / "vdb_repository_TEST_dir" / "layoutcache_cache" / "installed.layout");
+
+    TestEnvironment env;
+    std::shared_ptr<Map<std::string, std::string> > keys(std::make_shared<Map<std::string, std::string>>());
+    keys->insert("format", "vdb");
+    keys->insert("names_cache", "/var/empty");
+    keys->insert("layout_cache", stringify(layout_cache));
+    keys->insert("location", stringify(location));
+    keys->insert("builddir", stringify(FSPath::cwd() / "vdb_repository_TEST_dir" / "build"));
+
+    {
+        std::shared_ptr<Repository> repo(VDBRepository::VDBRepository::repository_factory_create(&env,
+                    std::bind(from_keys, keys, std::placeholders::_1)));
+
+        EXPECT_EQ("cat-a/pkg-a cat-a/pkg-with-dashes", join(repo->package_names(CategoryNamePart("cat-a"), { })->begin(),
+                    repo->package_names(CategoryNamePart("cat-a"), { })->end(), " "));
+        EXPECT_EQ("1.2-r3", stringify((*repo->package_ids(QualifiedPackageName("cat-a/pkg-with-dashes"), { })->begin())->version()));
+        EXPECT_EQ("scm", stringify((*repo->package_ids(QualifiedPackageName("cat-b/pkg-b"), { })->begin())->version()));
+        EXPECT_TRUE(layout_cache.stat().is_regular_file());
+    }
+
+    /* a cache that matches the directories' timestamps is used instead of
+     * looking in them */
+    {
+        SafeOFStream f(layout_cache, -1, true);
+        Timestamp t(location.stat().mtim()), a((location / "cat-a").stat().mtim()), b((location / "cat-b").stat().mtim());
+        f << "paludis-vdb-layout-1" << std::endl
+            << t.seconds() << " " << t.nanoseconds() << std::endl
+            << "cat-a " << a.seconds() << " " << a.nanoseconds() << " 2" << std::endl
+            << "pkg-a-1" << std::endl
+            << "pkg-cached-1" << std::endl
+            << "cat-b " << b.seconds() << " " << b.nanoseconds() << " 0" << std::endl;
+    }
+
+    {
+        std::shared_ptr<Repository> repo(VDBRepository::VDBRepository::repository_factory_create(&env,
+                    std::bind(from_keys, keys, std::placeholders::_1)));
+        EXPECT_TRUE(repo->has_package_named(QualifiedPackageName("cat-a/pkg-cached"), { }));
+        EXPECT_FALSE(repo->has_package_named(QualifiedPackageName("cat-a/pkg-with-dashes"), { }));
+        EXPECT_FALSE(repo->has_package_named(QualifiedPackageName("cat-b/pkg-b"), { }));
+    }
+
+    /* but only for categories that haven't changed */
+    ASSERT_TRUE((location / "cat-a").utime(Timestamp(12345, 0)));
+
+    {
+        std::shared_ptr<Repository> repo(VDBRepository::VDBRepository::repository_factory_create(&env,
+                    std::bind(from_keys, keys, std::placeholders::_1)));
+        EXPECT_FALSE(repo->has_package_named(QualifiedPackageName("cat-a/pkg-cached"), { }));
+        EXPECT_TRUE(repo->has_package_named(QualifiedPackageName("cat-a/pkg-with-dashes"), { }));
+        EXPECT_FALSE(repo->has_package_named(QualifiedPackageName("cat-b/pkg-b"), { }));
+    }
+}
+
+TEST(VDBRepository, MetadataRecord)
+{
+    FSPath dir(FSPath::cwd() / "vdb_repository_TEST_dir" / "metadatarecord" / "cat" / "pkg-1");
+
+    TestEnvironment env;
+    std::shared_ptr<Map<std::string, std::string> > keys(std::make_shared<Map<std::string, std::string>>());
+    keys->insert("format", "vdb");
+    keys->insert("names_cache", "/var/empty");
+    keys->insert("location", stringify(FSPath::cwd() / "vdb_repository_TEST_dir" / "metadatarecord"));
+    keys->insert("builddir", stringify(FSPath::cwd() / "vdb_repository_TEST_dir" / "build"));
+
+    erepository::EInstalledMetadataRecord::write(dir);
+    if (0 == dir.stat().mtim().nanoseconds())
+        return;
+
+    auto record(erepository::EInstalledMetadataRecord::load(dir));
+    ASSERT_TRUE(bool(record));
+    EXPECT_TRUE(record->exists("pkg-1.ebuild"));
+    EXPECT_FALSE(record->has_contents("pkg-1.ebuild"));
+    EXPECT_FALSE(record->exists("RDEPEND"));
+    ASSERT_TRUE(record->has_contents("SLOT"));
+    EXPECT_EQ("0\n", record->contents("SLOT"));
+
+    /* a rewrite which keeps the size and the mtime doesn't make the record
+     * stale, so we can tell whether it's being used */
+    Timestamp slot_mtime((dir / "SLOT").stat().mtim());
+    {
+        SafeOFStream f(dir / "SLOT", -1, true);
+        f << "1" << std::endl;
+    }
+    (dir / "SLOT").utime(slot_mtime);
+
+    {
+        std::shared_ptr<Repository> repo(VDBRepository::VDBRepository::repository_factory_create(&env,
+                    std::bind(from_keys, keys, std::placeholders::_1)));
+        auto id(*repo->package_ids(QualifiedPackageName("cat/pkg"), { })->begin());
+        EXPECT_EQ("0", stringify(id->slot_key()->parse_value().raw_value()));
+        EXPECT_EQ("The short description", id->short_description_key()->parse_value());
+    }
+
+    /* but any other rewrite in place does */
+    {
+        SafeOFStream f(dir / "SLOT", -1, true);
+        f << "1" << std::endl;
+    }
+    EXPECT_FALSE(bool(erepository::EInstalledMetadataRecord::load(dir)));
+
+    {
+        std::shared_ptr<Repository> repo(VDBRepository::VDBRepository::repository_factory_create(&env,
+                    std::bind(from_keys, keys, std::placeholders::_1)));
+        auto id(*repo->package_ids(QualifiedPackageName("cat/pkg"), { })->begin());
+        EXPECT_EQ("1", stringify(id->slot_key()->parse_value().raw_value()));
+    }
+
+    /* as does adding a file */
+    erepository::EInstalledMetadataRecord::write(dir);
+    ASSERT_TRUE(bool(erepository::EInstalledMetadataRecord::load(dir)));
+    {
+        SafeOFStream f(dir / "RDEPEND", -1, true);
+    }
+    EXPECT_FALSE(bool(erepository::EInstalledMetadataRecord::load(dir)));
+
+    {
+        std::shared_ptr<Repository> repo(VDBRepository::VDBRepository::repository_factory_create(&env,
+                    std::bind(from_keys, keys, std::placeholders::_1)));
+        auto id(*repo->package_ids(QualifiedPackageName("cat/pkg"), { })->begin());
+        EXPECT_EQ("1", stringify(id->slot_key()->parse_value().raw_value()));
+    }
+}
+
 TEST(VDBRepository, QueryUse)
 {
     TestEnvironment env;
@@ -10,6 +10,8 @@ mkdir -p root/etc
 
 mkdir -p repo1/cat-{one/{pkg-one-1,pkg-both-1},two/{pkg-two-2,pkg-both-2}} || exit 1
 
+mkdir -p layoutcache/cat-{a/{pkg-a-1,pkg-with-dashes-1.2-r3,not_a_package},b/pkg-b-scm} layoutcache_cache || exit 1
+
 for i in SLOT EAPI; do
     echo "0" >repo1/cat-one/pkg-one-1/${i}
 done
@@ -82,6 +84,12 @@ echo "exheres-0" >repo2/category/package-1/EAPI
 echo "0" >repo2/category/package-1/SLOT
 echo "cat/pkg1 build: cat/pkg2 build+run: cat/pkg3 suggestion: cat/pkg4 post: cat/pkg5" >repo2/category/package-1/DEPENDENCIES
 
+mkdir -p metadatarecord/cat/pkg-1 || exit 1
+echo "0" >metadatarecord/cat/pkg-1/EAPI
+echo "0" >metadatarecord/cat/pkg-1/SLOT
+echo "The short description" >metadatarecord/cat/pkg-1/DESCRIPTION
+touch metadatarecord/cat/pkg-1/pkg-1.ebuild
+
 mkdir -p reinstalltest reinstalltest_src{1,2}/{eclass,profiles/profile,cat/pkg} || exit 1
 
 cat <<END > reinstalltest_src1/profiles/profile/make.defaults
@@ -19,6 +19,7 @@
 
 #include <paludis/repositories/unavailable/unavailable_repository.hh>
 #include <paludis/repositories/unavailable/unavailable_repository_store.hh>
+#include <paludis/repositories/unavailable/unavailable_repository_index.hh>
 #include <paludis/util/pimp-impl.hh>
 #include <paludis/util/active_object_ptr.hh>
 #include <paludis/util/deferred_construction_ptr.hh>
@@ -26,6 +27,9 @@
 #include <paludis/util/tokeniser.hh>
 #include <paludis/util/make_named_values.hh>
 #include <paludis/util/extract_host_from_url.hh>
+#include <paludis/util/fs_iterator.hh>
+#include <paludis/util/is_file_with_extension.hh>
+#include <paludis/util/log.hh>
 #include <paludis/literal_metadata_key.hh>
 #include <paludis/action.hh>
 #include <paludis/syncer.hh>
@@ -319,9 +323,33 @@ UnavailableRepository::sync(
     if (! ok)
         throw SyncFailedError(stringify(_imp->params.location()), sync_uri);
 
+    regenerate_cache();
+
     return true;
 }
 
+void
+UnavailableRepository::regenerate_cache() const
+{
+    Context context("When generating indices for repository '" + stringify(name()) + "':");
+
+    for (FSIterator f(_imp->params.location(), { fsio_inode_sort }), f_end ; f != f_end ; ++f)
+    {
+        if (! is_file_with_extension(*f, ".repository", { }))
+            continue;
+
+        try
+        {
+            UnavailableRepositoryIndex::generate(*f);
+        }
+        catch (const Exception & e)
+        {
+            Log::get_instance()->message("unavailable_repository.index.write_failed", ll_warning, lc_context)
+                << "Cannot write index for '" << *f << "': '" << e.message() << "' (" << e.what() << ")";
+        }
+    }
+}
+
 std::shared_ptr<Repository>
 UnavailableRepository::repository_factory_create(
         Environment * const env,
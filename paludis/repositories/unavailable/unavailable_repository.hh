@@ -92,6 +92,7 @@ namespace paludis
                 virtual void invalidate();
 
                 virtual bool sync(const std::string &, const std::string &, const std::shared_ptr<OutputManager> &) const;
+                virtual void regenerate_cache() const;
 
                 virtual const std::shared_ptr<const Set<std::string> > maybe_expand_licence_nonrecursively(
                         const std::string &) const;
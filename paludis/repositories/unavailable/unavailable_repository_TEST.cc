@@ -18,6 +18,7 @@
  */
 
 #include <paludis/repositories/unavailable/unavailable_repository.hh>
+#include <paludis/repositories/unavailable/unavailable_repository_index.hh>
 #include <paludis/repositories/fake/fake_repository.hh>
 
 #include <paludis/environments/test/test_environment.hh>
@@ -28,14 +29,20 @@
 #include <paludis/util/indirect_iterator-impl.hh>
 #include <paludis/util/make_named_values.hh>
 #include <paludis/util/map.hh>
+#include <paludis/util/fs_path.hh>
+#include <paludis/util/fs_stat.hh>
+#include <paludis/util/safe_ofstream.hh>
 
 #include <paludis/generator.hh>
 #include <paludis/selection.hh>
 #include <paludis/filtered_generator.hh>
 #include <paludis/filter.hh>
 #include <paludis/package_id.hh>
+#include <paludis/metadata_key.hh>
 
 #include <memory>
+#include <algorithm>
+#include <fcntl.h>
 
 #include <gtest/gtest.h>
 
@@ -114,3 +121,87 @@ TEST(UnavailableRepository, Contents)
             );
 }
 
+
+TEST(UnavailableRepository, Index)
+{
+    TestEnvironment env;
+    FSPath location(FSPath::cwd() / "unavailable_repository_TEST_dir" / "repo3");
+    std::shared_ptr<UnavailableRepository> repo(std::make_shared<UnavailableRepository>(
+                make_named_values<UnavailableRepositoryParams>(
+                    n::environment() = &env,
+                    n::location() = location,
+                    n::name() = RepositoryName("unavailable"),
+                    n::sync() = std::make_shared<Map<std::string, std::string> >(),
+                    n::sync_options() = std::make_shared<Map<std::string, std::string> >()
+                )));
+    env.add_repository(1, repo);
+
+    repo->regenerate_cache();
+    EXPECT_TRUE(UnavailableRepositoryIndex::index_file_for(location / "foo.repository").stat().is_regular_file());
+    EXPECT_TRUE(bool(UnavailableRepositoryIndex::open(location / "foo.repository")));
+    EXPECT_TRUE(bool(UnavailableRepositoryIndex::open(location / "bar.repository")));
+
+    repo->invalidate();
+    EXPECT_TRUE(repo->has_package_named(QualifiedPackageName("cat-two/pkg-six"), { }));
+    EXPECT_FALSE(repo->has_package_named(QualifiedPackageName("cat-two/pkg-one"), { }));
+    EXPECT_EQ("cat-one/pkg-one cat-one/pkg-six cat-one/pkg-two",
+            join(repo->package_names(CategoryNamePart("cat-one"), { })->begin(),
+                repo->package_names(CategoryNamePart("cat-one"), { })->end(), " "));
+
+    std::shared_ptr<const PackageIDSequence> contents(
+            env[selection::AllVersionsSorted(generator::All())]);
+    ASSERT_TRUE(bool(contents));
+
+    EXPECT_EQ(
+            "cat-one/pkg-one-1:0::unavailable (in ::bar) "
+            "cat-one/pkg-one-1:0::unavailable (in ::foo) "
+            "cat-one/pkg-one-2:0::unavailable (in ::foo) "
+            "cat-one/pkg-one-3:0::unavailable (in ::foo) "
+            "cat-one/pkg-one-3:3::unavailable (in ::bar) "
+            "cat-one/pkg-six-3:0::unavailable (in ::bar) "
+            "cat-one/pkg-two-1:1::unavailable (in ::foo) "
+            "cat-one/pkg-two-2:2::unavailable (in ::foo) "
+            "cat-two/pkg-six-1:0::unavailable (in ::bar) "
+            "repository/bar-0::unavailable "
+            "repository/foo-0::unavailable",
+            join(indirect_iterator(contents->begin()), indirect_iterator(contents->end()), " ")
+            );
+
+    std::shared_ptr<const PackageIDSequence> pkg_one(repo->package_ids(QualifiedPackageName("cat-one/pkg-one"), { }));
+    auto m(std::find_if(pkg_one->begin(), pkg_one->end(), [] (const std::shared_ptr<const PackageID> & id) {
+                return id->version() == VersionSpec("2", { });
+                }));
+    ASSERT_TRUE(m != pkg_one->end());
+    EXPECT_EQ("Monkey", (*m)->short_description_key()->parse_value());
+}
+
+TEST(UnavailableRepository, StaleIndex)
+{
+    TestEnvironment env;
+    FSPath location(FSPath::cwd() / "unavailable_repository_TEST_dir" / "repo3");
+    std::shared_ptr<UnavailableRepository> repo(std::make_shared<UnavailableRepository>(
+                make_named_values<UnavailableRepositoryParams>(
+                    n::environment() = &env,
+                    n::location() = location,
+                    n::name() = RepositoryName("unavailable"),
+                    n::sync() = std::make_shared<Map<std::string, std::string> >(),
+                    n::sync_options() = std::make_shared<Map<std::string, std::string> >()
+                )));
+    env.add_repository(1, repo);
+
+    repo->regenerate_cache();
+
+    {
+        SafeOFStream f(location / "bar.repository", O_WRONLY | O_APPEND, true);
+        f << "cat-three/" << std::endl << "    pkg-new/" << std::endl << "        :0 4 ; New" << std::endl;
+    }
+
+    EXPECT_FALSE(bool(UnavailableRepositoryIndex::open(location / "bar.repository")));
+    EXPECT_TRUE(bool(UnavailableRepositoryIndex::open(location / "foo.repository")));
+
+    repo->invalidate();
+    EXPECT_TRUE(repo->has_category_named(CategoryNamePart("cat-three"), { }));
+    EXPECT_EQ("cat-three/pkg-new-4:0::unavailable (in ::bar)",
+            join(indirect_iterator(repo->package_ids(QualifiedPackageName("cat-three/pkg-new"), { })->begin()),
+                indirect_iterator(repo->package_ids(QualifiedPackageName("cat-three/pkg-new"), { })->end()), " "));
+}
@@ -35,5 +35,8 @@ cat-two/
         :0 1 ; Cheese on toast
 END
 
+mkdir -p repo3
+cp repo2/*.repository repo3/
+
 cd ..
 
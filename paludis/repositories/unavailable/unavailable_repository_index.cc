@@ -0,0 +1,575 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2026 agent
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <paludis/repositories/unavailable/unavailable_repository_index.hh>
+#include <paludis/repositories/unavailable/unavailable_repository_file.hh>
+#include <paludis/repositories/unavailable/unavailable_repository.hh>
+#include <paludis/util/pimp-impl.hh>
+#include <paludis/util/stringify.hh>
+#include <paludis/util/log.hh>
+#include <paludis/util/set.hh>
+#include <paludis/util/make_named_values.hh>
+#include <paludis/util/fs_path.hh>
+#include <paludis/util/fs_stat.hh>
+#include <paludis/util/timestamp.hh>
+#include <paludis/util/safe_ofstream.hh>
+#include <paludis/util/wrapped_forward_iterator.hh>
+#include <paludis/name.hh>
+#include <paludis/version_spec.hh>
+#include <paludis/literal_metadata_key.hh>
+#include <paludis/user_dep_spec.hh>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace paludis;
+using namespace paludis::unavailable_repository;
+
+/*
+ * Index layout. All integers are in native byte order; the byte order marker
+ * makes an index written on a different architecture look corrupt rather than
+ * wrong.
+ *
+ *   char[16] magic
+ *   u32      byte order marker
+ *   u32      flags
+ *   i64      source mtime seconds
+ *   i64      source mtime nanoseconds
+ *   u64      source size
+ *   u32[6]   header strings (repo_name, homepage, description, sync,
+ *            repo_format, dependencies)
+ *   u32      category count
+ *   u32      package count
+ *   u32      entry count
+ *   u32      string table size
+ *   { u32 name, u32 first package, u32 package count } categories, sorted
+ *   { u32 name, u32 first entry, u32 entry count } packages, sorted per category
+ *   { u32 version, u32 slot, u32 description } entries, in file order
+ *   string table of { u32 length, char[length] }
+ *
+ * Strings are stored as offsets into the string table, and are shared.
+ */
+
+namespace
+{
+    const char index_magic[16] = { 'p', 'a', 'l', 'u', 'd', 'i', 's', '-', 'u', 'a', 'i', 'd', 'x', '-', '1', '\n' };
+    const uint32_t index_byte_order = 0x01020304;
+    const uint32_t flag_autoconfigurable = 1;
+
+    enum HeaderString
+    {
+        hs_repo_name,
+        hs_homepage,
+        hs_description,
+        hs_sync,
+        hs_repo_format,
+        hs_dependencies,
+        last_hs
+    };
+
+    const std::size_t header_strings_at = 48;
+    const std::size_t counts_at = header_strings_at + 4 * last_hs;
+    const std::size_t header_size = counts_at + 16;
+    const std::size_t record_size = 12;
+
+    void put_u32(std::string & s, const uint32_t v)
+    {
+        s.append(reinterpret_cast<const char *>(&v), sizeof(v));
+    }
+
+    void put_u64(std::string & s, const uint64_t v)
+    {
+        s.append(reinterpret_cast<const char *>(&v), sizeof(v));
+    }
+
+    struct StringTable
+    {
+        std::string data;
+        std::unordered_map<std::string, uint32_t> offsets;
+
+        uint32_t add(const std::string & s)
+        {
+            auto i(offsets.find(s));
+            if (offsets.end() != i)
+                return i->second;
+
+            uint32_t result(data.size());
+            put_u32(data, s.length());
+            data.append(s);
+            offsets.insert(std::make_pair(s, result));
+            return result;
+        }
+    };
+
+    struct EntryStrings
+    {
+        std::string version;
+        std::string slot;
+        std::string description;
+    };
+
+    typedef std::map<std::string, std::map<std::string, std::vector<EntryStrings> > > Tree;
+
+    std::string make_index(const FSPath & source, const FSStat & source_stat)
+    {
+        UnavailableRepositoryFile file(source);
+
+        Tree tree;
+        for (UnavailableRepositoryFile::ConstIterator i(file.begin()), i_end(file.end()) ;
+                i != i_end ; ++i)
+            tree[stringify((*i).name().category())][stringify((*i).name().package())].push_back(EntryStrings{
+                    stringify((*i).version()), (*i).slot().raw_value(), (*i).description()->parse_value() });
+
+        StringTable strings;
+        std::string categories, packages, entries;
+        uint32_t n_packages(0), n_entries(0);
+
+        for (auto & c : tree)
+        {
+            put_u32(categories, strings.add(c.first));
+            put_u32(categories, n_packages);
+            put_u32(categories, c.second.size());
+
+            for (auto & p : c.second)
+            {
+                put_u32(packages, strings.add(p.first));
+                put_u32(packages, n_entries);
+                put_u32(packages, p.second.size());
+                ++n_packages;
+
+                for (auto & e : p.second)
+                {
+                    put_u32(entries, strings.add(e.version));
+                    put_u32(entries, strings.add(e.slot));
+                    put_u32(entries, strings.add(e.description));
+                    ++n_entries;
+                }
+            }
+        }
+
+        std::string result(index_magic, sizeof(index_magic));
+        put_u32(result, index_byte_order);
+        put_u32(result, file.autoconfigurable() ? flag_autoconfigurable : 0);
+        put_u64(result, source_stat.mtim().seconds());
+        put_u64(result, source_stat.mtim().nanoseconds());
+        put_u64(result, source_stat.file_size());
+
+        put_u32(result, strings.add(file.repo_name()));
+        put_u32(result, strings.add(file.homepage()));
+        put_u32(result, strings.add(file.description()));
+        put_u32(result, strings.add(file.sync()));
+        put_u32(result, strings.add(file.repo_format()));
+        put_u32(result, strings.add(file.dependencies()));
+
+        put_u32(result, tree.size());
+        put_u32(result, n_packages);
+        put_u32(result, n_entries);
+        put_u32(result, strings.data.size());
+
+        result.append(categories);
+        result.append(packages);
+        result.append(entries);
+        result.append(strings.data);
+        return result;
+    }
+
+    int compare(const std::pair<const char *, uint32_t> & a, const std::string & b)
+    {
+        int r(std::memcmp(a.first, b.data(), std::min<std::size_t>(a.second, b.length())));
+        if (0 != r)
+            return r;
+        return a.second < b.length() ? -1 : a.second == b.length() ? 0 : 1;
+    }
+}
+
+namespace paludis
+{
+    template <>
+    struct Imp<UnavailableRepositoryIndex>
+    {
+        std::string owned;
+        void * map;
+        std::size_t map_size;
+
+        const char * data;
+        std::size_t size;
+
+        uint32_t n_categories, n_packages, n_entries, strings_size;
+        std::size_t categories_at, packages_at, entries_at, strings_at;
+
+        Imp() :
+            map(MAP_FAILED),
+            map_size(0),
+            data(nullptr),
+            size(0),
+            n_categories(0),
+            n_packages(0),
+            n_entries(0),
+            strings_size(0),
+            categories_at(0),
+            packages_at(0),
+            entries_at(0),
+            strings_at(0)
+        {
+        }
+
+        ~Imp()
+        {
+            if (MAP_FAILED != map)
+                ::munmap(map, map_size);
+        }
+
+        uint32_t u32(const std::size_t offset) const
+        {
+            uint32_t result;
+            std::memcpy(&result, data + offset, sizeof(result));
+            return result;
+        }
+
+        uint64_t u64(const std::size_t offset) const
+        {
+            uint64_t result;
+            std::memcpy(&result, data + offset, sizeof(result));
+            return result;
+        }
+
+        bool load()
+        {
+            if (size < header_size || 0 != std::memcmp(data, index_magic, sizeof(index_magic))
+                    || index_byte_order != u32(sizeof(index_magic)))
+                return false;
+
+            n_categories = u32(counts_at);
+            n_packages = u32(counts_at + 4);
+            n_entries = u32(counts_at + 8);
+            strings_size = u32(counts_at + 12);
+
+            categories_at = header_size;
+            packages_at = categories_at + uint64_t(n_categories) * record_size;
+            entries_at = packages_at + uint64_t(n_packages) * record_size;
+            strings_at = entries_at + uint64_t(n_entries) * record_size;
+
+            return size == strings_at + strings_size;
+        }
+
+        std::pair<const char *, uint32_t> raw_string(const uint32_t offset) const
+        {
+            if (uint64_t(offset) + 4 > strings_size)
+                throw UnavailableRepositoryConfigurationError("Corrupt unavailable repository index");
+
+            uint32_t length(u32(strings_at + offset));
+            if (uint64_t(offset) + 4 + length > strings_size)
+                throw UnavailableRepositoryConfigurationError("Corrupt unavailable repository index");
+
+            return std::make_pair(data + strings_at + offset + 4, length);
+        }
+
+        std::string string(const uint32_t offset) const
+        {
+            auto s(raw_string(offset));
+            return std::string(s.first, s.second);
+        }
+
+        /* binary search over [first, first + count) records starting at table */
+        bool find(const std::size_t table, const uint32_t first, const uint32_t count, const uint32_t limit,
+                const std::string & name, uint32_t & result) const
+        {
+            if (uint64_t(first) + count > limit)
+                throw UnavailableRepositoryConfigurationError("Corrupt unavailable repository index");
+
+            uint32_t lo(first), hi(first + count);
+            while (lo < hi)
+            {
+                uint32_t mid(lo + (hi - lo) / 2);
+                int c(compare(raw_string(u32(table + std::size_t(mid) * record_size)), name));
+                if (c < 0)
+                    lo = mid + 1;
+                else if (c > 0)
+                    hi = mid;
+                else
+                {
+                    result = mid;
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        bool find_category(const CategoryNamePart & c, uint32_t & result) const
+        {
+            return find(categories_at, 0, n_categories, n_categories, stringify(c), result);
+        }
+
+        bool find_package(const QualifiedPackageName & q, uint32_t & result) const
+        {
+            uint32_t c;
+            if (! find_category(q.category(), c))
+                return false;
+
+            const std::size_t record(categories_at + std::size_t(c) * record_size);
+            return find(packages_at, u32(record + 4), u32(record + 8), n_packages, stringify(q.package()), result);
+        }
+    };
+}
+
+UnavailableRepositoryIndex::UnavailableRepositoryIndex() :
+    _imp()
+{
+}
+
+UnavailableRepositoryIndex::~UnavailableRepositoryIndex() = default;
+
+FSPath
+UnavailableRepositoryIndex::index_file_for(const FSPath & source)
+{
+    return source.dirname() / ".cache" / (source.basename() + ".index");
+}
+
+std::shared_ptr<const UnavailableRepositoryIndex>
+UnavailableRepositoryIndex::open(const FSPath & source)
+{
+    FSPath index(index_file_for(source));
+    Context context("When opening unavailable repository index '" + stringify(index) + "':");
+
+    int fd(::open(stringify(index).c_str(), O_RDONLY | O_CLOEXEC));
+    if (-1 == fd)
+    {
+        Log::get_instance()->message("unavailable_repository.index.missing", ll_debug, lc_context)
+            << "No index for '" << source << "', falling back to parsing it";
+        return nullptr;
+    }
+
+    std::shared_ptr<UnavailableRepositoryIndex> result(new UnavailableRepositoryIndex);
+
+    struct ::stat st;
+    if (0 == ::fstat(fd, &st) && 0 < st.st_size)
+    {
+        result->_imp->map_size = st.st_size;
+        result->_imp->map = ::mmap(nullptr, result->_imp->map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    ::close(fd);
+
+    if (MAP_FAILED == result->_imp->map)
+    {
+        Log::get_instance()->message("unavailable_repository.index.unreadable", ll_warning, lc_context)
+            << "Cannot map index for '" << source << "', falling back to parsing it";
+        return nullptr;
+    }
+
+    result->_imp->data = static_cast<const char *>(result->_imp->map);
+    result->_imp->size = result->_imp->map_size;
+
+    if (! result->_imp->load())
+    {
+        Log::get_instance()->message("unavailable_repository.index.corrupt", ll_warning, lc_context)
+            << "Index for '" << source << "' is corrupt, falling back to parsing it";
+        return nullptr;
+    }
+
+    FSStat source_stat(source);
+    if (uint64_t(source_stat.mtim().seconds()) != result->_imp->u64(24)
+            || uint64_t(source_stat.mtim().nanoseconds()) != result->_imp->u64(32)
+            || uint64_t(source_stat.file_size()) != result->_imp->u64(40))
+    {
+        Log::get_instance()->message("unavailable_repository.index.stale", ll_debug, lc_context)
+            << "Index for '" << source << "' is out of date, falling back to parsing it";
+        return nullptr;
+    }
+
+    return result;
+}
+
+std::shared_ptr<const UnavailableRepositoryIndex>
+UnavailableRepositoryIndex::parse(const FSPath & source)
+{
+    std::shared_ptr<UnavailableRepositoryIndex> result(new UnavailableRepositoryIndex);
+    result->_imp->owned = make_index(source, FSStat(source));
+    result->_imp->data = result->_imp->owned.data();
+    result->_imp->size = result->_imp->owned.size();
+
+    if (! result->_imp->load())
+        throw InternalError(PALUDIS_HERE, "Generated a corrupt index for '" + stringify(source) + "'");
+
+    return result;
+}
+
+void
+UnavailableRepositoryIndex::generate(const FSPath & source)
+{
+    FSPath index(index_file_for(source));
+    Context context("When generating unavailable repository index '" + stringify(index) + "':");
+
+    /* stat before parsing, so a concurrent change leaves us looking stale */
+    FSStat source_stat(source);
+    std::string data(make_index(source, source_stat));
+
+    index.dirname().mkdir(0755, { fspmkdo_ok_if_exists });
+
+    /* readers may have the old index mapped, so replace it rather than overwrite it */
+    FSPath tmp(index.dirname() / (index.basename() + ".tmp"));
+    {
+        SafeOFStream f(tmp, -1, true);
+        f << data;
+    }
+    tmp.rename(index);
+}
+
+std::string
+UnavailableRepositoryIndex::repo_name() const
+{
+    return _imp->string(_imp->u32(header_strings_at + 4 * hs_repo_name));
+}
+
+std::string
+UnavailableRepositoryIndex::homepage() const
+{
+    return _imp->string(_imp->u32(header_strings_at + 4 * hs_homepage));
+}
+
+std::string
+UnavailableRepositoryIndex::description() const
+{
+    return _imp->string(_imp->u32(header_strings_at + 4 * hs_description));
+}
+
+std::string
+UnavailableRepositoryIndex::sync() const
+{
+    return _imp->string(_imp->u32(header_strings_at + 4 * hs_sync));
+}
+
+std::string
+UnavailableRepositoryIndex::repo_format() const
+{
+    return _imp->string(_imp->u32(header_strings_at + 4 * hs_repo_format));
+}
+
+std::string
+UnavailableRepositoryIndex::dependencies() const
+{
+    return _imp->string(_imp->u32(header_strings_at + 4 * hs_dependencies));
+}
+
+bool
+UnavailableRepositoryIndex::autoconfigurable() const
+{
+    return _imp->u32(sizeof(index_magic) + 4) & flag_autoconfigurable;
+}
+
+std::shared_ptr<const CategoryNamePartSet>
+UnavailableRepositoryIndex::category_names() const
+{
+    std::shared_ptr<CategoryNamePartSet> result(std::make_shared<CategoryNamePartSet>());
+    for (uint32_t c(0) ; c != _imp->n_categories ; ++c)
+        result->insert(CategoryNamePart(_imp->string(_imp->u32(_imp->categories_at + std::size_t(c) * record_size))));
+    return result;
+}
+
+std::shared_ptr<const QualifiedPackageNameSet>
+UnavailableRepositoryIndex::package_names(const CategoryNamePart & c) const
+{
+    std::shared_ptr<QualifiedPackageNameSet> result(std::make_shared<QualifiedPackageNameSet>());
+
+    uint32_t category;
+    if (! _imp->find_category(c, category))
+        return result;
+
+    const std::size_t record(_imp->categories_at + std::size_t(category) * record_size);
+    uint32_t first(_imp->u32(record + 4)), count(_imp->u32(record + 8));
+    if (uint64_t(first) + count > _imp->n_packages)
+        throw UnavailableRepositoryConfigurationError("Corrupt unavailable repository index");
+
+    for (uint32_t p(first) ; p != first + count ; ++p)
+        result->insert(c + PackageNamePart(_imp->string(_imp->u32(_imp->packages_at + std::size_t(p) * record_size))));
+
+    return result;
+}
+
+bool
+UnavailableRepositoryIndex::has_package_named(const QualifiedPackageName & q) const
+{
+    uint32_t package;
+    return _imp->find_package(q, package);
+}
+
+void
+UnavailableRepositoryIndex::each_entry(const QualifiedPackageName & q,
+        const std::function<void (const UnavailableRepositoryFileEntry &)> & f) const
+{
+    uint32_t package;
+    if (! _imp->find_package(q, package))
+        return;
+
+    const std::size_t record(_imp->packages_at + std::size_t(package) * record_size);
+    uint32_t first(_imp->u32(record + 4)), count(_imp->u32(record + 8));
+    if (uint64_t(first) + count > _imp->n_entries)
+        throw UnavailableRepositoryConfigurationError("Corrupt unavailable repository index");
+
+    /* versions listed on the same line share a description */
+    std::map<uint32_t, std::shared_ptr<const MetadataValueKey<std::string> > > descriptions;
+
+    for (uint32_t e(first) ; e != first + count ; ++e)
+    {
+        const std::size_t entry(_imp->entries_at + std::size_t(e) * record_size);
+
+        std::string ss(_imp->string(_imp->u32(entry + 4)));
+        SlotName slot("x"), subslot("x");
+        auto p(ss.find('/'));
+        if (std::string::npos != p)
+        {
+            slot = SlotName(ss.substr(0, p));
+            subslot = SlotName(ss.substr(p + 1));
+        }
+        else
+            subslot = slot = SlotName(ss);
+
+        uint32_t description_offset(_imp->u32(entry + 8));
+        auto d(descriptions.find(description_offset));
+        if (descriptions.end() == d)
+            d = descriptions.insert(std::make_pair(description_offset,
+                        std::make_shared<LiteralMetadataValueKey<std::string>>("DESCRIPTION", "Description", mkt_significant,
+                            _imp->string(description_offset)))).first;
+
+        f(make_named_values<UnavailableRepositoryFileEntry>(
+                    n::description() = d->second,
+                    n::name() = q,
+                    n::slot() = make_named_values<Slot>(
+                        n::match_values() = std::make_pair(slot, subslot),
+                        n::parallel_value() = slot,
+                        n::raw_value() = ss),
+                    n::version() = VersionSpec(_imp->string(_imp->u32(entry)), user_version_spec_options())
+                    ));
+    }
+}
+
+namespace paludis
+{
+    template class Pimp<UnavailableRepositoryIndex>;
+}
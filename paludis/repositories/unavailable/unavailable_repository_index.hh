@@ -0,0 +1,106 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2026 agent
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PALUDIS_GUARD_PALUDIS_REPOSITORIES_UNAVAILABLE_UNAVAILABLE_REPOSITORY_INDEX_HH
+#define PALUDIS_GUARD_PALUDIS_REPOSITORIES_UNAVAILABLE_UNAVAILABLE_REPOSITORY_INDEX_HH 1
+
+#include <paludis/repositories/unavailable/unavailable_repository_file-fwd.hh>
+#include <paludis/util/pimp.hh>
+#include <paludis/util/fs_path-fwd.hh>
+#include <paludis/name-fwd.hh>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace paludis
+{
+    namespace unavailable_repository
+    {
+        /**
+         * A compact, sorted binary form of an UnavailableRepositoryFile.
+         *
+         * Indices are written at sync time and mmapped when the repository is
+         * loaded, so that only the categories and packages which are actually
+         * queried are ever turned into names and IDs. An index records the
+         * modification time and size of the file it was made from, and is
+         * ignored if these no longer match.
+         */
+        class PALUDIS_VISIBLE UnavailableRepositoryIndex
+        {
+            private:
+                Pimp<UnavailableRepositoryIndex> _imp;
+
+                UnavailableRepositoryIndex();
+
+            public:
+                ~UnavailableRepositoryIndex();
+
+                /**
+                 * Where the index for a given source file lives.
+                 */
+                static FSPath index_file_for(const FSPath & source);
+
+                /**
+                 * Open the index for a source file, or return a null pointer if
+                 * there is no index or if it is out of date.
+                 */
+                static std::shared_ptr<const UnavailableRepositoryIndex> open(const FSPath & source)
+                    PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                /**
+                 * Parse a source file, and build an in-memory index for it.
+                 */
+                static std::shared_ptr<const UnavailableRepositoryIndex> parse(const FSPath & source)
+                    PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                /**
+                 * Parse a source file, and write its index.
+                 */
+                static void generate(const FSPath & source);
+
+                std::string repo_name() const PALUDIS_ATTRIBUTE((warn_unused_result));
+                std::string homepage() const PALUDIS_ATTRIBUTE((warn_unused_result));
+                std::string description() const PALUDIS_ATTRIBUTE((warn_unused_result));
+                std::string sync() const PALUDIS_ATTRIBUTE((warn_unused_result));
+                std::string repo_format() const PALUDIS_ATTRIBUTE((warn_unused_result));
+                std::string dependencies() const PALUDIS_ATTRIBUTE((warn_unused_result));
+                bool autoconfigurable() const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                std::shared_ptr<const CategoryNamePartSet> category_names() const
+                    PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                std::shared_ptr<const QualifiedPackageNameSet> package_names(const CategoryNamePart &) const
+                    PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                bool has_package_named(const QualifiedPackageName &) const
+                    PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                /**
+                 * Call the function for every entry for the named package, in
+                 * the order in which they appear in the source file.
+                 */
+                void each_entry(const QualifiedPackageName &,
+                        const std::function<void (const UnavailableRepositoryFileEntry &)> &) const;
+        };
+    }
+
+    extern template class Pimp<unavailable_repository::UnavailableRepositoryIndex>;
+}
+
+#endif
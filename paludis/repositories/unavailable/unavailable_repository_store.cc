@@ -19,6 +19,7 @@
 
 #include <paludis/repositories/unavailable/unavailable_repository_store.hh>
 #include <paludis/repositories/unavailable/unavailable_repository_file.hh>
+#include <paludis/repositories/unavailable/unavailable_repository_index.hh>
 #include <paludis/repositories/unavailable/unavailable_package_id.hh>
 #include <paludis/repositories/unavailable/unavailable_repository_id.hh>
 #include <paludis/repositories/unavailable/unavailable_repository_dependencies_key.hh>
@@ -41,6 +42,8 @@
 #include <unordered_map>
 #include <algorithm>
 #include <set>
+#include <vector>
+#include <mutex>
 
 using namespace paludis;
 using namespace paludis::unavailable_repository;
@@ -53,19 +56,42 @@ typedef std::unordered_map<QualifiedPackageName,
         std::shared_ptr<PackageIDSequence>,
         Hash<QualifiedPackageName> > IDs;
 
+namespace
+{
+    struct Source
+    {
+        std::shared_ptr<const UnavailableRepositoryIndex> index;
+        std::shared_ptr<Mask> mask;
+        std::shared_ptr<MetadataCollectionKey<Set<std::string> > > from_repositories;
+        std::shared_ptr<MetadataValueKey<std::string> > repository_description;
+        std::shared_ptr<MetadataValueKey<std::string> > repository_homepage;
+    };
+}
+
 namespace paludis
 {
     template <>
     struct Imp<UnavailableRepositoryStore>
     {
+        const Environment * const env;
         const UnavailableRepository * const repo;
-        mutable std::shared_ptr<CategoryNamePartSet> categories;
+        std::shared_ptr<CategoryNamePartSet> categories;
+
+        /* package and ID lists are only made for the sources when asked
+         * for, and are then cached */
+        std::vector<Source> sources;
+
+        mutable std::mutex mutex;
         mutable PackageNames package_names;
         mutable IDs ids;
 
+        PackageNames repository_package_names;
+        IDs repository_ids;
+
         std::set<std::string> seen_repo_names;
 
-        Imp(const UnavailableRepository * const r) :
+        Imp(const Environment * const e, const UnavailableRepository * const r) :
+            env(e),
             repo(r),
             categories(std::make_shared<CategoryNamePartSet>())
         {
@@ -77,7 +103,7 @@ UnavailableRepositoryStore::UnavailableRepositoryStore(
         const Environment * const env,
         const UnavailableRepository * const repo,
         const FSPath & f) :
-    _imp(repo)
+    _imp(env, repo)
 {
     _populate(env, f);
 }
@@ -102,92 +128,59 @@ UnavailableRepositoryStore::_populate_one(const Environment * const env, const F
 
     Context context("When populating UnavailableRepository from file '" + stringify(f) + "':");
 
-    UnavailableRepositoryFile file(f);
+    std::shared_ptr<const UnavailableRepositoryIndex> file(UnavailableRepositoryIndex::open(f));
+    if (! file)
+        file = UnavailableRepositoryIndex::parse(f);
 
-    bool has_repo(env->has_repository_named(RepositoryName(file.repo_name())));
+    bool has_repo(env->has_repository_named(RepositoryName(file->repo_name())));
 
-    if (! _imp->seen_repo_names.insert(file.repo_name()).second)
+    if (! _imp->seen_repo_names.insert(file->repo_name()).second)
     {
         Log::get_instance()->message("unavailable_repository.file.duplicate", ll_warning, lc_context)
-            << "Skipping file '" << f << "' due to duplicate repo_name '" << file.repo_name() << "'";
+            << "Skipping file '" << f << "' due to duplicate repo_name '" << file->repo_name() << "'";
         return;
     }
 
     std::shared_ptr<MetadataValueKey<std::string> > repository_homepage, repository_description,
         repository_format, repository_sync;
-    if (! file.homepage().empty())
+    if (! file->homepage().empty())
         repository_homepage = std::make_shared<LiteralMetadataValueKey<std::string>>(
-                "REPOSITORY_HOMEPAGE", "Repository homepage", mkt_normal, file.homepage());
-    if (! file.description().empty())
+                "REPOSITORY_HOMEPAGE", "Repository homepage", mkt_normal, file->homepage());
+    if (! file->description().empty())
         repository_description = std::make_shared<LiteralMetadataValueKey<std::string>>(
-                "REPOSITORY_DESCRIPTION", "Repository description", mkt_normal, file.description());
-    if (! file.repo_format().empty())
+                "REPOSITORY_DESCRIPTION", "Repository description", mkt_normal, file->description());
+    if (! file->repo_format().empty())
         repository_format = std::make_shared<LiteralMetadataValueKey<std::string>>(
-                "REPOSITORY_FORMAT", "Repository format", mkt_normal, file.repo_format());
-    if (! file.sync().empty())
+                "REPOSITORY_FORMAT", "Repository format", mkt_normal, file->repo_format());
+    if (! file->sync().empty())
         repository_sync = std::make_shared<LiteralMetadataValueKey<std::string>>(
-                "REPOSITORY_SYNC", "Repository sync", mkt_normal, file.sync());
+                "REPOSITORY_SYNC", "Repository sync", mkt_normal, file->sync());
 
     if (! has_repo)
     {
-        std::shared_ptr<Mask> mask(std::make_shared<UnavailableMask>());
         std::shared_ptr<Set<std::string> > from_repositories_set(std::make_shared<Set<std::string>>());
-        from_repositories_set->insert(file.repo_name());
-        std::shared_ptr<MetadataCollectionKey<Set<std::string> > > from_repositories(
-                std::make_shared<LiteralMetadataStringSetKey>("OWNING_REPOSITORY", "Owning repository",
-                    mkt_significant, from_repositories_set));
+        from_repositories_set->insert(file->repo_name());
 
-        QualifiedPackageName old_name("x/x");
-        std::shared_ptr<QualifiedPackageNameSet> pkgs;
-        std::shared_ptr<PackageIDSequence> ids;
-        for (UnavailableRepositoryFile::ConstIterator i(file.begin()), i_end(file.end()) ;
-                i != i_end ; ++i)
-        {
-            if (old_name.category() != (*i).name().category())
-            {
-                _imp->categories->insert((*i).name().category());
-                PackageNames::iterator p(_imp->package_names.find((*i).name().category()));
-                if (_imp->package_names.end() == p)
-                    p = _imp->package_names.insert(std::make_pair((*i).name().category(),
-                                std::make_shared<QualifiedPackageNameSet>())).first;
-                pkgs = p->second;
-            }
-
-            if (old_name != (*i).name())
-            {
-                pkgs->insert((*i).name());
-                IDs::iterator p(_imp->ids.find((*i).name()));
-                if (_imp->ids.end() == p)
-                    p = _imp->ids.insert(std::make_pair((*i).name(),
-                                std::make_shared<PackageIDSequence>())).first;
-
-                ids = p->second;
-            }
-
-            ids->push_back(std::make_shared<UnavailablePackageID>(make_named_values<UnavailablePackageIDParams>(
-                                n::description() = (*i).description(),
-                                n::environment() = env,
-                                n::from_repositories() = from_repositories,
-                                n::mask() = mask,
-                                n::name() = (*i).name(),
-                                n::repository() = _imp->repo->name(),
-                                n::repository_description() = repository_description,
-                                n::repository_homepage() = repository_homepage,
-                                n::slot() = (*i).slot(),
-                                n::version() = (*i).version()
-                            )));
+        _imp->sources.push_back(Source{
+                file,
+                std::make_shared<UnavailableMask>(),
+                std::make_shared<LiteralMetadataStringSetKey>("OWNING_REPOSITORY", "Owning repository",
+                    mkt_significant, from_repositories_set),
+                repository_description,
+                repository_homepage
+                });
 
-            old_name = (*i).name();
-        }
+        std::shared_ptr<const CategoryNamePartSet> file_categories(file->category_names());
+        std::copy(file_categories->begin(), file_categories->end(), _imp->categories->inserter());
     }
 
-    if (file.autoconfigurable())
+    if (file->autoconfigurable())
     {
         std::shared_ptr<Mask> mask;
         std::shared_ptr<UnavailableRepositoryDependenciesKey> deps;
-        if (! file.dependencies().empty())
+        if (! file->dependencies().empty())
             deps = std::make_shared<UnavailableRepositoryDependenciesKey>(env, "dependencies", "Dependencies", mkt_dependencies,
-                        file.dependencies());
+                        file->dependencies());
 
         if (has_repo)
             mask = std::make_shared<AlreadyConfiguredMask>();
@@ -201,21 +194,21 @@ UnavailableRepositoryStore::_populate_one(const Environment * const env, const F
                         n::format() = repository_format,
                         n::homepage() = repository_homepage,
                         n::mask() = mask,
-                        n::name() = CategoryNamePart("repository") + PackageNamePart(file.repo_name()),
+                        n::name() = CategoryNamePart("repository") + PackageNamePart(file->repo_name()),
                         n::repository() = _imp->repo->name(),
                         n::sync() = repository_sync
                         )));
 
         _imp->categories->insert(id->name().category());
-        PackageNames::iterator p(_imp->package_names.find(id->name().category()));
-        if (_imp->package_names.end() == p)
-            p = _imp->package_names.insert(std::make_pair(id->name().category(),
+        PackageNames::iterator p(_imp->repository_package_names.find(id->name().category()));
+        if (_imp->repository_package_names.end() == p)
+            p = _imp->repository_package_names.insert(std::make_pair(id->name().category(),
                         std::make_shared<QualifiedPackageNameSet>())).first;
         p->second->insert(id->name());
 
-        IDs::iterator i(_imp->ids.find(id->name()));
-        if (_imp->ids.end() == i)
-            i = _imp->ids.insert(std::make_pair(id->name(), std::make_shared<PackageIDSequence>())).first;
+        IDs::iterator i(_imp->repository_ids.find(id->name()));
+        if (_imp->repository_ids.end() == i)
+            i = _imp->repository_ids.insert(std::make_pair(id->name(), std::make_shared<PackageIDSequence>())).first;
         i->second->push_back(id);
     }
 }
@@ -229,7 +222,12 @@ UnavailableRepositoryStore::has_category_named(const CategoryNamePart & c) const
 bool
 UnavailableRepositoryStore::has_package_named(const QualifiedPackageName & q) const
 {
-    return _imp->ids.end() != _imp->ids.find(q);
+    if (_imp->repository_ids.end() != _imp->repository_ids.find(q))
+        return true;
+
+    return std::any_of(_imp->sources.begin(), _imp->sources.end(), [&] (const Source & s) {
+            return s.index->has_package_named(q);
+            });
 }
 
 std::shared_ptr<const CategoryNamePartSet>
@@ -250,21 +248,63 @@ UnavailableRepositoryStore::unimportant_category_names() const
 std::shared_ptr<const QualifiedPackageNameSet>
 UnavailableRepositoryStore::package_names(const CategoryNamePart & c) const
 {
+    std::unique_lock<std::mutex> lock(_imp->mutex);
+
     PackageNames::iterator p(_imp->package_names.find(c));
-    if (_imp->package_names.end() == p)
-        return std::make_shared<QualifiedPackageNameSet>();
-    else
+    if (_imp->package_names.end() != p)
         return p->second;
+
+    std::shared_ptr<QualifiedPackageNameSet> result(std::make_shared<QualifiedPackageNameSet>());
+
+    PackageNames::const_iterator r(_imp->repository_package_names.find(c));
+    if (_imp->repository_package_names.end() != r)
+        std::copy(r->second->begin(), r->second->end(), result->inserter());
+
+    if (_imp->categories->end() != _imp->categories->find(c))
+        for (auto & s : _imp->sources)
+        {
+            std::shared_ptr<const QualifiedPackageNameSet> names(s.index->package_names(c));
+            std::copy(names->begin(), names->end(), result->inserter());
+        }
+
+    _imp->package_names.insert(std::make_pair(c, result));
+    return result;
 }
 
 std::shared_ptr<const PackageIDSequence>
 UnavailableRepositoryStore::package_ids(const QualifiedPackageName & p) const
 {
+    std::unique_lock<std::mutex> lock(_imp->mutex);
+
     IDs::iterator i(_imp->ids.find(p));
-    if (_imp->ids.end() == i)
-        return std::make_shared<PackageIDSequence>();
-    else
+    if (_imp->ids.end() != i)
         return i->second;
+
+    std::shared_ptr<PackageIDSequence> result(std::make_shared<PackageIDSequence>());
+
+    if (_imp->categories->end() != _imp->categories->find(p.category()))
+        for (auto & s : _imp->sources)
+            s.index->each_entry(p, [&] (const UnavailableRepositoryFileEntry & e) {
+                    result->push_back(std::make_shared<UnavailablePackageID>(make_named_values<UnavailablePackageIDParams>(
+                                n::description() = e.description(),
+                                n::environment() = _imp->env,
+                                n::from_repositories() = s.from_repositories,
+                                n::mask() = s.mask,
+                                n::name() = e.name(),
+                                n::repository() = _imp->repo->name(),
+                                n::repository_description() = s.repository_description,
+                                n::repository_homepage() = s.repository_homepage,
+                                n::slot() = e.slot(),
+                                n::version() = e.version()
+                                )));
+                    });
+
+    IDs::const_iterator r(_imp->repository_ids.find(p));
+    if (_imp->repository_ids.end() != r)
+        std::copy(r->second->begin(), r->second->end(), result->back_inserter());
+
+    _imp->ids.insert(std::make_pair(p, result));
+    return result;
 }
 
 namespace paludis
@@ -381,6 +381,7 @@ UnpackagedID::perform_action(Action & action) const
                             n::debug_dir() = fs_location_key()->parse_value() / "usr" / libdir / "debug",
                             n::dwarf_compression() = dwarf_compression && dwarf_compression->enabled(),
                             n::image_dir() = fs_location_key()->parse_value(),
+                            n::jobs() = 1,
                             n::output_manager() = output_manager,
                             n::package_id() = shared_from_this(),
                             n::split() = symbols_choice && symbols_choice->enabled() && ELikeSymbolsChoiceValue::should_split(symbols_choice->parameter()),
@@ -33,6 +33,7 @@ namespace paludis
         typedef Name<struct name_debug_dir> debug_dir;
         typedef Name<struct name_dwarf_compression> dwarf_compression;
         typedef Name<struct name_image_dir> image_dir;
+        typedef Name<struct name_jobs> jobs;
         typedef Name<struct name_output_manager> output_manager;
         typedef Name<struct name_package_id> package_id;
         typedef Name<struct name_split> split;
@@ -47,6 +48,7 @@ namespace paludis
             NamedValue<n::debug_dir, FSPath> debug_dir;
             NamedValue<n::dwarf_compression, bool> dwarf_compression;
             NamedValue<n::image_dir, FSPath> image_dir;
+            NamedValue<n::jobs, unsigned> jobs;
             NamedValue<n::output_manager, std::shared_ptr<OutputManager> > output_manager;
             NamedValue<n::package_id, std::shared_ptr<const PackageID> > package_id;
             NamedValue<n::split, bool> split;
@@ -23,6 +23,7 @@
 #include <paludis/util/attributes.hh>
 #include <paludis/util/sequence-fwd.hh>
 #include <paludis/resolver/change_by_resolvent-fwd.hh>
+#include <paludis/resolver/dependents_index-fwd.hh>
 #include <paludis/package_id-fwd.hh>
 #include <paludis/environment-fwd.hh>
 #include <memory>
@@ -52,6 +53,11 @@ namespace paludis
                 const Environment * const,
                 const std::shared_ptr<const PackageID> &,
                 const std::shared_ptr<const PackageIDSequence> &) PALUDIS_ATTRIBUTE((warn_unused_result));
+
+        const std::shared_ptr<const PackageIDSet> collect_dependents(
+                const Environment * const,
+                const std::shared_ptr<const PackageID> &,
+                const DependentsIndex &) PALUDIS_ATTRIBUTE((warn_unused_result));
     }
 }
 
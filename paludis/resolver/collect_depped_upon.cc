@@ -19,6 +19,7 @@
 
 #include <paludis/resolver/collect_depped_upon.hh>
 #include <paludis/resolver/change_by_resolvent.hh>
+#include <paludis/resolver/dependents_index.hh>
 
 #include <paludis/util/visitor_cast.hh>
 #include <paludis/util/indirect_iterator-impl.hh>
@@ -283,13 +284,23 @@ paludis::resolver::collect_dependents(
         const Environment * const env,
         const std::shared_ptr<const PackageID> & going_away,
         const std::shared_ptr<const PackageIDSequence> & installed_ids)
+{
+    return collect_dependents(env, going_away, DependentsIndex(env, installed_ids));
+}
+
+const std::shared_ptr<const PackageIDSet>
+paludis::resolver::collect_dependents(
+        const Environment * const env,
+        const std::shared_ptr<const PackageID> & going_away,
+        const DependentsIndex & index)
 {
     auto going_away_as_ids(std::make_shared<PackageIDSequence>());
     going_away_as_ids->push_back(going_away);
 
     auto result(std::make_shared<PackageIDSet>());
 
-    for (auto i(installed_ids->begin()), i_end(installed_ids->end()) ;
+    auto candidates(index.candidates(going_away->name()));
+    for (auto i(candidates->begin()), i_end(candidates->end()) ;
             i != i_end ; ++i)
     {
         DependentChecker<PackageIDSequence, PackageIDSequence> c(env, *i, going_away_as_ids,
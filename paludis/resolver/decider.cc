@@ -32,6 +32,8 @@
 #include <paludis/resolver/required_confirmations.hh>
 #include <paludis/resolver/change_by_resolvent.hh>
 #include <paludis/resolver/collect_depped_upon.hh>
+#include <paludis/resolver/dependents_index.hh>
+#include <paludis/resolver/decision_cache.hh>
 #include <paludis/resolver/collect_installed.hh>
 #include <paludis/resolver/collect_purges.hh>
 #include <paludis/resolver/accumulate_deps.hh>
@@ -53,6 +55,8 @@
 #include <paludis/util/tribool.hh>
 #include <paludis/util/log.hh>
 #include <paludis/util/visitor_cast.hh>
+#include <paludis/util/profiler.hh>
+#include <paludis/util/task_scheduler.hh>
 #include <paludis/environment.hh>
 #include <paludis/notifier_callback.hh>
 #include <paludis/repository.hh>
@@ -73,13 +77,19 @@
 #include <paludis/partially_made_package_dep_spec.hh>
 #include <paludis/dep_spec_annotations.hh>
 #include <paludis/slot.hh>
+#include <paludis/version_spec.hh>
+#include <paludis/serialise.hh>
 
 #include <paludis/util/pimp-impl.hh>
 
 #include <list>
 #include <algorithm>
+#include <atomic>
+#include <exception>
 #include <map>
 #include <set>
+#include <sstream>
+#include <vector>
 
 using namespace paludis;
 using namespace paludis::resolver;
@@ -94,6 +104,11 @@ namespace paludis
 
         const std::shared_ptr<ResolutionsByResolvent> resolutions_by_resolvent;
 
+        /* what's installed doesn't change whilst we're resolving */
+        std::shared_ptr<const DependentsIndex> dependents_index;
+
+        std::shared_ptr<DecisionCache> decision_cache;
+
         Imp(const Environment * const e, const ResolverFunctions & f,
                 const std::shared_ptr<ResolutionsByResolvent> & l) :
             env(e),
@@ -112,10 +127,17 @@ Decider::Decider(const Environment * const e, const ResolverFunctions & f,
 
 Decider::~Decider() = default;
 
+void
+Decider::set_decision_cache(const std::shared_ptr<DecisionCache> & c)
+{
+    _imp->decision_cache = c;
+}
+
 void
 Decider::_resolve_decide_with_dependencies()
 {
     Context context("When resolving and adding dependencies recursively:");
+    ProfileTimer timer("decider.decide_with_dependencies");
 
     enum State { deciding_non_suggestions, deciding_nothings, deciding_suggestions, finished } state = deciding_non_suggestions;
     bool changed(true);
@@ -158,6 +180,7 @@ bool
 Decider::_resolve_vias()
 {
     Context context("When finding vias:");
+    ProfileTimer timer("decider.vias");
 
     bool changed(false);
 
@@ -202,6 +225,7 @@ bool
 Decider::_resolve_dependents()
 {
     Context context("When finding dependents:");
+    ProfileTimer timer("decider.dependents");
 
     bool changed(false);
     const std::pair<
@@ -213,10 +237,25 @@ Decider::_resolve_dependents()
 
     const std::shared_ptr<const PackageIDSequence> staying(_collect_staying(changing.first));
 
+    if (! _imp->dependents_index)
+        _imp->dependents_index = std::make_shared<DependentsIndex>(_imp->env, (*_imp->env)[selection::AllVersionsUnsorted(
+                    generator::All() | filter::InstalledAtRoot(_imp->env->system_root_key()->parse_value()))]);
+
+    /* nothing can be dependent upon a package without mentioning its name */
+    PackageIDSet candidates;
+    for (const auto & going_away : *changing.first)
+    {
+        auto c(_imp->dependents_index->candidates(going_away.package_id()->name()));
+        std::copy(c->begin(), c->end(), candidates.inserter());
+    }
+
     for (const auto & package : *staying)
     {
         _imp->env->trigger_notifier_callback(NotifierCallbackResolverStepEvent());
 
+        if (candidates.end() == candidates.find(package))
+            continue;
+
         if (! package->supports_action(SupportsActionTest<UninstallAction>()))
             continue;
 
@@ -375,6 +414,7 @@ void
 Decider::_resolve_confirmations()
 {
     Context context("When resolving confirmations:");
+    ProfileTimer timer("decider.confirmations");
 
     for (const auto & resolution : *_imp->resolutions_by_resolvent)
         _confirm(resolution);
@@ -977,15 +1017,79 @@ void
 Decider::_decide(const std::shared_ptr<Resolution> & resolution)
 {
     Context context("When deciding upon an origin ID to use for '" + stringify(resolution->resolvent()) + "':");
+    ProfileTimer timer("decider.decide");
+    if (timer.active())
+        timer.set_subject(stringify(resolution->resolvent()));
 
     _copy_other_destination_constraints(resolution);
 
+    bool allow_choice_changes(_imp->fns.allow_choice_changes_fn()(resolution));
+
+    std::string cache_inputs;
+    if (_imp->decision_cache)
+    {
+        cache_inputs = _decision_cache_inputs(resolution, allow_choice_changes);
+        auto cached(_imp->decision_cache->find(cache_inputs));
+        if (cached)
+        {
+            /* where things go depends upon repository configuration rather
+             * than anything in our inputs, so work it out again */
+            auto changes_to_make(visitor_cast<ChangesToMakeDecision>(*cached));
+            if (changes_to_make)
+                _fixup_changes_to_make_decision(resolution, *changes_to_make);
+
+            resolution->decision() = cached;
+            return;
+        }
+    }
+
     std::shared_ptr<Decision> decision(_try_to_find_decision_for(
-                resolution, _imp->fns.allow_choice_changes_fn()(resolution), false, true, false, true));
+                resolution, allow_choice_changes, false, true, false, true));
     if (decision)
         resolution->decision() = decision;
     else
         resolution->decision() = _cannot_decide_for(resolution);
+
+    if (_imp->decision_cache)
+        _imp->decision_cache->store(cache_inputs, *resolution->decision());
+}
+
+const std::string
+Decider::_decision_cache_inputs(
+        const std::shared_ptr<const Resolution> & resolution,
+        const bool allow_choice_changes) const
+{
+    std::stringstream result;
+    result << resolution->resolvent() << "\n" << allow_choice_changes << "\n";
+
+    {
+        Serialiser serialiser(result);
+        for (const auto & constraint : *resolution->constraints())
+            constraint->serialise(serialiser);
+        result << "\n";
+    }
+
+    /* dependencies only matter for working out whether an installed ID is
+     * the same as an installable one */
+    const std::shared_ptr<const PackageIDSequence> installed_ids(_installed_ids(resolution));
+    std::set<VersionSpec> installed_versions;
+    for (const auto & id : *installed_ids)
+    {
+        result << DecisionCache::id_fingerprint(id, true) << "\n";
+        installed_versions.insert(id->version());
+    }
+
+    result << "\n";
+
+    const std::shared_ptr<const PackageIDSequence> installable_ids(_find_installable_id_candidates_for(
+                resolution->resolvent().package(),
+                make_slot_filter(resolution->resolvent()),
+                make_destination_type_filter(resolution->resolvent().destination_type()),
+                true, false));
+    for (const auto & id : *installable_ids)
+        result << DecisionCache::id_fingerprint(id, installed_versions.end() != installed_versions.find(id->version())) << "\n";
+
+    return result.str();
 }
 
 void
@@ -1059,6 +1163,10 @@ void
 Decider::_add_dependencies_if_necessary(
         const std::shared_ptr<Resolution> & our_resolution)
 {
+    ProfileTimer timer("decider.add_dependencies");
+    if (timer.active())
+        timer.set_subject(stringify(our_resolution->resolvent()));
+
     std::shared_ptr<const PackageID> package_id;
     std::shared_ptr<const ChangedChoices> changed_choices;
     std::tie(package_id, changed_choices) = our_resolution->decision()->accept_returning<
@@ -1131,6 +1239,7 @@ Decider::find_any_score(
 {
     Context context("When working out whether we'd like || child '" + stringify(dep.spec()) + "' because of '"
             + stringify(our_resolution->resolvent()) + "':");
+    ProfileTimer timer("decider.find_any_score");
 
     const bool is_block(dep.spec().if_block());
     const PackageDepSpec & spec(is_block ? dep.spec().if_block()->blocking() : *dep.spec().if_package());
@@ -1371,6 +1480,7 @@ Decider::_get_resolvents_for(
         const std::shared_ptr<const Reason> & reason) const
 {
     Context context("When finding slots for '" + stringify(spec) + "':");
+    ProfileTimer timer("decider.get_resolvents_for");
 
     std::shared_ptr<SlotName> exact_slot;
 
@@ -1570,6 +1680,18 @@ Decider::_try_to_find_decision_for(
     throw InternalError(PALUDIS_HERE, "resolver bug: shouldn't be reached");
 }
 
+namespace
+{
+    /* checking a candidate is fairly cheap, so only bother handing them out
+     * to other threads if there are quite a few of them */
+    const std::size_t min_candidates_for_parallel(8);
+
+    bool worth_checking_in_parallel(const std::size_t n)
+    {
+        return n >= min_candidates_for_parallel && TaskScheduler::get_instance()->concurrency() > 1;
+    }
+}
+
 const std::shared_ptr<Decision>
 Decider::_cannot_decide_for(
         const std::shared_ptr<const Resolution> & resolution) const
@@ -1585,8 +1707,42 @@ Decider::_cannot_decide_for(
                 make_slot_filter(resolution->resolvent()),
                 make_destination_type_filter(resolution->resolvent().destination_type()),
                 true, false));
-    for (const auto & package : *installable_ids)
-        unsuitable_candidates->push_back(_make_unsuitable_candidate(resolution, package, false));
+    if (! worth_checking_in_parallel(std::distance(installable_ids->begin(), installable_ids->end())))
+    {
+        for (const auto & package : *installable_ids)
+            unsuitable_candidates->push_back(_make_unsuitable_candidate(resolution, package, false));
+    }
+    else
+    {
+        const std::vector<std::shared_ptr<const PackageID> > candidates(installable_ids->begin(), installable_ids->end());
+        std::vector<std::shared_ptr<const Constraints> > unmet(candidates.size());
+        std::vector<std::exception_ptr> exceptions(candidates.size());
+
+        TaskGroup group;
+        for (std::size_t n(0) ; n < candidates.size() ; ++n)
+            group.spawn([&, n] () {
+                    try
+                    {
+                        unmet[n] = _get_unmatching_constraints(resolution, candidates[n], false);
+                    }
+                    catch (...)
+                    {
+                        exceptions[n] = std::current_exception();
+                    }
+                    });
+        group.wait();
+
+        for (std::size_t n(0) ; n < candidates.size() ; ++n)
+        {
+            if (exceptions[n])
+                std::rethrow_exception(exceptions[n]);
+
+            unsuitable_candidates->push_back(make_named_values<UnsuitableCandidate>(
+                        n::package_id() = candidates[n],
+                        n::unmet_constraints() = unmet[n]
+                        ));
+        }
+    }
 
     return std::make_shared<UnableToMakeDecision>(
                 resolution->resolvent(),
@@ -1694,6 +1850,7 @@ Decider::_find_installable_id_candidates_for(
         const bool include_unmaskable) const
 {
     Context context("When finding installable ID candidates for '" + stringify(package) + "':");
+    ProfileTimer timer("decider.find_installable_id_candidates_for");
 
     return _imp->fns.remove_hidden_fn()(
             (*_imp->env)[_imp->fns.promote_binaries_fn()(
@@ -1724,102 +1881,154 @@ Decider::_find_id_for_from(
         const std::shared_ptr<const PackageIDSequence> & ids,
         const bool try_changing_choices,
         const bool trying_changing_choices) const
+{
+    /* best first */
+    const std::vector<std::shared_ptr<const PackageID> > candidates(ids->rbegin(), ids->rend());
+
+    auto found([&] (const std::shared_ptr<const PackageID> & id, const std::shared_ptr<WhyChangedChoices> & why_changed_choices) {
+            return FoundID(id,
+                    why_changed_choices->changed_choices()->empty() ? nullptr : why_changed_choices,
+                    id->version() == candidates.front()->version());
+            });
+
+    if (! worth_checking_in_parallel(candidates.size()))
+    {
+        for (const auto & candidate : candidates)
+        {
+            auto why_changed_choices(_check_candidate(resolution, candidate, trying_changing_choices));
+            if (why_changed_choices)
+                return found(candidate, why_changed_choices);
+        }
+    }
+    else
+    {
+        /* we want the first suitable candidate, and whatever the first
+         * candidate before it to throw would have thrown, exactly as if we'd
+         * gone through them in order. anything after a suitable candidate
+         * doesn't need checking. */
+        std::vector<std::shared_ptr<WhyChangedChoices> > results(candidates.size());
+        std::vector<std::exception_ptr> exceptions(candidates.size());
+        std::atomic<std::size_t> first_done(candidates.size());
+
+        TaskGroup group;
+        for (std::size_t n(0) ; n < candidates.size() ; ++n)
+            group.spawn([&, n] () {
+                    if (n > first_done.load())
+                        return;
+
+                    try
+                    {
+                        results[n] = _check_candidate(resolution, candidates[n], trying_changing_choices);
+                        if (! results[n])
+                            return;
+                    }
+                    catch (...)
+                    {
+                        exceptions[n] = std::current_exception();
+                    }
+
+                    std::size_t f(first_done.load());
+                    while (n < f && ! first_done.compare_exchange_weak(f, n))
+                        ;
+                    });
+        group.wait();
+
+        for (std::size_t n(0) ; n < candidates.size() ; ++n)
+        {
+            if (exceptions[n])
+                std::rethrow_exception(exceptions[n]);
+            else if (results[n])
+                return found(candidates[n], results[n]);
+        }
+    }
+
+    if (try_changing_choices && ! trying_changing_choices)
+        return _find_id_for_from(resolution, ids, true, true);
+    else
+        return FoundID(nullptr, nullptr, false);
+}
+
+const std::shared_ptr<WhyChangedChoices>
+Decider::_check_candidate(
+        const std::shared_ptr<const Resolution> & resolution,
+        const std::shared_ptr<const PackageID> & id,
+        const bool trying_changing_choices) const
 {
     MatchPackageOptions opts;
     if (trying_changing_choices)
         opts += mpo_ignore_additional_requirements;
 
-    std::shared_ptr<const PackageID> best_version;
-    for (PackageIDSequence::ReverseConstIterator i(ids->rbegin()), i_end(ids->rend()) ;
-            i != i_end ; ++i)
+    for (const auto & constraint : *resolution->constraints())
     {
-        if (! best_version)
-            best_version = *i;
-
-        bool ok(true);
-        for (const auto & constraint : *resolution->constraints())
+        if (constraint->spec().if_package())
         {
-            if (constraint->spec().if_package())
-                ok = ok && match_package(*_imp->env, *constraint->spec().if_package(), *i, constraint->from_id(), opts);
-            else
-                ok = ok && ! match_package(*_imp->env, constraint->spec().if_block()->blocking(), *i, constraint->from_id(), opts);
-
-            if (! ok)
-                break;
+            if (! match_package(*_imp->env, *constraint->spec().if_package(), id, constraint->from_id(), opts))
+                return nullptr;
+        }
+        else
+        {
+            if (match_package(*_imp->env, constraint->spec().if_block()->blocking(), id, constraint->from_id(), opts))
+                return nullptr;
         }
+    }
 
-        if (ok)
+    auto why_changed_choices(std::make_shared<WhyChangedChoices>(WhyChangedChoices(make_named_values<WhyChangedChoices>(
+                        n::changed_choices() = std::make_shared<ChangedChoices>(),
+                        n::reasons() = std::make_shared<Reasons>()
+                        ))));
+    if (trying_changing_choices)
+    {
+        for (const auto & constraint : *resolution->constraints())
         {
-            auto why_changed_choices(std::make_shared<WhyChangedChoices>(WhyChangedChoices(make_named_values<WhyChangedChoices>(
-                                n::changed_choices() = std::make_shared<ChangedChoices>(),
-                                n::reasons() = std::make_shared<Reasons>()
-                                ))));
-            if (trying_changing_choices)
+            if (! constraint->spec().if_package())
             {
-                for (const auto & constraint : *resolution->constraints())
+                if (constraint->spec().if_block()->blocking().additional_requirements_ptr() &&
+                        ! constraint->spec().if_block()->blocking().additional_requirements_ptr()->empty())
                 {
-                    if (! ok)
-                        break;
-
-                    if (! constraint->spec().if_package())
-                    {
-                        if (constraint->spec().if_block()->blocking().additional_requirements_ptr() &&
-                                ! constraint->spec().if_block()->blocking().additional_requirements_ptr()->empty())
-                        {
-                            /* too complicated for now */
-                            ok = false;
-                        }
-                        break;
-                    }
-
-                    if (! constraint->spec().if_package()->additional_requirements_ptr())
-                    {
-                        /* no additional requirements, so no tinkering required */
-                        continue;
-                    }
-
-                    for (const auto & requirement : *constraint->spec().if_package()->additional_requirements_ptr())
-                    {
-                        auto b(requirement->accumulate_changes_to_make_met(_imp->env,
-                                    get_changed_choices_for(constraint).get(), *i, constraint->from_id(),
-                                    *why_changed_choices->changed_choices()));
-                        if (b.is_false())
-                        {
-                            ok = false;
-                            break;
-                        }
-                        else if (b.is_true())
-                            why_changed_choices->reasons()->push_back(constraint->reason());
-                    }
+                    /* too complicated for now */
+                    return nullptr;
                 }
+                break;
             }
 
-            /* might have an early requirement of [x], and a later [-x], and
-             * chosen to change because of the latter */
-            for (const auto & constraint : *resolution->constraints())
+            if (! constraint->spec().if_package()->additional_requirements_ptr())
             {
-                if (! ok)
-                    break;
+                /* no additional requirements, so no tinkering required */
+                continue;
+            }
 
-                if (constraint->spec().if_package())
-                    ok = ok && match_package_with_maybe_changes(*_imp->env, *constraint->spec().if_package(),
-                            get_changed_choices_for(constraint).get(), *i, constraint->from_id(), why_changed_choices->changed_choices().get(), { });
-                else
-                    ok = ok && ! match_package_with_maybe_changes(*_imp->env, constraint->spec().if_block()->blocking(),
-                            get_changed_choices_for(constraint).get(), *i, constraint->from_id(), why_changed_choices->changed_choices().get(), { });
+            for (const auto & requirement : *constraint->spec().if_package()->additional_requirements_ptr())
+            {
+                auto b(requirement->accumulate_changes_to_make_met(_imp->env,
+                            get_changed_choices_for(constraint).get(), id, constraint->from_id(),
+                            *why_changed_choices->changed_choices()));
+                if (b.is_false())
+                    return nullptr;
+                else if (b.is_true())
+                    why_changed_choices->reasons()->push_back(constraint->reason());
             }
+        }
+    }
 
-            if (ok)
-                return FoundID(*i,
-                        why_changed_choices->changed_choices()->empty() ? nullptr : why_changed_choices,
-                        (*i)->version() == best_version->version());
+    /* might have an early requirement of [x], and a later [-x], and
+     * chosen to change because of the latter */
+    for (const auto & constraint : *resolution->constraints())
+    {
+        if (constraint->spec().if_package())
+        {
+            if (! match_package_with_maybe_changes(*_imp->env, *constraint->spec().if_package(),
+                        get_changed_choices_for(constraint).get(), id, constraint->from_id(), why_changed_choices->changed_choices().get(), { }))
+                return nullptr;
+        }
+        else
+        {
+            if (match_package_with_maybe_changes(*_imp->env, constraint->spec().if_block()->blocking(),
+                        get_changed_choices_for(constraint).get(), id, constraint->from_id(), why_changed_choices->changed_choices().get(), { }))
+                return nullptr;
         }
     }
 
-    if (try_changing_choices && ! trying_changing_choices)
-        return _find_id_for_from(resolution, ids, true, true);
-    else
-        return FoundID(nullptr, nullptr, false);
+    return why_changed_choices;
 }
 
 const std::shared_ptr<const Constraints>
@@ -1945,6 +2154,8 @@ Decider::purge()
 void
 Decider::resolve()
 {
+    ProfileTimer timer("decider.resolve");
+
     while (true)
     {
         _imp->env->trigger_notifier_callback(NotifierCallbackResolverStageEvent("Deciding"));
@@ -2099,6 +2310,7 @@ bool
 Decider::_resolve_purges()
 {
     Context context("When finding things to purge:");
+    ProfileTimer timer("decider.purges");
 
     const std::pair<
         std::shared_ptr<const ChangeByResolventSequence>,
@@ -38,6 +38,7 @@
 #include <paludis/resolver/resolutions_by_resolvent-fwd.hh>
 #include <paludis/resolver/change_by_resolvent-fwd.hh>
 #include <paludis/resolver/why_changed_choices-fwd.hh>
+#include <paludis/resolver/decision_cache-fwd.hh>
 #include <paludis/util/attributes.hh>
 #include <paludis/util/pimp.hh>
 #include <paludis/util/tribool-fwd.hh>
@@ -48,6 +49,7 @@
 #include <paludis/generator-fwd.hh>
 #include <paludis/changed_choices-fwd.hh>
 #include <paludis/name-fwd.hh>
+#include <string>
 #include <tuple>
 
 namespace paludis
@@ -154,6 +156,10 @@ namespace paludis
                         const ChangesToMakeDecision &) const;
 
                 void _decide(const std::shared_ptr<Resolution> & resolution);
+
+                const std::string _decision_cache_inputs(
+                        const std::shared_ptr<const Resolution> & resolution,
+                        const bool allow_choice_changes) const;
                 void _copy_other_destination_constraints(const std::shared_ptr<Resolution> & resolution);
 
                 const std::shared_ptr<Decision> _try_to_find_decision_for(
@@ -191,6 +197,11 @@ namespace paludis
                         const bool try_changing_choices,
                         const bool trying_changing_choices) const;
 
+                const std::shared_ptr<WhyChangedChoices> _check_candidate(
+                        const std::shared_ptr<const Resolution> &,
+                        const std::shared_ptr<const PackageID> &,
+                        const bool trying_changing_choices) const;
+
                 const std::shared_ptr<const Constraints> _get_unmatching_constraints(
                         const std::shared_ptr<const Resolution> &,
                         const std::shared_ptr<const PackageID> &,
@@ -243,6 +254,12 @@ namespace paludis
 
                 void purge();
 
+                /**
+                 * Reuse decisions from, and store new decisions in, this
+                 * cache.
+                 */
+                void set_decision_cache(const std::shared_ptr<DecisionCache> &);
+
                 std::pair<AnyChildScore, OperatorScore> find_any_score(
                         const std::shared_ptr<const Resolution> &,
                         const std::shared_ptr<const PackageID> &,
@@ -0,0 +1,303 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2026 agent
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <paludis/resolver/decision_cache.hh>
+#include <paludis/resolver/decision.hh>
+
+#include <paludis/util/pimp-impl.hh>
+#include <paludis/util/log.hh>
+#include <paludis/util/exception.hh>
+#include <paludis/util/stringify.hh>
+#include <paludis/util/join.hh>
+#include <paludis/util/destringify.hh>
+#include <paludis/util/fs_path.hh>
+#include <paludis/util/fs_stat.hh>
+#include <paludis/util/safe_ifstream.hh>
+#include <paludis/util/cache_file.hh>
+#include <paludis/util/sha256.hh>
+#include <paludis/util/set.hh>
+#include <paludis/util/wrapped_forward_iterator.hh>
+#include <paludis/util/profiler.hh>
+
+#include <paludis/environment.hh>
+#include <paludis/repository.hh>
+#include <paludis/package_id.hh>
+#include <paludis/metadata_key.hh>
+#include <paludis/mask.hh>
+#include <paludis/choice.hh>
+#include <paludis/serialise.hh>
+#include <paludis/unformatted_pretty_printer.hh>
+
+#include <atomic>
+#include <iterator>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
+using namespace paludis;
+using namespace paludis::resolver;
+
+namespace
+{
+    const std::string cache_magic("paludis-decision-cache-1");
+
+    /* entries not used by this many saves in a row are dropped */
+    const unsigned long max_unused_generations(20);
+
+    struct Entry
+    {
+        unsigned long generation;
+        std::string decision;
+    };
+
+    std::string hash(const std::string & s)
+    {
+        std::istringstream stream(s);
+        return SHA256(stream).hexsum();
+    }
+}
+
+namespace paludis
+{
+    template <>
+    struct Imp<DecisionCache>
+    {
+        const Environment * const env;
+        const FSPath file;
+        std::string options;
+
+        mutable std::mutex mutex;
+        mutable std::unordered_map<std::string, Entry> entries;
+        unsigned long generation;
+        mutable bool changed;
+        mutable std::atomic<unsigned long> hits;
+
+        Imp(const Environment * const e, const FSPath & f, const std::string & o) :
+            env(e),
+            file(f),
+            options(o),
+            generation(0),
+            changed(false),
+            hits(0)
+        {
+        }
+
+        void load()
+        {
+            Context context("When loading decision cache '" + stringify(file) + "':");
+
+            if (! file.stat().is_regular_file())
+                return;
+
+            try
+            {
+                SafeIFStream s(file);
+                std::string data((std::istreambuf_iterator<char>(s)), std::istreambuf_iterator<char>());
+                if (0 != data.compare(0, cache_magic.length() + 1, cache_magic + "\n"))
+                {
+                    Log::get_instance()->message("resolver.decision_cache.bad", ll_warning, lc_context)
+                        << "Ignoring decision cache with bad magic";
+                    return;
+                }
+
+                CacheFieldReader r(data, cache_magic.length() + 1);
+                generation = destringify<unsigned long>(r.get());
+                while (! (r.bad() || r.done()))
+                {
+                    std::string key(r.get()), entry_generation(r.get()), decision(r.get());
+                    if (! r.bad())
+                        entries.insert(std::make_pair(key, Entry{ destringify<unsigned long>(entry_generation), decision }));
+                }
+
+                if (r.bad())
+                {
+                    Log::get_instance()->message("resolver.decision_cache.bad", ll_warning, lc_context)
+                        << "Ignoring truncated decision cache";
+                    entries.clear();
+                }
+            }
+            catch (const Exception & e)
+            {
+                Log::get_instance()->message("resolver.decision_cache.bad", ll_warning, lc_context)
+                    << "Ignoring decision cache due to exception '" << e.message() << "' (" << e.what() << ")";
+                entries.clear();
+            }
+
+            ++generation;
+        }
+    };
+}
+
+DecisionCache::DecisionCache(const Environment * const env, const FSPath & f, const std::string & o) :
+    _imp(env, f, o)
+{
+    /* a repository appearing or going away can change anything */
+    for (const auto & repo : env->repositories())
+        _imp->options.append(" " + stringify(repo->name()));
+
+    _imp->load();
+}
+
+DecisionCache::~DecisionCache() = default;
+
+const std::shared_ptr<Decision>
+DecisionCache::find(const std::string & inputs) const
+{
+    std::string key(hash(_imp->options + "\n" + inputs));
+    std::string decision;
+
+    {
+        std::unique_lock<std::mutex> lock(_imp->mutex);
+        auto e(_imp->entries.find(key));
+        if (_imp->entries.end() == e)
+        {
+            if (Profiler::enabled())
+                Profiler::get_instance()->add_cache_lookup("decision_cache", false);
+            return nullptr;
+        }
+
+        if (e->second.generation != _imp->generation)
+        {
+            e->second.generation = _imp->generation;
+            _imp->changed = true;
+        }
+        decision = e->second.decision;
+    }
+
+    try
+    {
+        std::istringstream stream(decision);
+        Deserialiser deserialiser(_imp->env, stream);
+        Deserialisation deserialisation("Decision", deserialiser);
+        auto result(Decision::deserialise(deserialisation));
+        ++_imp->hits;
+        if (Profiler::enabled())
+            Profiler::get_instance()->add_cache_lookup("decision_cache", true);
+        return result;
+    }
+    catch (const Exception & e)
+    {
+        /* for example, the ID it refers to might have gone away, or the
+         * entry might have been written by an incompatible version */
+        Log::get_instance()->message("resolver.decision_cache.unusable", ll_debug, lc_context)
+            << "Not using cached decision due to exception '" << e.message() << "' (" << e.what() << ")";
+        if (Profiler::enabled())
+            Profiler::get_instance()->add_cache_lookup("decision_cache", false);
+        return nullptr;
+    }
+}
+
+void
+DecisionCache::store(const std::string & inputs, const Decision & decision)
+{
+    std::stringstream stream;
+    Serialiser serialiser(stream);
+    decision.serialise(serialiser);
+
+    std::string key(hash(_imp->options + "\n" + inputs));
+
+    std::unique_lock<std::mutex> lock(_imp->mutex);
+    _imp->entries[key] = Entry{ _imp->generation, stream.str() };
+    _imp->changed = true;
+}
+
+unsigned long
+DecisionCache::hits() const
+{
+    return _imp->hits;
+}
+
+void
+DecisionCache::save() const
+{
+    Context context("When saving decision cache '" + stringify(_imp->file) + "':");
+
+    std::unique_lock<std::mutex> lock(_imp->mutex);
+    if (! _imp->changed)
+        return;
+
+    std::string data(cache_magic + "\n");
+    put_cache_field(data, stringify(_imp->generation));
+    for (const auto & e : _imp->entries)
+    {
+        if (e.second.generation + max_unused_generations < _imp->generation)
+            continue;
+
+        put_cache_field(data, e.first);
+        put_cache_field(data, stringify(e.second.generation));
+        put_cache_field(data, e.second.decision);
+    }
+
+    try
+    {
+        write_cache_file(_imp->file, data);
+        _imp->changed = false;
+    }
+    catch (const Exception & e)
+    {
+        Log::get_instance()->message("resolver.decision_cache.write_failure", ll_warning, lc_context)
+            << "Couldn't write decision cache: " << e.message() << " (" << e.what() << ")";
+    }
+}
+
+std::string
+DecisionCache::id_fingerprint(const std::shared_ptr<const PackageID> & id, const bool with_dependencies)
+{
+    std::string result;
+    put_cache_field(result, stringify(*id));
+
+    std::string masks;
+    for (auto m(id->begin_masks()), m_end(id->end_masks()) ; m != m_end ; ++m)
+        masks.append(1, (*m)->key());
+    put_cache_field(result, masks);
+
+    std::string overridden_masks;
+    for (auto m(id->begin_overridden_masks()), m_end(id->end_overridden_masks()) ; m != m_end ; ++m)
+        overridden_masks.append(stringify((*m)->mask()->key()) + stringify((*m)->override_reason()) + " ");
+    put_cache_field(result, overridden_masks);
+
+    std::string choices;
+    if (id->choices_key())
+        for (const auto & c : *id->choices_key()->parse_value())
+            for (const auto & v : *c)
+                choices.append(stringify(v->name_with_prefix()) + (v->enabled() ? "+" : "-") +
+                        (v->locked() ? "!" : "") + stringify(v->origin()) + " ");
+    put_cache_field(result, choices);
+
+    if (id->behaviours_key())
+    {
+        auto behaviours(id->behaviours_key()->parse_value());
+        put_cache_field(result, join(behaviours->begin(), behaviours->end(), " "));
+    }
+
+    if (with_dependencies)
+    {
+        UnformattedPrettyPrinter printer;
+        for (const auto & k : { id->build_dependencies_key(), id->run_dependencies_key(), id->post_dependencies_key(), id->dependencies_key() })
+            put_cache_field(result, k ? k->pretty_print_value(printer, { }) : "");
+    }
+
+    return result;
+}
+
+namespace paludis
+{
+    template class Pimp<DecisionCache>;
+}
@@ -0,0 +1,102 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2026 agent
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef PALUDIS_GUARD_PALUDIS_RESOLVER_DECISION_CACHE_HH
+#define PALUDIS_GUARD_PALUDIS_RESOLVER_DECISION_CACHE_HH 1
+
+#include <paludis/resolver/decision_cache-fwd.hh>
+#include <paludis/resolver/decision-fwd.hh>
+#include <paludis/util/pimp.hh>
+#include <paludis/util/attributes.hh>
+#include <paludis/util/fs_path-fwd.hh>
+#include <paludis/package_id-fwd.hh>
+#include <paludis/environment-fwd.hh>
+#include <memory>
+#include <string>
+
+namespace paludis
+{
+    namespace resolver
+    {
+        /**
+         * Decisions made by an earlier resolution, kept in a file so that
+         * a later resolution can reuse them.
+         *
+         * A decision is looked up using a description of everything which
+         * went into making it. The caller builds this description, usually
+         * with the help of id_fingerprint. The options given to the
+         * constructor, and the names of the environment's repositories, are
+         * treated as part of every description, so changing either of them
+         * makes every entry miss.
+         *
+         * Entries which have not been used for a while are dropped when the
+         * file is saved.
+         */
+        class PALUDIS_VISIBLE DecisionCache
+        {
+            private:
+                Pimp<DecisionCache> _imp;
+
+            public:
+                DecisionCache(const Environment * const, const FSPath &, const std::string & options);
+                ~DecisionCache();
+
+                DecisionCache(const DecisionCache &) = delete;
+                DecisionCache & operator= (const DecisionCache &) = delete;
+
+                /**
+                 * The decision stored for these inputs, or a null pointer
+                 * if there isn't a usable one.
+                 */
+                const std::shared_ptr<Decision> find(const std::string & inputs) const
+                    PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                /**
+                 * Remember a decision for these inputs. The decision is
+                 * serialised immediately, so later changes to it are not
+                 * stored.
+                 */
+                void store(const std::string & inputs, const Decision &);
+
+                /**
+                 * How many calls to find have returned a decision.
+                 */
+                unsigned long hits() const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                /**
+                 * Write the cache file, if anything has changed. Failure is
+                 * logged, not thrown.
+                 */
+                void save() const;
+
+                /**
+                 * Describe the things about an ID which can affect what we
+                 * decide for it: its masks, choices, behaviours and, if
+                 * asked, its dependencies.
+                 */
+                static std::string id_fingerprint(const std::shared_ptr<const PackageID> &, const bool with_dependencies)
+                    PALUDIS_ATTRIBUTE((warn_unused_result));
+        };
+    }
+
+    extern template class Pimp<resolver::DecisionCache>;
+}
+
+#endif
@@ -0,0 +1,390 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2026 agent
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <paludis/resolver/dependents_index.hh>
+
+#include <paludis/util/pimp-impl.hh>
+#include <paludis/util/sequence.hh>
+#include <paludis/util/wrapped_forward_iterator.hh>
+#include <paludis/util/indirect_iterator-impl.hh>
+#include <paludis/util/visitor_cast.hh>
+#include <paludis/util/log.hh>
+#include <paludis/util/stringify.hh>
+#include <paludis/util/destringify.hh>
+#include <paludis/util/tokeniser.hh>
+#include <paludis/util/fs_path.hh>
+#include <paludis/util/fs_stat.hh>
+#include <paludis/util/safe_ifstream.hh>
+#include <paludis/util/cache_file.hh>
+#include <paludis/util/timestamp.hh>
+#include <paludis/util/task_scheduler.hh>
+#include <paludis/util/profiler.hh>
+
+#include <paludis/spec_tree.hh>
+#include <paludis/dep_spec.hh>
+#include <paludis/environment.hh>
+#include <paludis/repository.hh>
+#include <paludis/package_id.hh>
+#include <paludis/metadata_key.hh>
+#include <paludis/name.hh>
+
+#include <algorithm>
+#include <iterator>
+#include <sstream>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+using namespace paludis;
+using namespace paludis::resolver;
+
+namespace
+{
+    const std::string index_magic("paludis-dependents-index-1");
+
+    /* stands in for a set or a spec with no package name, either of which
+     * could match anything */
+    const std::string any_name("*");
+
+    typedef std::set<std::string> Names;
+
+    struct NamesCollector
+    {
+        Names & names;
+
+        void visit(const DependencySpecTree::NodeType<PackageDepSpec>::Type & s)
+        {
+            if (s.spec()->package_ptr())
+                names.insert(stringify(*s.spec()->package_ptr()));
+            else
+                names.insert(any_name);
+        }
+
+        void visit(const DependencySpecTree::NodeType<NamedSetDepSpec>::Type &)
+        {
+            names.insert(any_name);
+        }
+
+        void visit(const DependencySpecTree::NodeType<BlockDepSpec>::Type &)
+        {
+        }
+
+        void visit(const DependencySpecTree::NodeType<DependenciesLabelsDepSpec>::Type &)
+        {
+        }
+
+        /* we don't care whether conditionals are met, since being a superset
+         * is fine */
+        void visit(const DependencySpecTree::NodeType<ConditionalDepSpec>::Type & s)
+        {
+            std::for_each(indirect_iterator(s.begin()), indirect_iterator(s.end()), accept_visitor(*this));
+        }
+
+        void visit(const DependencySpecTree::NodeType<AnyDepSpec>::Type & s)
+        {
+            std::for_each(indirect_iterator(s.begin()), indirect_iterator(s.end()), accept_visitor(*this));
+        }
+
+        void visit(const DependencySpecTree::NodeType<AllDepSpec>::Type & s)
+        {
+            std::for_each(indirect_iterator(s.begin()), indirect_iterator(s.end()), accept_visitor(*this));
+        }
+    };
+
+    Names names_for(const std::shared_ptr<const PackageID> & id)
+    {
+        Context context("When finding names in the dependencies of '" + stringify(*id) + "':");
+
+        Names result;
+        NamesCollector c{result};
+
+        try
+        {
+            if (id->dependencies_key())
+                id->dependencies_key()->parse_value()->top()->accept(c);
+            else
+            {
+                if (id->build_dependencies_key())
+                    id->build_dependencies_key()->parse_value()->top()->accept(c);
+                if (id->run_dependencies_key())
+                    id->run_dependencies_key()->parse_value()->top()->accept(c);
+                if (id->post_dependencies_key())
+                    id->post_dependencies_key()->parse_value()->top()->accept(c);
+            }
+        }
+        catch (const InternalError &)
+        {
+            throw;
+        }
+        catch (const Exception & e)
+        {
+            /* whoever checks this ID properly will hit the same problem, and
+             * can report it */
+            Log::get_instance()->message("resolver.dependents_index.bad_dependencies", ll_debug, lc_context)
+                << "Treating as a candidate for everything due to exception '" << e.message() << "' (" << e.what() << ")";
+            result.insert(any_name);
+        }
+
+        return result;
+    }
+
+    /* an ID's names can be reused for as long as the ID's directory is
+     * unchanged. IDs without a directory aren't kept. */
+    std::shared_ptr<const FSPath> location_of(const std::shared_ptr<const PackageID> & id)
+    {
+        if (! id->fs_location_key())
+            return nullptr;
+
+        return std::make_shared<FSPath>(id->fs_location_key()->parse_value());
+    }
+
+    struct CachedEntry
+    {
+        Timestamp mtime;
+        Names names;
+    };
+
+    struct IndexFile
+    {
+        FSPath path;
+        std::unordered_map<std::string, CachedEntry> entries;
+        std::vector<unsigned> ids;
+        bool changed;
+
+        IndexFile(const FSPath & p) :
+            path(p),
+            changed(false)
+        {
+        }
+    };
+
+    std::shared_ptr<IndexFile> index_file_for(const Environment * const env, const RepositoryName & name)
+    {
+        auto repo(env->fetch_repository(name));
+        auto k(repo->find_metadata("names_cache"));
+        if (repo->end_metadata() == k)
+            return nullptr;
+
+        auto v(visitor_cast<const MetadataValueKey<FSPath> >(**k));
+        if (! v)
+            return nullptr;
+
+        FSPath dir(v->parse_value());
+        if (dir == FSPath("/var/empty") || ! dir.stat().is_directory())
+            return nullptr;
+
+        return std::make_shared<IndexFile>(dir / (stringify(name) + ".dependents"));
+    }
+
+    void read_index_file(IndexFile & f)
+    {
+        if (! f.path.stat().is_regular_file())
+        {
+            f.changed = true;
+            return;
+        }
+
+        Context context("When reading dependents index '" + stringify(f.path) + "':");
+
+        auto bad([&] (const std::string & why) {
+                Log::get_instance()->message("resolver.dependents_index.bad", ll_debug, lc_context)
+                    << "Ignoring dependents index '" << f.path << "': " << why;
+                f.entries.clear();
+                f.changed = true;
+            });
+
+        try
+        {
+            SafeIFStream s(f.path);
+
+            std::string line;
+            if ((! std::getline(s, line)) || line != index_magic)
+                return bad("bad magic");
+
+            std::string location;
+            while (std::getline(s, location))
+            {
+                std::vector<std::string> tokens;
+                if (! std::getline(s, line))
+                    return bad("truncated entry '" + location + "'");
+                tokenise_whitespace(line, std::back_inserter(tokens));
+                if (tokens.size() < 2)
+                    return bad("bad entry line '" + line + "'");
+
+                CachedEntry e{ Timestamp(destringify<time_t>(tokens[0]), destringify<long>(tokens[1])), Names() };
+                e.names.insert(std::next(tokens.begin(), 2), tokens.end());
+                f.entries.insert(std::make_pair(location, e));
+            }
+        }
+        catch (const Exception & e)
+        {
+            return bad("exception '" + e.message() + "' (" + e.what() + ")");
+        }
+    }
+}
+
+namespace paludis
+{
+    template <>
+    struct Imp<DependentsIndex>
+    {
+        std::vector<std::shared_ptr<const PackageID> > ids;
+
+        /* positions in ids, in order */
+        std::unordered_map<std::string, std::vector<unsigned> > by_name;
+        std::vector<unsigned> any;
+
+        void write_index_file(const IndexFile & f, const std::vector<Names> & names,
+                const std::vector<Timestamp> & mtimes) const
+        {
+            Context context("When writing dependents index '" + stringify(f.path) + "':");
+
+            try
+            {
+                std::ostringstream s;
+                s << index_magic << std::endl;
+
+                for (auto i(f.ids.begin()), i_end(f.ids.end()) ;
+                        i != i_end ; ++i)
+                {
+                    std::string location(stringify(*location_of(ids[*i])));
+                    if (std::string::npos != location.find('\n'))
+                        continue;
+
+                    Timestamp mtime(cache_timestamp(mtimes[*i]));
+                    s << location << std::endl << mtime.seconds() << " " << mtime.nanoseconds();
+
+                    for (auto n(names[*i].begin()), n_end(names[*i].end()) ;
+                            n != n_end ; ++n)
+                        s << " " << *n;
+                    s << std::endl;
+                }
+
+                write_cache_file(f.path, s.str());
+            }
+            catch (const Exception & e)
+            {
+                Log::get_instance()->message("resolver.dependents_index.write_failure", ll_debug, lc_context)
+                    << "Not writing dependents index due to exception '" << e.message() << "' (" << e.what() << ")";
+            }
+        }
+
+        Imp(const Environment * const env, const std::shared_ptr<const PackageIDSequence> & i) :
+            ids(i->begin(), i->end())
+        {
+            Context context("When building dependents index:");
+            ProfileTimer timer("dependents_index.build");
+
+            std::map<RepositoryName, std::shared_ptr<IndexFile> > files;
+            std::vector<Timestamp> mtimes(ids.size(), Timestamp(0, 0));
+            std::vector<Names> names(ids.size());
+            std::vector<unsigned> need;
+
+            for (unsigned n(0) ; n < ids.size() ; ++n)
+            {
+                auto location(location_of(ids[n]));
+                auto f(files.find(ids[n]->repository_name()));
+                if (files.end() == f)
+                {
+                    f = files.insert(std::make_pair(ids[n]->repository_name(),
+                                index_file_for(env, ids[n]->repository_name()))).first;
+                    if (f->second)
+                        read_index_file(*f->second);
+                }
+
+                if (location && f->second)
+                {
+                    f->second->ids.push_back(n);
+
+                    FSStat location_stat(*location);
+                    if (location_stat.exists())
+                        mtimes[n] = location_stat.mtim();
+
+                    auto e(f->second->entries.find(stringify(*location)));
+                    if (f->second->entries.end() != e && e->second.mtime == mtimes[n] && mtimes[n] != Timestamp(0, 0))
+                    {
+                        if (Profiler::enabled())
+                            Profiler::get_instance()->add_cache_lookup("dependents_index", true);
+                        names[n] = e->second.names;
+                        continue;
+                    }
+
+                    if (Profiler::enabled())
+                        Profiler::get_instance()->add_cache_lookup("dependents_index", false);
+                    f->second->changed = true;
+                }
+
+                need.push_back(n);
+            }
+
+            parallel_for_each(need.begin(), need.end(), [&] (const unsigned n) {
+                    names[n] = names_for(ids[n]);
+                    });
+
+            for (unsigned n(0) ; n < ids.size() ; ++n)
+                for (auto name(names[n].begin()), name_end(names[n].end()) ;
+                        name != name_end ; ++name)
+                {
+                    if (*name == any_name)
+                        any.push_back(n);
+                    else
+                        by_name[*name].push_back(n);
+                }
+
+            /* anything left over has been unmerged */
+            for (auto f(files.begin()), f_end(files.end()) ;
+                    f != f_end ; ++f)
+                if (f->second && (f->second->changed || f->second->entries.size() != f->second->ids.size()))
+                    write_index_file(*f->second, names, mtimes);
+        }
+    };
+}
+
+DependentsIndex::DependentsIndex(const Environment * const env, const std::shared_ptr<const PackageIDSequence> & ids) :
+    _imp(env, ids)
+{
+}
+
+DependentsIndex::~DependentsIndex() = default;
+
+const std::shared_ptr<const PackageIDSequence>
+DependentsIndex::candidates(const QualifiedPackageName & name) const
+{
+    static const std::vector<unsigned> none;
+
+    auto n(_imp->by_name.find(stringify(name)));
+    const std::vector<unsigned> & named(_imp->by_name.end() == n ? none : n->second);
+
+    std::vector<unsigned> positions;
+    std::set_union(named.begin(), named.end(), _imp->any.begin(), _imp->any.end(), std::back_inserter(positions));
+
+    auto result(std::make_shared<PackageIDSequence>());
+    for (auto p(positions.begin()), p_end(positions.end()) ;
+            p != p_end ; ++p)
+        result->push_back(_imp->ids[*p]);
+
+    return result;
+}
+
+namespace paludis
+{
+    template class Pimp<DependentsIndex>;
+}
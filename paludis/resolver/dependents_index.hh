@@ -0,0 +1,75 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2026 agent
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef PALUDIS_GUARD_PALUDIS_RESOLVER_DEPENDENTS_INDEX_HH
+#define PALUDIS_GUARD_PALUDIS_RESOLVER_DEPENDENTS_INDEX_HH 1
+
+#include <paludis/resolver/dependents_index-fwd.hh>
+#include <paludis/util/pimp.hh>
+#include <paludis/util/attributes.hh>
+#include <paludis/package_id-fwd.hh>
+#include <paludis/environment-fwd.hh>
+#include <paludis/name-fwd.hh>
+#include <memory>
+
+namespace paludis
+{
+    namespace resolver
+    {
+        /**
+         * Which installed IDs might depend upon a given package name.
+         *
+         * The index only looks at the names mentioned in an ID's
+         * dependencies, so it gives a superset of the real dependents, which
+         * must still be checked properly. IDs whose dependencies refer to a
+         * set, or to a spec without a package name, are candidates for every
+         * name.
+         *
+         * For repositories with a names cache, the names for each ID are
+         * also kept in a file in that directory, and are reused for as long
+         * as the ID's directory is unchanged. IDs which have been merged
+         * since the file was written are added to it, and those which have
+         * been unmerged are dropped from it.
+         */
+        class PALUDIS_VISIBLE DependentsIndex
+        {
+            private:
+                Pimp<DependentsIndex> _imp;
+
+            public:
+                DependentsIndex(const Environment * const, const std::shared_ptr<const PackageIDSequence> &);
+                ~DependentsIndex();
+
+                DependentsIndex(const DependentsIndex &) = delete;
+                DependentsIndex & operator= (const DependentsIndex &) = delete;
+
+                /**
+                 * Every ID we were given which might depend upon something
+                 * with this name, in the order we were given them.
+                 */
+                const std::shared_ptr<const PackageIDSequence> candidates(
+                        const QualifiedPackageName &) const PALUDIS_ATTRIBUTE((warn_unused_result));
+        };
+    }
+
+    extern template class Pimp<resolver::DependentsIndex>;
+}
+
+#endif
@@ -0,0 +1,288 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2026 agent
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <paludis/resolver/dependents_index.hh>
+#include <paludis/resolver/collect_depped_upon.hh>
+#include <paludis/resolver/change_by_resolvent.hh>
+#include <paludis/resolver/resolvent.hh>
+
+#include <paludis/repositories/fake/fake_installed_repository.hh>
+#include <paludis/repositories/fake/fake_package_id.hh>
+
+#include <paludis/environments/test/test_environment.hh>
+
+#include <paludis/util/sequence.hh>
+#include <paludis/util/set.hh>
+#include <paludis/util/map.hh>
+#include <paludis/util/make_named_values.hh>
+#include <paludis/util/wrapped_forward_iterator.hh>
+#include <paludis/util/indirect_iterator-impl.hh>
+#include <paludis/util/fs_path.hh>
+#include <paludis/util/fs_stat.hh>
+#include <paludis/util/fs_iterator.hh>
+#include <paludis/util/safe_ifstream.hh>
+#include <paludis/util/safe_ofstream.hh>
+#include <paludis/util/timestamp.hh>
+#include <paludis/util/stringify.hh>
+
+#include <paludis/repository_factory.hh>
+#include <paludis/generator.hh>
+#include <paludis/filter.hh>
+#include <paludis/filtered_generator.hh>
+#include <paludis/selection.hh>
+#include <paludis/package_id.hh>
+#include <paludis/name.hh>
+
+#include <functional>
+#include <iterator>
+#include <string>
+
+#include <gtest/gtest.h>
+
+using namespace paludis;
+using namespace paludis::resolver;
+
+namespace
+{
+    std::string from_keys(const std::shared_ptr<const Map<std::string, std::string> > & m,
+            const std::string & k)
+    {
+        Map<std::string, std::string>::ConstIterator mm(m->find(k));
+        if (m->end() == mm)
+            return "";
+        else
+            return mm->second;
+    }
+
+    FSPath test_dir(const std::string & t)
+    {
+        return FSPath::cwd() / "dependents_index_TEST_dir" / t;
+    }
+
+    std::shared_ptr<const PackageIDSequence> installed_ids(TestEnvironment & env, const std::string & t,
+            const bool use_names_cache)
+    {
+        std::shared_ptr<Map<std::string, std::string> > keys(std::make_shared<Map<std::string, std::string>>());
+        keys->insert("format", "vdb");
+        keys->insert("names_cache", use_names_cache ? stringify(test_dir(t) / "names_cache") : "/var/empty");
+        keys->insert("location", stringify(test_dir(t) / "installed"));
+        keys->insert("builddir", stringify(test_dir(t) / "build"));
+        env.add_repository(1, RepositoryFactory::get_instance()->create(&env,
+                    std::bind(from_keys, keys, std::placeholders::_1)));
+
+        return env[selection::AllVersionsSorted(generator::All())];
+    }
+
+    std::string candidates(const DependentsIndex & index, const std::string & name)
+    {
+        auto c(index.candidates(QualifiedPackageName(name)));
+        std::string result;
+        for (auto i(c->begin()), i_end(c->end()) ;
+                i != i_end ; ++i)
+            result.append((result.empty() ? "" : " ") + stringify((*i)->name()));
+        return result;
+    }
+
+    std::string index_file_contents(const std::string & t)
+    {
+        SafeIFStream s(test_dir(t) / "names_cache" / "installed.dependents");
+        return std::string((std::istreambuf_iterator<char>(s)), std::istreambuf_iterator<char>());
+    }
+
+    void set_mtimes(const std::string & t, const Timestamp & m)
+    {
+        for (FSIterator d(test_dir(t) / "installed" / "cat", { }), d_end ; d != d_end ; ++d)
+            ASSERT_TRUE(d->utime(m));
+    }
+
+    void unmerge(const std::string & t, const std::string & p)
+    {
+        FSPath dir(test_dir(t) / "installed" / "cat" / p);
+        for (FSIterator f(dir, { fsio_include_dotfiles }), f_end ; f != f_end ; ++f)
+            ASSERT_TRUE(f->unlink());
+        ASSERT_TRUE(dir.rmdir());
+    }
+}
+
+TEST(DependentsIndex, Candidates)
+{
+    TestEnvironment env;
+    DependentsIndex index(&env, installed_ids(env, "candidates", false));
+
+    EXPECT_EQ("cat/a cat/b cat/d", candidates(index, "cat/x"));
+    EXPECT_EQ("cat/b cat/c cat/d", candidates(index, "cat/y"));
+    EXPECT_EQ("cat/b cat/d", candidates(index, "cat/z"));
+    EXPECT_EQ("cat/d", candidates(index, "cat/nothing"));
+}
+
+TEST(DependentsIndex, Reuse)
+{
+    set_mtimes("reuse", Timestamp(12345, 0));
+
+    {
+        TestEnvironment env;
+        DependentsIndex index(&env, installed_ids(env, "reuse", true));
+        EXPECT_EQ("cat/a cat/b cat/d", candidates(index, "cat/x"));
+        EXPECT_EQ("cat/d", candidates(index, "cat/q"));
+    }
+
+    EXPECT_NE(std::string::npos, index_file_contents("reuse").find("/cat/a-1\n12345 0 cat/x\n"));
+
+    /* a change that leaves the directory's mtime alone isn't noticed */
+    {
+        SafeOFStream s(test_dir("reuse") / "installed" / "cat" / "a-1" / "RDEPEND", -1, true);
+        s << "cat/q" << std::endl;
+    }
+    set_mtimes("reuse", Timestamp(12345, 0));
+
+    {
+        TestEnvironment env;
+        DependentsIndex index(&env, installed_ids(env, "reuse", true));
+        EXPECT_EQ("cat/a cat/b cat/d", candidates(index, "cat/x"));
+        EXPECT_EQ("cat/d", candidates(index, "cat/q"));
+    }
+
+    /* but one that changes it is */
+    ASSERT_TRUE((test_dir("reuse") / "installed" / "cat" / "a-1").utime(Timestamp(23456, 0)));
+
+    {
+        TestEnvironment env;
+        DependentsIndex index(&env, installed_ids(env, "reuse", true));
+        EXPECT_EQ("cat/b cat/d", candidates(index, "cat/x"));
+        EXPECT_EQ("cat/a cat/d", candidates(index, "cat/q"));
+    }
+
+    EXPECT_NE(std::string::npos, index_file_contents("reuse").find("/cat/a-1\n23456 0 cat/q\n"));
+    EXPECT_EQ(std::string::npos, index_file_contents("reuse").find("cat/x\n"));
+
+    /* nor is anything modified very recently trusted */
+    ASSERT_TRUE((test_dir("reuse") / "installed" / "cat" / "a-1").utime(Timestamp::now()));
+
+    {
+        TestEnvironment env;
+        DependentsIndex index(&env, installed_ids(env, "reuse", true));
+        EXPECT_EQ("cat/a cat/d", candidates(index, "cat/q"));
+    }
+
+    EXPECT_NE(std::string::npos, index_file_contents("reuse").find("/cat/a-1\n0 0 cat/q\n"));
+}
+
+TEST(DependentsIndex, Unmerge)
+{
+    set_mtimes("unmerge", Timestamp(12345, 0));
+
+    {
+        TestEnvironment env;
+        DependentsIndex index(&env, installed_ids(env, "unmerge", true));
+        EXPECT_EQ("cat/b cat/c cat/d", candidates(index, "cat/y"));
+    }
+
+    EXPECT_NE(std::string::npos, index_file_contents("unmerge").find("/cat/c-1\n"));
+
+    unmerge("unmerge", "c-1");
+
+    {
+        TestEnvironment env;
+        DependentsIndex index(&env, installed_ids(env, "unmerge", true));
+        EXPECT_EQ("cat/b cat/d", candidates(index, "cat/y"));
+    }
+
+    EXPECT_EQ(std::string::npos, index_file_contents("unmerge").find("/cat/c-1\n"));
+    EXPECT_NE(std::string::npos, index_file_contents("unmerge").find("/cat/a-1\n"));
+    EXPECT_NE(std::string::npos, index_file_contents("unmerge").find("/cat/b-1\n"));
+    EXPECT_NE(std::string::npos, index_file_contents("unmerge").find("/cat/d-1\n"));
+}
+
+namespace
+{
+    /* what Decider::_resolve_dependents finds, optionally only looking at
+     * the candidates the index gives it */
+    std::string dependents(const Environment * const env, const std::shared_ptr<const PackageIDSequence> & installed,
+            const std::string & going_away_names, const DependentsIndex * const index)
+    {
+        auto going_away(std::make_shared<ChangeByResolventSequence>());
+        auto staying(std::make_shared<PackageIDSequence>());
+        for (auto i(installed->begin()), i_end(installed->end()) ;
+                i != i_end ; ++i)
+            if (std::string::npos != (" " + going_away_names + " ").find(" " + stringify((*i)->name()) + " "))
+                going_away->push_back(make_named_values<ChangeByResolvent>(
+                            n::package_id() = *i,
+                            n::resolvent() = Resolvent(*i, dt_install_to_slash)));
+            else
+                staying->push_back(*i);
+
+        PackageIDSet candidates;
+        if (index)
+            for (auto g(going_away->begin()), g_end(going_away->end()) ;
+                    g != g_end ; ++g)
+            {
+                auto c(index->candidates(g->package_id()->name()));
+                std::copy(c->begin(), c->end(), candidates.inserter());
+            }
+
+        std::string result;
+        for (auto i(staying->begin()), i_end(staying->end()) ;
+                i != i_end ; ++i)
+        {
+            if (index && candidates.end() == candidates.find(*i))
+                continue;
+
+            if (dependent_upon(env, *i, going_away, std::make_shared<ChangeByResolventSequence>(), staying)->empty())
+                continue;
+
+            result.append((result.empty() ? "" : " ") + stringify((*i)->name()));
+        }
+
+        return result;
+    }
+}
+
+TEST(DependentsIndex, SameDependents)
+{
+    TestEnvironment env;
+    auto repo(std::make_shared<FakeInstalledRepository>(make_named_values<FakeInstalledRepositoryParams>(
+                    n::environment() = &env,
+                    n::name() = RepositoryName("installed"),
+                    n::suitable_destination() = true,
+                    n::supports_uninstall() = true
+                    )));
+    env.add_repository(1, repo);
+
+    repo->add_version("cat", "x", "1");
+    repo->add_version("cat", "y", "1");
+    repo->add_version("cat", "z", "1");
+    repo->add_version("cat", "a", "1")->run_dependencies_key()->set_from_string("cat/x");
+    repo->add_version("cat", "b", "1")->run_dependencies_key()->set_from_string("|| ( cat/x cat/y )");
+    repo->add_version("cat", "c", "1")->build_dependencies_key()->set_from_string("cat/y");
+    repo->add_version("cat", "d", "1")->run_dependencies_key()->set_from_string("!cat/z");
+    auto e(repo->add_version("cat", "e", "1"));
+    e->build_dependencies_key()->set_from_string("cat/z");
+    e->post_dependencies_key()->set_from_string("cat/a");
+    repo->add_version("cat", "f", "1")->run_dependencies_key()->set_from_string("cat/x cat/nothing");
+
+    auto installed(env[selection::AllVersionsSorted(generator::All())]);
+    DependentsIndex index(&env, installed);
+
+    EXPECT_EQ("cat/a cat/b cat/f", dependents(&env, installed, "cat/x", nullptr));
+    EXPECT_EQ("cat/a cat/b cat/c cat/f", dependents(&env, installed, "cat/x cat/y", nullptr));
+    EXPECT_EQ("cat/e", dependents(&env, installed, "cat/a", nullptr));
+
+    for (auto s : { "cat/x", "cat/y", "cat/z", "cat/a", "cat/x cat/y", "cat/x cat/z", "cat/a cat/b cat/c cat/x cat/y cat/z" })
+        EXPECT_EQ(dependents(&env, installed, s, nullptr), dependents(&env, installed, s, &index)) << s;
+}
@@ -0,0 +1,23 @@
+#!/usr/bin/env bash
+# vim: set ft=sh sw=4 sts=4 et :
+
+mkdir dependents_index_TEST_dir || exit 1
+cd dependents_index_TEST_dir || exit 1
+
+for t in candidates reuse unmerge ; do
+    mkdir -p ${t}/{build,names_cache}
+    mkdir -p ${t}/installed/cat/{a-1,b-1,c-1,d-1}
+
+    for p in a b c d ; do
+        echo "0" >${t}/installed/cat/${p}-1/EAPI
+        echo "0" >${t}/installed/cat/${p}-1/SLOT
+        touch ${t}/installed/cat/${p}-1/{DEPEND,PDEPEND,CONTENTS}
+    done
+
+    echo "cat/x" >${t}/installed/cat/a-1/RDEPEND
+    echo "|| ( cat/x cat/y ) foo? ( cat/z )" >${t}/installed/cat/b-1/RDEPEND
+    echo "!cat/x" >${t}/installed/cat/c-1/RDEPEND
+    echo "cat/y" >${t}/installed/cat/c-1/DEPEND
+    echo "|| ( cat/x" >${t}/installed/cat/d-1/RDEPEND
+done
+
@@ -32,6 +32,7 @@
 #include <paludis/util/enum_iterator.hh>
 #include <paludis/util/make_named_values.hh>
 #include <paludis/util/hashes.hh>
+#include <paludis/util/profiler.hh>
 
 #include <paludis/dep_spec.hh>
 #include <paludis/environment.hh>
@@ -303,6 +304,8 @@ GetResolventsForHelper::operator() (
     {
         std::unique_lock<std::mutex> lock(_imp->cache_mutex);
         auto c(_imp->cache.find(cache_key));
+        if (Profiler::enabled())
+            Profiler::get_instance()->add_cache_lookup("get_resolvents_for", _imp->cache.end() != c);
         if (_imp->cache.end() != c)
             return c->second;
     }
@@ -48,6 +48,7 @@
 #include <paludis/util/visitor_cast.hh>
 #include <paludis/util/tribool.hh>
 #include <paludis/util/enum_iterator.hh>
+#include <paludis/util/profiler.hh>
 
 #include <paludis/partially_made_package_dep_spec.hh>
 #include <paludis/environment.hh>
@@ -529,61 +530,72 @@ void
 Orderer::resolve()
 {
     Context context("When resolving ordering:");
+    ProfileTimer timer("orderer.resolve");
 
     _imp->env->trigger_notifier_callback(NotifierCallbackResolverStageEvent("Nodifying Decisions"));
 
     ResolventsSet ignore_dependencies_from_resolvents, ignore_edges_from_resolvents;
-    for (ResolutionsByResolvent::ConstIterator r(_imp->resolved->resolutions_by_resolvent()->begin()),
-            r_end(_imp->resolved->resolutions_by_resolvent()->end()) ;
-            r != r_end ; ++r)
     {
-        _imp->env->trigger_notifier_callback(NotifierCallbackResolverStepEvent());
-
-        DecisionDispatcher decision_dispatcher(
-                _imp->resolved,
-                ignore_dependencies_from_resolvents,
-                _imp->change_or_remove_indices,
-                (*r)->resolvent(),
-                (*r)->decision());
-        if (! (*r)->decision()->accept_returning<bool>(decision_dispatcher))
-            ignore_edges_from_resolvents.insert((*r)->resolvent());
+        ProfileTimer nodify_timer("orderer.nodify_decisions");
+        for (ResolutionsByResolvent::ConstIterator r(_imp->resolved->resolutions_by_resolvent()->begin()),
+                r_end(_imp->resolved->resolutions_by_resolvent()->end()) ;
+                r != r_end ; ++r)
+        {
+            _imp->env->trigger_notifier_callback(NotifierCallbackResolverStepEvent());
+
+            DecisionDispatcher decision_dispatcher(
+                    _imp->resolved,
+                    ignore_dependencies_from_resolvents,
+                    _imp->change_or_remove_indices,
+                    (*r)->resolvent(),
+                    (*r)->decision());
+            if (! (*r)->decision()->accept_returning<bool>(decision_dispatcher))
+                ignore_edges_from_resolvents.insert((*r)->resolvent());
+        }
     }
 
     _imp->env->trigger_notifier_callback(NotifierCallbackResolverStageEvent("Building NAG Edges"));
 
-    for (ResolutionsByResolvent::ConstIterator r(_imp->resolved->resolutions_by_resolvent()->begin()),
-            r_end(_imp->resolved->resolutions_by_resolvent()->end()) ;
-            r != r_end ; ++r)
     {
-        Context subcontext("When ordering '" + stringify((*r)->resolvent()) + "':");
+        ProfileTimer edges_timer("orderer.build_nag_edges");
+        for (ResolutionsByResolvent::ConstIterator r(_imp->resolved->resolutions_by_resolvent()->begin()),
+                r_end(_imp->resolved->resolutions_by_resolvent()->end()) ;
+                r != r_end ; ++r)
+        {
+            Context subcontext("When ordering '" + stringify((*r)->resolvent()) + "':");
 
-        _imp->env->trigger_notifier_callback(NotifierCallbackResolverStepEvent());
+            _imp->env->trigger_notifier_callback(NotifierCallbackResolverStepEvent());
 
-        if (ignore_edges_from_resolvents.end() != ignore_edges_from_resolvents.find((*r)->resolvent()))
-            continue;
+            if (ignore_edges_from_resolvents.end() != ignore_edges_from_resolvents.find((*r)->resolvent()))
+                continue;
 
-        _add_binary_cleverness(*r);
+            _add_binary_cleverness(*r);
 
-        EdgesFromReasonVisitor edges_from_reason_visitor(_imp->env, _imp->resolved->nag(), ignore_dependencies_from_resolvents, (*r)->resolvent(),
-                (*r)->decision(), std::bind(&Orderer::_role_for_fetching, this, std::placeholders::_1));
-        for (Constraints::ConstIterator c((*r)->constraints()->begin()),
-                c_end((*r)->constraints()->end()) ;
-                c != c_end ; ++c)
-        {
-            Context subsubcontext("When handling constraint '" + stringify((*c)->spec()) + "' with reason '" + stringify(*(*c)->reason()) + "':");
-            (*c)->reason()->accept(edges_from_reason_visitor);
+            EdgesFromReasonVisitor edges_from_reason_visitor(_imp->env, _imp->resolved->nag(), ignore_dependencies_from_resolvents, (*r)->resolvent(),
+                    (*r)->decision(), std::bind(&Orderer::_role_for_fetching, this, std::placeholders::_1));
+            for (Constraints::ConstIterator c((*r)->constraints()->begin()),
+                    c_end((*r)->constraints()->end()) ;
+                    c != c_end ; ++c)
+            {
+                Context subsubcontext("When handling constraint '" + stringify((*c)->spec()) + "' with reason '" + stringify(*(*c)->reason()) + "':");
+                (*c)->reason()->accept(edges_from_reason_visitor);
+            }
         }
-    }
 
-    _imp->resolved->nag()->verify_edges();
+        _imp->resolved->nag()->verify_edges();
+    }
 
     const std::function<Tribool (const NAGIndex &)> order_early_fn(std::bind(&Orderer::_order_early, this, std::placeholders::_1));
 
     _imp->env->trigger_notifier_callback(NotifierCallbackResolverStageEvent("Finding NAG SCCs"));
-    const std::shared_ptr<const SortedStronglyConnectedComponents> ssccs(
-            _imp->resolved->nag()->sorted_strongly_connected_components(order_early_fn));
+    std::shared_ptr<const SortedStronglyConnectedComponents> ssccs;
+    {
+        ProfileTimer scc_timer("orderer.find_sccs");
+        ssccs = _imp->resolved->nag()->sorted_strongly_connected_components(order_early_fn);
+    }
 
     _imp->env->trigger_notifier_callback(NotifierCallbackResolverStageEvent("Ordering SCCs"));
+    ProfileTimer order_timer("orderer.order_sccs");
     for (SortedStronglyConnectedComponents::ConstIterator scc(ssccs->begin()), scc_end(ssccs->end()) ;
             scc != scc_end ; ++scc)
     {
@@ -619,6 +631,10 @@ Orderer::resolve()
         else
         {
             Context sub_context("When considering only changes:");
+            ProfileTimer cycle_timer("orderer.order_cycle");
+            if (cycle_timer.active())
+                cycle_timer.set_subject(stringify(changes_in_scc.size()) + " changes including '"
+                        + stringify(_imp->change_or_remove_indices.find(*changes_in_scc.begin())->second->resolvent()) + "'");
 
             /* whoop de doo. what do our SCCs look like if we only count change
              * or remove nodes? */
@@ -35,6 +35,7 @@
 #include <paludis/util/make_shared_copy.hh>
 #include <paludis/util/indirect_iterator-impl.hh>
 #include <paludis/util/pimp-impl.hh>
+#include <paludis/util/profiler.hh>
 #include <paludis/environment.hh>
 #include <paludis/notifier_callback.hh>
 #include <paludis/spec_tree.hh>
@@ -165,9 +166,16 @@ Resolver::purge()
     _imp->decider->purge();
 }
 
+void
+Resolver::set_decision_cache(const std::shared_ptr<DecisionCache> & c)
+{
+    _imp->decider->set_decision_cache(c);
+}
+
 void
 Resolver::resolve()
 {
+    ProfileTimer timer("resolver.resolve");
     _imp->decider->resolve();
     _imp->orderer->resolve();
     _imp->env->trigger_notifier_callback(NotifierCallbackResolverStageEvent("Done"));
@@ -24,6 +24,7 @@
 #include <paludis/resolver/reason-fwd.hh>
 #include <paludis/resolver/resolver_functions-fwd.hh>
 #include <paludis/resolver/decider-fwd.hh>
+#include <paludis/resolver/decision_cache-fwd.hh>
 #include <paludis/resolver/resolved-fwd.hh>
 #include <paludis/resolver/sanitised_dependencies-fwd.hh>
 #include <paludis/resolver/package_or_block_dep_spec-fwd.hh>
@@ -57,6 +58,12 @@ namespace paludis
                 void add_target(const SetName &, const std::string & extra_information);
                 void purge();
 
+                /**
+                 * Reuse earlier decisions from, and store new decisions
+                 * in, this cache.
+                 */
+                void set_decision_cache(const std::shared_ptr<DecisionCache> &);
+
                 void resolve();
 
                 const std::shared_ptr<const Resolved> resolved() const PALUDIS_ATTRIBUTE((warn_unused_result));
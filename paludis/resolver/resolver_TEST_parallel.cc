@@ -0,0 +1,166 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2026 agent
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <paludis/resolver/resolver.hh>
+#include <paludis/resolver/resolver_functions.hh>
+#include <paludis/resolver/resolution.hh>
+#include <paludis/resolver/resolved.hh>
+#include <paludis/resolver/decision.hh>
+#include <paludis/resolver/decisions.hh>
+#include <paludis/resolver/constraint.hh>
+#include <paludis/resolver/resolvent.hh>
+#include <paludis/resolver/suggest_restart.hh>
+
+#include <paludis/environments/test/test_environment.hh>
+
+#include <paludis/util/make_named_values.hh>
+#include <paludis/util/options.hh>
+#include <paludis/util/wrapped_forward_iterator-impl.hh>
+#include <paludis/util/sequence.hh>
+#include <paludis/util/map.hh>
+#include <paludis/util/indirect_iterator-impl.hh>
+#include <paludis/util/make_shared_copy.hh>
+#include <paludis/util/visitor_cast.hh>
+#include <paludis/util/task_scheduler.hh>
+#include <paludis/util/stringify.hh>
+
+#include <paludis/user_dep_spec.hh>
+#include <paludis/repository_factory.hh>
+#include <paludis/package_id.hh>
+
+#include <paludis/resolver/resolver_test.hh>
+
+#include <list>
+#include <functional>
+#include <algorithm>
+#include <map>
+
+#include <stdlib.h>
+
+using namespace paludis;
+using namespace paludis::resolver;
+using namespace paludis::resolver::resolver_test;
+
+namespace
+{
+    struct ResolverParallelTestCase : ResolverTestCase
+    {
+        std::shared_ptr<ResolverTestData> data;
+
+        /* the scheduler reads this when it is first used, and candidates are
+         * only checked in parallel if it allows more than one job. the
+         * expected results are what checking the candidates one at a time,
+         * best first, gives. */
+        static void SetUpTestCase()
+        {
+            ::setenv("PALUDIS_JOBS", "4", 1);
+        }
+
+        void SetUp() override
+        {
+            ASSERT_LT(1u, TaskScheduler::get_instance()->concurrency());
+            data = std::make_shared<ResolverTestData>("parallel", "exheres-0", "exheres");
+        }
+
+        void TearDown() override
+        {
+            data.reset();
+        }
+
+        std::string chosen_version(const std::shared_ptr<const Resolved> & resolved, const QualifiedPackageName & q)
+        {
+            for (auto d(resolved->taken_change_or_remove_decisions()->begin()),
+                    d_end(resolved->taken_change_or_remove_decisions()->end()) ;
+                    d != d_end ; ++d)
+            {
+                auto c(visitor_cast<const ChangesToMakeDecision>(*d->first));
+                if (c && c->resolvent().package() == q)
+                    return stringify(c->origin_id()->version());
+            }
+
+            return "";
+        }
+    };
+}
+
+TEST_F(ResolverParallelTestCase, LowestSuitable)
+{
+    std::shared_ptr<const Resolved> resolved(data->get_resolved("lowest-suitable/target"));
+
+    this->check_resolved(resolved,
+            n::taken_change_or_remove_decisions() = make_shared_copy(DecisionChecks()
+                .change(QualifiedPackageName("lowest-suitable/dep"))
+                .change(QualifiedPackageName("lowest-suitable/target"))
+                .finished()),
+            n::taken_unable_to_make_decisions() = make_shared_copy(DecisionChecks()
+                .finished()),
+            n::taken_unconfirmed_decisions() = make_shared_copy(DecisionChecks()
+                .change(QualifiedPackageName("lowest-suitable/dep"))
+                .finished()),
+            n::taken_unorderable_decisions() = make_shared_copy(DecisionChecks()
+                .finished()),
+            n::untaken_change_or_remove_decisions() = make_shared_copy(DecisionChecks()
+                .finished()),
+            n::untaken_unable_to_make_decisions() = make_shared_copy(DecisionChecks()
+                .finished())
+            );
+
+    EXPECT_EQ("1", chosen_version(resolved, QualifiedPackageName("lowest-suitable/dep")));
+}
+
+TEST_F(ResolverParallelTestCase, Throws)
+{
+    /* dep-3 is broken too, but checking in order would never get that far */
+    try
+    {
+        std::shared_ptr<const Resolved> resolved(data->get_resolved("throws/target"));
+        FAIL() << "expected an exception";
+    }
+    catch (const Exception & e)
+    {
+        EXPECT_NE(std::string::npos, e.backtrace("\n").find("'throws/dep-6:0::repo'")) << e.backtrace("\n");
+        EXPECT_EQ(std::string::npos, e.backtrace("\n").find("'throws/dep-3:0::repo'")) << e.backtrace("\n");
+    }
+}
+
+TEST_F(ResolverParallelTestCase, ThrowsUnreached)
+{
+    /* dep-2 is broken, but dep-6 is suitable and is checked first */
+    std::shared_ptr<const Resolved> resolved(data->get_resolved("throws-unreached/target"));
+
+    this->check_resolved(resolved,
+            n::taken_change_or_remove_decisions() = make_shared_copy(DecisionChecks()
+                .change(QualifiedPackageName("throws-unreached/dep"))
+                .change(QualifiedPackageName("throws-unreached/target"))
+                .finished()),
+            n::taken_unable_to_make_decisions() = make_shared_copy(DecisionChecks()
+                .finished()),
+            n::taken_unconfirmed_decisions() = make_shared_copy(DecisionChecks()
+                .change(QualifiedPackageName("throws-unreached/dep"))
+                .finished()),
+            n::taken_unorderable_decisions() = make_shared_copy(DecisionChecks()
+                .finished()),
+            n::untaken_change_or_remove_decisions() = make_shared_copy(DecisionChecks()
+                .finished()),
+            n::untaken_unable_to_make_decisions() = make_shared_copy(DecisionChecks()
+                .finished())
+            );
+
+    EXPECT_EQ("6", chosen_version(resolved, QualifiedPackageName("throws-unreached/dep")));
+}
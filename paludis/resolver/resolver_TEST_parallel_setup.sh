@@ -0,0 +1,101 @@
+#!/usr/bin/env bash
+# vim: set ft=sh sw=4 sts=4 et :
+
+mkdir resolver_TEST_parallel_dir || exit 1
+cd resolver_TEST_parallel_dir || exit 1
+
+mkdir -p build
+mkdir -p distdir
+mkdir -p installed
+
+mkdir -p repo/{profiles/profile,metadata}
+
+cd repo
+echo "repo" > profiles/repo_name
+:> metadata/categories.conf
+
+# lowest-suitable
+echo 'lowest-suitable' >> metadata/categories.conf
+
+mkdir -p 'packages/lowest-suitable/target'
+cat <<END > packages/lowest-suitable/target/target-1.exheres-0
+SUMMARY="target"
+PLATFORMS="test"
+SLOT="0"
+DEPENDENCIES="build: lowest-suitable/dep[<2]"
+END
+
+mkdir -p 'packages/lowest-suitable/dep'
+for v in 1 2 3 4 5 6 7 8 9 10 ; do
+cat <<END > packages/lowest-suitable/dep/dep-${v}.exheres-0
+SUMMARY="dep"
+PLATFORMS="test"
+SLOT="0"
+DEPENDENCIES=""
+END
+done
+
+# throws
+echo 'throws' >> metadata/categories.conf
+
+mkdir -p 'packages/throws/target'
+cat <<END > packages/throws/target/target-1.exheres-0
+SUMMARY="target"
+PLATFORMS="test"
+SLOT="0"
+DEPENDENCIES="build: throws/dep[<7][enabled]"
+END
+
+mkdir -p 'packages/throws/dep'
+for v in 1 2 4 5 7 8 9 10 ; do
+cat <<END > packages/throws/dep/dep-${v}.exheres-0
+SUMMARY="dep"
+PLATFORMS="test"
+SLOT="0"
+MYOPTIONS="enabled"
+DEPENDENCIES=""
+END
+done
+
+for v in 3 6 ; do
+cat <<END > packages/throws/dep/dep-${v}.exheres-0
+SUMMARY="dep"
+PLATFORMS="test"
+SLOT="0"
+MYOPTIONS="( enabled"
+DEPENDENCIES=""
+END
+done
+
+# throws-unreached
+echo 'throws-unreached' >> metadata/categories.conf
+
+mkdir -p 'packages/throws-unreached/target'
+cat <<END > packages/throws-unreached/target/target-1.exheres-0
+SUMMARY="target"
+PLATFORMS="test"
+SLOT="0"
+DEPENDENCIES="build: throws-unreached/dep[<7][enabled]"
+END
+
+mkdir -p 'packages/throws-unreached/dep'
+for v in 1 3 4 5 6 7 8 9 10 ; do
+cat <<END > packages/throws-unreached/dep/dep-${v}.exheres-0
+SUMMARY="dep"
+PLATFORMS="test"
+SLOT="0"
+MYOPTIONS="enabled"
+DEPENDENCIES=""
+END
+done
+
+cat <<END > packages/throws-unreached/dep/dep-2.exheres-0
+SUMMARY="dep"
+PLATFORMS="test"
+SLOT="0"
+MYOPTIONS="( enabled"
+DEPENDENCIES=""
+END
+
+cd ..
+
@@ -24,6 +24,7 @@
 #include <paludis/resolver/constraint.hh>
 #include <paludis/resolver/resolvent.hh>
 #include <paludis/resolver/suggest_restart.hh>
+#include <paludis/resolver/decision_cache.hh>
 
 #include <paludis/environments/test/test_environment.hh>
 
@@ -34,6 +35,8 @@
 #include <paludis/util/map.hh>
 #include <paludis/util/indirect_iterator-impl.hh>
 #include <paludis/util/make_shared_copy.hh>
+#include <paludis/util/fs_path.hh>
+#include <paludis/util/fs_stat.hh>
 
 #include <paludis/user_dep_spec.hh>
 #include <paludis/repository_factory.hh>
@@ -159,3 +162,41 @@ TEST_F(ResolverSimpleTestCase, PostDeps)
             );
 }
 
+
+TEST_F(ResolverSimpleTestCase, DecisionCache)
+{
+    FSPath cache_file(FSPath::cwd() / "resolver_TEST_simple_dir" / "decision-cache");
+
+    for (int pass(0) ; pass < 2 ; ++pass)
+    {
+        data->decision_cache = std::make_shared<DecisionCache>(&data->env, cache_file, "");
+        std::shared_ptr<const Resolved> resolved(data->get_resolved("build-deps/target"));
+        data->decision_cache->save();
+        EXPECT_TRUE(cache_file.stat().is_regular_file());
+
+        /* the second pass should be made entirely of things from the first */
+        if (0 == pass)
+            EXPECT_EQ(0u, data->decision_cache->hits());
+        else
+            EXPECT_EQ(4u, data->decision_cache->hits());
+
+        this->check_resolved(resolved,
+                n::taken_change_or_remove_decisions() = make_shared_copy(DecisionChecks()
+                    .change(QualifiedPackageName("build-deps/a-dep"))
+                    .change(QualifiedPackageName("build-deps/b-dep"))
+                    .change(QualifiedPackageName("build-deps/z-dep"))
+                    .change(QualifiedPackageName("build-deps/target"))
+                    .finished()),
+                n::taken_unable_to_make_decisions() = make_shared_copy(DecisionChecks()
+                    .finished()),
+                n::taken_unconfirmed_decisions() = make_shared_copy(DecisionChecks()
+                    .finished()),
+                n::taken_unorderable_decisions() = make_shared_copy(DecisionChecks()
+                    .finished()),
+                n::untaken_change_or_remove_decisions() = make_shared_copy(DecisionChecks()
+                    .finished()),
+                n::untaken_unable_to_make_decisions() = make_shared_copy(DecisionChecks()
+                    .finished())
+                );
+    }
+}
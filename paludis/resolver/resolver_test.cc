@@ -202,6 +202,8 @@ ResolverTestData::get_resolved(const PackageOrBlockDepSpec & target)
         try
         {
             Resolver resolver(&env, get_resolver_functions());
+            if (decision_cache)
+                resolver.set_decision_cache(decision_cache);
             resolver.add_target(target, "");
             resolver.resolve();
             return resolver.resolved();
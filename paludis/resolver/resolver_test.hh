@@ -60,6 +60,7 @@
 #include <paludis/resolver/remove_if_dependent_helper.hh>
 #include <paludis/resolver/prefer_or_avoid_helper.hh>
 #include <paludis/resolver/promote_binaries_helper.hh>
+#include <paludis/resolver/decision_cache-fwd.hh>
 
 #include <paludis/repositories/fake/fake_installed_repository.hh>
 #include <paludis/repositories/fake/fake_package_id.hh>
@@ -120,6 +121,8 @@ namespace paludis
                 RemoveIfDependentHelper remove_if_dependent_helper;
                 GetResolventsForHelper get_resolvents_for_helper;
 
+                std::shared_ptr<DecisionCache> decision_cache;
+
                 ResolverTestData(const std::string & group, const std::string & eapi, const std::string & layout);
 
                 ResolverFunctions get_resolver_functions();
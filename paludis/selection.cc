@@ -41,6 +41,7 @@
 #include <algorithm>
 #include <functional>
 #include <map>
+#include <vector>
 
 using namespace paludis;
 
@@ -107,6 +108,47 @@ namespace
             return "(none)";
     }
 
+    typedef std::map<QualifiedPackageName, unsigned> NameOrder;
+
+    struct SortKey
+    {
+        NameOrder::const_iterator name;
+        VersionSpec version;
+        unsigned rank;
+        std::shared_ptr<const PackageID> id;
+    };
+
+    /* orders IDs the same way as PackageIDComparator, but fetches each ID's
+     * name, version and repository rank once, rather than on every
+     * comparison, and compares names as integers */
+    void sort_ids(const Environment * const env, const PackageIDSet & ids, PackageIDSequence & result)
+    {
+        NameOrder names;
+        std::vector<SortKey> keys;
+        for (const auto & id : ids)
+            keys.push_back(SortKey{ names.insert(std::make_pair(id->name(), 0)).first, id->version(),
+                    env->repository_rank(id->repository_name()), id });
+
+        unsigned n(0);
+        for (auto & name : names)
+            name.second = n++;
+
+        std::stable_sort(keys.begin(), keys.end(), [] (const SortKey & a, const SortKey & b) -> bool {
+                if (a.name->second != b.name->second)
+                    return a.name->second < b.name->second;
+                if (a.version < b.version)
+                    return true;
+                if (b.version < a.version)
+                    return false;
+                if (a.rank != b.rank)
+                    return a.rank < b.rank;
+                return a.id->arbitrary_less_than_comparison(*b.id);
+                });
+
+        for (const auto & key : keys)
+            result.push_back(key.id);
+    }
+
     class SomeArbitraryVersionSelectionHandler :
         public SelectionHandler
     {
@@ -229,8 +271,7 @@ namespace
                     return result;
 
                 std::shared_ptr<const PackageIDSet> i(_fg.filter().ids(env, _fg.generator().ids(env, r, p, may_excludes)));
-                std::copy(i->begin(), i->end(), result->back_inserter());
-                result->sort(PackageIDComparator(env));
+                sort_ids(env, *i, *result);
 
                 return result;
             }
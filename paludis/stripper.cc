@@ -25,14 +25,19 @@
 #include <paludis/util/stringify.hh>
 #include <paludis/util/log.hh>
 #include <paludis/util/process.hh>
-#include <paludis/util/fs_iterator.hh>
+#include <paludis/util/fs_dir_walker.hh>
 #include <paludis/util/fs_stat.hh>
 #include <paludis/util/options.hh>
 #include <paludis/util/singleton-impl.hh>
+#include <paludis/util/thread_pool.hh>
 #include <functional>
 #include <sstream>
 #include <list>
 #include <set>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
 #include <algorithm>
 #include <sys/stat.h>
 
@@ -116,6 +121,74 @@ namespace
     };
 }
 
+namespace
+{
+    /**
+     * Run work for each of count items using up to jobs threads. Errors are
+     * rethrown once everything has finished, first item first.
+     */
+    void run_jobs(
+            const unsigned jobs,
+            const std::size_t count,
+            const std::function<void (std::size_t)> & work)
+    {
+        const std::size_t threads(std::min<std::size_t>(jobs, count));
+        if (threads <= 1)
+        {
+            for (std::size_t i(0) ; i != count ; ++i)
+                work(i);
+            return;
+        }
+
+        std::mutex mutex;
+        std::size_t next(0);
+        std::vector<std::exception_ptr> errors(count);
+
+        {
+            ThreadPool pool;
+            for (std::size_t t(0) ; t != threads ; ++t)
+                pool.create_thread([&] () noexcept {
+                        while (true)
+                        {
+                            std::size_t i;
+                            {
+                                std::unique_lock<std::mutex> lock(mutex);
+                                if (next == count)
+                                    return;
+                                i = next++;
+                            }
+
+                            try
+                            {
+                                work(i);
+                            }
+                            catch (...)
+                            {
+                                errors[i] = std::current_exception();
+                            }
+                        }
+                    });
+        }
+
+        for (auto & e : errors)
+            if (e)
+                std::rethrow_exception(e);
+    }
+
+    enum StripStepKind
+    {
+        ssk_enter_dir,
+        ssk_leave_dir,
+        ssk_file
+    };
+
+    struct StripStep
+    {
+        StripStepKind kind;
+        FSPath path;
+    };
+}
+
 namespace paludis
 {
     template <>
@@ -123,29 +196,92 @@ namespace paludis
     {
         StripperOptions options;
         StrippedSet stripped_ids;
-        PaludisStripperExtras * stripper_extras;
+
+        /* the image walk, in order, so that the on_ callbacks can be made
+         * in the usual order once the parallel work is done */
+        std::vector<StripStep> steps;
+        std::vector<FSPath> candidates;
+
+        /* libmagic handles aren't thread safe, so each concurrent file_type
+         * call gets its own, created on demand */
+        std::mutex extras_mutex;
+        std::condition_variable extras_condition;
+        std::vector<PaludisStripperExtras *> idle_extras;
+        unsigned number_of_extras;
+        bool can_make_more_extras;
 
         Imp(const StripperOptions & o) :
             options(o),
-            stripper_extras(nullptr)
+            number_of_extras(0),
+            can_make_more_extras(false)
         {
             try
             {
                 if (StripperHandle::get_instance()->handle)
-                    stripper_extras = StripperHandle::get_instance()->init();
+                {
+                    idle_extras.push_back(StripperHandle::get_instance()->init());
+                    number_of_extras = 1;
+                    can_make_more_extras = true;
+                }
             }
             catch (const StripperError & e)
             {
                 Log::get_instance()->message("strip.broken", ll_warning, lc_context)
                     << "Got error '" << e.message() << "' (" << e.what() << ") when attempting to strip";
-                stripper_extras = nullptr;
             }
         }
 
         ~Imp()
         {
-            if (stripper_extras)
-                StripperHandle::get_instance()->cleanup(stripper_extras);
+            for (auto & e : idle_extras)
+                StripperHandle::get_instance()->cleanup(e);
+        }
+
+        PaludisStripperExtras * acquire_extras()
+        {
+            std::unique_lock<std::mutex> lock(extras_mutex);
+            while (true)
+            {
+                if (0 == number_of_extras)
+                    return nullptr;
+
+                if (! idle_extras.empty())
+                {
+                    PaludisStripperExtras * result(idle_extras.back());
+                    idle_extras.pop_back();
+                    return result;
+                }
+
+                if (can_make_more_extras)
+                {
+                    ++number_of_extras;
+                    lock.unlock();
+                    try
+                    {
+                        return StripperHandle::get_instance()->init();
+                    }
+                    catch (const StripperError & e)
+                    {
+                        Log::get_instance()->message("strip.extras", ll_debug, lc_context)
+                            << "Got error '" << e.message() << "' when creating another magic handle, sharing existing ones instead";
+                    }
+                    lock.lock();
+                    --number_of_extras;
+                    can_make_more_extras = false;
+                    continue;
+                }
+
+                extras_condition.wait(lock);
+            }
+        }
+
+        void release_extras(PaludisStripperExtras * const e)
+        {
+            {
+                std::unique_lock<std::mutex> lock(extras_mutex);
+                idle_extras.push_back(e);
+            }
+            extras_condition.notify_one();
         }
     };
 }
@@ -157,6 +293,27 @@ Stripper::Stripper(const StripperOptions & options) :
 
 Stripper::~Stripper() = default;
 
+namespace
+{
+    enum StripKind
+    {
+        sk_binary,
+        sk_archive,
+        sk_unknown
+    };
+
+    StripKind strip_kind(const std::string & t)
+    {
+        if (std::string::npos != t.find("SB executable") || std::string::npos != t.find("SB shared object") ||
+                std::string::npos != t.find("SB pie executable"))
+            return sk_binary;
+        else if (std::string::npos != t.find("current ar archive"))
+            return sk_archive;
+        else
+            return sk_unknown;
+    }
+}
+
 void
 Stripper::strip()
 {
@@ -165,7 +322,79 @@ Stripper::strip()
     if (! _imp->options.strip())
         return;
 
+    _imp->steps.clear();
+    _imp->candidates.clear();
     do_dir_recursive(_imp->options.image_dir());
+
+    const std::size_t count(_imp->candidates.size());
+    std::vector<StripKind> kinds(count, sk_unknown);
+
+    auto split_target([&] (const FSPath & f) {
+            FSPath target(_imp->options.debug_dir() / f.strip_leading(_imp->options.image_dir()));
+            return target.dirname() / (target.basename() + ".debug");
+            });
+
+    run_jobs(_imp->options.jobs(), count,
+            [&] (std::size_t i) {
+                const FSPath & f(_imp->candidates[i]);
+                kinds[i] = strip_kind(file_type(f));
+                switch (kinds[i])
+                {
+                    case sk_binary:
+                        if (_imp->options.dwarf_compression())
+                            do_dwarf_compress(f);
+                        if (_imp->options.split())
+                            do_split(f, split_target(f));
+                        do_strip(f, "");
+                        break;
+
+                    case sk_archive:
+                        do_strip(f, "-g");
+                        break;
+
+                    case sk_unknown:
+                        break;
+                }
+            });
+
+    std::size_t i(0);
+    for (const auto & step : _imp->steps)
+    {
+        switch (step.kind)
+        {
+            case ssk_enter_dir:
+                on_enter_dir(step.path);
+                continue;
+
+            case ssk_leave_dir:
+                on_leave_dir(step.path);
+                continue;
+
+            case ssk_file:
+                switch (kinds[i++])
+                {
+                    case sk_binary:
+                        if (_imp->options.dwarf_compression())
+                            on_dwarf_compress(step.path);
+                        if (_imp->options.split())
+                            on_split(step.path, split_target(step.path));
+                        on_strip(step.path);
+                        break;
+
+                    case sk_archive:
+                        on_strip(step.path);
+                        break;
+
+                    case sk_unknown:
+                        on_unknown(step.path);
+                        break;
+                }
+                continue;
+        }
+    }
+
+    _imp->steps.clear();
+    _imp->candidates.clear();
 }
 
 void
@@ -176,51 +405,32 @@ Stripper::do_dir_recursive(const FSPath & f)
     if (f == _imp->options.debug_dir())
         return;
 
-    on_enter_dir(f);
-
-    for (FSIterator d(f, { fsio_include_dotfiles, fsio_inode_sort }), d_end ; d != d_end ; ++d)
-    {
-        FSStat d_stat(*d);
+    _imp->steps.push_back(StripStep{ ssk_enter_dir, f });
 
-        if (d_stat.is_symlink())
-            continue;
-        if (_imp->stripped_ids.end() != _imp->stripped_ids.find(d_stat.lowlevel_id()))
-            continue;
+    FSDirWalker(f).walk({ fsio_include_dotfiles, fsio_inode_sort }, [&] (const FSDirEntry & d) {
+            if (d.is_directory())
+                do_dir_recursive(d.path());
 
-        if (d_stat.is_directory())
-            do_dir_recursive(*d);
-
-        else if (d_stat.is_regular_file())
-        {
-            if ((0 != (d_stat.permissions() & (S_IXUSR | S_IXGRP | S_IXOTH))) ||
-                    (std::string::npos != d->basename().find(".so.")) ||
-                    (d->basename() != strip_trailing_string(d->basename(), ".so")))
+            else if (d.is_regular_file())
             {
-                std::string t(file_type(*d));
-                if (std::string::npos != t.find("SB executable") || std::string::npos != t.find("SB shared object") ||
-                                std::string::npos != t.find("SB pie executable"))
+                FSStat d_stat(d.stat());
+                std::string basename(d.name_string());
+
+                if ((0 != (d_stat.permissions() & (S_IXUSR | S_IXGRP | S_IXOTH))) ||
+                        (std::string::npos != basename.find(".so.")) ||
+                        (basename != strip_trailing_string(basename, ".so")))
                 {
-                    if (_imp->options.dwarf_compression())
-                        do_dwarf_compress(*d);
-                    if (_imp->options.split())
+                    /* only strip one name for each hard linked file */
+                    if (_imp->stripped_ids.insert(d_stat.lowlevel_id()).second)
                     {
-                        FSPath target(_imp->options.debug_dir() / d->strip_leading(_imp->options.image_dir()));
-                        target = target.dirname() / (target.basename() + ".debug");
-                        do_split(*d, target);
+                        _imp->steps.push_back(StripStep{ ssk_file, d.path() });
+                        _imp->candidates.push_back(d.path());
                     }
-                    do_strip(*d, "");
-                }
-                else if (std::string::npos != t.find("current ar archive"))
-                {
-                    do_strip(*d, "-g");
                 }
-                else
-                    on_unknown(*d);
             }
-        }
-    }
+        });
 
-    on_leave_dir(f);
+    _imp->steps.push_back(StripStep{ ssk_leave_dir, f });
 }
 
 std::string
@@ -228,36 +438,43 @@ Stripper::file_type(const FSPath & f)
 {
     Context context("When finding the file type of '" + stringify(f) + "':");
 
-    if (_imp->stripper_extras)
+    PaludisStripperExtras * const extras(_imp->acquire_extras());
+    if (! extras)
+        return "";
+
+    std::string result;
+    try
     {
-        std::string result(StripperHandle::get_instance()->lookup(_imp->stripper_extras, stringify(f)));
-        Log::get_instance()->message("strip.type", ll_debug, lc_context)
-            << "Magic says '" << f << "' is '" << result << "'";
-        return result;
+        result = StripperHandle::get_instance()->lookup(extras, stringify(f));
     }
-    else
-        return "";
+    catch (...)
+    {
+        _imp->release_extras(extras);
+        throw;
+    }
+    _imp->release_extras(extras);
+
+    Log::get_instance()->message("strip.type", ll_debug, lc_context)
+        << "Magic says '" << f << "' is '" << result << "'";
+    return result;
 }
 
 void
 Stripper::do_strip(const FSPath & f, const std::string & options)
 {
     Context context("When stripping '" + stringify(f) + "':");
-    on_strip(f);
 
     Process strip_process(options.empty() ?
             ProcessCommand({ "strip", stringify(f) }) :
             ProcessCommand({ "strip", options, stringify(f) }));
     if (0 != strip_process.run().wait())
         Log::get_instance()->message("strip.failure", ll_warning, lc_context) << "Couldn't strip '" << f << "'";
-    _imp->stripped_ids.insert(f.stat().lowlevel_id());
 }
 
 void
 Stripper::do_split(const FSPath & f, const FSPath & g)
 {
     Context context("When splitting '" + stringify(f) + "' to '" + stringify(g) + "':");
-    on_split(f, g);
 
     {
         std::list<FSPath> to_make;
@@ -288,8 +505,6 @@ Stripper::do_dwarf_compress(const FSPath & f)
 {
     Context context("When compressing DWARF information for '" + stringify(f) + "'");
 
-    on_dwarf_compress(f);
-
     Process dwz_process(ProcessCommand({ "dwz", /* quiet => */ "-q", stringify(f) }));
     if (dwz_process.run().wait() != 0)
         Log::get_instance()->message("strip.failure", ll_warning, lc_context)
@@ -36,6 +36,7 @@ namespace paludis
         typedef Name<struct name_debug_dir> debug_dir;
         typedef Name<struct name_dwarf_compression> dwarf_compression;
         typedef Name<struct name_image_dir> image_dir;
+        typedef Name<struct name_jobs> jobs;
         typedef Name<struct name_split> split;
         typedef Name<struct name_strip> strip;
     }
@@ -46,6 +47,15 @@ namespace paludis
         NamedValue<n::debug_dir, FSPath> debug_dir;
         NamedValue<n::dwarf_compression, bool> dwarf_compression;
         NamedValue<n::image_dir, FSPath> image_dir;
+
+        /**
+         * How many files to classify and strip at once. Zero or one means
+         * work serially.
+         *
+         * \since 3.0
+         */
+        NamedValue<n::jobs, unsigned> jobs;
+
         NamedValue<n::split, bool> split;
         NamedValue<n::strip, bool> strip;
     };
@@ -71,10 +81,25 @@ namespace paludis
             virtual void on_dwarf_compress(const FSPath &) = 0;
             virtual void on_unknown(const FSPath &) = 0;
 
+            /**
+             * Walk the image, remembering every directory entered and left
+             * and every file which might need stripping. Nothing is stripped
+             * and no on_ function is called until the walk is complete.
+             */
             virtual void do_dir_recursive(const FSPath &);
 
+            /**
+             * Find the type of a file. May be called from several threads
+             * at once.
+             */
             virtual std::string file_type(const FSPath &);
 
+            /**
+             * The do_ functions may be called from several threads at once.
+             * Once they have all finished, the on_ functions are called, in
+             * image order, from the thread which called strip().
+             */
+
             virtual void do_split(const FSPath &, const FSPath &);
             virtual void do_strip(const FSPath &, const std::string &);
             virtual void do_dwarf_compress(const FSPath &);
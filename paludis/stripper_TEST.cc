@@ -23,9 +23,13 @@
 
 #include <paludis/util/fs_stat.hh>
 #include <paludis/util/make_named_values.hh>
+#include <paludis/util/stringify.hh>
 
 #include <gtest/gtest.h>
 
+#include <vector>
+#include <string>
+
 using namespace paludis;
 
 namespace
@@ -33,21 +37,27 @@ namespace
     struct TestStripper :
         Stripper
     {
-        void on_enter_dir(const FSPath &) override
+        std::vector<std::string> actions;
+
+        void on_enter_dir(const FSPath & f) override
         {
+            actions.push_back("enter " + f.basename());
         }
 
-        void on_leave_dir(const FSPath &) override
+        void on_leave_dir(const FSPath & f) override
         {
+            actions.push_back("leave " + f.basename());
         }
 
 
-        void on_strip(const FSPath &) override
+        void on_strip(const FSPath & f) override
         {
+            actions.push_back("strip " + f.basename());
         }
 
-        void on_split(const FSPath &, const FSPath &) override
+        void on_split(const FSPath & f, const FSPath &) override
         {
+            actions.push_back("split " + f.basename());
         }
 
         void on_dwarf_compress(const FSPath &) override
@@ -72,6 +82,7 @@ TEST(Stripper, Works)
                 n::debug_dir() = FSPath("stripper_TEST_dir/image").realpath() / "usr" / "lib" / "debug",
                 n::dwarf_compression() = false,
                 n::image_dir() = FSPath("stripper_TEST_dir/image").realpath(),
+                n::jobs() = 1,
                 n::split() = true,
                 n::strip() = true
             ));
@@ -80,3 +91,38 @@ TEST(Stripper, Works)
     ASSERT_TRUE(FSPath("stripper_TEST_dir/image/usr/lib/debug/usr/bin/stripper_TEST_binary.debug").stat().is_regular_file());
 }
 
+
+TEST(Stripper, Parallel)
+{
+    TestStripper s(make_named_values<StripperOptions>(
+                n::compress_splits() = false,
+                n::debug_dir() = FSPath("stripper_TEST_dir/parallel").realpath() / "usr" / "lib" / "debug",
+                n::dwarf_compression() = false,
+                n::image_dir() = FSPath("stripper_TEST_dir/parallel").realpath(),
+                n::jobs() = 4,
+                n::split() = true,
+                n::strip() = true
+            ));
+    s.strip();
+
+    FSPath debug("stripper_TEST_dir/parallel/usr/lib/debug/usr/bin");
+    for (int i(2) ; i <= 8 ; ++i)
+        EXPECT_TRUE((debug / ("binary_" + stringify(i) + ".debug")).stat().is_regular_file());
+
+    /* binary_1 and linked are the same file, so only one of them gets split */
+    EXPECT_NE((debug / "binary_1.debug").stat().exists(), (debug / "linked.debug").stat().exists());
+
+    /* callbacks come in walk order, with each file inside its directory */
+    ASSERT_EQ(22u, s.actions.size());
+    EXPECT_EQ("enter parallel", s.actions[0]);
+    EXPECT_EQ("enter usr", s.actions[1]);
+    EXPECT_EQ("enter bin", s.actions[2]);
+    EXPECT_EQ("leave bin", s.actions[19]);
+    EXPECT_EQ("leave usr", s.actions[20]);
+    EXPECT_EQ("leave parallel", s.actions[21]);
+    for (unsigned i(3) ; i < 19 ; i += 2)
+    {
+        ASSERT_EQ(0u, s.actions[i].find("split "));
+        EXPECT_EQ("strip " + s.actions[i].substr(6), s.actions[i + 1]);
+    }
+}
@@ -7,3 +7,9 @@ cd stripper_TEST_dir || exit 3
 mkdir -p image/usr/bin || exit 5
 cp ../stripper_TEST_binary image/usr/bin || exit 6
 
+
+mkdir -p parallel/usr/bin || exit 7
+for i in 1 2 3 4 5 6 7 8 ; do
+    cp ../stripper_TEST_binary parallel/usr/bin/binary_${i} || exit 8
+done
+ln parallel/usr/bin/binary_1 parallel/usr/bin/linked || exit 9
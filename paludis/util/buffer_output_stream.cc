@@ -19,7 +19,6 @@
 
 #include <paludis/util/buffer_output_stream.hh>
 #include <paludis/util/pimp-impl.hh>
-#include <list>
 #include <string>
 #include <mutex>
 
@@ -27,15 +26,21 @@ using namespace paludis;
 
 namespace paludis
 {
+    /* Output goes into one big buffer, the first complete_end bytes of which
+     * are complete lines ready to be unbuffered. unbuffer() swaps the buffer
+     * out so that writing it doesn't hold the lock, and hands it back
+     * afterwards as the spare, so steady state use doesn't allocate. */
     template <>
     struct Imp<BufferOutputStreamBuf>
     {
         mutable std::mutex mutex;
 
-        std::list<std::string> complete_strings;
-        std::string active_string;
+        std::string buffer;
+        std::string::size_type complete_end;
+        std::string spare;
 
-        Imp()
+        Imp() :
+            complete_end(0)
         {
         }
     };
@@ -56,12 +61,9 @@ BufferOutputStreamBuf::overflow(int_type c)
 
     if (c != traits_type::eof())
     {
-        _imp->active_string.append(std::string(1, c));
+        _imp->buffer.push_back(c);
         if (c == '\n' || c == '\r')
-        {
-            _imp->complete_strings.push_back(_imp->active_string);
-            _imp->active_string.clear();
-        }
+            _imp->complete_end = _imp->buffer.length();
     }
 
     return c;
@@ -72,12 +74,13 @@ BufferOutputStreamBuf::xsputn(const char * s, std::streamsize num)
 {
     std::unique_lock<std::mutex> lock(_imp->mutex);
 
-    _imp->active_string.append(std::string(s, num));
-    if (std::string::npos != _imp->active_string.find_first_of("\r\n", _imp->active_string.length() - num))
-    {
-        _imp->complete_strings.push_back(_imp->active_string);
-        _imp->active_string.clear();
-    }
+    _imp->buffer.append(s, num);
+    for (std::streamsize p(num) ; p > 0 ; --p)
+        if (s[p - 1] == '\n' || s[p - 1] == '\r')
+        {
+            _imp->complete_end = _imp->buffer.length() - num + p;
+            break;
+        }
 
     return num;
 }
@@ -85,16 +88,30 @@ BufferOutputStreamBuf::xsputn(const char * s, std::streamsize num)
 void
 BufferOutputStreamBuf::unbuffer(std::ostream & stream)
 {
-    std::list<std::string> c;
+    std::string c;
+    std::string::size_type c_end;
 
     {
         std::unique_lock<std::mutex> lock(_imp->mutex);
-        _imp->complete_strings.swap(c);
+        c_end = _imp->complete_end;
+        if (0 != c_end)
+        {
+            c.swap(_imp->buffer);
+            _imp->buffer.swap(_imp->spare);
+            _imp->buffer.assign(c, c_end, std::string::npos);
+            _imp->complete_end = 0;
+        }
     }
 
-    for (std::list<std::string>::const_iterator s(c.begin()), s_end(c.end()) ;
-            s != s_end ; ++s)
-        stream << *s;
+    if (0 != c_end)
+    {
+        stream.write(c.data(), c_end);
+
+        c.clear();
+        std::unique_lock<std::mutex> lock(_imp->mutex);
+        if (c.capacity() > _imp->spare.capacity())
+            _imp->spare.swap(c);
+    }
 
     stream << std::flush;
 }
@@ -103,7 +120,7 @@ bool
 BufferOutputStreamBuf::anything_to_unbuffer() const
 {
     std::unique_lock<std::mutex> lock(_imp->mutex);
-    return ! _imp->complete_strings.empty();
+    return 0 != _imp->complete_end;
 }
 
 BufferOutputStreamBase::BufferOutputStreamBase()
@@ -53,3 +53,25 @@ TEST(BufferOutputStream, Works)
     EXPECT_EQ("foo\n", sss.str());
 }
 
+
+TEST(BufferOutputStream, PartialLines)
+{
+    BufferOutputStream s;
+
+    s << "one\ntw";
+    s << 'o';
+    EXPECT_TRUE(s.anything_to_unbuffer());
+
+    std::stringstream ss;
+    s.unbuffer(ss);
+    EXPECT_EQ("one\n", ss.str());
+    EXPECT_TRUE(! s.anything_to_unbuffer());
+
+    s << "\rthree" << '\n' << "fo";
+    s.unbuffer(ss);
+    EXPECT_EQ("one\ntwo\rthree\n", ss.str());
+
+    s << "ur\n";
+    s.unbuffer(ss);
+    EXPECT_EQ("one\ntwo\rthree\nfour\n", ss.str());
+}
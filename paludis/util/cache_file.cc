@@ -0,0 +1,125 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2026 agent
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include <paludis/util/cache_file.hh>
+#include <paludis/util/fs_path.hh>
+#include <paludis/util/fs_error.hh>
+#include <paludis/util/timestamp.hh>
+#include <paludis/util/safe_ofstream.hh>
+#include <paludis/util/stringify.hh>
+#include <paludis/util/destringify.hh>
+
+#include <unistd.h>
+
+using namespace paludis;
+
+void
+paludis::put_cache_field(std::string & s, const std::string & v)
+{
+    s.append(stringify(v.length()));
+    s.append(1, ':');
+    s.append(v);
+    s.append(1, ',');
+}
+
+CacheFieldReader::CacheFieldReader(const std::string & d, const std::string::size_type p) :
+    _data(d),
+    _pos(p),
+    _bad(false)
+{
+}
+
+std::string
+CacheFieldReader::get()
+{
+    std::string::size_type colon(_bad ? std::string::npos : _data.find(':', _pos));
+    if (std::string::npos == colon)
+    {
+        _bad = true;
+        return "";
+    }
+
+    std::string::size_type length(destringify<std::string::size_type>(_data.substr(_pos, colon - _pos)));
+    if (colon + 1 + length >= _data.length() || ',' != _data[colon + 1 + length])
+    {
+        _bad = true;
+        return "";
+    }
+
+    _pos = colon + 2 + length;
+    return _data.substr(colon + 1, length);
+}
+
+bool
+CacheFieldReader::bad() const
+{
+    return _bad;
+}
+
+bool
+CacheFieldReader::done() const
+{
+    return _pos == _data.length();
+}
+
+namespace
+{
+    std::string temporary_prefix(const std::string & cache_file_name)
+    {
+        return "." + cache_file_name + ".tmp.";
+    }
+}
+
+void
+paludis::write_cache_file(const FSPath & f, const std::string & data)
+{
+    FSPath tmp(f.dirname() / (temporary_prefix(f.basename()) + stringify(::getpid())));
+    try
+    {
+        {
+            SafeOFStream s(tmp, -1, true);
+            s << data;
+        }
+        tmp.rename(f);
+    }
+    catch (...)
+    {
+        try
+        {
+            tmp.unlink();
+        }
+        catch (const FSError &)
+        {
+        }
+        throw;
+    }
+}
+
+bool
+paludis::is_cache_file_temporary(const std::string & name, const std::string & cache_file_name)
+{
+    return 0 == name.compare(0, temporary_prefix(cache_file_name).length(), temporary_prefix(cache_file_name));
+}
+
+Timestamp
+paludis::cache_timestamp(const Timestamp & t)
+{
+    if (Timestamp(Timestamp::now().seconds() - 2, 0) < t)
+        return Timestamp(0, 0);
+    return t;
+}
@@ -0,0 +1,111 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2026 agent
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef PALUDIS_GUARD_PALUDIS_UTIL_CACHE_FILE_HH
+#define PALUDIS_GUARD_PALUDIS_UTIL_CACHE_FILE_HH 1
+
+#include <paludis/util/attributes.hh>
+#include <paludis/util/fs_path-fwd.hh>
+#include <paludis/util/timestamp-fwd.hh>
+#include <string>
+
+namespace paludis
+{
+    /**
+     * Append a field to a cache file's contents. Fields are written as
+     * "length:text,", so that they can contain anything.
+     *
+     * \ingroup g_fs
+     * \since 3.0
+     */
+    void put_cache_field(std::string &, const std::string &) PALUDIS_VISIBLE;
+
+    /**
+     * Reads fields written by put_cache_field back out of a cache file's
+     * contents.
+     *
+     * \ingroup g_fs
+     * \since 3.0
+     */
+    class PALUDIS_VISIBLE CacheFieldReader
+    {
+        private:
+            const std::string & _data;
+            std::string::size_type _pos;
+            bool _bad;
+
+        public:
+            /**
+             * Start reading at the given offset into the data, which must
+             * outlive us.
+             */
+            CacheFieldReader(const std::string &, const std::string::size_type);
+
+            /**
+             * The next field. If there isn't a well formed one, returns an
+             * empty string, and we are bad() from then on.
+             *
+             * \exception DestringifyError if a length is not a number
+             */
+            std::string get() PALUDIS_ATTRIBUTE((warn_unused_result));
+
+            bool bad() const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+            /**
+             * Have we read every field?
+             */
+            bool done() const PALUDIS_ATTRIBUTE((warn_unused_result));
+    };
+
+    /**
+     * Replace a cache file with new contents. The contents are written to
+     * a temporary file in the same directory first and then renamed into
+     * place, so other processes reading the old file are not disturbed,
+     * and never see half a file. If anything goes wrong, the temporary file
+     * is removed again.
+     *
+     * \exception FSError or SafeOFStreamError if writing or renaming fails
+     * \ingroup g_fs
+     * \since 3.0
+     */
+    void write_cache_file(const FSPath &, const std::string &) PALUDIS_VISIBLE;
+
+    /**
+     * Is this the name of a temporary file that write_cache_file might
+     * leave behind for the named file?
+     *
+     * \ingroup g_fs
+     * \since 3.0
+     */
+    bool is_cache_file_temporary(const std::string & name, const std::string & cache_file_name)
+        PALUDIS_VISIBLE PALUDIS_ATTRIBUTE((warn_unused_result));
+
+    /**
+     * The mtime to record in a cache for something that has this mtime.
+     *
+     * Anything modified in the last couple of seconds might be modified
+     * again without its mtime changing, so for those we give a zero
+     * timestamp, which won't match next time.
+     *
+     * \ingroup g_fs
+     * \since 3.0
+     */
+    Timestamp cache_timestamp(const Timestamp &) PALUDIS_VISIBLE PALUDIS_ATTRIBUTE((warn_unused_result));
+}
+
+#endif
@@ -0,0 +1,122 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2026 agent
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include <paludis/util/cache_file.hh>
+#include <paludis/util/fs_path.hh>
+#include <paludis/util/fs_stat.hh>
+#include <paludis/util/fs_iterator.hh>
+#include <paludis/util/options.hh>
+#include <paludis/util/safe_ifstream.hh>
+#include <paludis/util/timestamp.hh>
+
+#include <iterator>
+
+#include <gtest/gtest.h>
+
+using namespace paludis;
+
+namespace
+{
+    std::string file_contents(const FSPath & f)
+    {
+        SafeIFStream s(f);
+        return std::string((std::istreambuf_iterator<char>(s)), std::istreambuf_iterator<char>());
+    }
+}
+
+TEST(CacheField, RoundTrip)
+{
+    std::string data("magic\n");
+    put_cache_field(data, "monkey");
+    put_cache_field(data, "");
+    put_cache_field(data, "a:b,c\nd");
+
+    EXPECT_EQ("magic\n6:monkey,0:,7:a:b,c\nd,", data);
+
+    CacheFieldReader r(data, 6);
+    EXPECT_EQ("monkey", r.get());
+    EXPECT_FALSE(r.done());
+    EXPECT_EQ("", r.get());
+    EXPECT_EQ("a:b,c\nd", r.get());
+    EXPECT_TRUE(r.done());
+    EXPECT_FALSE(r.bad());
+}
+
+TEST(CacheField, Bad)
+{
+    std::string truncated("6:monkey,3:ab");
+    CacheFieldReader r(truncated, 0);
+    EXPECT_EQ("monkey", r.get());
+    EXPECT_EQ("", r.get());
+    EXPECT_TRUE(r.bad());
+
+    std::string missing_comma("3:abcd,");
+    CacheFieldReader s(missing_comma, 0);
+    EXPECT_EQ("", s.get());
+    EXPECT_TRUE(s.bad());
+
+    std::string empty("");
+    CacheFieldReader t(empty, 0);
+    EXPECT_TRUE(t.done());
+    EXPECT_EQ("", t.get());
+    EXPECT_TRUE(t.bad());
+}
+
+TEST(CacheFile, Write)
+{
+    FSPath dir(FSPath::cwd() / "cache_file_TEST_dir" / "write");
+    FSPath f(dir / "cache");
+
+    write_cache_file(f, "one\n");
+    EXPECT_EQ("one\n", file_contents(f));
+
+    write_cache_file(f, "two\n");
+    EXPECT_EQ("two\n", file_contents(f));
+
+    /* only the cache file itself is left behind */
+    int n(0);
+    for (FSIterator i(dir, { fsio_include_dotfiles }), i_end ; i != i_end ; ++i)
+    {
+        ++n;
+        EXPECT_EQ("cache", i->basename());
+    }
+    EXPECT_EQ(1, n);
+
+    EXPECT_TRUE(is_cache_file_temporary(".cache.tmp.1234", "cache"));
+    EXPECT_FALSE(is_cache_file_temporary("cache", "cache"));
+    EXPECT_FALSE(is_cache_file_temporary(".cache.tmp", "other"));
+
+    EXPECT_THROW(write_cache_file(dir / "missing" / "cache", "three\n"), Exception);
+}
+
+TEST(CacheFile, WriteFailure)
+{
+    FSPath dir(FSPath::cwd() / "cache_file_TEST_dir" / "failure");
+
+    /* renaming over a non-empty directory fails */
+    EXPECT_THROW(write_cache_file(dir / "cache", "one\n"), Exception);
+
+    for (FSIterator i(dir, { fsio_include_dotfiles }), i_end ; i != i_end ; ++i)
+        EXPECT_FALSE(is_cache_file_temporary(i->basename(), "cache")) << i->basename();
+}
+
+TEST(CacheFile, Timestamp)
+{
+    EXPECT_EQ(Timestamp(12345, 678), cache_timestamp(Timestamp(12345, 678)));
+    EXPECT_EQ(Timestamp(0, 0), cache_timestamp(Timestamp::now()));
+}
@@ -0,0 +1,8 @@
+#!/usr/bin/env bash
+# vim: set ft=sh sw=4 sts=4 et :
+
+mkdir cache_file_TEST_dir || exit 1
+cd cache_file_TEST_dir || exit 1
+
+mkdir write || exit 1
+mkdir -p failure/cache/full || exit 1
@@ -0,0 +1,158 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2026 agent
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef PALUDIS_GUARD_PALUDIS_UTIL_CONCURRENT_MAP_HH
+#define PALUDIS_GUARD_PALUDIS_UTIL_CONCURRENT_MAP_HH 1
+
+#include <paludis/util/hashes.hh>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+/** \file
+ * Declarations for the ConcurrentMap class.
+ *
+ * \ingroup g_threads
+ *
+ * \section Examples
+ *
+ * - None at this time.
+ */
+
+namespace paludis
+{
+    /**
+     * A map for caches which are read far more often than they are written,
+     * from many threads at once.
+     *
+     * Entries are spread over a number of shards by hash, each with its own
+     * lock, so threads only contend when they want the same shard at the
+     * same time, and then only for the length of a hash lookup. Values are
+     * never built whilst a lock is held, so a slow insert does not hold up
+     * anyone else.
+     *
+     * Values are returned by copy, so they should be cheap to copy; usually
+     * they are a std::shared_ptr.
+     *
+     * \ingroup g_threads
+     * \since 3.0
+     */
+    template <typename Key_, typename Value_, typename Hash_ = Hash<Key_>, typename Equal_ = std::equal_to<Key_> >
+    class ConcurrentMap
+    {
+        private:
+            static const unsigned shard_bits = 4;
+
+            struct Shard
+            {
+                std::mutex mutex;
+                std::unordered_map<Key_, Value_, Hash_, Equal_> values;
+            };
+
+            mutable Shard _shards[1 << shard_bits];
+
+            Shard & _shard_for(const Key_ & k) const
+            {
+                /* the low bits of the hash pick the bucket within a shard, so
+                 * take the shard from the high bits instead */
+                std::uint64_t h(Hash_()(k));
+                return _shards[(h * 0x9e3779b97f4a7c15ull) >> (64 - shard_bits)];
+            }
+
+        public:
+            ///\name Basic operations
+            ///\{
+
+            ConcurrentMap() = default;
+
+            ConcurrentMap(const ConcurrentMap &) = delete;
+            ConcurrentMap & operator= (const ConcurrentMap &) = delete;
+
+            ///\}
+
+            /**
+             * If we have a value for k, copy it into v and return true.
+             */
+            bool find(const Key_ & k, Value_ & v) const
+            {
+                Shard & s(_shard_for(k));
+                std::unique_lock<std::mutex> lock(s.mutex);
+                auto i(s.values.find(k));
+                if (i == s.values.end())
+                    return false;
+                v = i->second;
+                return true;
+            }
+
+            /**
+             * Return our value for k, first calling make() to create it if
+             * we don't have one.
+             *
+             * make() is called without any lock held. If two threads race to
+             * create the same value, both may call make(), but only the first
+             * value to be inserted is kept and returned to both.
+             */
+            template <typename Make_>
+            Value_ find_or_insert(const Key_ & k, const Make_ & make)
+            {
+                Shard & s(_shard_for(k));
+                {
+                    std::unique_lock<std::mutex> lock(s.mutex);
+                    auto i(s.values.find(k));
+                    if (i != s.values.end())
+                        return i->second;
+                }
+
+                Value_ v(make());
+
+                std::unique_lock<std::mutex> lock(s.mutex);
+                return s.values.insert(std::make_pair(k, std::move(v))).first->second;
+            }
+
+            /**
+             * Set our value for k, replacing any existing value.
+             */
+            void assign(const Key_ & k, const Value_ & v)
+            {
+                Shard & s(_shard_for(k));
+                std::unique_lock<std::mutex> lock(s.mutex);
+                s.values[k] = v;
+            }
+
+            /**
+             * How many values do we hold?
+             */
+            std::size_t size() const
+            {
+                std::size_t result(0);
+                for (auto & s : _shards)
+                {
+                    std::unique_lock<std::mutex> lock(s.mutex);
+                    result += s.values.size();
+                }
+                return result;
+            }
+    };
+}
+
+#endif
@@ -0,0 +1,75 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2026 agent
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <paludis/util/concurrent_map.hh>
+#include <paludis/util/task_scheduler.hh>
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include <gtest/gtest.h>
+
+using namespace paludis;
+
+TEST(ConcurrentMap, Basics)
+{
+    ConcurrentMap<std::string, int> m;
+    int v(0);
+    EXPECT_FALSE(m.find("a", v));
+
+    EXPECT_EQ(1, m.find_or_insert("a", [] () { return 1; }));
+    EXPECT_EQ(1, m.find_or_insert("a", [] () { return 2; }));
+    EXPECT_TRUE(m.find("a", v));
+    EXPECT_EQ(1, v);
+
+    m.assign("a", 3);
+    m.assign("b", 4);
+    EXPECT_TRUE(m.find("a", v));
+    EXPECT_EQ(3, v);
+    EXPECT_TRUE(m.find("b", v));
+    EXPECT_EQ(4, v);
+    EXPECT_EQ(2u, m.size());
+}
+
+TEST(ConcurrentMap, Threads)
+{
+    ConcurrentMap<int, std::shared_ptr<const int> > m;
+    std::atomic<int> made(0);
+
+    TaskGroup group;
+    for (int t(0) ; t < 8 ; ++t)
+        group.spawn([&] () {
+                for (int i(0) ; i < 1000 ; ++i)
+                {
+                    auto v(m.find_or_insert(i, [&] () { ++made; return std::make_shared<const int>(i); }));
+                    ASSERT_EQ(i, *v);
+
+                    /* everyone must get the same value, whoever made it */
+                    std::shared_ptr<const int> w;
+                    ASSERT_TRUE(m.find(i, w));
+                    ASSERT_EQ(v, w);
+                }
+                });
+    group.wait();
+
+    EXPECT_EQ(1000u, m.size());
+    EXPECT_LE(1000, made.load());
+}
@@ -36,8 +36,10 @@ namespace paludis
         const std::string ebuild_dir("PALUDIS_EBUILD_DIR");
         const std::string fetchers_dir("PALUDIS_FETCHERS_DIR");
         const std::string home("PALUDIS_HOME");
+        const std::string hooker_cache_dir("PALUDIS_HOOKER_CACHE_DIR");
         const std::string hooker_dir("PALUDIS_HOOKER_DIR");
         const std::string ignore_hooks_named("PALUDIS_IGNORE_HOOKS_NAMED");
+        const std::string jobs("PALUDIS_JOBS");
         const std::string no_chown("PALUDIS_NO_CHOWN");
         const std::string no_global_fetchers("PALUDIS_NO_GLOBAL_FETCHERS");
         const std::string no_global_hooks("PALUDIS_NO_GLOBAL_HOOKS");
@@ -21,13 +21,16 @@
 #include <paludis/util/pimp-impl.hh>
 #include <paludis/util/exception.hh>
 #include <paludis/util/stringify.hh>
+#include <paludis/util/thread_pool.hh>
 #include <condition_variable>
 #include <functional>
+#include <iterator>
 #include <iostream>
+#include <deque>
 #include <list>
 #include <map>
 #include <mutex>
-#include <thread>
+#include <set>
 
 using namespace paludis;
 
@@ -47,17 +50,38 @@ namespace paludis
         int active;
         int done;
 
+        int active_limit;
+        std::map<std::string, int> queue_limits;
+        std::set<std::string> unordered_queues;
+
         Queues queues;
+        std::map<std::string, int> running_per_queue;
+        ExecutiveList running;
+        std::deque<std::shared_ptr<Executive> > to_start;
         ReadyForPost ready_for_post;
+
+        unsigned waiting_workers;
+        bool finished;
+
         std::mutex mutex;
         std::condition_variable condition;
+        std::condition_variable worker_condition;
 
         Imp(int u) :
             ms_update_interval(u),
             pending(0),
             active(0),
-            done(0)
+            done(0),
+            active_limit(0),
+            waiting_workers(0),
+            finished(false)
+        {
+        }
+
+        int queue_limit(const std::string & q) const
         {
+            auto l(queue_limits.find(q));
+            return l == queue_limits.end() ? 1 : l->second;
         }
     };
 }
@@ -88,6 +112,30 @@ Executor::_one(const std::shared_ptr<Executive> executive)
     }
 }
 
+void
+Executor::set_queue_limit(const std::string & queue_name, const int n)
+{
+    if (n < 1)
+        throw InternalError(PALUDIS_HERE, "queue limit for '" + queue_name + "' must be positive, not " + stringify(n));
+    _imp->queue_limits[queue_name] = n;
+}
+
+void
+Executor::set_queue_in_order(const std::string & queue_name, const bool in_order)
+{
+    if (in_order)
+        _imp->unordered_queues.erase(queue_name);
+    else
+        _imp->unordered_queues.insert(queue_name);
+}
+
+void
+Executor::set_active_limit(const int n)
+{
+    if (n < 0)
+        throw InternalError(PALUDIS_HERE, "active limit must not be negative, not " + stringify(n));
+    _imp->active_limit = n;
+}
 
 int
 Executor::pending() const
@@ -117,55 +165,123 @@ Executor::add(const std::shared_ptr<Executive> & x)
 void
 Executor::execute()
 {
-    typedef std::map<std::string, std::pair<std::thread, std::shared_ptr<Executive> > > Running;
-    Running running;
+    ThreadPool workers;
 
-    std::unique_lock<std::mutex> lock(_imp->mutex);
-    while (true)
+    /* workers are only ever woken up by us handing them an executive, and we
+     * are only ever woken up by an executive finishing, or when it's time to
+     * flush output */
+    auto worker([&] () noexcept {
+            while (true)
+            {
+                std::shared_ptr<Executive> executive;
+                {
+                    std::unique_lock<std::mutex> lock(_imp->mutex);
+                    ++_imp->waiting_workers;
+                    _imp->worker_condition.wait(lock, [&] { return _imp->finished || ! _imp->to_start.empty(); });
+                    --_imp->waiting_workers;
+
+                    if (_imp->to_start.empty())
+                        return;
+
+                    executive = _imp->to_start.front();
+                    _imp->to_start.pop_front();
+                }
+
+                _one(executive);
+            }
+        });
+
+    struct Finish
     {
-        bool any(false);
-        for (Queues::iterator q(_imp->queues.begin()), q_end(_imp->queues.end()) ;
-                q != q_end ; )
+        Imp<Executor> & imp;
+
+        ~Finish()
         {
-            if ((running.end() != running.find(q->first)) || ! (*q->second.begin())->can_run())
+            std::unique_lock<std::mutex> lock(imp.mutex);
+            imp.finished = true;
+            imp.worker_condition.notify_all();
+        }
+    } finish{*_imp.get()};
+
+    /* start at most one executive from each queue per pass, so that an
+     * active limit doesn't let one queue starve the others */
+    auto start_what_we_can([&] () {
+            bool any(true);
+            while (any)
             {
-                ++q;
-                continue;
+                any = false;
+                for (Queues::iterator q(_imp->queues.begin()), q_end(_imp->queues.end()) ; q != q_end ; )
+                {
+                    if ((0 != _imp->active_limit && _imp->active >= _imp->active_limit) ||
+                            (_imp->running_per_queue[q->first] >= _imp->queue_limit(q->first)))
+                    {
+                        ++q;
+                        continue;
+                    }
+
+                    const bool in_order(_imp->unordered_queues.end() == _imp->unordered_queues.find(q->first));
+                    ExecutiveList::iterator x(q->second.begin()), x_end(q->second.end());
+                    while (x != x_end && ! (*x)->can_run())
+                        x = in_order ? x_end : std::next(x);
+
+                    if (x == x_end)
+                    {
+                        ++q;
+                        continue;
+                    }
+
+                    std::shared_ptr<Executive> executive(*x);
+                    q->second.erase(x);
+
+                    ++_imp->active;
+                    --_imp->pending;
+                    ++_imp->running_per_queue[q->first];
+                    executive->pre_execute_exclusive();
+
+                    _imp->running.push_back(executive);
+                    _imp->to_start.push_back(executive);
+                    if (_imp->to_start.size() > _imp->waiting_workers)
+                        workers.create_thread(worker);
+                    _imp->worker_condition.notify_one();
+
+                    if (q->second.empty())
+                        _imp->queues.erase(q++);
+                    else
+                        ++q;
+                    any = true;
+                }
             }
+        });
 
-            ++_imp->active;
-            --_imp->pending;
-            (*q->second.begin())->pre_execute_exclusive();
-            running.insert(std::make_pair(q->first, std::make_pair(std::thread(std::bind(&Executor::_one, this, *q->second.begin())), *q->second.begin())));
-            q->second.erase(q->second.begin());
-            if (q->second.empty())
-                _imp->queues.erase(q++);
-            else
-                ++q;
-            any = true;
-        }
+    std::unique_lock<std::mutex> lock(_imp->mutex);
+    bool something_changed(true);
+    while (true)
+    {
+        if (something_changed)
+            start_what_we_can();
+        something_changed = false;
 
-        if ((! any) && running.empty())
+        if (_imp->running.empty())
         {
             if (! _imp->queues.empty())
                 throw InternalError(PALUDIS_HERE, "None of our executives can start, but queues are not empty");
             break;
         }
 
-        _imp->condition.wait_for(lock, std::chrono::milliseconds(_imp->ms_update_interval));
+        if (_imp->ready_for_post.empty())
+            _imp->condition.wait_for(lock, std::chrono::milliseconds(_imp->ms_update_interval));
 
-        for (auto & r : running)
-            r.second.second->flush_threaded();
+        for (auto & r : _imp->running)
+            r->flush_threaded();
 
-        for (ReadyForPost::iterator p(_imp->ready_for_post.begin()), p_end(_imp->ready_for_post.end()) ;
-                p != p_end ; ++p)
+        for (auto & p : _imp->ready_for_post)
         {
             --_imp->active;
             ++_imp->done;
-            auto r = running.find((*p)->queue_name());
-            r->second.first.join();
-            running.erase(r);
-            (*p)->post_execute_exclusive();
+            --_imp->running_per_queue[p->queue_name()];
+            _imp->running.remove(p);
+            p->post_execute_exclusive();
+            something_changed = true;
         }
 
         _imp->ready_for_post.clear();
@@ -182,4 +298,3 @@ namespace paludis
 {
     template class Pimp<Executor>;
 }
-
@@ -55,6 +55,32 @@ namespace paludis
             explicit Executor(const int ms_update_interval = 1000);
             ~Executor();
 
+            /**
+             * Allow up to n executives from the named queue to run at once.
+             * Queues default to running one executive at a time.
+             *
+             * \since 3.0
+             */
+            void set_queue_limit(const std::string & queue_name, const int n);
+
+            /**
+             * Queues normally start their executives strictly in the order
+             * they were added, so one which cannot run yet holds up the
+             * rest of its queue. If in_order is false, the first executive
+             * in the named queue which can run is started instead.
+             *
+             * \since 3.0
+             */
+            void set_queue_in_order(const std::string & queue_name, const bool in_order);
+
+            /**
+             * Allow up to n executives to run at once, over all queues. Zero
+             * means no limit, which is the default.
+             *
+             * \since 3.0
+             */
+            void set_active_limit(const int n);
+
             int pending() const;
             int active() const;
             int done() const;
@@ -0,0 +1,205 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2026 agent
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <paludis/util/executor.hh>
+#include <paludis/util/stringify.hh>
+#include <paludis/util/join.hh>
+#include <paludis/util/exception.hh>
+
+#include <algorithm>
+#include <condition_variable>
+#include <list>
+#include <map>
+#include <mutex>
+
+#include <gtest/gtest.h>
+
+using namespace paludis;
+
+namespace
+{
+    /* executives are held until open_at of them are running together, so
+     * that the limits really are reached, and then everything runs freely */
+    struct Counts
+    {
+        std::mutex mutex;
+        std::condition_variable condition;
+        int open_at = 1;
+        bool open = false;
+        int active = 0;
+        int max_active = 0;
+        std::map<std::string, int> queue_active;
+        std::map<std::string, int> queue_max_active;
+        std::list<std::string> finished;
+    };
+
+    struct TestExecutive :
+        Executive
+    {
+        Counts & counts;
+        const std::string queue;
+        const std::string id;
+        const std::string after;
+
+        TestExecutive(Counts & c, const std::string & q, const std::string & i, const std::string & a = "") :
+            counts(c),
+            queue(q),
+            id(i),
+            after(a)
+        {
+        }
+
+        std::string queue_name() const override
+        {
+            return queue;
+        }
+
+        std::string unique_id() const override
+        {
+            return id;
+        }
+
+        bool can_run() const override
+        {
+            return after.empty() || counts.finished.end() != std::find(counts.finished.begin(), counts.finished.end(), after);
+        }
+
+        void pre_execute_exclusive() override
+        {
+        }
+
+        void execute_threaded() override
+        {
+            std::unique_lock<std::mutex> lock(counts.mutex);
+            counts.max_active = std::max(counts.max_active, ++counts.active);
+            counts.queue_max_active[queue] = std::max(counts.queue_max_active[queue], ++counts.queue_active[queue]);
+
+            if (counts.active >= counts.open_at)
+            {
+                counts.open = true;
+                counts.condition.notify_all();
+            }
+            counts.condition.wait(lock, [&] { return counts.open; });
+
+            --counts.active;
+            --counts.queue_active[queue];
+        }
+
+        void flush_threaded() override
+        {
+        }
+
+        void post_execute_exclusive() override
+        {
+            counts.finished.push_back(id);
+        }
+    };
+}
+
+TEST(Executor, OnePerQueue)
+{
+    Counts counts;
+    counts.open_at = 2;
+    Executor executor(10);
+    for (int i(0) ; i < 4 ; ++i)
+    {
+        executor.add(std::make_shared<TestExecutive>(counts, "a", "a" + stringify(i)));
+        executor.add(std::make_shared<TestExecutive>(counts, "b", "b" + stringify(i)));
+    }
+    executor.execute();
+
+    EXPECT_EQ(8, executor.done());
+    EXPECT_EQ(0, executor.pending());
+    EXPECT_EQ(0, executor.active());
+    EXPECT_EQ(1, counts.queue_max_active["a"]);
+    EXPECT_EQ(1, counts.queue_max_active["b"]);
+
+    counts.finished.remove_if([] (const std::string & s) { return s[0] != 'a'; });
+    EXPECT_EQ("a0 a1 a2 a3", join(counts.finished.begin(), counts.finished.end(), " "));
+}
+
+TEST(Executor, QueueLimit)
+{
+    Counts counts;
+    counts.open_at = 3;
+    Executor executor(10);
+    executor.set_queue_limit("a", 3);
+    for (int i(0) ; i < 6 ; ++i)
+        executor.add(std::make_shared<TestExecutive>(counts, "a", "a" + stringify(i)));
+    executor.execute();
+
+    EXPECT_EQ(6, executor.done());
+    EXPECT_EQ(3, counts.queue_max_active["a"]);
+}
+
+TEST(Executor, ActiveLimit)
+{
+    Counts counts;
+    counts.open_at = 3;
+    Executor executor(10);
+    executor.set_active_limit(3);
+    for (const auto & q : { "a", "b", "c", "d" })
+    {
+        executor.set_queue_limit(q, 2);
+        for (int i(0) ; i < 3 ; ++i)
+            executor.add(std::make_shared<TestExecutive>(counts, q, q + stringify(i)));
+    }
+    executor.execute();
+
+    EXPECT_EQ(12, executor.done());
+    EXPECT_EQ(3, counts.max_active);
+    for (const auto & q : { "a", "b", "c", "d" })
+        EXPECT_GE(2, counts.queue_max_active[q]);
+}
+
+TEST(Executor, WaitsForCanRun)
+{
+    Counts counts;
+    Executor executor(10000);
+    executor.add(std::make_shared<TestExecutive>(counts, "b", "b0", "a1"));
+    executor.add(std::make_shared<TestExecutive>(counts, "a", "a0"));
+    executor.add(std::make_shared<TestExecutive>(counts, "a", "a1"));
+    executor.execute();
+
+    EXPECT_EQ("a0 a1 b0", join(counts.finished.begin(), counts.finished.end(), " "));
+}
+
+TEST(Executor, OutOfOrder)
+{
+    Counts counts;
+    Executor executor(10000);
+    executor.set_queue_in_order("a", false);
+    executor.add(std::make_shared<TestExecutive>(counts, "a", "a0", "b0"));
+    executor.add(std::make_shared<TestExecutive>(counts, "a", "a1"));
+    executor.add(std::make_shared<TestExecutive>(counts, "b", "b0", "a1"));
+    executor.execute();
+
+    EXPECT_EQ("a1 b0 a0", join(counts.finished.begin(), counts.finished.end(), " "));
+}
+
+TEST(Executor, InOrder)
+{
+    Counts counts;
+    Executor executor(10000);
+    executor.add(std::make_shared<TestExecutive>(counts, "a", "a0", "b0"));
+    executor.add(std::make_shared<TestExecutive>(counts, "a", "a1"));
+    executor.add(std::make_shared<TestExecutive>(counts, "b", "b0", "a1"));
+    EXPECT_THROW(executor.execute(), InternalError);
+}
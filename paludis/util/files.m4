@@ -12,9 +12,11 @@ add(`active_object_ptr',                 `hh', `cc', `fwd', `gtest')
 add(`attributes',                        `hh')
 add(`buffer_output_stream',              `hh', `cc', `fwd', `gtest')
 add(`byte_swap',                         `hh', `gtest')
+add(`cache_file',                        `hh', `cc', `gtest', `testscript')
 add(`channel',                           `hh', `cc')
 add(`checked_delete',                    `hh')
 add(`clone',                             `hh', `impl')
+add(`concurrent_map',                    `hh', `gtest')
 add(`config_file',                       `hh', `cc', `fwd', `se', `gtest', `testscript')
 add(`cookie',                            `hh', `cc')
 add(`create_iterator',                   `hh', `fwd', `impl', `gtest')
@@ -32,9 +34,10 @@ add(`elf_types',                         `hh')
 add(`enum_iterator',                     `hh', `cc', `fwd', `gtest')
 add(`env_var_names',                     `hh', `cc')
 add(`exception',                         `hh', `cc')
-add(`executor',                          `hh', `cc', `fwd')
+add(`executor',                          `hh', `cc', `fwd', `gtest')
 add(`extract_host_from_url',             `hh', `cc', `fwd', `gtest')
 add(`fd_holder',                         `hh')
+add(`fs_dir_walker',                     `hh', `cc', `fwd', `gtest', `testscript')
 add(`fs_iterator',                       `hh', `cc', `fwd', `se', `gtest', `testscript')
 add(`fs_error',                          `hh', `cc')
 add(`fs_path',                           `hh', `cc', `fwd', `se', `gtest', `testscript')
@@ -62,6 +65,7 @@ add(`pipe',                              `hh', `cc')
 add(`pool',                              `hh', `cc', `impl', `gtest', `fwd')
 add(`pretty_print',                      `hh', `cc', `gtest')
 add(`process',                           `hh', `cc', `fwd', `gtest', `testscript')
+add(`profiler',                          `hh', `cc', `fwd', `gtest')
 add(`pty',                               `hh', `cc', `gtest')
 add(`realpath',                          `hh', `cc', `gtest', `testscript')
 add(`remove_shared_ptr',                 `hh')
@@ -83,6 +87,7 @@ add(`string_list_stream',                `hh', `cc', `fwd', `gtest')
 add(`strip',                             `hh', `cc', `gtest')
 add(`system',                            `hh', `cc', `gtest')
 add(`tail_output_stream',                `hh', `cc', `fwd', `gtest')
+add(`task_scheduler',                    `hh', `cc', `fwd', `gtest')
 add(`tee_output_stream',                 `hh', `cc', `fwd')
 add(`thread_pool',                       `hh', `cc', `gtest')
 add(`timestamp',                         `hh', `cc', `fwd')
@@ -0,0 +1,297 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2026 agent
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <paludis/util/fs_dir_walker.hh>
+#include <paludis/util/fs_iterator.hh>
+#include <paludis/util/fs_path.hh>
+#include <paludis/util/fs_stat.hh>
+#include <paludis/util/fs_error.hh>
+#include <paludis/util/options.hh>
+#include <paludis/util/stringify.hh>
+#include <paludis/util/pimp-impl.hh>
+
+#include <algorithm>
+#include <vector>
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+using namespace paludis;
+
+namespace
+{
+    /* what getdents64 gives us. glibc only wraps it in newer versions. */
+    struct LinuxDirent64
+    {
+        uint64_t d_ino;
+        int64_t d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[];
+    };
+
+    const std::size_t getdents_buffer_size = 32768;
+
+    /* anything we're not told about, we'll stat for if we need to */
+    mode_t type_from_dtype(unsigned char d_type)
+    {
+        switch (d_type)
+        {
+            case DT_REG:  return S_IFREG;
+            case DT_DIR:  return S_IFDIR;
+            case DT_LNK:  return S_IFLNK;
+            case DT_FIFO: return S_IFIFO;
+            case DT_SOCK: return S_IFSOCK;
+            case DT_CHR:  return S_IFCHR;
+            case DT_BLK:  return S_IFBLK;
+        }
+        return 0;
+    }
+
+    struct SortableEntry
+    {
+        ino_t inode;
+        mode_t type;
+        std::string::size_type name_offset;
+        std::size_t name_length;
+    };
+
+    bool wanted(const FSIteratorOptions & options, const FSDirEntry & e)
+    {
+        if (! (options[fsio_want_directories] || options[fsio_want_regular_files]))
+            return true;
+
+        mode_t type(e.type());
+        if (S_ISLNK(type))
+        {
+            if (! options[fsio_deref_symlinks_for_wants])
+                return false;
+
+            struct stat st;
+            if (0 != ::fstatat(e.walker().fd(), e.name(), &st, 0))
+                return false;
+            type = st.st_mode & S_IFMT;
+        }
+
+        if (S_ISREG(type))
+            return options[fsio_want_regular_files];
+        else if (S_ISDIR(type))
+            return options[fsio_want_directories];
+        else
+            return false;
+    }
+}
+
+FSDirEntry::FSDirEntry(const FSDirWalker & w, const char * const n, const std::size_t l, const ino_t i, const mode_t t) :
+    _walker(w),
+    _name(n),
+    _name_length(l),
+    _inode(i),
+    _type(t)
+{
+}
+
+mode_t
+FSDirEntry::type() const
+{
+    if (0 == _type)
+    {
+        struct stat st;
+        if (0 != ::fstatat(_walker.fd(), _name, &st, AT_SYMLINK_NOFOLLOW))
+            throw FSError("Error running stat() on '" + stringify(path()) + "': " + ::strerror(errno));
+        _type = st.st_mode & S_IFMT;
+    }
+
+    return _type;
+}
+
+bool
+FSDirEntry::is_regular_file() const
+{
+    return S_ISREG(type());
+}
+
+bool
+FSDirEntry::is_directory() const
+{
+    return S_ISDIR(type());
+}
+
+bool
+FSDirEntry::is_symlink() const
+{
+    return S_ISLNK(type());
+}
+
+FSStat
+FSDirEntry::stat() const
+{
+    return _walker.stat_entry(name_string());
+}
+
+FSPath
+FSDirEntry::path() const
+{
+    return _walker.path() / name_string();
+}
+
+namespace paludis
+{
+    template <>
+    struct Imp<FSDirWalker>
+    {
+        const FSPath path;
+        int fd;
+
+        Imp(const FSPath & p, const int d, const std::string & name) :
+            path(p),
+            fd(::openat(d, name.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC))
+        {
+            if (-1 == fd)
+                throw FSError("Error opening directory '" + stringify(path) + "': " + stringify(::strerror(errno)));
+        }
+
+        ~Imp()
+        {
+            ::close(fd);
+        }
+    };
+}
+
+FSDirWalker::FSDirWalker(const FSPath & p) :
+    _imp(p, AT_FDCWD, stringify(p))
+{
+}
+
+FSDirWalker::FSDirWalker(const FSDirWalker & parent, const std::string & name) :
+    _imp(parent.path() / name, parent.fd(), name)
+{
+}
+
+FSDirWalker::~FSDirWalker() = default;
+
+const FSPath &
+FSDirWalker::path() const
+{
+    return _imp->path;
+}
+
+int
+FSDirWalker::fd() const
+{
+    return _imp->fd;
+}
+
+void
+FSDirWalker::walk(const FSIteratorOptions & options, const std::function<void (const FSDirEntry &)> & f) const
+{
+    /* we might be walked more than once, so start from the beginning */
+    if (-1 == ::lseek(_imp->fd, 0, SEEK_SET))
+        throw FSError("Error rewinding directory '" + stringify(_imp->path) + "': " + stringify(::strerror(errno)));
+
+    /* like FSIterator, give entries sorted by name unless asked to sort by
+     * inode, and only when we just want the first one do we hand over
+     * whatever the kernel gives us first */
+    const bool sorted(options[fsio_inode_sort] || ! options[fsio_first_only]);
+
+    std::vector<char> buf(getdents_buffer_size);
+    std::vector<SortableEntry> sortable;
+    std::string sortable_names;
+    bool done(false);
+
+    while (! done)
+    {
+        long n(::syscall(SYS_getdents64, _imp->fd, &buf[0], buf.size()));
+        if (-1 == n)
+            throw FSError("Error reading directory '" + stringify(_imp->path) + "': " + stringify(::strerror(errno)));
+        else if (0 == n)
+            break;
+
+        for (long p(0) ; p < n && ! done ; )
+        {
+            const LinuxDirent64 * const d(reinterpret_cast<const LinuxDirent64 *>(&buf[p]));
+            p += d->d_reclen;
+
+            if (d->d_name[0] == '.')
+            {
+                if (! options[fsio_include_dotfiles])
+                    continue;
+                if (d->d_name[1] == '\0' || (d->d_name[1] == '.' && d->d_name[2] == '\0'))
+                    continue;
+            }
+
+            std::size_t length(std::strlen(d->d_name));
+            if (sorted)
+            {
+                sortable.push_back(SortableEntry{ ino_t(d->d_ino), type_from_dtype(d->d_type), sortable_names.length(), length });
+                sortable_names.append(d->d_name, length + 1);
+            }
+            else
+            {
+                FSDirEntry e(*this, d->d_name, length, d->d_ino, type_from_dtype(d->d_type));
+                if (wanted(options, e))
+                {
+                    f(e);
+                    done = options[fsio_first_only];
+                }
+            }
+        }
+    }
+
+    if (sorted)
+    {
+        const char * const names(sortable_names.data());
+        std::sort(sortable.begin(), sortable.end(),
+                [names] (const SortableEntry & a, const SortableEntry & b) {
+                    return std::strcmp(names + a.name_offset, names + b.name_offset) < 0;
+                });
+
+        if (options[fsio_inode_sort])
+            std::stable_sort(sortable.begin(), sortable.end(),
+                    [] (const SortableEntry & a, const SortableEntry & b) { return a.inode < b.inode; });
+
+        for (const auto & s : sortable)
+        {
+            FSDirEntry e(*this, sortable_names.data() + s.name_offset, s.name_length, s.inode, s.type);
+            if (wanted(options, e))
+            {
+                f(e);
+                if (options[fsio_first_only])
+                    break;
+            }
+        }
+    }
+}
+
+FSStat
+FSDirWalker::stat_entry(const std::string & name) const
+{
+    return FSStat(_imp->path / name, _imp->fd, name);
+}
+
+namespace paludis
+{
+    template class Pimp<FSDirWalker>;
+}
@@ -0,0 +1,183 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2026 agent
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PALUDIS_GUARD_PALUDIS_UTIL_FS_DIR_WALKER_HH
+#define PALUDIS_GUARD_PALUDIS_UTIL_FS_DIR_WALKER_HH 1
+
+#include <paludis/util/fs_dir_walker-fwd.hh>
+#include <paludis/util/fs_iterator-fwd.hh>
+#include <paludis/util/fs_path-fwd.hh>
+#include <paludis/util/fs_stat-fwd.hh>
+#include <paludis/util/attributes.hh>
+#include <paludis/util/pimp.hh>
+#include <functional>
+#include <memory>
+#include <string>
+#include <sys/types.h>
+
+namespace paludis
+{
+    /**
+     * An entry seen by FSDirWalker::walk.
+     *
+     * Entries are only valid for the duration of the callback they are
+     * passed to. The name is not copied out of the kernel's buffer, and
+     * anything that needs a stat is done relative to the directory's fd.
+     *
+     * \ingroup g_fs
+     * \since 3.0
+     */
+    class PALUDIS_VISIBLE FSDirEntry
+    {
+        private:
+            const FSDirWalker & _walker;
+            const char * const _name;
+            const std::size_t _name_length;
+            const ino_t _inode;
+            mutable mode_t _type;
+
+        public:
+            ///\name Basic operations
+            ///\{
+
+            FSDirEntry(const FSDirWalker &, const char * const, const std::size_t, const ino_t, const mode_t);
+
+            FSDirEntry(const FSDirEntry &) = delete;
+            FSDirEntry & operator= (const FSDirEntry &) = delete;
+
+            ///\}
+
+            /**
+             * Our name, which is NUL terminated.
+             */
+            const char * name() const PALUDIS_ATTRIBUTE((warn_unused_result))
+            {
+                return _name;
+            }
+
+            std::size_t name_length() const PALUDIS_ATTRIBUTE((warn_unused_result))
+            {
+                return _name_length;
+            }
+
+            std::string name_string() const PALUDIS_ATTRIBUTE((warn_unused_result))
+            {
+                return std::string(_name, _name_length);
+            }
+
+            ino_t inode() const PALUDIS_ATTRIBUTE((warn_unused_result))
+            {
+                return _inode;
+            }
+
+            /**
+             * Our file type, as the S_IFMT bits of a mode. Symlinks are not
+             * followed. We only stat if the filesystem didn't tell us.
+             */
+            mode_t type() const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+            bool is_regular_file() const PALUDIS_ATTRIBUTE((warn_unused_result));
+            bool is_directory() const PALUDIS_ATTRIBUTE((warn_unused_result));
+            bool is_symlink() const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+            /**
+             * Stat us, relative to our directory, without following symlinks.
+             */
+            FSStat stat() const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+            /**
+             * Our full path. This allocates, so avoid it in hot loops where
+             * the name will do.
+             */
+            FSPath path() const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+            const FSDirWalker & walker() const PALUDIS_ATTRIBUTE((warn_unused_result))
+            {
+                return _walker;
+            }
+    };
+
+    /**
+     * Walks the contents of a directory through an open fd.
+     *
+     * Unlike FSIterator, this reads entries in large getdents64 batches,
+     * never builds full paths unless asked, and does any stats relative to
+     * the directory fd. Subdirectories can be opened relative to their
+     * parent, so a recursive walk never resolves a full path.
+     *
+     * \ingroup g_fs
+     * \since 3.0
+     */
+    class PALUDIS_VISIBLE FSDirWalker
+    {
+        private:
+            Pimp<FSDirWalker> _imp;
+
+        public:
+            ///\name Basic operations
+            ///\{
+
+            /**
+             * Open a directory, following symlinks.
+             *
+             * \exception FSError if the directory can't be opened
+             */
+            explicit FSDirWalker(const FSPath &);
+
+            /**
+             * Open a subdirectory of an existing walker's directory.
+             *
+             * \exception FSError if the directory can't be opened
+             */
+            FSDirWalker(const FSDirWalker &, const std::string &);
+
+            FSDirWalker(const FSDirWalker &) = delete;
+            FSDirWalker & operator= (const FSDirWalker &) = delete;
+
+            ~FSDirWalker();
+
+            ///\}
+
+            const FSPath & path() const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+            int fd() const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+            /**
+             * Call the function for every entry in the directory.
+             *
+             * Honours fsio_include_dotfiles, fsio_inode_sort, fsio_first_only,
+             * fsio_want_directories, fsio_want_regular_files and
+             * fsio_deref_symlinks_for_wants, as for FSIterator. Entries are
+             * given sorted by name, or by inode and then name with
+             * fsio_inode_sort. With just fsio_first_only, the first wanted
+             * entry the kernel returns is given.
+             */
+            void walk(const FSIteratorOptions &, const std::function<void (const FSDirEntry &)> &) const;
+
+            /**
+             * Stat something in our directory, relative to our fd, without
+             * following symlinks.
+             */
+            FSStat stat_entry(const std::string &) const PALUDIS_ATTRIBUTE((warn_unused_result));
+    };
+
+    extern template class Pimp<FSDirWalker>;
+}
+
+#endif
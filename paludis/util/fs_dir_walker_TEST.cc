@@ -0,0 +1,121 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2026 agent
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <paludis/util/fs_dir_walker.hh>
+#include <paludis/util/fs_iterator.hh>
+#include <paludis/util/fs_path.hh>
+#include <paludis/util/fs_stat.hh>
+#include <paludis/util/fs_error.hh>
+#include <paludis/util/options.hh>
+#include <paludis/util/join.hh>
+
+#include <algorithm>
+#include <vector>
+#include <string>
+
+#include <gtest/gtest.h>
+
+using namespace paludis;
+
+namespace
+{
+    std::string names(const FSDirWalker & w, const FSIteratorOptions & o)
+    {
+        std::vector<std::string> result;
+        w.walk(o, [&] (const FSDirEntry & e) { result.push_back(e.name_string()); });
+        std::sort(result.begin(), result.end());
+        return join(result.begin(), result.end(), " ");
+    }
+}
+
+TEST(FSDirWalker, Open)
+{
+    EXPECT_THROW(FSDirWalker(FSPath("/i/dont/exist/")), FSError);
+    EXPECT_THROW(FSDirWalker(FSPath("fs_dir_walker_TEST_dir/file1")), FSError);
+
+    FSDirWalker w(FSPath("fs_dir_walker_TEST_dir"));
+    EXPECT_THROW(FSDirWalker(w, "file1"), FSError);
+    EXPECT_THROW(FSDirWalker(w, "link2"), FSError);
+
+    FSDirWalker d(w, "dir1");
+    EXPECT_EQ(FSPath("fs_dir_walker_TEST_dir/dir1"), d.path());
+    EXPECT_EQ("file5", names(d, { }));
+
+    FSDirWalker l(w, "link1");
+    EXPECT_EQ("file5", names(l, { }));
+}
+
+TEST(FSDirWalker, Walk)
+{
+    FSDirWalker w(FSPath("fs_dir_walker_TEST_dir"));
+
+    EXPECT_EQ("dir1 file1 file2 link1 link2 many", names(w, { }));
+    EXPECT_EQ(".file3 dir1 file1 file2 link1 link2 many", names(w, { fsio_include_dotfiles }));
+    EXPECT_EQ("file1 file2", names(w, { fsio_want_regular_files }));
+    EXPECT_EQ("dir1 many", names(w, { fsio_want_directories }));
+    EXPECT_EQ("dir1 link1 many", names(w, { fsio_want_directories, fsio_deref_symlinks_for_wants }));
+    EXPECT_EQ("dir1 file1 file2 link1 many", names(w, { fsio_want_directories, fsio_want_regular_files,
+                fsio_deref_symlinks_for_wants }));
+
+    int count(0);
+    w.walk({ fsio_first_only }, [&] (const FSDirEntry &) { ++count; });
+    EXPECT_EQ(1, count);
+}
+
+TEST(FSDirWalker, Types)
+{
+    FSDirWalker w(FSPath("fs_dir_walker_TEST_dir"));
+
+    w.walk({ fsio_include_dotfiles }, [&] (const FSDirEntry & e) {
+            FSStat s(e.path());
+            EXPECT_EQ(s.is_directory(), e.is_directory()) << e.name();
+            EXPECT_EQ(s.is_regular_file(), e.is_regular_file()) << e.name();
+            EXPECT_EQ(s.is_symlink(), e.is_symlink()) << e.name();
+            EXPECT_EQ(s.lowlevel_id(), e.stat().lowlevel_id()) << e.name();
+            EXPECT_EQ(s.lowlevel_id().second, e.inode()) << e.name();
+            });
+
+    EXPECT_TRUE(w.stat_entry("link1").is_symlink());
+    EXPECT_TRUE(! w.stat_entry("nothing").exists());
+}
+
+TEST(FSDirWalker, Many)
+{
+    FSDirWalker w(FSPath("fs_dir_walker_TEST_dir/many"));
+
+    std::vector<std::string> walked, iterated;
+    ino_t last(0);
+    w.walk({ fsio_inode_sort }, [&] (const FSDirEntry & e) {
+            EXPECT_LE(last, e.inode());
+            last = e.inode();
+            walked.push_back(e.name_string());
+            });
+
+    for (FSIterator i(FSPath("fs_dir_walker_TEST_dir/many"), { }), i_end ; i != i_end ; ++i)
+        iterated.push_back(i->basename());
+
+    /* without an inode sort, we come out in the same order as FSIterator */
+    std::vector<std::string> by_name;
+    w.walk({ }, [&] (const FSDirEntry & e) { by_name.push_back(e.name_string()); });
+    EXPECT_EQ(iterated, by_name);
+
+    std::sort(walked.begin(), walked.end());
+    EXPECT_EQ(2000u, walked.size());
+    EXPECT_EQ(iterated, walked);
+}
@@ -0,0 +1,8 @@
+#!/usr/bin/env bash
+# vim: set ft=sh sw=4 sts=4 et :
+
+if [ -d fs_dir_walker_TEST_dir ] ; then
+    rm -fr fs_dir_walker_TEST_dir
+else
+    true
+fi
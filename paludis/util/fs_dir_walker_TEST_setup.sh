@@ -0,0 +1,14 @@
+#!/usr/bin/env bash
+# vim: set ft=sh sw=4 sts=4 et :
+
+mkdir fs_dir_walker_TEST_dir || exit 2
+cd fs_dir_walker_TEST_dir || exit 3
+touch file1 file2 .file3 || exit 4
+mkdir dir1 || exit 5
+touch dir1/file5 || exit 6
+ln -s dir1 link1 || exit 7
+ln -s nowhere link2 || exit 8
+mkdir many || exit 9
+for a in $(seq 1 2000) ; do
+    > many/file_with_a_reasonably_long_name_${a}
+done
@@ -28,6 +28,8 @@
 #include <cerrno>
 #include <cstring>
 
+#include <fcntl.h>
+
 using namespace paludis;
 
 namespace paludis
@@ -58,6 +60,19 @@ namespace paludis
             else
                 exists = true;
         }
+
+        Imp(const FSPath & p, const int dir_fd, const std::string & name) :
+            path(p),
+            exists(false)
+        {
+            if (0 != ::fstatat(dir_fd, name.c_str(), &st, AT_SYMLINK_NOFOLLOW))
+            {
+                if (errno != ENOENT && errno != ENOTDIR)
+                    throw FSError("Error running stat() on '" + stringify(p) + "': " + strerror(errno));
+            }
+            else
+                exists = true;
+        }
     };
 }
 
@@ -67,6 +82,11 @@ FSStat::FSStat(const FSPath & p) :
 {
 }
 
+FSStat::FSStat(const FSPath & p, const int dir_fd, const std::string & name) :
+    _imp(p, dir_fd, name)
+{
+}
+
 FSStat::FSStat(const FSStat & p) :
     _imp(p._imp->path, p._imp->exists, p._imp->st)
 {
@@ -28,6 +28,7 @@
 #include <paludis/util/attributes.hh>
 #include <paludis/util/timestamp-fwd.hh>
 #include <utility>
+#include <string>
 #include <sys/stat.h>
 
 namespace paludis
@@ -40,6 +41,14 @@ namespace paludis
         public:
             explicit FSStat(const FSPath &);
 
+            /**
+             * Stat name relative to the directory open as dir_fd, using
+             * path only for reporting.
+             *
+             * \since 3.0
+             */
+            FSStat(const FSPath & path, const int dir_fd, const std::string & name);
+
             FSStat(const FSStat &);
 
             FSStat & operator= (const FSStat &);
@@ -23,9 +23,8 @@
 #include <paludis/util/pool.hh>
 #include <paludis/util/hashes.hh>
 #include <paludis/util/stringify.hh>
-#include <unordered_map>
+#include <paludis/util/concurrent_map.hh>
 #include <memory>
-#include <mutex>
 
 namespace paludis
 {
@@ -49,14 +48,7 @@ namespace paludis
     template <typename T_>
     struct Imp<Pool<T_> >
     {
-        mutable std::mutex mutex;
-        mutable std::unordered_map<PoolKeys, std::shared_ptr<const T_>, PoolKeysHasher, PoolKeysComparator> store;
-        mutable unsigned reused;
-
-        Imp() :
-            reused(0)
-        {
-        }
+        mutable ConcurrentMap<PoolKeys, std::shared_ptr<const T_>, PoolKeysHasher, PoolKeysComparator> store;
     };
 
     template <typename T_>
@@ -92,17 +84,10 @@ namespace paludis
         PoolKeys keys;
         keys.add(args...);
 
-        std::unique_lock<std::mutex> lock(_imp->mutex);
-        auto i(_imp->store.find(keys));
-        if (i == _imp->store.end())
-        {
-            /* std::make_shared<> doesn't play well with private ctors */
-            i = _imp->store.insert(std::make_pair(keys, std::shared_ptr<const T_>(new T_(PreventConversion<Args_>(args)...)))).first;
-        }
-        else
-            ++_imp->reused;
-
-        return i->second;
+        return _imp->store.find_or_insert(keys, [&] () {
+                /* std::make_shared<> doesn't play well with private ctors */
+                return std::shared_ptr<const T_>(new T_(PreventConversion<Args_>(args)...));
+                });
     }
 
     template <typename T_>
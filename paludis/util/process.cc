@@ -30,14 +30,20 @@
 #include <paludis/util/env_var_names.hh>
 
 #include <iostream>
+#include <sstream>
 #include <functional>
 #include <algorithm>
 #include <vector>
 #include <map>
+#include <set>
+#include <list>
+#include <deque>
 #include <cstdlib>
 #include <cstring>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
+#include <exception>
 
 #include <errno.h>
 #include <unistd.h>
@@ -48,8 +54,10 @@
 #include <limits.h>
 #include <sys/types.h>
 #include <sys/wait.h>
-#include <sys/select.h>
 #include <sys/ioctl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
 
 using namespace paludis;
 
@@ -477,12 +485,23 @@ ProcessCommand::exec(int err_fd)
     _exit(1);
 }
 
+namespace
+{
+    class OutputSink;
+    class ProcessReactor;
+}
+
 namespace paludis
 {
+    /* Despite the name, there is no longer a thread per running process. All
+     * running processes' pipes are serviced by a single ProcessReactor
+     * thread, except for pipe commands, which get a thread of their own
+     * because handlers can be slow and can start processes of their own, and
+     * output streams that might block, which get an OutputSink. While a pipe
+     * command is being handled, the reactor leaves that process's output
+     * alone, since the handler may write to the same streams. */
     struct RunningProcessThread
     {
-        Pipe ctl_pipe;
-
         std::unique_ptr<SafeOFStream> own_capture_stdout;
         std::unique_ptr<SafeOFStream> own_capture_stderr;
 
@@ -497,12 +516,20 @@ namespace paludis
         std::string prefix_stderr_buffer;
 
         bool extra_newlines_if_any_output_exists;
+        bool done_extra_newlines_stdout;
+        bool done_extra_newlines_stderr;
 
         std::ostream * capture_output_to_fd;
         std::unique_ptr<Pipe> capture_output_to_fd_pipe;
 
+        /* owned by the reactor, and null if it writes to the stream itself */
+        OutputSink * stdout_sink;
+        OutputSink * stderr_sink;
+        OutputSink * output_to_fd_sink;
+
         std::istream * send_input_to_fd;
         std::unique_ptr<Pipe> send_input_to_fd_pipe;
+        std::string input_stream_pending;
 
         ProcessPipeCommandFunction pipe_command_handler;
         std::unique_ptr<Pipe> pipe_command_handler_command_pipe;
@@ -511,301 +538,955 @@ namespace paludis
 
         bool as_main_process;
 
+        ProcessReactor * reactor;
+
+        /* only touched by the reactor thread, or with the reactor's mutex held */
+        bool want_to_finish;
+        bool finished;
+        std::exception_ptr error;
+        unsigned pipe_commands_in_flight;
+
+        std::mutex pipe_commands_mutex;
+        std::condition_variable pipe_commands_condition;
+        std::deque<std::string> pipe_commands;
+        bool no_more_pipe_commands;
+        std::exception_ptr pipe_command_error;
+
         /* must be last, so the thread gets join()ed before its FDs vanish */
-        std::thread thread;
+        std::thread pipe_commands_thread;
 
         RunningProcessThread() :
-            ctl_pipe(true),
             capture_stdout(nullptr),
             capture_stderr(nullptr),
+            extra_newlines_if_any_output_exists(false),
+            done_extra_newlines_stdout(false),
+            done_extra_newlines_stderr(false),
             capture_output_to_fd(nullptr),
+            stdout_sink(nullptr),
+            stderr_sink(nullptr),
+            output_to_fd_sink(nullptr),
             send_input_to_fd(nullptr),
-            as_main_process(false)
+            as_main_process(false),
+            reactor(nullptr),
+            want_to_finish(false),
+            finished(false),
+            pipe_commands_in_flight(0),
+            no_more_pipe_commands(false)
         {
         }
 
         ~RunningProcessThread()
         {
-            if (thread.joinable())
-                thread.join();
+            stop_pipe_commands();
         }
 
-        void thread_func();
-
         void start();
+        void finish();
+
+        void stop_pipe_commands()
+        {
+            {
+                std::unique_lock<std::mutex> lock(pipe_commands_mutex);
+                no_more_pipe_commands = true;
+            }
+            pipe_commands_condition.notify_all();
+
+            if (pipe_commands_thread.joinable())
+                pipe_commands_thread.join();
+        }
+
+        void queue_pipe_command(const std::string &);
+        void pipe_commands_thread_func();
     };
 }
 
-void
-RunningProcessThread::thread_func()
+namespace
 {
-    bool prefix_stdout_buffer_has_newline(false), prefix_stderr_buffer_has_newline(false), want_to_finish(true);
-    bool done_extra_newlines_stdout(false), done_extra_newlines_stderr(false);
-    std::string input_stream_pending;
+    /* level triggered, so a chatty child can't starve anyone else if we
+     * only do a bounded amount of work for each ready FD each time round */
+    const int reads_per_wakeup = 16;
+    const std::size_t io_buffer_size = 65536;
+    const std::size_t splice_size = 1 << 20;
+    const std::size_t sink_buffer_size = 1 << 20;
+
+    enum ReactorFDKind
+    {
+        rfk_stdout,
+        rfk_stderr,
+        rfk_output_to_fd,
+        rfk_input_to_fd,
+        rfk_pipe_command
+    };
+
+    struct ReactorFD
+    {
+        RunningProcessThread * process;
+        ReactorFDKind kind;
+        int fd;
+
+        /* if non-negative, we can splice straight into this file */
+        int splice_to_fd;
 
-    if (as_main_process && send_input_to_fd)
-        want_to_finish = false;
+        /* not being watched until its OutputSink has room */
+        bool paused;
+
+        /* not being watched until a pipe command has been handled */
+        bool held;
+    };
 
-    bool done(false);
-    while (! done)
+    void set_nonblocking(const int fd)
     {
-        fd_set read_fds, write_fds;
-        int max_fd(0);
-        FD_ZERO(&read_fds);
-        FD_ZERO(&write_fds);
+        int arg(::fcntl(fd, F_GETFL, NULL));
+        if (-1 == arg)
+            throw ProcessError("fcntl(F_GETFL) failed");
+        if (-1 == ::fcntl(fd, F_SETFL, arg | O_NONBLOCK))
+            throw ProcessError("fcntl(F_SETFL) failed");
+    }
 
-        if (want_to_finish)
-        {
-            FD_SET(ctl_pipe.read_fd(), &read_fds);
-            max_fd = std::max(max_fd, ctl_pipe.read_fd());
-        }
+    /* If output can go straight to a regular file with no mangling, we can
+     * splice it there rather than copying it through userspace. */
+    int find_splice_target(std::ostream * const stream, const Channel * const channel, const std::string & prefix)
+    {
+        if ((! prefix.empty()) || ! dynamic_cast<const Pipe *>(channel))
+            return -1;
 
-        if (capture_stdout_pipe)
-        {
-            FD_SET(capture_stdout_pipe->read_fd(), &read_fds);
-            max_fd = std::max(max_fd, capture_stdout_pipe->read_fd());
-        }
+        SafeOFStreamBuf * buf(dynamic_cast<SafeOFStreamBuf *>(stream->rdbuf()));
+        if (! buf)
+            return -1;
 
-        if (capture_stderr_pipe)
-        {
-            FD_SET(capture_stderr_pipe->read_fd(), &read_fds);
-            max_fd = std::max(max_fd, capture_stderr_pipe->read_fd());
-        }
+        struct stat s;
+        if (-1 == ::fstat(buf->fd, &s) || ! S_ISREG(s.st_mode))
+            return -1;
 
-        if (capture_output_to_fd)
-        {
-            FD_SET(capture_output_to_fd_pipe->read_fd(), &read_fds);
-            max_fd = std::max(max_fd, capture_output_to_fd_pipe->read_fd());
-        }
+        return buf->fd;
+    }
 
-        if (send_input_to_fd)
-        {
-            FD_SET(send_input_to_fd_pipe->write_fd(), &write_fds);
-            max_fd = std::max(max_fd, send_input_to_fd_pipe->write_fd());
-        }
+    /* Writes to regular files and to strings don't block for long, so the
+     * reactor can do those itself. */
+    bool can_write_directly(std::ostream * const stream)
+    {
+        if (dynamic_cast<std::stringbuf *>(stream->rdbuf()))
+            return true;
 
-        if (pipe_command_handler)
-        {
-            FD_SET(pipe_command_handler_command_pipe->read_fd(), &read_fds);
-            max_fd = std::max(max_fd, pipe_command_handler_command_pipe->read_fd());
-        }
+        SafeOFStreamBuf * buf(dynamic_cast<SafeOFStreamBuf *>(stream->rdbuf()));
+        if (! buf)
+            return false;
 
-        int retval(::pselect(max_fd + 1, &read_fds, &write_fds, nullptr, nullptr, nullptr));
-        if (-1 == retval)
-            throw ProcessError("pselect() failed");
+        struct stat s;
+        return 0 == ::fstat(buf->fd, &s) && S_ISREG(s.st_mode);
+    }
 
-        bool done_anything(false);
-        char buf[4096];
+    /* Anything else might be a pipe or a terminal whose reader is in no
+     * hurry, and if the reactor waited for it, every other child would wait
+     * too. So output for such a stream is queued up here, and a thread of its
+     * own writes it. Everyone writing to the same stream shares a sink, so
+     * there's still only one writer. */
+    class OutputSink
+    {
+        private:
+            std::ostream & _stream;
+            const std::function<void ()> _on_room;
 
-        if (capture_stdout_pipe && FD_ISSET(capture_stdout_pipe->read_fd(), &read_fds))
-        {
-            int n(::read(capture_stdout_pipe->read_fd(), &buf, sizeof(buf)));
-            if (-1 == n)
-                throw ProcessError("read() capture_stdout_pipe read_fd failed");
-            else if (0 != n)
+            std::mutex _mutex;
+            std::condition_variable _condition;
+            std::string _pending;
+            unsigned long long _queued;
+            unsigned long long _written;
+            bool _was_full;
+            bool _done;
+            std::exception_ptr _error;
+
+            std::thread _thread;
+
+            void _run()
             {
-                if (prefix_stdout.empty())
-                    capture_stdout->write(buf, n);
-                else
+                std::unique_lock<std::mutex> lock(_mutex);
+                while (true)
                 {
-                    std::string s(buf, n);
-                    prefix_stdout_buffer.append(s);
-                    if (std::string::npos != s.find('\n'))
-                        prefix_stdout_buffer_has_newline = true;
+                    _condition.wait(lock, [&] { return _done || ! _pending.empty(); });
+                    if (_pending.empty())
+                        return;
+
+                    std::string data;
+                    data.swap(_pending);
+                    bool was_full(_was_full);
+                    _was_full = false;
+                    lock.unlock();
+
+                    try
+                    {
+                        if (was_full)
+                            _on_room();
+
+                        if (! _error)
+                            _stream.write(data.data(), data.length());
+                    }
+                    catch (...)
+                    {
+                        _error = std::current_exception();
+                    }
+
+                    lock.lock();
+                    _written += data.length();
+                    _condition.notify_all();
                 }
             }
-            done_anything = true;
-        }
 
-        if (capture_stderr_pipe && FD_ISSET(capture_stderr_pipe->read_fd(), &read_fds))
-        {
-            int n(::read(capture_stderr_pipe->read_fd(), &buf, sizeof(buf)));
-            if (-1 == n)
-                throw ProcessError("read() capture_stderr_pipe read_fd failed");
-            else if (0 != n)
+        public:
+            /* only touched with the reactor's mutex held */
+            unsigned users;
+
+            /* on_room is called once there's space again after full() */
+            OutputSink(std::ostream & s, const std::function<void ()> & on_room) :
+                _stream(s),
+                _on_room(on_room),
+                _queued(0),
+                _written(0),
+                _was_full(false),
+                _done(false),
+                _thread(std::bind(&OutputSink::_run, this)),
+                users(0)
+            {
+            }
+
+            ~OutputSink()
             {
-                if (prefix_stderr.empty())
-                    capture_stderr->write(buf, n);
-                else
                 {
-                    std::string s(buf, n);
-                    prefix_stderr_buffer.append(s);
-                    if (std::string::npos != s.find('\n'))
-                        prefix_stderr_buffer_has_newline = true;
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    _done = true;
                 }
+                _condition.notify_all();
+                _thread.join();
             }
-            done_anything = true;
-        }
 
-        if (capture_output_to_fd_pipe && FD_ISSET(capture_output_to_fd_pipe->read_fd(), &read_fds))
-        {
-            int n(::read(capture_output_to_fd_pipe->read_fd(), &buf, sizeof(buf)));
-            if (-1 == n)
-                throw ProcessError("read() capture_output_to_fd_pipe read_fd failed");
-            else if (0 != n)
-                capture_output_to_fd->write(buf, n);
-            done_anything = true;
-        }
+            void write(const char * const data, const std::size_t n)
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _pending.append(data, n);
+                _queued += n;
+                _condition.notify_all();
+            }
 
-        if (send_input_to_fd && FD_ISSET(send_input_to_fd_pipe->write_fd(), &write_fds))
-        {
-            while ((! input_stream_pending.empty()) || send_input_to_fd->good())
+            /* if so, stop reading until on_room gets called */
+            bool full()
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                if (_pending.length() < sink_buffer_size)
+                    return false;
+                _was_full = true;
+                return true;
+            }
+
+            /* waits for everything queued so far to be written */
+            std::exception_ptr flush()
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                const unsigned long long target(_queued);
+                _condition.wait(lock, [&] { return _written >= target; });
+                return _error;
+            }
+    };
+
+    class ProcessReactor
+    {
+        private:
+            int _epoll_fd;
+            int _wake_fd;
+
+            std::mutex _mutex;
+            std::condition_variable _condition;
+            std::list<RunningProcessThread *> _finish_requests;
+            std::map<RunningProcessThread *, std::list<ReactorFD> > _fds;
+            std::map<std::ostream *, std::unique_ptr<OutputSink> > _sinks;
+            bool _any_paused;
+            std::exception_ptr _error;
+
+            std::thread _thread;
+
+            void _wake()
+            {
+                uint64_t one(1);
+                if (sizeof(one) != ::write(_wake_fd, &one, sizeof(one)) && errno != EAGAIN)
+                    throw ProcessError("write() to reactor eventfd failed");
+            }
+
+            void _watch(RunningProcessThread * const p, std::list<ReactorFD> & fds, const ReactorFDKind kind, const int fd,
+                    const uint32_t events, const int splice_to_fd)
+            {
+                set_nonblocking(fd);
+                fds.push_back(ReactorFD{p, kind, fd, splice_to_fd, false, false});
+
+                struct epoll_event e;
+                std::memset(&e, 0, sizeof(e));
+                e.events = events;
+                e.data.ptr = &fds.back();
+                if (-1 == ::epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, fd, &e))
+                    throw ProcessError("epoll_ctl(EPOLL_CTL_ADD) failed: " + stringify(::strerror(errno)));
+            }
+
+            void _unwatch(RunningProcessThread * const p, const ReactorFDKind kind)
+            {
+                auto & fds(_fds[p]);
+                for (auto f(fds.begin()), f_end(fds.end()) ; f != f_end ; ++f)
+                    if (f->kind == kind)
+                    {
+                        ::epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, f->fd, nullptr);
+                        fds.erase(f);
+                        break;
+                    }
+            }
+
+            void _watch_again(ReactorFD & f)
             {
-                if (input_stream_pending.empty() && send_input_to_fd->good())
+                struct epoll_event e;
+                std::memset(&e, 0, sizeof(e));
+                e.events = EPOLLIN;
+                e.data.ptr = &f;
+                if (-1 == ::epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, f.fd, &e))
+                    throw ProcessError("epoll_ctl(EPOLL_CTL_ADD) failed: " + stringify(::strerror(errno)));
+            }
+
+            OutputSink * _sink_for(const ReactorFD & f)
+            {
+                switch (f.kind)
                 {
-                    send_input_to_fd->read(buf, sizeof(buf));
-                    input_stream_pending.assign(buf, send_input_to_fd->gcount());
+                    case rfk_stdout:
+                        return f.process->stdout_sink;
+                    case rfk_stderr:
+                        return f.process->stderr_sink;
+                    case rfk_output_to_fd:
+                        return f.process->output_to_fd_sink;
+                    case rfk_input_to_fd:
+                    case rfk_pipe_command:
+                        return nullptr;
                 }
 
-                int w(::write(send_input_to_fd_pipe->write_fd(), input_stream_pending.data(),
-                            input_stream_pending.length()));
-
-                if (0 == w || (-1 == w && (errno == EAGAIN || errno == EWOULDBLOCK)))
-                    break;
-                else if (-1 == w)
-                    throw ProcessError("write() send_input_to_fd_pipe write_fd failed");
-                else
-                    input_stream_pending.erase(0, w);
+                throw InternalError(PALUDIS_HERE, "bad ReactorFDKind");
             }
 
-            if (input_stream_pending.empty() && ! send_input_to_fd->good())
+            OutputSink * _acquire_sink(std::ostream * const stream)
             {
-                if (0 != ::close(send_input_to_fd_pipe->write_fd()))
-                    throw ProcessError("close() send_input_to_fd_pipe write_fd failed");
-                send_input_to_fd_pipe->clear_write_fd();
-                send_input_to_fd = nullptr;
-                want_to_finish = true;
+                if (can_write_directly(stream))
+                    return nullptr;
+
+                auto & sink(_sinks[stream]);
+                if (! sink)
+                    sink.reset(new OutputSink(*stream, [this] () { _wake(); }));
+                ++sink->users;
+                return sink.get();
             }
 
-            done_anything = true;
-        }
+            void _write(std::ostream & stream, OutputSink * const sink, const char * const data, const std::size_t n)
+            {
+                if (sink)
+                    sink->write(data, n);
+                else
+                    stream.write(data, n);
+            }
 
-        if (pipe_command_handler && FD_ISSET(pipe_command_handler_command_pipe->read_fd(), &read_fds))
-        {
-            int n(::read(pipe_command_handler_command_pipe->read_fd(), &buf, sizeof(buf)));
-            if (-1 == n)
-                throw ProcessError("read() pipe_command_handler_command_pipe read_fd failed");
-            else if (0 != n)
-                pipe_command_handler_buffer.append(buf, n);
-            done_anything = true;
-        }
+            void _write_prefixed(std::ostream & stream, OutputSink * const sink, const std::string & prefix, std::string & buffer,
+                    const bool extra_newlines, bool & done_extra_newlines)
+            {
+                std::string out;
+                while (true)
+                {
+                    std::string::size_type p(buffer.find('\n'));
+                    if (std::string::npos == p)
+                        break;
 
-        while (! pipe_command_handler_buffer.empty())
-        {
-            std::string::size_type n_p(pipe_command_handler_buffer.find('\0'));
-            if (std::string::npos == n_p)
-                break;
+                    if (extra_newlines)
+                    {
+                        if (! done_extra_newlines)
+                            out.append("\n");
+                        done_extra_newlines = true;
+                    }
 
-            std::string op(pipe_command_handler_buffer.substr(0, n_p));
-            pipe_command_handler_buffer.erase(0, n_p + 1);
+                    out.append(prefix);
+                    out.append(buffer, 0, p + 1);
+                    buffer.erase(0, p + 1);
+                }
 
-            std::string response(pipe_command_handler(op));
+                if (! out.empty())
+                    _write(stream, sink, out.data(), out.length());
+            }
 
-            ssize_t n(0);
-            while (! response.empty())
+            /* returns false if there's nothing more to read for now */
+            bool _read_one(ReactorFD & f)
             {
-                n = write(pipe_command_handler_response_pipe->write_fd(), response.c_str(), response.length());
+                RunningProcessThread & p(*f.process);
+
+                if (-1 != f.splice_to_fd)
+                {
+                    std::ostream & stream(rfk_stdout == f.kind ? *p.capture_stdout : rfk_stderr == f.kind ? *p.capture_stderr :
+                            *p.capture_output_to_fd);
+                    static_cast<SafeOFStreamBuf *>(stream.rdbuf())->write_buffered();
+
+                    ssize_t n(::splice(f.fd, nullptr, f.splice_to_fd, nullptr, splice_size, SPLICE_F_MOVE | SPLICE_F_NONBLOCK));
+                    if (n > 0)
+                        return true;
+                    else if (0 == n || errno == EAGAIN)
+                        return false;
+                    else if (errno != EINTR)
+                    {
+                        Log::get_instance()->message("util.process.splice_failed", ll_debug, lc_no_context)
+                            << "splice() to fd " << f.splice_to_fd << " failed: " << ::strerror(errno) << ", copying instead";
+                        f.splice_to_fd = -1;
+                    }
+                    return true;
+                }
+
+                char buf[io_buffer_size];
+                ssize_t n(::read(f.fd, buf, sizeof(buf)));
                 if (-1 == n)
-                    throw ProcessError("write() pipe_command_handler_response_pipe write_fd failed");
-                else
-                    response.erase(0, n);
+                {
+                    if (errno == EAGAIN || errno == EWOULDBLOCK)
+                        return false;
+                    else if (errno == EINTR)
+                        return true;
+                    else
+                        throw ProcessError("read() from child process failed: " + stringify(::strerror(errno)));
+                }
+                else if (0 == n)
+                    return false;
+
+                switch (f.kind)
+                {
+                    case rfk_stdout:
+                        if (p.prefix_stdout.empty())
+                            _write(*p.capture_stdout, p.stdout_sink, buf, n);
+                        else
+                        {
+                            p.prefix_stdout_buffer.append(buf, n);
+                            _write_prefixed(*p.capture_stdout, p.stdout_sink, p.prefix_stdout, p.prefix_stdout_buffer,
+                                    p.extra_newlines_if_any_output_exists, p.done_extra_newlines_stdout);
+                        }
+                        break;
+
+                    case rfk_stderr:
+                        if (p.prefix_stderr.empty())
+                            _write(*p.capture_stderr, p.stderr_sink, buf, n);
+                        else
+                        {
+                            p.prefix_stderr_buffer.append(buf, n);
+                            _write_prefixed(*p.capture_stderr, p.stderr_sink, p.prefix_stderr, p.prefix_stderr_buffer,
+                                    p.extra_newlines_if_any_output_exists, p.done_extra_newlines_stderr);
+                        }
+                        break;
+
+                    case rfk_output_to_fd:
+                        _write(*p.capture_output_to_fd, p.output_to_fd_sink, buf, n);
+                        break;
+
+                    case rfk_pipe_command:
+                        p.pipe_command_handler_buffer.append(buf, n);
+                        while (true)
+                        {
+                            std::string::size_type n_p(p.pipe_command_handler_buffer.find('\0'));
+                            if (std::string::npos == n_p)
+                                break;
+
+                            std::string command(p.pipe_command_handler_buffer.substr(0, n_p));
+                            p.pipe_command_handler_buffer.erase(0, n_p + 1);
+                            _hand_over_pipe_command(p, command);
+                        }
+                        break;
+
+                    case rfk_input_to_fd:
+                        throw InternalError(PALUDIS_HERE, "read from input fd");
+                }
+
+                return true;
             }
 
-            char c(0);
-            n = write(pipe_command_handler_response_pipe->write_fd(), &c, 1);
-            if (1 != n)
-                throw ProcessError("write() pipe_command_handler_response_pipe write_fd failed");
-        }
+            /* Anything the child wrote before sending the command has to come
+             * out before whatever the handler writes, and nothing it writes
+             * afterwards may be written while the handler is running, so read
+             * what's there and then stop listening until the handler is done. */
+            void _hand_over_pipe_command(RunningProcessThread & p, const std::string & command)
+            {
+                for (auto & f : _fds[&p])
+                {
+                    if (rfk_input_to_fd == f.kind || rfk_pipe_command == f.kind || f.held)
+                        continue;
 
-        if (prefix_stdout_buffer_has_newline)
-        {
-            while (true)
+                    while (_read_one(f))
+                    {
+                    }
+
+                    if (! f.paused)
+                        ::epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, f.fd, nullptr);
+                    f.held = true;
+                }
+
+                ++p.pipe_commands_in_flight;
+                p.queue_pipe_command(command);
+            }
+
+            /* Only ask the istream for more input when the child has room
+             * for it, so a slow reader can't make us buffer without limit. */
+            void _write_input(ReactorFD & f)
             {
-                std::string::size_type p(prefix_stdout_buffer.find('\n'));
-                if (std::string::npos == p)
-                    break;
+                RunningProcessThread & p(*f.process);
 
-                if (extra_newlines_if_any_output_exists)
+                for (int i(0) ; i < reads_per_wakeup ; ++i)
                 {
-                    if (! done_extra_newlines_stdout)
-                        capture_stdout->write("\n", 1);
-                    done_extra_newlines_stdout = true;
+                    if (p.input_stream_pending.empty())
+                    {
+                        if (! p.send_input_to_fd->good())
+                            break;
+
+                        char buf[io_buffer_size];
+                        p.send_input_to_fd->read(buf, sizeof(buf));
+                        p.input_stream_pending.assign(buf, p.send_input_to_fd->gcount());
+                        if (p.input_stream_pending.empty())
+                            continue;
+                    }
+
+                    ssize_t w(::write(f.fd, p.input_stream_pending.data(), p.input_stream_pending.length()));
+                    if (0 == w || (-1 == w && (errno == EAGAIN || errno == EWOULDBLOCK)))
+                        return;
+                    else if (-1 == w && errno == EINTR)
+                        continue;
+                    else if (-1 == w)
+                        throw ProcessError("write() send_input_to_fd_pipe write_fd failed");
+                    else
+                        p.input_stream_pending.erase(0, w);
                 }
 
-                capture_stdout->write(prefix_stdout.data(), prefix_stdout.length());
-                capture_stdout->write(prefix_stdout_buffer.data(), p + 1);
-                prefix_stdout_buffer.erase(0, p + 1);
+                if (p.input_stream_pending.empty() && ! p.send_input_to_fd->good())
+                    _close_input(p);
             }
 
-            prefix_stdout_buffer_has_newline = false;
-        }
+            void _close_input(RunningProcessThread & p)
+            {
+                _unwatch(&p, rfk_input_to_fd);
+                if (0 != ::close(p.send_input_to_fd_pipe->write_fd()))
+                    throw ProcessError("close() send_input_to_fd_pipe write_fd failed");
+                p.send_input_to_fd_pipe->clear_write_fd();
+                p.send_input_to_fd = nullptr;
+            }
 
-        if (prefix_stderr_buffer_has_newline)
-        {
-            while (true)
+            /* must be called with _mutex held */
+            bool _try_finish(RunningProcessThread & p)
             {
-                std::string::size_type p(prefix_stderr_buffer.find('\n'));
-                if (std::string::npos == p)
-                    break;
+                if (0 != p.pipe_commands_in_flight)
+                    return false;
 
-                if (extra_newlines_if_any_output_exists)
+                try
+                {
+                    if (! p.error)
+                    {
+                        if (p.send_input_to_fd)
+                        {
+                            /* when we're the main process, nothing else will
+                             * feed our input to the child, so we have to wait */
+                            if (p.as_main_process)
+                                return false;
+                            _close_input(p);
+                        }
+
+                        for (auto & f : _fds[&p])
+                            if (rfk_input_to_fd != f.kind)
+                                while (_read_one(f))
+                                {
+                                }
+
+                        /* a last command turned up, so let it be handled first */
+                        if (0 != p.pipe_commands_in_flight)
+                            return false;
+
+                        if (! p.prefix_stdout_buffer.empty())
+                        {
+                            p.prefix_stdout_buffer.append("\n");
+                            _write_prefixed(*p.capture_stdout, p.stdout_sink, p.prefix_stdout, p.prefix_stdout_buffer,
+                                    p.extra_newlines_if_any_output_exists, p.done_extra_newlines_stdout);
+                        }
+
+                        if (! p.prefix_stderr_buffer.empty())
+                        {
+                            p.prefix_stderr_buffer.append("\n");
+                            _write_prefixed(*p.capture_stderr, p.stderr_sink, p.prefix_stderr, p.prefix_stderr_buffer,
+                                    p.extra_newlines_if_any_output_exists, p.done_extra_newlines_stderr);
+                        }
+
+                        if (p.extra_newlines_if_any_output_exists)
+                        {
+                            if (p.done_extra_newlines_stdout)
+                                _write(*p.capture_stdout, p.stdout_sink, "\n", 1);
+                            if (p.done_extra_newlines_stderr)
+                                _write(*p.capture_stderr, p.stderr_sink, "\n", 1);
+                        }
+                    }
+                }
+                catch (...)
                 {
-                    if (! done_extra_newlines_stderr)
-                        capture_stderr->write("\n", 1);
-                    done_extra_newlines_stderr = true;
+                    p.error = std::current_exception();
                 }
 
-                capture_stderr->write(prefix_stderr.data(), prefix_stderr.length());
-                capture_stderr->write(prefix_stderr_buffer.data(), p + 1);
-                prefix_stderr_buffer.erase(0, p + 1);
+                for (auto & f : _fds[&p])
+                    ::epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, f.fd, nullptr);
+                _fds.erase(&p);
+
+                p.finished = true;
+                return true;
             }
 
-            prefix_stderr_buffer_has_newline = false;
-        }
+            void _run()
+            {
+                std::vector<struct epoll_event> events(64);
+                std::set<RunningProcessThread *> failed;
+
+                while (true)
+                {
+                    int n(::epoll_wait(_epoll_fd, &events[0], events.size(), -1));
+                    if (-1 == n)
+                    {
+                        if (errno == EINTR)
+                            continue;
+                        throw ProcessError("epoll_wait() failed: " + stringify(::strerror(errno)));
+                    }
 
-        if (done_anything)
-            continue;
+                    std::unique_lock<std::mutex> lock(_mutex);
 
-        /* don't do this until nothing else has anything to do */
-        if (FD_ISSET(ctl_pipe.read_fd(), &read_fds))
-        {
-            /* haxx: flush our buffers first */
-            if (! prefix_stdout_buffer.empty())
+                    for (int i(0) ; i < n ; ++i)
+                    {
+                        if (! events[i].data.ptr)
+                        {
+                            uint64_t count;
+                            if (-1 == ::read(_wake_fd, &count, sizeof(count)) && errno != EAGAIN)
+                                throw ProcessError("read() from reactor eventfd failed");
+                            continue;
+                        }
+
+                        ReactorFD & f(*static_cast<ReactorFD *>(events[i].data.ptr));
+                        RunningProcessThread * const p(f.process);
+                        if (failed.count(p))
+                            continue;
+
+                        try
+                        {
+                            if (rfk_input_to_fd == f.kind)
+                                _write_input(f);
+                            else
+                            {
+                                OutputSink * const sink(_sink_for(f));
+                                for (int r(0) ; r < reads_per_wakeup ; ++r)
+                                {
+                                    if (! _read_one(f))
+                                        break;
+
+                                    /* leave the rest in the pipe, so the child
+                                     * waits rather than us buffering without limit */
+                                    if (sink && sink->full())
+                                    {
+                                        ::epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, f.fd, nullptr);
+                                        f.paused = true;
+                                        _any_paused = true;
+                                        break;
+                                    }
+                                }
+                            }
+                        }
+                        catch (...)
+                        {
+                            /* stop listening to this process, and tell
+                             * whoever wait()s for it what went wrong */
+                            p->error = std::current_exception();
+                            for (auto & g : _fds[p])
+                            {
+                                ::epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, g.fd, nullptr);
+                                g.paused = false;
+                                g.held = false;
+                            }
+                            failed.insert(p);
+                        }
+                    }
+                    failed.clear();
+
+                    if (_any_paused)
+                    {
+                        _any_paused = false;
+                        for (auto & fds : _fds)
+                            for (auto & f : fds.second)
+                                if (f.paused)
+                                {
+                                    if (_sink_for(f)->full())
+                                        _any_paused = true;
+                                    else
+                                    {
+                                        f.paused = false;
+                                        if (! f.held)
+                                            _watch_again(f);
+                                    }
+                                }
+                    }
+
+                    bool any_finished(false);
+                    for (auto r(_finish_requests.begin()), r_end(_finish_requests.end()) ; r != r_end ; )
+                    {
+                        if (_try_finish(**r))
+                        {
+                            _finish_requests.erase(r++);
+                            any_finished = true;
+                        }
+                        else
+                            ++r;
+                    }
+
+                    if (any_finished)
+                        _condition.notify_all();
+                }
+            }
+
+        public:
+            ProcessReactor() :
+                _epoll_fd(::epoll_create1(EPOLL_CLOEXEC)),
+                _wake_fd(::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+                _any_paused(false)
             {
-                prefix_stdout_buffer.append("\n");
-                prefix_stdout_buffer_has_newline = true;
-                continue;
+                if (-1 == _epoll_fd)
+                    throw ProcessError("epoll_create1() failed: " + stringify(::strerror(errno)));
+                if (-1 == _wake_fd)
+                    throw ProcessError("eventfd() failed: " + stringify(::strerror(errno)));
+
+                struct epoll_event e;
+                std::memset(&e, 0, sizeof(e));
+                e.events = EPOLLIN;
+                e.data.ptr = nullptr;
+                if (-1 == ::epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, _wake_fd, &e))
+                    throw ProcessError("epoll_ctl(EPOLL_CTL_ADD) failed: " + stringify(::strerror(errno)));
+
+                _thread = std::thread([this] () noexcept {
+                        try
+                        {
+                            _run();
+                        }
+                        catch (...)
+                        {
+                            /* anyone waiting for a process gets this from
+                             * wait(), and new processes get a new reactor */
+                            std::unique_lock<std::mutex> lock(_mutex);
+                            _error = std::current_exception();
+                            _condition.notify_all();
+                        }
+                    });
+                _thread.detach();
             }
 
-            if (! prefix_stderr_buffer.empty())
+            void add(RunningProcessThread * const p)
             {
-                prefix_stderr_buffer.append("\n");
-                prefix_stderr_buffer_has_newline = true;
-                continue;
+                std::unique_lock<std::mutex> lock(_mutex);
+                auto & fds(_fds[p]);
+
+                if (p->capture_stdout_pipe)
+                    p->stdout_sink = _acquire_sink(p->capture_stdout);
+                if (p->capture_stderr_pipe)
+                    p->stderr_sink = _acquire_sink(p->capture_stderr);
+                if (p->capture_output_to_fd_pipe)
+                    p->output_to_fd_sink = _acquire_sink(p->capture_output_to_fd);
+
+                if (p->capture_stdout_pipe)
+                    _watch(p, fds, rfk_stdout, p->capture_stdout_pipe->read_fd(), EPOLLIN,
+                            find_splice_target(p->capture_stdout, p->capture_stdout_pipe.get(), p->prefix_stdout));
+                if (p->capture_stderr_pipe)
+                    _watch(p, fds, rfk_stderr, p->capture_stderr_pipe->read_fd(), EPOLLIN,
+                            find_splice_target(p->capture_stderr, p->capture_stderr_pipe.get(), p->prefix_stderr));
+                if (p->capture_output_to_fd_pipe)
+                    _watch(p, fds, rfk_output_to_fd, p->capture_output_to_fd_pipe->read_fd(), EPOLLIN,
+                            find_splice_target(p->capture_output_to_fd, p->capture_output_to_fd_pipe.get(), ""));
+                if (p->send_input_to_fd)
+                    _watch(p, fds, rfk_input_to_fd, p->send_input_to_fd_pipe->write_fd(), EPOLLOUT, -1);
+                if (p->pipe_command_handler)
+                    _watch(p, fds, rfk_pipe_command, p->pipe_command_handler_command_pipe->read_fd(), EPOLLIN, -1);
             }
 
-            char c('?');
-            if (1 != ::read(ctl_pipe.read_fd(), &c, 1))
-                throw ProcessError("read() on our ctl pipe failed");
-            else if (c != 'x')
-                throw ProcessError("read() on our ctl pipe gave '" + std::string(1, c) + "' not 'x'");
-            done = true;
-        }
-    }
+            void finish(RunningProcessThread * const p)
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _finish_requests.push_back(p);
+                _wake();
+                _condition.wait(lock, [&] { return p->finished || _error; });
+                if (! p->finished)
+                {
+                    p->error = _error;
+                    p->finished = true;
+                }
+            }
+
+            /* the handler for one of p's pipe commands has finished, so its
+             * output can be written again */
+            void pipe_command_done(RunningProcessThread * const p)
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                if (0 != --p->pipe_commands_in_flight)
+                    return;
+
+                auto fds(_fds.find(p));
+                if (_fds.end() != fds)
+                    for (auto & f : fds->second)
+                        if (f.held)
+                        {
+                            f.held = false;
+                            try
+                            {
+                                if (! f.paused)
+                                    _watch_again(f);
+                            }
+                            catch (...)
+                            {
+                                if (! p->error)
+                                    p->error = std::current_exception();
+                            }
+                        }
+
+                _wake();
+            }
+
+            bool failed()
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                return bool(_error);
+            }
 
-    if (extra_newlines_if_any_output_exists)
+            /* waits for everything finish() wrote for p to reach its streams,
+             * without holding anyone else up while it does */
+            std::exception_ptr release(RunningProcessThread * const p)
+            {
+                OutputSink * const sinks[] = { p->stdout_sink, p->stderr_sink, p->output_to_fd_sink };
+                p->stdout_sink = p->stderr_sink = p->output_to_fd_sink = nullptr;
+
+                std::exception_ptr result;
+                for (auto & sink : sinks)
+                    if (sink)
+                    {
+                        std::exception_ptr e(sink->flush());
+                        if (e && ! result)
+                            result = e;
+                    }
+
+                std::list<std::unique_ptr<OutputSink> > unused;
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    for (auto & sink : sinks)
+                        if (sink && 0 == --sink->users)
+                            for (auto s(_sinks.begin()), s_end(_sinks.end()) ; s != s_end ; ++s)
+                                if (s->second.get() == sink)
+                                {
+                                    unused.push_back(std::move(s->second));
+                                    _sinks.erase(s);
+                                    break;
+                                }
+                }
+
+                return result;
+            }
+
+            /* the reactor thread doesn't survive a fork, so a child that
+             * carries on using Process needs a reactor of its own, as does
+             * anyone coming along after a reactor has failed. we never
+             * destroy old reactors, since their locks may be held by threads
+             * that no longer exist, or by processes still using them. */
+            static ProcessReactor & get_instance()
+            {
+                static std::mutex mutex;
+                static ProcessReactor * instance(nullptr);
+                static pid_t owner(0);
+
+                std::unique_lock<std::mutex> lock(mutex);
+                if ((! instance) || owner != ::getpid() || instance->failed())
+                {
+                    instance = new ProcessReactor;
+                    owner = ::getpid();
+                }
+                return *instance;
+            }
+    };
+}
+
+void
+RunningProcessThread::queue_pipe_command(const std::string & command)
+{
+    std::unique_lock<std::mutex> lock(pipe_commands_mutex);
+    pipe_commands.push_back(command);
+    if (! pipe_commands_thread.joinable())
+        pipe_commands_thread = std::thread(std::bind(&RunningProcessThread::pipe_commands_thread_func, this));
+    pipe_commands_condition.notify_all();
+}
+
+void
+RunningProcessThread::pipe_commands_thread_func()
+{
+    while (true)
     {
-        if (done_extra_newlines_stdout)
-            capture_stdout->write("\n", 1);
-        if (done_extra_newlines_stderr)
-            capture_stderr->write("\n", 1);
+        std::string command;
+        {
+            std::unique_lock<std::mutex> lock(pipe_commands_mutex);
+            pipe_commands_condition.wait(lock, [&] { return no_more_pipe_commands || ! pipe_commands.empty(); });
+            if (pipe_commands.empty())
+                return;
+            command = pipe_commands.front();
+            pipe_commands.pop_front();
+        }
+
+        /* the handler may write to our output streams, so anything the
+         * reactor has already queued up for them goes first */
+        for (OutputSink * const sink : { stdout_sink, stderr_sink, output_to_fd_sink })
+            if (sink)
+                sink->flush();
+
+        std::string response;
+        try
+        {
+            response = pipe_command_handler(command);
+        }
+        catch (...)
+        {
+            /* still answer, so the child isn't left waiting forever */
+            std::unique_lock<std::mutex> lock(pipe_commands_mutex);
+            if (! pipe_command_error)
+                pipe_command_error = std::current_exception();
+        }
+        response.append(1, '\0');
+
+        while (! response.empty())
+        {
+            ssize_t n(::write(pipe_command_handler_response_pipe->write_fd(), response.c_str(), response.length()));
+            if (-1 == n && errno == EINTR)
+                continue;
+            else if (-1 == n)
+            {
+                Log::get_instance()->message("util.process.pipe_command_response_failed", ll_warning, lc_no_context)
+                    << "write() pipe_command_handler_response_pipe write_fd failed: " << ::strerror(errno);
+                break;
+            }
+            else
+                response.erase(0, n);
+        }
+
+        reactor->pipe_command_done(this);
     }
 }
 
 void
 RunningProcessThread::start()
 {
-    thread = std::thread(std::bind(&RunningProcessThread::thread_func, this));
+    reactor = &ProcessReactor::get_instance();
+    reactor->add(this);
+}
+
+void
+RunningProcessThread::finish()
+{
+    reactor->finish(this);
+    stop_pipe_commands();
+    std::exception_ptr output_error(reactor->release(this));
+
+    if (error)
+        std::rethrow_exception(error);
+    if (pipe_command_error)
+        std::rethrow_exception(pipe_command_error);
+    if (output_error)
+        std::rethrow_exception(output_error);
 }
 
 namespace paludis
@@ -961,13 +1642,6 @@ Process::run()
         {
             thread->send_input_to_fd = _imp->send_input_to_fd_stream;
             thread->send_input_to_fd_pipe.reset(new Pipe(true));
-
-            int arg(::fcntl(thread->send_input_to_fd_pipe->write_fd(), F_GETFL, NULL));
-            if (-1 == arg)
-                throw ProcessError("fcntl(F_GETFL) failed");
-            arg |= O_NONBLOCK;
-            if (-1 == ::fcntl(thread->send_input_to_fd_pipe->write_fd(), F_SETFL, arg))
-                throw ProcessError("fcntl(F_SETFL) failed");
         }
 
         if (_imp->pipe_command_handler)
@@ -1096,7 +1770,8 @@ Process::run()
             const int src_fd(thread->capture_output_to_fd_pipe->write_fd());
             const int tgt_fd(_imp->capture_output_to_fd_fd);
 
-            if (-1 == tgt_fd)
+            /* dup2 onto itself leaves FD_CLOEXEC alone */
+            if (-1 == tgt_fd || src_fd == tgt_fd)
             {
                 int flags = ::fcntl(src_fd, F_GETFD);
                 if (-1 == flags || -1 == ::fcntl(src_fd, F_SETFD, flags & ~FD_CLOEXEC))
@@ -1120,7 +1795,8 @@ Process::run()
             const int src_fd(thread->send_input_to_fd_pipe->read_fd());
             const int tgt_fd(_imp->send_input_to_fd_fd);
 
-            if (-1 == tgt_fd)
+            /* dup2 onto itself leaves FD_CLOEXEC alone */
+            if (-1 == tgt_fd || src_fd == tgt_fd)
             {
                 int flags = ::fcntl(src_fd, F_GETFD);
                 if (-1 == flags || -1 == ::fcntl(src_fd, F_SETFD, flags & ~FD_CLOEXEC))
@@ -1446,11 +2122,8 @@ RunningProcessHandle::wait()
 
     if (_imp->thread)
     {
-        char c('x');
-        if (1 != ::write(_imp->thread->ctl_pipe.write_fd(), &c, 1))
-            throw ProcessError("write() on our ctl pipe failed");
-
-        _imp->thread.reset();
+        std::unique_ptr<RunningProcessThread> thread(std::move(_imp->thread));
+        thread->finish();
     }
 
     if (actually_wait)
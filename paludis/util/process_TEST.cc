@@ -24,6 +24,10 @@
 #include <paludis/util/stringify.hh>
 
 #include <sstream>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <thread>
 #include <sys/types.h>
 #include <pwd.h>
 
@@ -46,6 +50,59 @@ namespace
         else
             return "9";
     }
+
+    /* like a terminal that somebody has paused */
+    class StuckBuf :
+        public std::streambuf
+    {
+        private:
+            std::mutex _mutex;
+            std::condition_variable _condition;
+            bool _entered;
+            bool _released;
+
+        public:
+            std::string text;
+
+            StuckBuf() :
+                _entered(false),
+                _released(false)
+            {
+            }
+
+            std::streamsize xsputn(const char * s, std::streamsize n) override
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _entered = true;
+                _condition.notify_all();
+                _condition.wait(lock, [&] { return _released; });
+                text.append(s, n);
+                return n;
+            }
+
+            int_type overflow(int_type c) override
+            {
+                if (! traits_type::eq_int_type(c, traits_type::eof()))
+                {
+                    char ch(traits_type::to_char_type(c));
+                    xsputn(&ch, 1);
+                }
+                return traits_type::not_eof(c);
+            }
+
+            void wait_until_entered()
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _condition.wait(lock, [&] { return _entered; });
+            }
+
+            void release()
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _released = true;
+                _condition.notify_all();
+            }
+    };
 }
 
 TEST(Process, True)
@@ -136,6 +193,26 @@ TEST(Process, GrabStdoutLong)
     ASSERT_TRUE(! std::getline(stdout_stream, s));
 }
 
+TEST(Process, StuckStdoutDoesNotBlockOthers)
+{
+    StuckBuf stuck_buf;
+    std::ostream stuck_stream(&stuck_buf);
+    Process stuck_process(ProcessCommand({"echo", "stuck"}));
+    stuck_process.capture_stdout(stuck_stream);
+    RunningProcessHandle stuck_handle(stuck_process.run());
+    stuck_buf.wait_until_entered();
+
+    std::stringstream stdout_stream;
+    Process echo_process(ProcessCommand({"echo", "monkey"}));
+    echo_process.capture_stdout(stdout_stream);
+    EXPECT_EQ(0, echo_process.run().wait());
+    EXPECT_EQ("monkey\n", stdout_stream.str());
+
+    stuck_buf.release();
+    EXPECT_EQ(0, stuck_handle.wait());
+    EXPECT_EQ("stuck\n", stuck_buf.text);
+}
+
 TEST(Process, Setenv)
 {
     std::stringstream stdout_stream;
@@ -270,6 +347,69 @@ TEST(Process, CapturedPipeCommand)
     ASSERT_TRUE(! std::getline(stdout_stream, line));
 }
 
+namespace
+{
+    /* not a stringbuf or a file, so the reactor hands writes to it to a
+     * thread of its own, and slow enough that they'd get left behind */
+    struct SlowStringBuf :
+        std::streambuf
+    {
+        std::string str;
+
+        int_type overflow(int_type c) override
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            if (traits_type::eof() != c)
+                str.push_back(traits_type::to_char_type(c));
+            return traits_type::not_eof(c);
+        }
+
+        std::streamsize xsputn(const char * s, std::streamsize n) override
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            str.append(s, n);
+            return n;
+        }
+    };
+}
+
+TEST(Process, PipeCommandOutputOrder)
+{
+    SlowStringBuf stdout_buf;
+    std::ostream stdout_stream(&stdout_buf);
+    Process process(ProcessCommand({ "bash", "-c",
+                "for i in 1 2 3 4 5 6 7 8 ; do "
+                "    echo before $i ; "
+                "    printf '%s\\0' $i 1>&$PALUDIS_PIPE_COMMAND_WRITE_FD ; "
+                "    read -d $'\\0' -u $PALUDIS_PIPE_COMMAND_READ_FD r ; "
+                "    echo after $r ; "
+                "done" }));
+    process.capture_stdout(stdout_stream);
+    process.pipe_command_handler("PALUDIS_PIPE_COMMAND", [&] (const std::string & s) -> std::string {
+            stdout_stream << "handler " << s << std::endl;
+            return s;
+            });
+    EXPECT_EQ(0, process.run().wait());
+
+    std::string expected;
+    for (int i(1) ; i <= 8 ; ++i)
+        expected += "before " + stringify(i) + "\nhandler " + stringify(i) + "\nafter " + stringify(i) + "\n";
+    EXPECT_EQ(expected, stdout_buf.str);
+}
+
+TEST(Process, PipeCommandThrows)
+{
+    Process process(ProcessCommand({ "bash", "-c",
+                "printf 'x\\0' 1>&$PALUDIS_PIPE_COMMAND_WRITE_FD ; "
+                "read -d $'\\0' -u $PALUDIS_PIPE_COMMAND_READ_FD r ; "
+                "exit 3" }));
+    process.pipe_command_handler("PALUDIS_PIPE_COMMAND", [&] (const std::string &) -> std::string {
+            throw ProcessError("handler failed");
+            });
+    RunningProcessHandle handle(process.run());
+    EXPECT_THROW(int PALUDIS_ATTRIBUTE((unused)) dummy(handle.wait()), ProcessError);
+}
+
 TEST(Process, PrefixStdout)
 {
     std::stringstream stdout_stream;
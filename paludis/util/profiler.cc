@@ -0,0 +1,310 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2026 agent
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <paludis/util/profiler.hh>
+#include <paludis/util/pimp-impl.hh>
+#include <paludis/util/singleton-impl.hh>
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+using namespace paludis;
+
+namespace
+{
+    struct Times
+    {
+        unsigned long long calls;
+        std::chrono::steady_clock::duration total;
+
+        Times() :
+            calls(0),
+            total(std::chrono::steady_clock::duration::zero())
+        {
+        }
+    };
+
+    struct Lookups
+    {
+        unsigned long long hits;
+        unsigned long long misses;
+
+        Lookups() :
+            hits(0),
+            misses(0)
+        {
+        }
+    };
+
+    typedef std::map<std::string, Times> TimesByName;
+
+    /* most expensive first, and then by name so that output is stable */
+    std::vector<std::pair<std::string, Times> > sorted(const TimesByName & t, const unsigned limit)
+    {
+        std::vector<std::pair<std::string, Times> > result(t.begin(), t.end());
+        std::stable_sort(result.begin(), result.end(), [] (
+                    const std::pair<std::string, Times> & a, const std::pair<std::string, Times> & b) {
+                return a.second.total > b.second.total;
+                });
+
+        if (result.size() > limit)
+            result.resize(limit);
+        return result;
+    }
+
+    unsigned long long microseconds(const std::chrono::steady_clock::duration & d)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+    }
+
+    std::string json_string(const std::string & s)
+    {
+        std::string result("\"");
+        for (const auto & c : s)
+        {
+            switch (c)
+            {
+                case '"':
+                case '\\':
+                    result.append(1, '\\');
+                    result.append(1, c);
+                    break;
+
+                case '\n':
+                    result.append("\\n");
+                    break;
+
+                case '\t':
+                    result.append("\\t");
+                    break;
+
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20)
+                    {
+                        static const char hex[] = "0123456789abcdef";
+                        result.append("\\u00");
+                        result.append(1, hex[(c >> 4) & 0xf]);
+                        result.append(1, hex[c & 0xf]);
+                    }
+                    else
+                        result.append(1, c);
+            }
+        }
+        result.append(1, '"');
+        return result;
+    }
+
+    void write_times_json(std::ostream & s, const std::pair<std::string, Times> & t, const std::string & what)
+    {
+        s << "{ " << json_string(what) << ": " << json_string(t.first)
+            << ", \"calls\": " << t.second.calls
+            << ", \"total_us\": " << microseconds(t.second.total) << " }";
+    }
+}
+
+namespace paludis
+{
+    template <>
+    struct Imp<Profiler>
+    {
+        mutable std::mutex mutex;
+
+        TimesByName phases;
+        std::map<std::string, TimesByName> subjects_by_phase;
+        std::map<std::string, Lookups> caches;
+        std::map<std::string, unsigned long long> counters;
+    };
+}
+
+std::atomic<bool> Profiler::_enabled(false);
+
+Profiler::Profiler() :
+    _imp()
+{
+}
+
+Profiler::~Profiler() = default;
+
+void
+Profiler::enable()
+{
+    _enabled.store(true);
+}
+
+void
+Profiler::add_time(const std::string & phase, const std::string & subject, const std::chrono::steady_clock::duration & d)
+{
+    std::unique_lock<std::mutex> lock(_imp->mutex);
+
+    Times & p(_imp->phases[phase]);
+    ++p.calls;
+    p.total += d;
+
+    if (! subject.empty())
+    {
+        Times & s(_imp->subjects_by_phase[phase][subject]);
+        ++s.calls;
+        s.total += d;
+    }
+}
+
+void
+Profiler::add_cache_lookup(const std::string & cache, const bool hit)
+{
+    std::unique_lock<std::mutex> lock(_imp->mutex);
+
+    Lookups & c(_imp->caches[cache]);
+    if (hit)
+        ++c.hits;
+    else
+        ++c.misses;
+}
+
+void
+Profiler::add_count(const std::string & counter, const unsigned long n)
+{
+    std::unique_lock<std::mutex> lock(_imp->mutex);
+    _imp->counters[counter] += n;
+}
+
+void
+Profiler::set_count(const std::string & counter, const unsigned long long n)
+{
+    std::unique_lock<std::mutex> lock(_imp->mutex);
+    _imp->counters[counter] = n;
+}
+
+void
+Profiler::clear()
+{
+    std::unique_lock<std::mutex> lock(_imp->mutex);
+    _imp->phases.clear();
+    _imp->subjects_by_phase.clear();
+    _imp->caches.clear();
+    _imp->counters.clear();
+}
+
+void
+Profiler::write_table(std::ostream & s, const unsigned top_n) const
+{
+    std::unique_lock<std::mutex> lock(_imp->mutex);
+
+    s << std::left << std::setw(50) << "Phase" << std::right << std::setw(12) << "Calls"
+        << std::setw(14) << "Total ms" << std::setw(12) << "Mean us" << std::endl;
+    for (const auto & p : sorted(_imp->phases, _imp->phases.size()))
+        s << std::left << std::setw(50) << p.first << std::right << std::setw(12) << p.second.calls
+            << std::setw(14) << std::fixed << std::setprecision(1) << microseconds(p.second.total) / 1000.0
+            << std::setw(12) << microseconds(p.second.total) / std::max(1ull, p.second.calls) << std::endl;
+
+    if (! _imp->caches.empty())
+    {
+        s << std::endl;
+        s << std::left << std::setw(50) << "Cache" << std::right << std::setw(12) << "Hits"
+            << std::setw(14) << "Misses" << std::setw(12) << "Hit rate" << std::endl;
+        for (const auto & c : _imp->caches)
+            s << std::left << std::setw(50) << c.first << std::right << std::setw(12) << c.second.hits
+                << std::setw(14) << c.second.misses << std::setw(11) << std::fixed << std::setprecision(1)
+                << (100.0 * c.second.hits) / std::max(1ull, c.second.hits + c.second.misses) << "%" << std::endl;
+    }
+
+    if (! _imp->counters.empty())
+    {
+        s << std::endl;
+        s << std::left << std::setw(50) << "Counter" << std::right << std::setw(12) << "Count" << std::endl;
+        for (const auto & c : _imp->counters)
+            s << std::left << std::setw(50) << c.first << std::right << std::setw(12) << c.second << std::endl;
+    }
+
+    for (const auto & p : _imp->subjects_by_phase)
+    {
+        s << std::endl;
+        s << "Most expensive for " << p.first << ":" << std::endl;
+        for (const auto & t : sorted(p.second, top_n))
+            s << std::right << std::setw(14) << std::fixed << std::setprecision(1) << microseconds(t.second.total) / 1000.0
+                << " ms" << std::setw(8) << t.second.calls << "x  " << t.first << std::endl;
+    }
+
+    s << std::left;
+}
+
+void
+Profiler::write_json(std::ostream & s, const unsigned top_n) const
+{
+    std::unique_lock<std::mutex> lock(_imp->mutex);
+
+    s << "{" << std::endl;
+
+    s << "  \"phases\": [";
+    bool first(true);
+    for (const auto & p : sorted(_imp->phases, _imp->phases.size()))
+    {
+        s << (first ? "\n    " : ",\n    ");
+        write_times_json(s, p, "name");
+        first = false;
+    }
+    s << "\n  ]," << std::endl;
+
+    s << "  \"caches\": [";
+    first = true;
+    for (const auto & c : _imp->caches)
+    {
+        s << (first ? "\n    " : ",\n    ") << "{ \"name\": " << json_string(c.first)
+            << ", \"hits\": " << c.second.hits << ", \"misses\": " << c.second.misses << " }";
+        first = false;
+    }
+    s << "\n  ]," << std::endl;
+
+    s << "  \"counters\": {";
+    first = true;
+    for (const auto & c : _imp->counters)
+    {
+        s << (first ? "\n    " : ",\n    ") << json_string(c.first) << ": " << c.second;
+        first = false;
+    }
+    s << "\n  }," << std::endl;
+
+    s << "  \"most_expensive\": {";
+    first = true;
+    for (const auto & p : _imp->subjects_by_phase)
+    {
+        s << (first ? "\n    " : ",\n    ") << json_string(p.first) << ": [";
+        bool first_subject(true);
+        for (const auto & t : sorted(p.second, top_n))
+        {
+            s << (first_subject ? "\n      " : ",\n      ");
+            write_times_json(s, t, "subject");
+            first_subject = false;
+        }
+        s << "\n    ]";
+        first = false;
+    }
+    s << "\n  }" << std::endl;
+
+    s << "}" << std::endl;
+}
+
+namespace paludis
+{
+    template class Pimp<Profiler>;
+    template class Singleton<Profiler>;
+}
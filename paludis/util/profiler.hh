@@ -0,0 +1,177 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2026 agent
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef PALUDIS_GUARD_PALUDIS_UTIL_PROFILER_HH
+#define PALUDIS_GUARD_PALUDIS_UTIL_PROFILER_HH 1
+
+#include <paludis/util/profiler-fwd.hh>
+#include <paludis/util/attributes.hh>
+#include <paludis/util/pimp.hh>
+#include <paludis/util/singleton.hh>
+#include <atomic>
+#include <chrono>
+#include <iosfwd>
+#include <string>
+
+namespace paludis
+{
+    extern template class Pimp<Profiler>;
+    extern template class PALUDIS_VISIBLE Singleton<Profiler>;
+
+    /**
+     * Gathers timings and counters from hot code paths, so that we can find
+     * out where a slow operation spends its time.
+     *
+     * Profiling is off unless enable() is called. Whilst it is off,
+     * instrumented code pays for a single relaxed atomic load and nothing
+     * else, so there is no need to compile instrumentation out.
+     *
+     * Phase times include the time spent in any phases nested inside them.
+     *
+     * \see ProfileTimer
+     * \ingroup g_utils
+     * \since 3.0
+     */
+    class PALUDIS_VISIBLE Profiler :
+        public Singleton<Profiler>
+    {
+        friend class Singleton<Profiler>;
+
+        private:
+            Pimp<Profiler> _imp;
+
+            static std::atomic<bool> _enabled;
+
+            Profiler();
+            ~Profiler();
+
+        public:
+            /**
+             * Is anyone collecting results?
+             */
+            static bool enabled()
+            {
+                return _enabled.load(std::memory_order_relaxed);
+            }
+
+            /**
+             * Start collecting results.
+             */
+            void enable();
+
+            /**
+             * Record that a phase took a certain amount of time. If subject is
+             * not empty, the time is also attributed to that subject, for the
+             * most expensive subjects list.
+             */
+            void add_time(const std::string & phase, const std::string & subject,
+                    const std::chrono::steady_clock::duration &);
+
+            /**
+             * Record a lookup in a named cache.
+             */
+            void add_cache_lookup(const std::string & cache, const bool hit);
+
+            /**
+             * Add to a named counter.
+             */
+            void add_count(const std::string & counter, const unsigned long n = 1);
+
+            /**
+             * Set a named counter, for values which are gathered elsewhere
+             * and only copied in here to be reported.
+             */
+            void set_count(const std::string & counter, const unsigned long long n);
+
+            /**
+             * Forget everything we have collected so far.
+             */
+            void clear();
+
+            /**
+             * Write our results as human readable tables, including the
+             * top_n most expensive subjects for each phase that has them.
+             */
+            void write_table(std::ostream &, const unsigned top_n) const;
+
+            /**
+             * Write our results as a JSON object.
+             */
+            void write_json(std::ostream &, const unsigned top_n) const;
+    };
+
+    /**
+     * Times a phase for the Profiler, from construction until destruction,
+     * if profiling is enabled.
+     *
+     * \ingroup g_utils
+     * \since 3.0
+     */
+    class PALUDIS_VISIBLE ProfileTimer
+    {
+        private:
+            const char * const _phase;
+            const bool _active;
+            std::string _subject;
+            std::chrono::steady_clock::time_point _start;
+
+        public:
+            ///\name Basic operations
+            ///\{
+
+            explicit ProfileTimer(const char * const phase) :
+                _phase(phase),
+                _active(Profiler::enabled())
+            {
+                if (_active)
+                    _start = std::chrono::steady_clock::now();
+            }
+
+            ~ProfileTimer()
+            {
+                if (_active)
+                    Profiler::get_instance()->add_time(_phase, _subject, std::chrono::steady_clock::now() - _start);
+            }
+
+            ProfileTimer(const ProfileTimer &) = delete;
+            ProfileTimer & operator= (const ProfileTimer &) = delete;
+
+            ///\}
+
+            /**
+             * Are we recording? Callers should check this before doing any
+             * work to produce a subject.
+             */
+            bool active() const
+            {
+                return _active;
+            }
+
+            /**
+             * Attribute our time to a subject, as well as to our phase.
+             */
+            void set_subject(const std::string & s)
+            {
+                _subject = s;
+            }
+    };
+}
+
+#endif
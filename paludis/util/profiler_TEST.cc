@@ -0,0 +1,82 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2026 agent
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <paludis/util/profiler.hh>
+
+#include <sstream>
+
+#include <gtest/gtest.h>
+
+using namespace paludis;
+
+TEST(Profiler, Disabled)
+{
+    ASSERT_FALSE(Profiler::enabled());
+    {
+        ProfileTimer timer("disabled");
+        EXPECT_FALSE(timer.active());
+    }
+
+    std::stringstream s;
+    Profiler::get_instance()->write_table(s, 10);
+    EXPECT_EQ(std::string::npos, s.str().find("disabled"));
+}
+
+TEST(Profiler, Enabled)
+{
+    Profiler::get_instance()->enable();
+    Profiler::get_instance()->clear();
+
+    for (int i(0) ; i < 3 ; ++i)
+    {
+        ProfileTimer timer("phase");
+        EXPECT_TRUE(timer.active());
+        timer.set_subject(i == 2 ? "b" : "a");
+    }
+    Profiler::get_instance()->add_cache_lookup("cache", true);
+    Profiler::get_instance()->add_cache_lookup("cache", false);
+    Profiler::get_instance()->add_count("counter", 5);
+
+    std::stringstream t;
+    Profiler::get_instance()->write_table(t, 1);
+    EXPECT_NE(std::string::npos, t.str().find("phase"));
+    EXPECT_NE(std::string::npos, t.str().find("50.0%"));
+    EXPECT_NE(std::string::npos, t.str().find("Most expensive for phase:"));
+
+    std::stringstream j;
+    Profiler::get_instance()->write_json(j, 10);
+    EXPECT_NE(std::string::npos, j.str().find("{ \"name\": \"phase\", \"calls\": 3, "));
+    EXPECT_NE(std::string::npos, j.str().find("{ \"name\": \"cache\", \"hits\": 1, \"misses\": 1 }"));
+    EXPECT_NE(std::string::npos, j.str().find("\"counter\": 5"));
+    EXPECT_NE(std::string::npos, j.str().find("\"calls\": 2, "));
+}
+
+TEST(Profiler, SetCount)
+{
+    Profiler::get_instance()->enable();
+    Profiler::get_instance()->clear();
+
+    Profiler::get_instance()->set_count("counter", 5);
+    Profiler::get_instance()->set_count("counter", 7);
+
+    std::stringstream j;
+    Profiler::get_instance()->write_json(j, 10);
+    EXPECT_NE(std::string::npos, j.str().find("\"counter\": 7"));
+}
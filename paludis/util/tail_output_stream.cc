@@ -19,30 +19,48 @@
 
 #include <paludis/util/tail_output_stream.hh>
 #include <paludis/util/pimp-impl.hh>
-#include <paludis/util/iterator_funcs.hh>
-#include <functional>
-#include <algorithm>
-#include <list>
+#include <vector>
+#include <cstring>
 #include <mutex>
 
 using namespace paludis;
 
 namespace paludis
 {
+    /* A ring of size + 1 line slots, the last of which is the line currently
+     * being written. Slots are cleared rather than freed when they're
+     * reused, so once every slot has seen a line of a given length, we stop
+     * allocating. */
     template <>
     struct Imp<TailOutputStreamBuf>
     {
-        unsigned int n;
         const unsigned int size;
-        std::list<std::string> tail;
+        std::vector<std::string> lines;
+        unsigned int first;
+        unsigned int n;
 
         std::mutex mutex;
 
         Imp(const unsigned int nn) :
-            n(1),
-            size(nn)
+            size(nn),
+            lines(nn + 1),
+            first(0),
+            n(1)
+        {
+        }
+
+        std::string & current()
+        {
+            return lines[(first + n - 1) % lines.size()];
+        }
+
+        void new_line()
         {
-            tail.push_back("");
+            if (n == lines.size())
+                first = (first + 1) % lines.size();
+            else
+                ++n;
+            current().clear();
         }
     };
 }
@@ -58,34 +76,38 @@ TailOutputStreamBuf::int_type
 TailOutputStreamBuf::overflow(int_type c)
 {
     if (c != traits_type::eof())
-        _append(std::string(1, c));
+    {
+        char cc(c);
+        _append(&cc, 1);
+    }
     return c;
 }
 
 std::streamsize
 TailOutputStreamBuf::xsputn(const char * s, std::streamsize num)
 {
-    _append(std::string(s, num));
+    _append(s, num);
     return num;
 }
 
 void
-TailOutputStreamBuf::_append(const std::string & s)
+TailOutputStreamBuf::_append(const char * s, std::size_t num)
 {
     std::unique_lock<std::mutex> lock(_imp->mutex);
-    for (std::string::size_type p(0), p_end(s.length()) ; p != p_end ; ++p)
+
+    const char * const s_end(s + num);
+    while (s != s_end)
     {
-        if ('\n' == s[p])
+        const char * nl(static_cast<const char *>(std::memchr(s, '\n', s_end - s)));
+        if (! nl)
         {
-            if (++_imp->n > _imp->size + 1)
-            {
-                _imp->tail.pop_front();
-                --_imp->n;
-            }
-            _imp->tail.push_back("");
+            _imp->current().append(s, s_end - s);
+            break;
         }
-        else
-            _imp->tail.back().append(&s[p], 1);
+
+        _imp->current().append(s, nl - s);
+        _imp->new_line();
+        s = nl + 1;
     }
 }
 
@@ -94,19 +116,19 @@ TailOutputStreamBuf::tail(const bool clear)
 {
     std::shared_ptr<Sequence<std::string> > result(std::make_shared<Sequence<std::string>>());
     std::unique_lock<std::mutex> lock(_imp->mutex);
-    for (std::list<std::string>::const_iterator i(_imp->tail.begin()), i_end(_imp->tail.end()), i_last(previous(_imp->tail.end())) ;
-            i != i_end ; ++i)
+    for (unsigned int i(0) ; i < _imp->n ; ++i)
     {
-        if (i == i_last && i->empty())
+        const std::string & line(_imp->lines[(_imp->first + i) % _imp->lines.size()]);
+        if (i == _imp->n - 1 && line.empty())
             continue;
-        result->push_back(*i);
+        result->push_back(line);
     }
 
     if (clear)
     {
-        _imp->tail.clear();
+        _imp->first = 0;
         _imp->n = 1;
-        _imp->tail.push_back("");
+        _imp->current().clear();
     }
 
     return result;
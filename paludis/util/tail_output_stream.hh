@@ -35,7 +35,7 @@ namespace paludis
         private:
             Pimp<TailOutputStreamBuf> _imp;
 
-            void _append(const std::string &);
+            void _append(const char *, std::size_t);
 
         protected:
             virtual int_type
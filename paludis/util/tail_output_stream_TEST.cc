@@ -72,3 +72,36 @@ TEST(TailOutputStream, Works)
     }
 }
 
+
+TEST(TailOutputStream, Chunks)
+{
+    TailOutputStream s(3);
+
+    s.write("one\ntwo\nthr", 11);
+
+    {
+        std::shared_ptr<const Sequence<std::string> > a(s.tail(false));
+        EXPECT_EQ("one/two/thr", join(a->begin(), a->end(), "/"));
+    }
+
+    s.write("ee\nfour\n\nsix\nsev", 16);
+
+    {
+        std::shared_ptr<const Sequence<std::string> > a(s.tail(false));
+        EXPECT_EQ("four//six/sev", join(a->begin(), a->end(), "/"));
+    }
+
+    s << 'e' << 'n' << '\n';
+
+    {
+        std::shared_ptr<const Sequence<std::string> > a(s.tail(true));
+        EXPECT_EQ("/six/seven", join(a->begin(), a->end(), "/"));
+    }
+
+    s << "eight";
+
+    {
+        std::shared_ptr<const Sequence<std::string> > a(s.tail(false));
+        EXPECT_EQ("eight", join(a->begin(), a->end(), "/"));
+    }
+}
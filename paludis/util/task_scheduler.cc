@@ -0,0 +1,413 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2026 agent
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <paludis/util/task_scheduler.hh>
+#include <paludis/util/pimp-impl.hh>
+#include <paludis/util/singleton-impl.hh>
+#include <paludis/util/thread_pool.hh>
+#include <paludis/util/system.hh>
+#include <paludis/util/env_var_names.hh>
+#include <paludis/util/destringify.hh>
+#include <paludis/util/make_named_values.hh>
+#include <paludis/util/log.hh>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace paludis;
+
+namespace
+{
+    /* threads sleeping on one condition. all of this is protected by the
+     * scheduler's sleep_mutex. woken counts sleepers someone has already
+     * notified, so that we don't keep notifying the same sleeper whilst
+     * another one stays asleep */
+    struct Sleepers
+    {
+        std::condition_variable condition;
+        unsigned sleeping;
+        unsigned woken;
+
+        Sleepers() :
+            sleeping(0),
+            woken(0)
+        {
+        }
+
+        bool wake_one()
+        {
+            if (sleeping <= woken)
+                return false;
+
+            ++woken;
+            condition.notify_one();
+            return true;
+        }
+
+        template <typename Pred_>
+        void wait(std::unique_lock<std::mutex> & lock, const Pred_ & pred)
+        {
+            ++sleeping;
+            condition.wait(lock, pred);
+            --sleeping;
+            if (0 != woken)
+                --woken;
+        }
+    };
+}
+
+namespace paludis
+{
+    template <>
+    struct Imp<TaskGroup>
+    {
+        std::atomic<unsigned long> outstanding;
+        std::atomic<unsigned long> queued;
+        std::atomic<bool> cancelled;
+
+        std::mutex exception_mutex;
+        std::exception_ptr exception;
+
+        /* whoever is in TaskGroup::wait for us */
+        Sleepers waiters;
+
+        Imp() :
+            outstanding(0),
+            queued(0),
+            cancelled(false)
+        {
+        }
+    };
+}
+
+namespace
+{
+    struct Task
+    {
+        std::function<void ()> function;
+        Imp<TaskGroup> * group;
+    };
+
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    /* which of the scheduler's queues belongs to the current thread, or -1
+     * if the current thread isn't one of the scheduler's */
+    thread_local int current_worker(-1);
+
+    unsigned concurrency_from_environment()
+    {
+        unsigned result(std::thread::hardware_concurrency());
+
+        std::string jobs(getenv_with_default(env_vars::jobs, ""));
+        if (! jobs.empty())
+        {
+            try
+            {
+                result = destringify<unsigned>(jobs);
+            }
+            catch (const DestringifyError &)
+            {
+                Log::get_instance()->message("util.task_scheduler.bad_jobs", ll_warning, lc_no_context)
+                    << "Ignoring bad value '" << jobs << "' for " << env_vars::jobs;
+            }
+        }
+
+        return std::max(1u, result);
+    }
+}
+
+namespace paludis
+{
+    template <>
+    struct Imp<TaskScheduler>
+    {
+        const unsigned concurrency;
+
+        /* one queue for each of our threads, and then one more at the end
+         * for tasks spawned from elsewhere */
+        std::vector<std::unique_ptr<Queue> > queues;
+        std::atomic<unsigned long> queued;
+
+        std::mutex sleep_mutex;
+        Sleepers idle_workers;
+        bool finished;
+
+        std::atomic<unsigned long long> idle_microseconds;
+        std::atomic<unsigned long long> steals;
+        std::atomic<unsigned long long> tasks;
+
+        /* must come last, so that our threads are joined before anything
+         * they use goes away */
+        ThreadPool threads;
+
+        Imp() :
+            concurrency(concurrency_from_environment()),
+            queued(0),
+            finished(false),
+            idle_microseconds(0),
+            steals(0),
+            tasks(0)
+        {
+            for (unsigned n(0) ; n < concurrency ; ++n)
+                queues.push_back(std::unique_ptr<Queue>(new Queue));
+        }
+
+        unsigned external_queue() const
+        {
+            return queues.size() - 1;
+        }
+
+        void push(const Task & task)
+        {
+            Queue & q(*queues[-1 == current_worker ? external_queue() : current_worker]);
+            {
+                std::unique_lock<std::mutex> lock(q.mutex);
+                q.tasks.push_back(task);
+                ++task.group->queued;
+                ++queued;
+            }
+
+            /* holding the lock makes sure anyone who is about to sleep has
+             * either seen the new task or is already asleep. someone waiting
+             * for the task's group is the best one to run it, since they
+             * can't do anything else */
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            if (! task.group->waiters.wake_one())
+                idle_workers.wake_one();
+        }
+
+        /* take a task, which must belong to only if only is not null */
+        bool pop(Task & task, Imp<TaskGroup> * const only)
+        {
+            auto take([&] (Queue & q, std::deque<Task>::iterator i) {
+                    task = *i;
+                    q.tasks.erase(i);
+                    --task.group->queued;
+                    --queued;
+                    });
+
+            /* newest first from our own queue, to keep nested work together */
+            if (-1 != current_worker)
+            {
+                Queue & q(*queues[current_worker]);
+                std::unique_lock<std::mutex> lock(q.mutex);
+                for (auto i(q.tasks.rbegin()), i_end(q.tasks.rend()) ; i != i_end ; ++i)
+                    if ((! only) || i->group == only)
+                    {
+                        take(q, std::next(i).base());
+                        return true;
+                    }
+            }
+
+            /* then oldest first from everyone else, starting with tasks that
+             * nobody owns */
+            for (unsigned o(0), o_end(queues.size()) ; o != o_end ; ++o)
+            {
+                unsigned n((external_queue() + o) % o_end);
+                if (int(n) == current_worker)
+                    continue;
+
+                Queue & q(*queues[n]);
+                std::unique_lock<std::mutex> lock(q.mutex);
+                for (auto i(q.tasks.begin()), i_end(q.tasks.end()) ; i != i_end ; ++i)
+                    if ((! only) || i->group == only)
+                    {
+                        take(q, i);
+                        if (n != external_queue())
+                            ++steals;
+                        return true;
+                    }
+            }
+
+            return false;
+        }
+
+        void run(const Task & task)
+        {
+            ++tasks;
+
+            if (! task.group->cancelled.load())
+            {
+                try
+                {
+                    task.function();
+                }
+                catch (...)
+                {
+                    std::unique_lock<std::mutex> lock(task.group->exception_mutex);
+                    if (! task.group->exception)
+                        task.group->exception = std::current_exception();
+                    task.group->cancelled.store(true);
+                }
+            }
+
+            /* only the last task needs the lock. wait_for takes it before
+             * returning, so the group can't be destroyed whilst we're still
+             * notifying its waiters */
+            unsigned long outstanding(task.group->outstanding.load());
+            while (outstanding > 1 && ! task.group->outstanding.compare_exchange_weak(outstanding, outstanding - 1))
+                ;
+            if (outstanding > 1)
+                return;
+
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            if (0 == --task.group->outstanding)
+                task.group->waiters.condition.notify_all();
+        }
+
+        void work(const unsigned n) noexcept
+        {
+            current_worker = n;
+
+            Task task;
+            while (true)
+            {
+                if (pop(task, nullptr))
+                {
+                    run(task);
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> lock(sleep_mutex);
+                auto start(std::chrono::steady_clock::now());
+                idle_workers.wait(lock, [&] { return finished || 0 != queued.load(); });
+                idle_microseconds += std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - start).count();
+
+                if (finished && 0 == queued.load())
+                    return;
+            }
+        }
+
+        /* we only run the group's own tasks whilst waiting. the waiting
+         * thread may be holding locks, and a task from somewhere else could
+         * want those locks, or could see whatever they protect half built */
+        void wait_for(Imp<TaskGroup> & group)
+        {
+            Task task;
+            while (0 != group.outstanding.load())
+            {
+                if (pop(task, &group))
+                {
+                    run(task);
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> lock(sleep_mutex);
+                group.waiters.wait(lock, [&] { return 0 == group.outstanding.load() || 0 != group.queued.load(); });
+            }
+
+            /* wait for whoever ran the last task to finish notifying us,
+             * since our caller may destroy the group as soon as we return */
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+        }
+    };
+}
+
+TaskScheduler::TaskScheduler() :
+    _imp()
+{
+    /* the thread calling TaskGroup::wait does work too, so we only need
+     * enough of our own threads to make up the rest */
+    for (unsigned n(0) ; n < _imp->concurrency - 1 ; ++n)
+        _imp->threads.create_thread(std::bind(&Imp<TaskScheduler>::work, _imp.get(), n));
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    {
+        std::unique_lock<std::mutex> lock(_imp->sleep_mutex);
+        _imp->finished = true;
+    }
+    _imp->idle_workers.condition.notify_all();
+}
+
+unsigned
+TaskScheduler::concurrency() const
+{
+    return _imp->concurrency;
+}
+
+TaskSchedulerStatistics
+TaskScheduler::statistics() const
+{
+    return make_named_values<TaskSchedulerStatistics>(
+            n::idle_microseconds() = _imp->idle_microseconds.load(),
+            n::steals() = _imp->steals.load(),
+            n::tasks() = _imp->tasks.load(),
+            n::threads() = _imp->threads.number_of_threads()
+            );
+}
+
+TaskGroup::TaskGroup() :
+    _imp()
+{
+}
+
+TaskGroup::~TaskGroup()
+{
+    cancel();
+    TaskScheduler::get_instance()->_imp->wait_for(*_imp.get());
+}
+
+void
+TaskGroup::spawn(const std::function<void ()> & f)
+{
+    ++_imp->outstanding;
+    TaskScheduler::get_instance()->_imp->push(Task{ f, _imp.get() });
+}
+
+void
+TaskGroup::wait()
+{
+    TaskScheduler::get_instance()->_imp->wait_for(*_imp.get());
+
+    std::unique_lock<std::mutex> lock(_imp->exception_mutex);
+    if (_imp->exception)
+        std::rethrow_exception(_imp->exception);
+}
+
+void
+TaskGroup::cancel()
+{
+    _imp->cancelled.store(true);
+}
+
+bool
+TaskGroup::cancelled() const
+{
+    return _imp->cancelled.load();
+}
+
+namespace paludis
+{
+    template class Pimp<TaskScheduler>;
+    template class Singleton<TaskScheduler>;
+    template class Pimp<TaskGroup>;
+}
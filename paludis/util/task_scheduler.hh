@@ -0,0 +1,191 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2026 agent
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PALUDIS_GUARD_PALUDIS_UTIL_TASK_SCHEDULER_HH
+#define PALUDIS_GUARD_PALUDIS_UTIL_TASK_SCHEDULER_HH 1
+
+#include <paludis/util/task_scheduler-fwd.hh>
+#include <paludis/util/attributes.hh>
+#include <paludis/util/pimp.hh>
+#include <paludis/util/singleton.hh>
+#include <paludis/util/named_value.hh>
+#include <functional>
+#include <memory>
+
+namespace paludis
+{
+    namespace n
+    {
+        typedef Name<struct name_idle_microseconds> idle_microseconds;
+        typedef Name<struct name_steals> steals;
+        typedef Name<struct name_tasks> tasks;
+        typedef Name<struct name_threads> threads;
+    }
+
+    /**
+     * Counters describing what a TaskScheduler has done so far.
+     *
+     * \see TaskScheduler::statistics
+     * \ingroup g_threads
+     * \since 3.0
+     */
+    struct TaskSchedulerStatistics
+    {
+        /// Total time the scheduler's own threads have spent waiting for work.
+        NamedValue<n::idle_microseconds, unsigned long long> idle_microseconds;
+
+        /// How many tasks were taken from another thread's queue.
+        NamedValue<n::steals, unsigned long long> steals;
+
+        /// How many tasks have been run, including cancelled ones.
+        NamedValue<n::tasks, unsigned long long> tasks;
+
+        /// How many threads the scheduler owns.
+        NamedValue<n::threads, unsigned> threads;
+    };
+
+    extern template class Pimp<TaskScheduler>;
+    extern template class PALUDIS_VISIBLE Singleton<TaskScheduler>;
+
+    /**
+     * A shared pool of threads which run small tasks.
+     *
+     * Each scheduler thread has its own queue. Tasks spawned from inside a
+     * task go onto the spawning thread's queue, and idle threads steal from
+     * the other end of their neighbours' queues, so nested fork/join work
+     * spreads itself out without any central bottleneck.
+     *
+     * The scheduler runs at most as many tasks at once as the concurrency
+     * limit, which is taken from the PALUDIS_JOBS environment variable if it
+     * is set, and from the number of processors otherwise. A thread waiting
+     * in TaskGroup::wait counts towards that limit, and runs the group's
+     * tasks itself rather than blocking, so the scheduler owns one thread
+     * fewer than the limit. It never runs another group's tasks whilst
+     * waiting, so it is safe to wait whilst holding a lock.
+     *
+     * Tasks should not block for long periods on anything other than a
+     * TaskGroup, since doing so ties up one of a limited number of threads.
+     *
+     * \ingroup g_threads
+     * \since 3.0
+     */
+    class PALUDIS_VISIBLE TaskScheduler :
+        public Singleton<TaskScheduler>
+    {
+        friend class Singleton<TaskScheduler>;
+        friend class TaskGroup;
+
+        private:
+            Pimp<TaskScheduler> _imp;
+
+            TaskScheduler();
+            ~TaskScheduler();
+
+        public:
+            /**
+             * How many tasks can run at once.
+             */
+            unsigned concurrency() const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+            /**
+             * A snapshot of our counters.
+             */
+            TaskSchedulerStatistics statistics() const PALUDIS_ATTRIBUTE((warn_unused_result));
+    };
+
+    /**
+     * A collection of tasks which can be waited upon together.
+     *
+     * If a task throws, the first exception is kept, the rest of the group
+     * is cancelled, and the exception is rethrown by wait(). Cancelling a
+     * group stops any of its tasks which have not yet started from running;
+     * tasks which are already running can check cancelled() if they want to
+     * stop early.
+     *
+     * A group's tasks may spawn more tasks into the same group. Destroying a
+     * group without waiting for it cancels it and waits for anything that is
+     * already running.
+     *
+     * \ingroup g_threads
+     * \since 3.0
+     */
+    class PALUDIS_VISIBLE TaskGroup
+    {
+        private:
+            Pimp<TaskGroup> _imp;
+
+        public:
+            ///\name Basic operations
+            ///\{
+
+            TaskGroup();
+            ~TaskGroup();
+
+            TaskGroup(const TaskGroup &) = delete;
+            TaskGroup & operator= (const TaskGroup &) = delete;
+
+            ///\}
+
+            /**
+             * Queue a task to be run.
+             */
+            void spawn(const std::function<void ()> &);
+
+            /**
+             * Wait for every task in the group to finish, running the group's
+             * tasks ourself whilst we do so, and then rethrow the first
+             * exception any of them threw.
+             */
+            void wait();
+
+            /**
+             * Stop any tasks which have not started yet from running.
+             */
+            void cancel();
+
+            /**
+             * Has cancel been called, or has a task thrown?
+             */
+            bool cancelled() const PALUDIS_ATTRIBUTE((warn_unused_result));
+    };
+
+    /**
+     * Call f for every item in [begin, end), in parallel, and wait for all
+     * of the calls to finish.
+     *
+     * The range's iterators must remain valid until we return. If any call
+     * throws, calls which have not yet started are skipped, and the first
+     * exception is rethrown.
+     *
+     * \ingroup g_threads
+     * \since 3.0
+     */
+    template <typename Iter_, typename Func_>
+    void parallel_for_each(const Iter_ & begin, const Iter_ & end, const Func_ & f)
+    {
+        TaskGroup group;
+        for (Iter_ i(begin) ; i != end ; ++i)
+            group.spawn([&f, i] () { f(*i); });
+        group.wait();
+    }
+
+    extern template class Pimp<TaskGroup>;
+}
+
+#endif
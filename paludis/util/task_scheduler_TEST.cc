@@ -0,0 +1,130 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2026 agent
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <paludis/util/task_scheduler.hh>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace paludis;
+
+namespace
+{
+    struct Oops
+    {
+    };
+
+    unsigned long fib(unsigned n)
+    {
+        if (n < 2)
+            return n;
+
+        unsigned long a(0), b(0);
+        TaskGroup group;
+        group.spawn([&] () { a = fib(n - 1); });
+        b = fib(n - 2);
+        group.wait();
+        return a + b;
+    }
+}
+
+TEST(TaskScheduler, Concurrency)
+{
+    EXPECT_LE(1u, TaskScheduler::get_instance()->concurrency());
+    EXPECT_EQ(TaskScheduler::get_instance()->concurrency() - 1, TaskScheduler::get_instance()->statistics().threads());
+}
+
+TEST(TaskScheduler, ParallelForEach)
+{
+    std::vector<int> v(1000, 1);
+    std::atomic<int> total(0);
+    parallel_for_each(v.begin(), v.end(), [&] (int i) { total += i; });
+    EXPECT_EQ(1000, total.load());
+}
+
+TEST(TaskScheduler, Nested)
+{
+    unsigned long long tasks_before(TaskScheduler::get_instance()->statistics().tasks());
+    EXPECT_EQ(610u, fib(15));
+    EXPECT_LT(tasks_before, TaskScheduler::get_instance()->statistics().tasks());
+}
+
+TEST(TaskScheduler, Exceptions)
+{
+    std::atomic<int> run(0);
+    TaskGroup group;
+    group.spawn([&] () { ++run; throw Oops(); });
+    EXPECT_THROW(group.wait(), Oops);
+    EXPECT_TRUE(group.cancelled());
+
+    group.spawn([&] () { ++run; });
+    EXPECT_THROW(group.wait(), Oops);
+    EXPECT_EQ(1, run.load());
+}
+
+TEST(TaskScheduler, Cancel)
+{
+    std::atomic<int> run(0);
+    TaskGroup group;
+    group.cancel();
+    for (int i(0) ; i < 10 ; ++i)
+        group.spawn([&] () { ++run; });
+    group.wait();
+    EXPECT_EQ(0, run.load());
+}
+
+TEST(TaskScheduler, SpawnFromTask)
+{
+    std::atomic<int> run(0);
+    TaskGroup group;
+    for (int i(0) ; i < 10 ; ++i)
+        group.spawn([&] () {
+                ++run;
+                for (int j(0) ; j < 10 ; ++j)
+                    group.spawn([&] () { ++run; });
+                });
+    group.wait();
+    EXPECT_EQ(110, run.load());
+}
+
+TEST(TaskScheduler, WaitOnlyRunsOwnGroup)
+{
+    std::atomic<bool> waiting(false), ran_whilst_waiting(false);
+    std::thread::id waiter(std::this_thread::get_id());
+
+    TaskGroup other;
+    other.spawn([&] () {
+            if (waiting.load() && std::this_thread::get_id() == waiter)
+                ran_whilst_waiting.store(true);
+            });
+
+    TaskGroup group;
+    for (int i(0) ; i < 10 ; ++i)
+        group.spawn([] () { });
+
+    waiting.store(true);
+    group.wait();
+    waiting.store(false);
+
+    other.wait();
+    EXPECT_FALSE(ran_whilst_waiting.load());
+}
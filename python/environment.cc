@@ -29,6 +29,7 @@
 #include <paludis/hook.hh>
 #include <paludis/package_id.hh>
 #include <paludis/selection.hh>
+#include <paludis/columnar_query.hh>
 #include <paludis/spec_tree.hh>
 #include <paludis/filter.hh>
 #include <paludis/standard_output_manager.hh>
@@ -40,6 +41,7 @@
 #include <paludis/util/wrapped_forward_iterator.hh>
 #include <paludis/util/tribool.hh>
 #include <paludis/util/make_named_values.hh>
+#include <paludis/util/sequence.hh>
 
 using namespace paludis;
 using namespace paludis::python;
@@ -424,6 +426,32 @@ class EnvironmentImplementationWrapper :
         }
 };
 
+namespace
+{
+    bp::dict environment_query_columns(const Environment & env, const Selection & selection, const bp::object & fields)
+    {
+        std::shared_ptr<Sequence<std::string> > f(std::make_shared<Sequence<std::string> >());
+        for (bp::stl_input_iterator<std::string> i(fields), i_end ; i != i_end ; ++i)
+            f->push_back(*i);
+
+        ColumnarQuery q(env, selection, f);
+
+        bp::dict result;
+        for (unsigned c(0) ; c < q.number_of_columns() ; ++c)
+        {
+            bp::list column;
+            for (unsigned r(0) ; r < q.number_of_rows() ; ++r)
+                if (q.has_value(c, r))
+                    column.append(q.value(c, r));
+                else
+                    column.append(bp::object());
+            result[q.field(c)] = column;
+        }
+
+        return result;
+    }
+}
+
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(fetch_unique_qualified_package_name_overloads, fetch_unique_qualified_package_name, 1, 3)
 
 void expose_environment()
@@ -496,6 +524,15 @@ void expose_environment()
                 "Return PackageID instances matching a given selection."
             )
 
+        .def("query_columns", &environment_query_columns,
+                "query_columns(selection, list of str) -> dict of str to list\n"
+                "Return the named fields of every PackageID matching a given selection,\n"
+                "as a dict of lists with one item per PackageID. A field is one of 'id',\n"
+                "'name', 'category', 'package', 'version', 'slot', 'repository' or 'masked',\n"
+                "or the raw name of a metadata key. Values are str, or None where a\n"
+                "PackageID has no such key."
+            )
+
         .def("fetch_repository", fetch_repository_ptr, bp::with_custodian_and_ward_postcall<0, 1>(),
                 "fetch_repository(RepositoryName) -> Repository\n"
                 "Fetch a named repository."
@@ -62,6 +62,15 @@ class TestCase_01_Environments(unittest.TestCase):
         self.assert_(self.e.reduced_uid() >= 0)
         self.assert_(self.e.reduced_gid() >= 0)
 
+    def test_26_query_columns(self):
+        c = self.e.query_columns(Selection.AllVersionsSorted(Generator.Package(QualifiedPackageName("foo/bar"))),
+                ["name", "version", "repository", "SLOT", "NOT_A_KEY"])
+        self.assertEquals(c["name"], ["foo/bar", "foo/bar"])
+        self.assertEquals(c["version"], ["1.0", "2.0"])
+        self.assertEquals(c["repository"], ["testrepo", "testrepo"])
+        self.assertEquals(c["SLOT"], ["0", "0"])
+        self.assertEquals(c["NOT_A_KEY"], [None, None])
+
 class TestCase_03_TestEnvironment(unittest.TestCase):
     def test_01_create(self):
         e = TestEnvironment()
@@ -22,6 +22,7 @@
 #include <paludis/environments/paludis/paludis_environment.hh>
 #include <paludis/environments/test/test_environment.hh>
 #include <paludis/environment_factory.hh>
+#include <paludis/columnar_query.hh>
 #include <paludis/util/wrapped_forward_iterator.hh>
 #include <paludis/util/set.hh>
 #include <paludis/util/sequence.hh>
@@ -63,6 +64,55 @@ namespace
         }
     }
 
+    /*
+     * call-seq:
+     *     query_columns(Selection, Array of String) -> Hash
+     *
+     * Fetch the named fields of every PackageID matching the supplied Selection, as a Hash
+     * from field name to an Array with one String per PackageID, or nil where a PackageID
+     * has no such key. A field is one of 'id', 'name', 'category', 'package', 'version',
+     * 'slot', 'repository' or 'masked', or the raw name of a metadata key.
+     */
+    VALUE
+    environment_query_columns(VALUE self, VALUE selection, VALUE fields)
+    {
+        try
+        {
+            Check_Type(fields, T_ARRAY);
+            std::shared_ptr<Sequence<std::string> > f(std::make_shared<Sequence<std::string> >());
+            for (long i(0), i_end(RARRAY_LEN(fields)) ; i != i_end ; ++i)
+            {
+                VALUE entry(rb_ary_entry(fields, i));
+                StringValue(entry);
+                f->push_back(std::string(RSTRING_PTR(entry), RSTRING_LEN(entry)));
+            }
+
+            ColumnarQuery q(*value_to_environment(self), value_to_selection(selection), f);
+
+            VALUE result(rb_hash_new());
+            for (unsigned c(0) ; c < q.number_of_columns() ; ++c)
+            {
+                VALUE column(rb_ary_new());
+                for (unsigned r(0) ; r < q.number_of_rows() ; ++r)
+                    if (q.has_value(c, r))
+                    {
+                        const std::string & v(q.value(c, r));
+                        rb_ary_push(column, rb_str_new(v.data(), v.length()));
+                    }
+                    else
+                        rb_ary_push(column, Qnil);
+
+                const std::string & field(q.field(c));
+                rb_hash_aset(result, rb_str_new(field.data(), field.length()), column);
+            }
+            return result;
+        }
+        catch (const std::exception & e)
+        {
+            exception_to_ruby_exception(e);
+        }
+    }
+
     /*
      * call-seq:
      *     set(set_name) -> DepSpec
@@ -471,6 +521,7 @@ namespace
         rb_define_method(c_environment, "accept_keywords", RUBY_FUNC_CAST(&environment_accept_keywords), 2);
         rb_define_method(c_environment, "mirrors", RUBY_FUNC_CAST(&environment_mirrors), 1);
         rb_define_method(c_environment, "[]", RUBY_FUNC_CAST(&environment_square_brackets), 1);
+        rb_define_method(c_environment, "query_columns", RUBY_FUNC_CAST(&environment_query_columns), 2);
         rb_define_method(c_environment, "format_key",
                 RUBY_FUNC_CAST((&EnvironmentKey<MetadataValueKey<std::string> , &Environment::format_key>::fetch)), 0);
         rb_define_method(c_environment, "config_location_key",
@@ -228,6 +228,16 @@ module Paludis
             a = env[Selection::AllVersionsUnsorted.new(Generator::Matches.new(pda2, nil, []) | Filter::SupportsAction.new(ConfigAction))]
             assert a.empty?
         end
+
+        def test_query_columns
+            c = env.query_columns(Selection::AllVersionsSorted.new(Generator::Package.new('foo/bar')),
+                ['name', 'version', 'repository', 'NOT_A_KEY'])
+            assert_kind_of Hash, c
+            assert_equal ['foo/bar', 'foo/bar'], c['name']
+            assert_equal ['1.0', '2.0'], c['version']
+            assert_equal ['testrepo', 'testrepo'], c['repository']
+            assert_equal [nil, nil], c['NOT_A_KEY']
+        end
     end
 
     class TestCase_EnvironmentMetadataKeys < Test::Unit::TestCase
@@ -46,6 +46,7 @@
 #include <paludis/util/executor.hh>
 #include <paludis/util/timestamp.hh>
 #include <paludis/util/process.hh>
+#include <paludis/util/log.hh>
 #include <paludis/resolver/resolutions_by_resolvent.hh>
 #include <paludis/resolver/reason.hh>
 #include <paludis/resolver/sanitised_dependencies.hh>
@@ -1146,6 +1147,61 @@ namespace
         }
     };
 
+    /* every distfile an ID might fetch, whether or not its conditions are
+     * met, since a superset is fine for stopping two jobs fetching the same
+     * file at once */
+    struct DistfileNamesCollector
+    {
+        std::set<std::string> & names;
+
+        void visit(const FetchableURISpecTree::NodeType<AllDepSpec>::Type & node)
+        {
+            std::for_each(indirect_iterator(node.begin()), indirect_iterator(node.end()), accept_visitor(*this));
+        }
+
+        void visit(const FetchableURISpecTree::NodeType<ConditionalDepSpec>::Type & node)
+        {
+            std::for_each(indirect_iterator(node.begin()), indirect_iterator(node.end()), accept_visitor(*this));
+        }
+
+        void visit(const FetchableURISpecTree::NodeType<FetchableURIDepSpec>::Type & node)
+        {
+            names.insert(node.spec()->filename());
+        }
+
+        void visit(const FetchableURISpecTree::NodeType<URILabelsDepSpec>::Type &)
+        {
+        }
+    };
+
+    std::set<std::string> distfile_names(
+            const std::shared_ptr<Environment> & env,
+            const PackageDepSpec & spec)
+    {
+        Context context("When finding distfiles for '" + stringify(spec) + "':");
+
+        std::set<std::string> result;
+        try
+        {
+            const std::shared_ptr<const PackageIDSequence> ids((*env)[selection::BestVersionOnly(
+                        generator::Matches(spec, nullptr, { }))]);
+            for (const auto & id : *ids)
+                if (id->fetches_key())
+                {
+                    DistfileNamesCollector c{result};
+                    id->fetches_key()->parse_value()->top()->accept(c);
+                }
+        }
+        catch (const Exception & e)
+        {
+            /* the fetch itself will hit the same problem, and can report it */
+            Log::get_instance()->message("cave.execute_resolution.distfile_names", ll_debug, lc_context)
+                << "Not checking for shared distfiles due to exception '" << e.message() << "' (" << e.what() << ")";
+        }
+
+        return result;
+    }
+
     struct ExecuteJobExecutive :
         Executive
     {
@@ -1162,6 +1218,15 @@ namespace
         ExecuteCounts & counts;
         std::string & old_heading;
 
+        /* distfiles being fetched by running executives. Only touched by
+         * can_run and the exclusive methods, which the executor never calls
+         * concurrently. */
+        std::set<std::string> & claimed_distfiles;
+
+        /* worked out up front, because can_run is called with the executor's
+         * lock held */
+        const std::shared_ptr<const std::set<std::string> > distfiles;
+
         Timestamp last_flushed, last_output;
 
         std::recursive_mutex job_mutex;
@@ -1179,7 +1244,8 @@ namespace
                 std::mutex & m,
                 int & rc,
                 ExecuteCounts & k,
-                std::string & h) :
+                std::string & h,
+                std::set<std::string> & d) :
             env(e),
             cmdline(c),
             executor(x),
@@ -1192,6 +1258,8 @@ namespace
             local_retcode(0),
             counts(k),
             old_heading(h),
+            claimed_distfiles(d),
+            distfiles(find_distfiles(e, n, j)),
             last_flushed(Timestamp::now()),
             last_output(last_flushed),
             want(true),
@@ -1244,14 +1312,38 @@ namespace
                     return false;
             }
 
+            for (const auto & distfile : *distfiles)
+                if (claimed_distfiles.end() != claimed_distfiles.find(distfile))
+                    return false;
+
             return true;
         }
 
+        /* with a separate fetch queue, two jobs whose packages share a
+         * distfile could otherwise both be fetching it into the same place
+         * at once */
+        static const std::shared_ptr<const std::set<std::string> > find_distfiles(
+                const std::shared_ptr<Environment> & env,
+                const int n_fetch_jobs,
+                const std::shared_ptr<ExecuteJob> & job)
+        {
+            if (0 == n_fetch_jobs)
+                return std::make_shared<std::set<std::string> >();
+
+            return job->make_accept_returning(
+                    [&] (const UninstallJob &) { return std::make_shared<std::set<std::string> >(); },
+                    [&] (const InstallJob & j) { return std::make_shared<std::set<std::string> >(distfile_names(env, j.origin_id_spec())); },
+                    [&] (const FetchJob & j)   { return std::make_shared<std::set<std::string> >(distfile_names(env, j.origin_id_spec())); }
+                    );
+        }
+
         void pre_execute_exclusive() override
         {
             last_flushed = Timestamp::now();
             last_output = last_flushed;
 
+            claimed_distfiles.insert(distfiles->begin(), distfiles->end());
+
             ExistingStateVisitor initial_state;
 
             if (job->state())
@@ -1418,6 +1510,9 @@ namespace
 
         void post_execute_exclusive() override
         {
+            for (const auto & distfile : *distfiles)
+                claimed_distfiles.erase(distfile);
+
             if (want)
             {
                 ExecuteOneVisitor execute(env, cmdline, n_fetch_jobs, counts, job_mutex, executor.exclusivity_mutex(), x1_post, local_retcode);
@@ -1480,11 +1575,18 @@ namespace
                     + cmdline.execution_options.a_continue_on_failure.long_name() + "'");
 
         Executor executor(100);
+        if (n_fetch_jobs > 1)
+            executor.set_queue_limit("fetch", n_fetch_jobs);
+
+        /* a fetch which is waiting for someone else to finish getting a
+         * shared distfile shouldn't hold up every fetch behind it */
+        executor.set_queue_in_order("fetch", false);
 
         std::string old_heading;
+        std::set<std::string> claimed_distfiles;
         for (const auto & job : *lists->execute_job_list())
             executor.add(std::make_shared<ExecuteJobExecutive>(env, cmdline, executor, n_fetch_jobs, job, lists, require_if, retcode_mutex,
-                            retcode, counts, old_heading));
+                            retcode, counts, old_heading, claimed_distfiles));
 
         executor.execute();
 
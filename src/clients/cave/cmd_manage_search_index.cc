@@ -47,6 +47,10 @@
 #include <paludis/util/visitor_cast.hh>
 #include <paludis/util/iterator_funcs.hh>
 #include <paludis/util/stringify.hh>
+#include <paludis/util/task_scheduler.hh>
+#include <paludis/util/fs_path.hh>
+#include <paludis/util/fs_stat.hh>
+#include <paludis/util/timestamp.hh>
 
 #include <cstdlib>
 #include <iostream>
@@ -54,6 +58,7 @@
 #include <list>
 #include <map>
 #include <mutex>
+#include <vector>
 #include <unistd.h>
 
 #include "config.h"
@@ -198,6 +203,7 @@ namespace
     {
         args::ArgsGroup g_actions;
         args::SwitchArg a_create;
+        args::SwitchArg a_update;
 
         std::string app_name() const override
         {
@@ -213,17 +219,82 @@ namespace
         {
             return "Manages a search index for use by cave search. A search index is only valid until "
                 "a package is installed or uninstalled, or a sync is performed, or configuration is "
-                "changed.";
+                "changed. An existing index can be brought up to date using --update, which only "
+                "re-reads packages which have changed since the index was last written.";
         }
 
         ManageSearchIndexCommandLine() :
             g_actions(main_options_section(), "Actions", "Specify which action to perform. Exactly one action must be specified."),
             a_create(&g_actions, "create", 'c', "Create a new search index. The existing search index is removed if "
-                    "it already exists", true)
+                    "it already exists", true),
+            a_update(&g_actions, "update", 'u', "Update an existing search index, or create one if it does not "
+                    "already exist", true)
         {
             add_usage_line("--create ~/cave-search-index");
+            add_usage_line("--update ~/cave-search-index");
         }
     };
+
+    struct Candidate
+    {
+        std::string spec;
+        std::string repository;
+        std::string name;
+        std::string stamp;
+        bool is_visible;
+        bool changed;
+        std::string short_desc;
+        std::string long_desc;
+    };
+
+    std::string stamp_of(const FSPath & f)
+    {
+        FSStat s(f);
+        if (! s.exists())
+            return "";
+
+        Timestamp t(s.mtim());
+        return stringify(t.seconds()) + "." + stringify(t.nanoseconds());
+    }
+
+    /* an ID needs its descriptions re-reading if its file, or anything next
+     * to it such as metadata.xml, has changed. IDs without a location are
+     * always re-read. */
+    std::string stamp_for(const std::shared_ptr<const PackageID> & id)
+    {
+        if (! id->fs_location_key())
+            return "";
+
+        FSPath f(id->fs_location_key()->parse_value());
+        std::string s(stamp_of(f));
+        if (s.empty())
+            return "";
+
+        return s + ":" + stamp_of(f.dirname());
+    }
+
+    void read_candidate(const std::shared_ptr<const PackageID> & id, Candidate & candidate,
+            const std::map<std::string, std::string> & old_stamps, const DisplayCallback & display_callback)
+    {
+        candidate.spec = stringify(id->uniquely_identifying_spec());
+        candidate.repository = stringify(id->repository_name());
+        candidate.name = stringify(id->name());
+        candidate.stamp = stamp_for(id);
+        candidate.is_visible = ! id->masked();
+
+        auto o(old_stamps.find(candidate.spec));
+        candidate.changed = candidate.stamp.empty() || old_stamps.end() == o || o->second != candidate.stamp;
+
+        if (candidate.changed)
+        {
+            if (id->short_description_key())
+                candidate.short_desc = id->short_description_key()->parse_value();
+            if (id->long_description_key())
+                candidate.long_desc = id->long_description_key()->parse_value();
+        }
+
+        display_callback(ManageStep{"Reading"});
+    }
 }
 
 int
@@ -244,58 +315,73 @@ ManageSearchIndexCommand::run(
     if (capped_distance(cmdline.begin_parameters(), cmdline.end_parameters(), 2) != 1)
         throw args::DoHelp("manage-search-index requires exactly one parameter");
 
-    if (! cmdline.a_create.specified())
+    if (1 != cmdline.a_create.specified() + cmdline.a_update.specified())
         throw args::DoHelp("exactly one action must be specified");
 
     FSPath index_file(*cmdline.begin_parameters());
-    index_file.unlink();
+    if (cmdline.a_create.specified())
+        index_file.unlink();
 
     {
         DisplayCallback display_callback;
         ScopedNotifierCallback display_callback_holder(env.get(),
                 NotifierCallbackFunction(std::cref(display_callback)));
 
-        display_callback(ManageStep{"Creating DB"});
+        display_callback(ManageStep{"Opening DB"});
         CaveSearchExtrasDB * db(SearchExtrasHandle::get_instance()->create_db_function(stringify(index_file).c_str()));
 
+        std::map<std::string, std::string> old_stamps;
+        SearchExtrasHandle::get_instance()->find_stamps_function(db, old_stamps);
+
         display_callback(ManageStep{"Querying"});
         auto ids((*env)[selection::AllVersionsSorted(generator::All())]);
-        display_callback.total = display_callback.steps + std::distance(ids->begin(), ids->end()) + 1;
+        display_callback.total = display_callback.steps + 2 * std::distance(ids->begin(), ids->end()) + 1;
+
+        std::vector<Candidate> candidates(std::distance(ids->begin(), ids->end()));
+        {
+            TaskGroup group;
+            std::vector<Candidate>::iterator c(candidates.begin());
+            for (PackageIDSequence::ConstIterator i(ids->begin()), i_end(ids->end()) ; i != i_end ; ++i, ++c)
+                group.spawn(std::bind(&read_candidate, *i, std::ref(*c), std::cref(old_stamps), std::cref(display_callback)));
+            group.wait();
+        }
 
         SearchExtrasHandle::get_instance()->starting_adds_function(db);
 
         bool is_best(false), had_best_visible(false);
         std::string old_name;
-        for (auto i(ids->rbegin()), i_end(ids->rend()) ;
+        for (auto i(candidates.rbegin()), i_end(candidates.rend()) ;
                 i != i_end ; ++i)
         {
             display_callback(ManageStep{"Writing"});
 
-            std::string name(stringify((*i)->name())), short_desc, long_desc;
-            if ((*i)->short_description_key())
-                short_desc = (*i)->short_description_key()->parse_value();
-            if ((*i)->long_description_key())
-                long_desc = (*i)->long_description_key()->parse_value();
-
-            bool is_visible(! (*i)->masked());
-
-            if (name != old_name)
+            if (i->name != old_name)
             {
                 is_best = true;
                 had_best_visible = false;
-                old_name = name;
+                old_name = i->name;
             }
 
-            bool is_best_visible(is_visible && ! had_best_visible);
+            bool is_best_visible(i->is_visible && ! had_best_visible);
             if (is_best_visible)
                 had_best_visible = true;
 
-            SearchExtrasHandle::get_instance()->add_candidate_function(db, stringify((*i)->uniquely_identifying_spec()),
-                    is_visible, is_best, is_best_visible, name, short_desc, long_desc);
+            if (i->changed)
+                SearchExtrasHandle::get_instance()->add_candidate_function(db, i->spec, i->repository, i->stamp,
+                        i->is_visible, is_best, is_best_visible, i->name, i->short_desc, i->long_desc);
+            else
+                SearchExtrasHandle::get_instance()->update_candidate_flags_function(db, i->spec,
+                        i->is_visible, is_best, is_best_visible);
 
+            old_stamps.erase(i->spec);
             is_best = false;
         }
 
+        /* anything left over no longer exists */
+        for (auto s(old_stamps.begin()), s_end(old_stamps.end()) ;
+                s != s_end ; ++s)
+            SearchExtrasHandle::get_instance()->remove_candidate_function(db, s->first);
+
         display_callback(ManageStep{"Finalising"});
         SearchExtrasHandle::get_instance()->done_adds_function(db);
         SearchExtrasHandle::get_instance()->cleanup_db_function(db);
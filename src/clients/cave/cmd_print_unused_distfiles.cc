@@ -38,6 +38,7 @@
 #include <paludis/util/fs_iterator.hh>
 #include <paludis/util/indirect_iterator-impl.hh>
 #include <paludis/util/map.hh>
+#include <paludis/util/task_scheduler.hh>
 #include <paludis/util/visitor_cast.hh>
 #include <paludis/util/wrapped_forward_iterator.hh>
 
@@ -45,12 +46,13 @@
 #include <algorithm>
 #include <set>
 #include <list>
+#include <vector>
+#include <iterator>
 
 
 using namespace paludis;
 using namespace cave;
 using std::cout;
-using std::endl;
 
 namespace
 {
@@ -76,11 +78,21 @@ namespace
         args::ArgsGroup g_repository_options;
         args::StringSetArg a_include;
 
+        args::ArgsGroup g_display_options;
+        args::EnumArg a_format;
+
         PrintUnusedDistfilesCommandLine() :
             g_repository_options(main_options_section(), "Repository Options", "Alter how repositories are handled."),
             a_include(&g_repository_options, "include", 'i', "Treat all distfiles from IDs in the specified repository "
                     "as used. May be specified multiple times. Typically this is used for binary repositories, to avoid "
-                    "treating non-installed binary distfiles as unused.")
+                    "treating non-installed binary distfiles as unused."),
+            g_display_options(main_options_section(), "Display Options", "Controls the output format."),
+            a_format(&g_display_options, "format", 'f', "Select the output format.",
+                    args::EnumArg::EnumArgOptions
+                    ("lines",        'l', "Display one path per line")
+                    ("null",         '0', "Terminate each path with a null character rather than a newline, "
+                                          "for use with xargs -0 and similar"),
+                    "lines")
         {
             add_usage_line("[ --include mybinrepo ... ]");
         }
@@ -92,12 +104,12 @@ namespace
         private:
             const Environment * const env;
             const std::shared_ptr<const PackageID> id;
-            std::set<std::string> & files;
+            std::vector<std::string> & files;
 
         public:
             DistfilesFilter(const Environment * const e,
                     const std::shared_ptr<const PackageID> & i,
-                    std::set<std::string> & f) :
+                    std::vector<std::string> & f) :
                 env(e),
                 id(i),
                 files(f)
@@ -119,7 +131,7 @@ namespace
             void visit(const FetchableURISpecTree::NodeType<FetchableURIDepSpec>::Type & node)
             {
                 // found used distfile
-                files.insert(node.spec()->filename());
+                files.push_back(node.spec()->filename());
             }
 
             void visit(const FetchableURISpecTree::NodeType<URILabelsDepSpec>::Type &)
@@ -150,12 +162,16 @@ PrintUnusedDistfilesCommand::run(
     if (cmdline.begin_parameters() != cmdline.end_parameters())
         throw args::DoHelp("print-unused-distfiles takes no parameters");
 
+    char terminator('\n');
+    if (cmdline.a_format.argument() == "null")
+        terminator = '\0';
+    else if (cmdline.a_format.argument() != "lines")
+        throw args::DoHelp("bad value '" + cmdline.a_format.argument() + "' for --" + cmdline.a_format.long_name());
+
     //
     // Find all distfiles needed by installed packages
     //
 
-    std::set<std::string> used_distfiles;
-
     std::list<Selection> selections;
     selections.push_back(selection::AllVersionsUnsorted(generator::All() | filter::InstalledAtRoot(env->preferred_root_key()->parse_value())));
 
@@ -164,24 +180,38 @@ PrintUnusedDistfilesCommand::run(
         selections.push_back(selection::AllVersionsUnsorted(generator::InRepository(RepositoryName(*c))));
 
     std::set<std::shared_ptr<const PackageID>, PackageIDComparator> already_done((PackageIDComparator(env.get())));
+    std::vector<std::shared_ptr<const PackageID> > ids;
     for (auto & selection : selections)
     {
-        auto ids((*env)[selection]);
-
-        for (PackageIDSequence::ConstIterator iter(ids->begin()), end(ids->end()) ;
-                iter != end ; ++iter)
-        {
-            if (! already_done.insert(*iter).second)
-                continue;
+        auto selected((*env)[selection]);
+        for (const auto & id : *selected)
+            if (already_done.insert(id).second)
+                ids.push_back(id);
+    }
 
-            if ((*iter)->fetches_key())
-            {
-                DistfilesFilter filter(env.get(), *iter, used_distfiles);
-                (*iter)->fetches_key()->parse_value()->top()->accept(filter);
-            }
-        }
+    /* loading and parsing each ID's fetches is where the time goes, and IDs
+     * don't depend upon one another, so do them all at once, each into its
+     * own list */
+    std::vector<std::vector<std::string> > distfiles_for(ids.size());
+    {
+        TaskGroup group;
+        for (decltype(ids.size()) i(0), i_end(ids.size()) ; i != i_end ; ++i)
+            group.spawn([&, i] () {
+                    if (ids[i]->fetches_key())
+                    {
+                        DistfilesFilter filter(env.get(), ids[i], distfiles_for[i]);
+                        ids[i]->fetches_key()->parse_value()->top()->accept(filter);
+                    }
+                    });
+        group.wait();
     }
 
+    std::vector<std::string> used_distfiles;
+    for (auto & d : distfiles_for)
+        std::move(d.begin(), d.end(), std::back_inserter(used_distfiles));
+    std::sort(used_distfiles.begin(), used_distfiles.end());
+    used_distfiles.erase(std::unique(used_distfiles.begin(), used_distfiles.end()), used_distfiles.end());
+
     //
     // Find all distdirs
     //
@@ -205,14 +235,25 @@ PrintUnusedDistfilesCommand::run(
 
     for (const auto & distdir : distdirs)
     {
+        std::vector<std::pair<std::string, FSPath> > files;
         for (FSIterator file(distdir, {fsio_include_dotfiles, fsio_want_regular_files}), f_end ;
             file != f_end ; ++file)
+            files.push_back(std::make_pair(file->basename(), *file));
+        std::sort(files.begin(), files.end(), [] (const std::pair<std::string, FSPath> & a,
+                    const std::pair<std::string, FSPath> & b) { return a.first < b.first; });
+
+        /* both lists are sorted, so walk them together */
+        auto u(used_distfiles.begin()), u_end(used_distfiles.end());
+        for (const auto & file : files)
         {
-            if (used_distfiles.find(file->basename()) == used_distfiles.end())
-                cout << *file << endl;
+            u = std::lower_bound(u, u_end, file.first);
+            if (u == u_end || *u != file.first)
+                cout << file.second << terminator;
         }
     }
 
+    cout << std::flush;
+
     return EXIT_SUCCESS;
 }
 
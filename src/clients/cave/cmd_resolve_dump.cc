@@ -34,7 +34,9 @@
 #include <paludis/util/enum_iterator.hh>
 #include <paludis/util/indirect_iterator-impl.hh>
 #include <paludis/util/join.hh>
+#include <paludis/util/profiler.hh>
 #include <paludis/util/stringify.hh>
+#include <paludis/util/task_scheduler.hh>
 #include <paludis/util/wrapped_forward_iterator.hh>
 
 #include <iostream>
@@ -288,3 +290,28 @@ paludis::cave::dump_if_requested(
     dump(env, resolver, resolution_options);
 }
 
+void
+paludis::cave::profile_if_requested(
+        const ResolveCommandLineResolutionOptions & resolution_options)
+{
+    if (resolution_options.a_profile.argument() == "none")
+        return;
+
+    /* the scheduler is shared, so these cover everything it has done since
+     * we started, not just the resolution */
+    TaskSchedulerStatistics statistics(TaskScheduler::get_instance()->statistics());
+    Profiler::get_instance()->set_count("task_scheduler.threads", statistics.threads());
+    Profiler::get_instance()->set_count("task_scheduler.tasks", statistics.tasks());
+    Profiler::get_instance()->set_count("task_scheduler.steals", statistics.steals());
+    Profiler::get_instance()->set_count("task_scheduler.idle_ms", statistics.idle_microseconds() / 1000);
+
+    if (resolution_options.a_profile.argument() == "table")
+    {
+        std::cout << "Resolver profile:" << std::endl << std::endl;
+        Profiler::get_instance()->write_table(std::cout, 20);
+        std::cout << std::endl;
+    }
+    else if (resolution_options.a_profile.argument() == "json")
+        Profiler::get_instance()->write_json(std::cout, 20);
+}
+
@@ -32,6 +32,9 @@ namespace paludis
                 const std::shared_ptr<Environment> &,
                 const std::shared_ptr<resolver::Resolver> & resolver,
                 const ResolveCommandLineResolutionOptions & resolution_options);
+
+        void profile_if_requested(
+                const ResolveCommandLineResolutionOptions & resolution_options);
     }
 }
 
@@ -21,6 +21,7 @@
 #include "exceptions.hh"
 #include "colours.hh"
 #include "format_user_config.hh"
+#include <paludis/args/do_help.hh>
 #include <paludis/util/named_value.hh>
 #include <paludis/util/make_named_values.hh>
 #include <paludis/util/return_literal_function.hh>
@@ -61,6 +62,8 @@ namespace
     {
         args::ArgsGroup g_job_options;
         args::SwitchArg a_sequential;
+        args::IntegerArg a_jobs;
+        args::IntegerArg a_jobs_per_host;
 
         args::ArgsGroup g_sync_options;
         args::StringArg a_source;
@@ -86,6 +89,10 @@ namespace
         SyncCommandLine() :
             g_job_options(main_options_section(), "Job Options", "Job options."),
             a_sequential(&g_job_options, "sequential", '\0', "Only perform one sync at a time.", false),
+            a_jobs(&g_job_options, "jobs", '\0', "The maximum number of syncs to perform at once. Defaults to 0, "
+                    "meaning no limit."),
+            a_jobs_per_host(&g_job_options, "jobs-per-host", '\0', "The maximum number of repositories sharing a "
+                    "sync host to sync at once. Defaults to 1."),
 
             g_sync_options(main_options_section(), "Sync Options", "Sync options."),
             a_source(&g_sync_options, "source", 's', "Use the specified source for syncing."),
@@ -315,11 +322,20 @@ namespace
         {
             Executor executor;
 
+            if (cmdline.a_jobs.specified())
+                executor.set_active_limit(cmdline.a_jobs.argument());
+
             for (const auto & repo : repos)
             {
                 const std::shared_ptr<SyncExecutive> x(std::make_shared<SyncExecutive>(env, cmdline, &executor, repo));
                 executor.add(x);
                 executives.push_back(x);
+
+                /* repositories without a sync host all share the unnamed
+                 * queue, which always syncs one at a time */
+                std::string queue_name(x->queue_name());
+                if (cmdline.a_jobs_per_host.specified() && ! queue_name.empty())
+                    executor.set_queue_limit(queue_name, cmdline.a_jobs_per_host.argument());
             }
 
             executor.execute();
@@ -369,6 +385,12 @@ SyncCommand::run(
         return EXIT_SUCCESS;
     }
 
+    if (cmdline.a_jobs.specified() && cmdline.a_jobs.argument() < 0)
+        throw args::DoHelp("--" + cmdline.a_jobs.long_name() + " must not be negative");
+
+    if (cmdline.a_jobs_per_host.specified() && cmdline.a_jobs_per_host.argument() < 1)
+        throw args::DoHelp("--" + cmdline.a_jobs_per_host.long_name() + " must be at least 1");
+
     int retcode(0);
 
     Repos repos;
@@ -93,6 +93,9 @@ ResolveCommandLineResolutionOptions::ResolveCommandLineResolutionOptions(args::A
 
             "never"
             ),
+    a_decision_cache(&g_resolution_options, "decision-cache", '\0',
+            "Keep decisions in the specified file, and reuse them in later resolutions if nothing which "
+            "went into making them has changed. Decisions are only reused with the same resolution options."),
 
     g_dependent_options(this, "Dependent Options", "Dependent options. A package is dependent if it "
             "requires (or looks like it might require) a package which is being removed. By default, "
@@ -319,7 +322,15 @@ ResolveCommandLineResolutionOptions::ResolveCommandLineResolutionOptions(args::A
     g_dump_options(this, "Dump Options", "Dump the resolver's state to stdout after completion, or when an "
             "error occurs. For debugging purposes; produces rather a lot of noise."),
     a_dump(&g_dump_options, "dump", '\0', "Dump debug output", true),
-    a_dump_restarts(&g_dump_options, "dump-restarts", '\0', "Dump restarts", true)
+    a_dump_restarts(&g_dump_options, "dump-restarts", '\0', "Dump restarts", true),
+    a_profile(&g_dump_options, "profile", '\0', "Report where the resolver spent its time, how often its caches "
+            "were hit, which resolvents and selections were most expensive, and how busy the task scheduler was",
+            args::EnumArg::EnumArgOptions
+            ("none",                  'n', "Don't profile")
+            ("table",                 't', "As human readable tables")
+            ("json",                  'j', "As JSON"),
+            "none"
+            )
 {
 }
 
@@ -395,8 +406,7 @@ ResolveCommandLineExecutionOptions::ResolveCommandLineExecutionOptions(args::Arg
     a_fetch(&g_jobs_options, "fetch", 'f', "Skip any jobs that are not fetch jobs. Should be combined with "
             "--continue-on-failure if any of the packages to be merged have fetch dependencies.", true),
     a_fetch_jobs(&g_jobs_options, "fetch-jobs", 'J', "The number of parallel fetch jobs to launch. If set to 0, fetches "
-            "will be carried out sequentially with other jobs. Values higher than 1 are currently treated "
-            "as being 1. Defaults to 1, or if --fetch is specified, 0."),
+            "will be carried out sequentially with other jobs. Defaults to 1, or if --fetch is specified, 0."),
 
     g_phase_options(this, "Phase Options", "Options controlling which phases to execute. No sanity checking "
             "is done, allowing you to shoot as many feet off as you desire. Phase names do not have the "
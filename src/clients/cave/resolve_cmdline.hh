@@ -52,6 +52,7 @@ namespace paludis
             args::SwitchArg a_no_override_flags;
             args::StringSetArg a_no_restarts_for;
             args::EnumArg a_promote_binaries;
+            args::StringArg a_decision_cache;
 
             args::ArgsGroup g_dependent_options;
             args::StringSetArg a_uninstalls_may_break;
@@ -118,6 +119,7 @@ namespace paludis
             args::ArgsGroup g_dump_options;
             args::SwitchArg a_dump;
             args::SwitchArg a_dump_restarts;
+            args::EnumArg a_profile;
 
             void apply_shortcuts();
             void verify(const std::shared_ptr<const Environment> & env);
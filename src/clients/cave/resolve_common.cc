@@ -45,6 +45,8 @@
 #include <paludis/util/join.hh>
 #include <paludis/util/tribool.hh>
 #include <paludis/util/process.hh>
+#include <paludis/util/profiler.hh>
+#include <paludis/util/fs_path.hh>
 
 #include <paludis/args/do_help.hh>
 #include <paludis/args/escape.hh>
@@ -66,6 +68,7 @@
 #include <paludis/resolver/required_confirmations.hh>
 #include <paludis/resolver/make_uninstall_blocker.hh>
 #include <paludis/resolver/collect_depped_upon.hh>
+#include <paludis/resolver/dependents_index.hh>
 
 #include <paludis/resolver/allow_choice_changes_helper.hh>
 #include <paludis/resolver/allowed_to_remove_helper.hh>
@@ -92,6 +95,7 @@
 #include <paludis/resolver/remove_if_dependent_helper.hh>
 #include <paludis/resolver/prefer_or_avoid_helper.hh>
 #include <paludis/resolver/promote_binaries_helper.hh>
+#include <paludis/resolver/decision_cache.hh>
 
 #include <paludis/user_dep_spec.hh>
 #include <paludis/notifier_callback.hh>
@@ -187,6 +191,7 @@ namespace
             auto installed_ids((*env)[selection::AllVersionsSorted(
                         generator::All() |
                         installed_filter)]);
+            DependentsIndex dependents_index(env.get(), installed_ids);
 
             for (const auto & package : resolution_options.a_reinstall_dependents_of.args())
             {
@@ -197,7 +202,7 @@ namespace
 
                 for (const auto & id : *ids)
                 {
-                    auto dependents(collect_dependents(env.get(), id, installed_ids));
+                    auto dependents(collect_dependents(env.get(), id, dependents_index));
                     for (const auto & dependent : *dependents)
                     {
                         BlockDepSpec bs(make_uninstall_blocker(dependent->uniquely_identifying_spec()));
@@ -750,6 +755,35 @@ namespace
             return true;
         }
     };
+
+    std::shared_ptr<DecisionCache> make_decision_cache(
+            const std::shared_ptr<Environment> & env,
+            const ResolveCommandLineResolutionOptions & resolution_options)
+    {
+        if (! resolution_options.a_decision_cache.specified())
+            return nullptr;
+
+        /* anything which doesn't affect what we decide shouldn't stop us
+         * from reusing decisions */
+        std::string options;
+        for (const auto & group : resolution_options)
+        {
+            if (&group == &resolution_options.g_execution_options || &group == &resolution_options.g_dump_options)
+                continue;
+
+            for (const auto & option : group)
+            {
+                if (option == &resolution_options.a_decision_cache || ! option->specified())
+                    continue;
+
+                const std::shared_ptr<const Sequence<std::string> > f(option->forwardable_args());
+                for (const auto & arg : *f)
+                    options.append(arg + " ");
+            }
+        }
+
+        return std::make_shared<DecisionCache>(env.get(), FSPath(resolution_options.a_decision_cache.argument()), options);
+    }
 }
 
 int
@@ -1087,7 +1121,14 @@ paludis::cave::resolve_common(
                 n::remove_if_dependent_fn() = std::cref(remove_if_dependent_helper)
                 ));
 
+    if (resolution_options.a_profile.argument() != "none")
+        Profiler::get_instance()->enable();
+
+    const std::shared_ptr<DecisionCache> decision_cache(make_decision_cache(env, resolution_options));
+
     std::shared_ptr<Resolver> resolver(std::make_shared<Resolver>(env.get(), resolver_functions));
+    if (decision_cache)
+        resolver->set_decision_cache(decision_cache);
     bool is_set(false);
     std::shared_ptr<const Sequence<std::string> > targets_cleaned_up;
     std::list<SuggestRestart> restarts;
@@ -1129,14 +1170,20 @@ paludis::cave::resolve_common(
                     }
 
                     resolver->resolve();
+                    if (decision_cache)
+                        decision_cache->save();
                     break;
                 }
                 catch (const SuggestRestart & e)
                 {
                     restarts.push_back(e);
+                    if (Profiler::enabled())
+                        Profiler::get_instance()->add_count("resolver.restarts");
                     display_callback(ResolverRestart());
                     get_initial_constraints_for_helper.add_suggested_restart(e);
                     resolver = std::make_shared<Resolver>(env.get(), resolver_functions);
+                    if (decision_cache)
+                        resolver->set_decision_cache(decision_cache);
 
                     if (restarts.size() > 9000)
                         throw InternalError(PALUDIS_HERE, "Restarted over nine thousand times. Something's "
@@ -1150,6 +1197,7 @@ paludis::cave::resolve_common(
             display_restarts_if_requested(restarts, resolution_options);
 
         dump_if_requested(env, resolver, resolution_options);
+        profile_if_requested(resolution_options);
 
         retcode |= display_resolution(env, resolver->resolved(), resolution_options,
                 display_options, program_options, keys_if_import,
@@ -1197,6 +1245,7 @@ paludis::cave::resolve_common(
             display_restarts_if_requested(restarts, resolution_options);
 
         dump_if_requested(env, resolver, resolution_options);
+        profile_if_requested(resolution_options);
         throw;
     }
 
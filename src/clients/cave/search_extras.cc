@@ -24,37 +24,166 @@
 
 using namespace paludis;
 
+namespace
+{
+    /* bump this whenever the schema changes, and existing indexes will be
+     * recreated rather than updated */
+    const int schema_version = 3;
+
+    /* how many changes to make before committing and starting a new
+     * transaction */
+    const int changes_per_transaction = 1000;
+}
+
 struct CaveSearchExtrasDB
 {
     sqlite3 * db;
     sqlite3_stmt * add_candidate;
+    sqlite3_stmt * remove_candidate;
+    sqlite3_stmt * update_candidate_flags;
+
+    bool in_transaction;
+    int changes;
 };
 
+namespace
+{
+    void exec(CaveSearchExtrasDB * const data, const std::string & sql)
+    {
+        if (SQLITE_OK != sqlite3_exec(data->db, sql.c_str(), nullptr, nullptr, nullptr))
+            throw InternalError(PALUDIS_HERE, "sqlite3_exec '" + sql + "' failed: " + stringify(sqlite3_errmsg(data->db)));
+    }
+
+    void prepare(CaveSearchExtrasDB * const data, const std::string & sql, sqlite3_stmt * * const stmt)
+    {
+        if (SQLITE_OK != sqlite3_prepare_v2(data->db, sql.c_str(), -1, stmt, nullptr))
+            throw InternalError(PALUDIS_HERE, "sqlite3_prepare_v2 '" + sql + "' failed: " + stringify(sqlite3_errmsg(data->db)));
+    }
+
+    void reset(sqlite3_stmt * const stmt, const std::string & what)
+    {
+        if (SQLITE_OK != sqlite3_reset(stmt))
+            throw InternalError(PALUDIS_HERE, "sqlite3_reset " + what + " failed");
+        if (SQLITE_OK != sqlite3_clear_bindings(stmt))
+            throw InternalError(PALUDIS_HERE, "sqlite3_clear_bindings " + what + " failed");
+    }
+
+    void bind(sqlite3_stmt * const stmt, const int n, const std::string & v, const std::string & what)
+    {
+        if (SQLITE_OK != sqlite3_bind_text(stmt, n, v.c_str(), v.length(), SQLITE_TRANSIENT))
+            throw InternalError(PALUDIS_HERE, "sqlite3_bind_text " + what + " " + stringify(n) + " failed");
+    }
+
+    void bind(sqlite3_stmt * const stmt, const int n, const bool v, const std::string & what)
+    {
+        if (SQLITE_OK != sqlite3_bind_int(stmt, n, v ? 1 : 0))
+            throw InternalError(PALUDIS_HERE, "sqlite3_bind_int " + what + " " + stringify(n) + " failed");
+    }
+
+    void step(sqlite3_stmt * const stmt, const std::string & what)
+    {
+        int code;
+        if (SQLITE_DONE != (code = sqlite3_step(stmt)))
+            throw InternalError(PALUDIS_HERE, "sqlite3_step " + what + " failed: " + stringify(code));
+    }
+
+    int user_version(CaveSearchExtrasDB * const data)
+    {
+        sqlite3_stmt * stmt;
+        prepare(data, "pragma user_version", &stmt);
+
+        int result(0);
+        if (SQLITE_ROW == sqlite3_step(stmt))
+            result = sqlite3_column_int(stmt, 0);
+        sqlite3_finalize(stmt);
+
+        return result;
+    }
+
+    bool has_fts(CaveSearchExtrasDB * const data)
+    {
+        sqlite3_stmt * stmt;
+        prepare(data, "select 1 from sqlite_master where type = 'table' and name = 'candidates_fts'", &stmt);
+        bool result(SQLITE_ROW == sqlite3_step(stmt));
+        sqlite3_finalize(stmt);
+        return result;
+    }
+
+    void changed(CaveSearchExtrasDB * const data)
+    {
+        if (data->in_transaction && ++data->changes >= changes_per_transaction)
+        {
+            exec(data, "commit");
+            exec(data, "begin");
+            data->changes = 0;
+        }
+    }
+}
+
 extern "C"
 CaveSearchExtrasDB *
 cave_search_extras_create_db(const std::string & file)
 {
     auto data(cave_search_extras_open_db(file));
 
-    if (SQLITE_OK != sqlite3_exec(data->db, "drop table if exists candidates", nullptr, nullptr, nullptr))
-        throw InternalError(PALUDIS_HERE, "sqlite3_exec drop candidates failed");
+    if (schema_version != user_version(data))
+    {
+        exec(data, "drop table if exists candidates_fts");
+        exec(data, "drop table if exists candidates");
 
-    if (SQLITE_OK != sqlite3_exec(data->db, "create table candidates ( "
-                "spec text not null primary key, "
+        /* the full text index refers to rows by id, so that needs to be
+         * a real column which vacuum can't renumber */
+        exec(data, "create table candidates ( "
+                "id integer primary key, "
+                "spec text not null unique, "
+                "repository text not null, "
+                "stamp text not null, "
                 "is_visible int not null, "
                 "is_best int not_null, "
                 "is_best_visible int not_null, "
                 "name text not null, "
                 "short_desc text not null, "
                 "long_desc text not null"
-                ")", nullptr, nullptr, nullptr))
-        throw InternalError(PALUDIS_HERE, "sqlite3_exec create candidates failed");
+                ")");
+        exec(data, "create index candidates_repository on candidates ( repository )");
+
+        /* the trigram tokeniser lets the full text index answer substring
+         * queries, but needs sqlite 3.34 or later. Without it, we fall back
+         * to scanning the candidates table when searching. */
+        if (SQLITE_OK == sqlite3_exec(data->db, "create virtual table candidates_fts using fts5 ( "
+                    "name, short_desc, long_desc, "
+                    "content = 'candidates', content_rowid = 'id', tokenize = 'trigram' "
+                    ")", nullptr, nullptr, nullptr))
+        {
+            exec(data, "create trigger candidates_fts_insert after insert on candidates begin "
+                    "insert into candidates_fts ( rowid, name, short_desc, long_desc ) "
+                    "values ( new.id, new.name, new.short_desc, new.long_desc ); "
+                    "end");
+            exec(data, "create trigger candidates_fts_delete after delete on candidates begin "
+                    "insert into candidates_fts ( candidates_fts, rowid, name, short_desc, long_desc ) "
+                    "values ( 'delete', old.id, old.name, old.short_desc, old.long_desc ); "
+                    "end");
+            exec(data, "create trigger candidates_fts_update after update of name, short_desc, long_desc on candidates begin "
+                    "insert into candidates_fts ( candidates_fts, rowid, name, short_desc, long_desc ) "
+                    "values ( 'delete', old.id, old.name, old.short_desc, old.long_desc ); "
+                    "insert into candidates_fts ( rowid, name, short_desc, long_desc ) "
+                    "values ( new.id, new.name, new.short_desc, new.long_desc ); "
+                    "end");
+        }
+
+        exec(data, "pragma user_version = " + stringify(schema_version));
+    }
 
-    if (SQLITE_OK != sqlite3_prepare_v2(data->db, "insert into candidates "
-                "( spec, is_visible, is_best, is_best_visible, name, short_desc, long_desc ) "
-                "values ( ?1, ?2, ?3, ?4, ?5, ?6, ?7 )",
-                -1, &data->add_candidate, nullptr))
-        throw InternalError(PALUDIS_HERE, "sqlite3_prepare_v2 insert into candidates failed");
+    prepare(data, "insert into candidates "
+            "( spec, repository, stamp, is_visible, is_best, is_best_visible, name, short_desc, long_desc ) "
+            "values ( ?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9 )",
+            &data->add_candidate);
+
+    prepare(data, "delete from candidates where spec = ?1", &data->remove_candidate);
+
+    prepare(data, "update candidates set is_visible = ?2, is_best = ?3, is_best_visible = ?4 "
+            "where spec = ?1 and ( is_visible != ?2 or is_best != ?3 or is_best_visible != ?4 )",
+            &data->update_candidate_flags);
 
     return data;
 }
@@ -67,6 +196,10 @@ cave_search_extras_open_db(const std::string & file)
         throw InternalError(PALUDIS_HERE, "sqlite3_open failed");
 
     data->add_candidate = nullptr;
+    data->remove_candidate = nullptr;
+    data->update_candidate_flags = nullptr;
+    data->in_transaction = false;
+    data->changes = 0;
 
     return data;
 }
@@ -77,16 +210,46 @@ cave_search_extras_cleanup(CaveSearchExtrasDB * const data)
 {
     if (data->add_candidate)
         sqlite3_finalize(data->add_candidate);
+    if (data->remove_candidate)
+        sqlite3_finalize(data->remove_candidate);
+    if (data->update_candidate_flags)
+        sqlite3_finalize(data->update_candidate_flags);
 
     sqlite3_close(data->db);
     delete data;
 }
 
+extern "C"
+void
+cave_search_extras_find_stamps(CaveSearchExtrasDB * const data, std::map<std::string, std::string> & out)
+{
+    sqlite3_stmt * find_stamps;
+    prepare(data, "select spec, stamp from candidates", &find_stamps);
+
+    while (true)
+    {
+        int code(sqlite3_step(find_stamps));
+
+        if (code == SQLITE_DONE)
+            break;
+        else if (code == SQLITE_ROW)
+            out.insert(std::make_pair(
+                        std::string(reinterpret_cast<const char *>(sqlite3_column_text(find_stamps, 0))),
+                        std::string(reinterpret_cast<const char *>(sqlite3_column_text(find_stamps, 1)))));
+        else
+            throw InternalError(PALUDIS_HERE, "sqlite3_step select from candidates failed:" + stringify(code));
+    }
+
+    sqlite3_finalize(find_stamps);
+}
+
 extern "C"
 void
 cave_search_extras_add_candidate(
         CaveSearchExtrasDB * const data,
         const std::string & spec,
+        const std::string & repository,
+        const std::string & stamp,
         const bool visible,
         const bool best,
         const bool best_visible,
@@ -94,45 +257,75 @@ cave_search_extras_add_candidate(
         const std::string & short_desc,
         const std::string & long_desc)
 {
-    if (SQLITE_OK != sqlite3_reset(data->add_candidate))
-        throw InternalError(PALUDIS_HERE, "sqlite3_reset add candidate failed");
-    if (SQLITE_OK != sqlite3_clear_bindings(data->add_candidate))
-        throw InternalError(PALUDIS_HERE, "sqlite3_clear_bindings add candidate failed");
-
-    if (SQLITE_OK != sqlite3_bind_text(data->add_candidate, 1, spec.c_str(), spec.length(), SQLITE_TRANSIENT))
-        throw InternalError(PALUDIS_HERE, "sqlite3_bind_text add candidate 1 failed");
-    if (SQLITE_OK != sqlite3_bind_int(data->add_candidate, 2, visible ? 1 : 0))
-        throw InternalError(PALUDIS_HERE, "sqlite3_bind_text add candidate 2 failed");
-    if (SQLITE_OK != sqlite3_bind_int(data->add_candidate, 3, best ? 1 : 0))
-        throw InternalError(PALUDIS_HERE, "sqlite3_bind_text add candidate 3 failed");
-    if (SQLITE_OK != sqlite3_bind_int(data->add_candidate, 4, best_visible ? 1 : 0))
-        throw InternalError(PALUDIS_HERE, "sqlite3_bind_text add candidate 4 failed");
-    if (SQLITE_OK != sqlite3_bind_text(data->add_candidate, 5, name.c_str(), name.length(), SQLITE_TRANSIENT))
-        throw InternalError(PALUDIS_HERE, "sqlite3_bind_text add candidate 5 failed");
-    if (SQLITE_OK != sqlite3_bind_text(data->add_candidate, 6, short_desc.c_str(), short_desc.length(), SQLITE_TRANSIENT))
-        throw InternalError(PALUDIS_HERE, "sqlite3_bind_text add candidate 6 failed");
-    if (SQLITE_OK != sqlite3_bind_text(data->add_candidate, 7, long_desc.c_str(), long_desc.length(), SQLITE_TRANSIENT))
-        throw InternalError(PALUDIS_HERE, "sqlite3_bind_text add candidate 7 failed");
+    /* delete and insert rather than 'insert or replace', because replacing
+     * doesn't fire the delete trigger that keeps the full text index right */
+    reset(data->remove_candidate, "remove candidate");
+    bind(data->remove_candidate, 1, spec, "remove candidate");
+    step(data->remove_candidate, "remove candidate");
 
-    int code;
-    if (SQLITE_DONE != (code = sqlite3_step(data->add_candidate)))
-        throw InternalError(PALUDIS_HERE, "sqlite3_step failed: " + stringify(code));
+    reset(data->add_candidate, "add candidate");
+    bind(data->add_candidate, 1, spec, "add candidate");
+    bind(data->add_candidate, 2, repository, "add candidate");
+    bind(data->add_candidate, 3, stamp, "add candidate");
+    bind(data->add_candidate, 4, visible, "add candidate");
+    bind(data->add_candidate, 5, best, "add candidate");
+    bind(data->add_candidate, 6, best_visible, "add candidate");
+    bind(data->add_candidate, 7, name, "add candidate");
+    bind(data->add_candidate, 8, short_desc, "add candidate");
+    bind(data->add_candidate, 9, long_desc, "add candidate");
+    step(data->add_candidate, "add candidate");
+
+    changed(data);
+}
+
+extern "C"
+void
+cave_search_extras_update_candidate_flags(
+        CaveSearchExtrasDB * const data,
+        const std::string & spec,
+        const bool visible,
+        const bool best,
+        const bool best_visible)
+{
+    reset(data->update_candidate_flags, "update candidate flags");
+    bind(data->update_candidate_flags, 1, spec, "update candidate flags");
+    bind(data->update_candidate_flags, 2, visible, "update candidate flags");
+    bind(data->update_candidate_flags, 3, best, "update candidate flags");
+    bind(data->update_candidate_flags, 4, best_visible, "update candidate flags");
+    step(data->update_candidate_flags, "update candidate flags");
+
+    if (0 != sqlite3_changes(data->db))
+        changed(data);
+}
+
+extern "C"
+void
+cave_search_extras_remove_candidate(
+        CaveSearchExtrasDB * const data,
+        const std::string & spec)
+{
+    reset(data->remove_candidate, "remove candidate");
+    bind(data->remove_candidate, 1, spec, "remove candidate");
+    step(data->remove_candidate, "remove candidate");
+
+    changed(data);
 }
 
 extern "C"
 void
 cave_search_extras_starting_adds(CaveSearchExtrasDB * const data)
 {
-    if (SQLITE_OK != sqlite3_exec(data->db, "begin", nullptr, nullptr, nullptr))
-        throw InternalError(PALUDIS_HERE, "sqlite3_exec begin failed");
+    exec(data, "begin");
+    data->in_transaction = true;
+    data->changes = 0;
 }
 
 extern "C"
 void
 cave_search_extras_done_adds(CaveSearchExtrasDB * const data)
 {
-    if (SQLITE_OK != sqlite3_exec(data->db, "commit", nullptr, nullptr, nullptr))
-        throw InternalError(PALUDIS_HERE, "sqlite3_exec commit failed");
+    exec(data, "commit");
+    data->in_transaction = false;
 }
 
 extern "C"
@@ -155,7 +348,22 @@ cave_search_extras_find_candidates(CaveSearchExtrasDB * const data,
         s = "is_best";
 
     std::string h, p1;
-    if (! name_description_substring_hint.empty())
+    if (name_description_substring_hint.length() >= 3 && has_fts(data))
+    {
+        /* trigrams match substrings, so quote the hint as a phrase */
+        h = " and id in ( select rowid from candidates_fts where candidates_fts match ?1 )";
+
+        p1 = "\"";
+        for (auto i(name_description_substring_hint.begin()), i_end(name_description_substring_hint.end()) ;
+                i != i_end ; ++i)
+        {
+            if ('"' == *i)
+                p1.append(1, '"');
+            p1.append(1, *i);
+        }
+        p1.append("\"");
+    }
+    else if (! name_description_substring_hint.empty())
     {
         h = " and ( name like ?1 escape '\\' or short_desc like ?1 escape '\\' or long_desc like ?1 escape '\\' )";
 
@@ -23,6 +23,7 @@
 #include <paludis/util/attributes.hh>
 #include <string>
 #include <list>
+#include <map>
 
 struct CaveSearchExtrasDB;
 
@@ -34,9 +35,17 @@ extern "C" void cave_search_extras_cleanup(CaveSearchExtrasDB * const) PALUDIS_V
 
 extern "C" void cave_search_extras_starting_adds(CaveSearchExtrasDB * const) PALUDIS_VISIBLE;
 
+extern "C" void cave_search_extras_find_stamps(CaveSearchExtrasDB * const, std::map<std::string, std::string> &) PALUDIS_VISIBLE;
+
 extern "C" void cave_search_extras_add_candidate(CaveSearchExtrasDB * const, const std::string &,
+        const std::string &, const std::string &,
         const bool, const bool, const bool, const std::string &, const std::string &, const std::string &) PALUDIS_VISIBLE;
 
+extern "C" void cave_search_extras_update_candidate_flags(CaveSearchExtrasDB * const, const std::string &,
+        const bool, const bool, const bool) PALUDIS_VISIBLE;
+
+extern "C" void cave_search_extras_remove_candidate(CaveSearchExtrasDB * const, const std::string &) PALUDIS_VISIBLE;
+
 extern "C" void cave_search_extras_done_adds(CaveSearchExtrasDB * const) PALUDIS_VISIBLE;
 
 extern "C" void cave_search_extras_find_candidates(CaveSearchExtrasDB * const, std::list<std::string> &,
@@ -42,8 +42,11 @@ SearchExtrasHandle::SearchExtrasHandle() :
     create_db_function(nullptr),
     open_db_function(nullptr),
     cleanup_db_function(nullptr),
+    find_stamps_function(nullptr),
     starting_adds_function(nullptr),
     add_candidate_function(nullptr),
+    update_candidate_flags_function(nullptr),
+    remove_candidate_function(nullptr),
     done_adds_function(nullptr),
     find_candidates_function(nullptr)
 {
@@ -66,10 +69,22 @@ SearchExtrasHandle::SearchExtrasHandle() :
     if (! cleanup_db_function)
         throw args::DoHelp("Search index not available because dlsym said " + stringify(::dlerror()));
 
+    find_stamps_function = STUPID_CAST(FindStampsFunction, ::dlsym(handle, "cave_search_extras_find_stamps"));
+    if (! find_stamps_function)
+        throw args::DoHelp("Search index creation not available because dlsym said " + stringify(::dlerror()));
+
     add_candidate_function = STUPID_CAST(AddCandidateFunction, ::dlsym(handle, "cave_search_extras_add_candidate"));
     if (! add_candidate_function)
         throw args::DoHelp("Search index creation not available because dlsym said " + stringify(::dlerror()));
 
+    update_candidate_flags_function = STUPID_CAST(UpdateCandidateFlagsFunction, ::dlsym(handle, "cave_search_extras_update_candidate_flags"));
+    if (! update_candidate_flags_function)
+        throw args::DoHelp("Search index creation not available because dlsym said " + stringify(::dlerror()));
+
+    remove_candidate_function = STUPID_CAST(RemoveCandidateFunction, ::dlsym(handle, "cave_search_extras_remove_candidate"));
+    if (! remove_candidate_function)
+        throw args::DoHelp("Search index creation not available because dlsym said " + stringify(::dlerror()));
+
     starting_adds_function = STUPID_CAST(StartingAddsFunction, ::dlsym(handle, "cave_search_extras_starting_adds"));
     if (! starting_adds_function)
         throw args::DoHelp("Search index creation not available because dlsym said " + stringify(::dlerror()));
@@ -22,6 +22,7 @@
 
 #include <paludis/util/singleton.hh>
 #include <list>
+#include <map>
 #include <string>
 
 struct CaveSearchExtrasDB;
@@ -38,8 +39,14 @@ namespace paludis
 
             typedef void (* CleanupDBFunction)(CaveSearchExtrasDB * const);
 
+            typedef void (* FindStampsFunction)(CaveSearchExtrasDB * const, std::map<std::string, std::string> &);
+
             typedef void (* AddCandidateFunction)(CaveSearchExtrasDB * const, const std::string &,
+                    const std::string &, const std::string &,
                     const bool, const bool, const bool, const std::string &, const std::string &, const std::string &);
+            typedef void (* UpdateCandidateFlagsFunction)(CaveSearchExtrasDB * const, const std::string &,
+                    const bool, const bool, const bool);
+            typedef void (* RemoveCandidateFunction)(CaveSearchExtrasDB * const, const std::string &);
             typedef void (* StartingAddsFunction)(CaveSearchExtrasDB * const);
             typedef void (* DoneAddsFunction)(CaveSearchExtrasDB * const);
 
@@ -53,8 +60,12 @@ namespace paludis
 
             CleanupDBFunction cleanup_db_function;
 
+            FindStampsFunction find_stamps_function;
+
             StartingAddsFunction starting_adds_function;
             AddCandidateFunction add_candidate_function;
+            UpdateCandidateFlagsFunction update_candidate_flags_function;
+            RemoveCandidateFunction remove_candidate_function;
             DoneAddsFunction done_adds_function;
 
             FindCandidatesFunction find_candidates_function;